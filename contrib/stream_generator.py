@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+##
+## This file is part of the PulseView project.
+##
+## This program is free software; you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation; either version 2 of the License, or
+## (at your option) any later version.
+##
+## This program is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with this program; if not, see <http://www.gnu.org/licenses/>.
+##
+
+"""
+Sample front-end for PulseView's sample streams, see
+pv/devices/streamdevice.hpp for the stream format.
+
+Channel n toggles every 2^n samples, i.e. the samples count upwards.
+
+Serve the samples on a Unix domain socket, one stream per acquisition:
+    stream_generator.py /tmp/pv.sock
+Write the samples to a named pipe, which is created if needed:
+    stream_generator.py --fifo /tmp/pv.fifo
+
+Then use "Connect to Stream..." in PulseView with the same path.
+"""
+
+import argparse
+import os
+import socket
+import stat
+import struct
+import time
+
+MAGIC = b'PVSTREAM'
+VERSION = 1
+
+def header(samplerate, unit_size, channels):
+    data = MAGIC + struct.pack('<IQII', VERSION, samplerate, unit_size,
+        len(channels))
+    for name in channels:
+        encoded = name.encode('utf-8')
+        data += struct.pack('<I', len(encoded)) + encoded
+    return data
+
+def blocks(args):
+    """Yields blocks of samples until args.samples were generated."""
+    mask = (1 << args.channels) - 1
+    block_samples = 65536
+    sample = 0
+    while args.samples == 0 or sample < args.samples:
+        count = block_samples
+        if args.samples:
+            count = min(count, args.samples - sample)
+        yield b''.join((((sample + i) & mask).to_bytes(args.unit_size,
+            'little') for i in range(count)))
+        sample += count
+        if args.rate:
+            time.sleep(count / args.rate)
+
+def stream(out, args):
+    names = ['D%d' % i for i in range(args.channels)]
+    out(header(args.samplerate, args.unit_size, names))
+    for block in blocks(args):
+        out(block)
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('path', help='socket or named pipe to create')
+    parser.add_argument('--fifo', action='store_true',
+        help='write to a named pipe instead of serving a socket')
+    parser.add_argument('--samplerate', type=int, default=1000000,
+        help='samplerate announced in the header (default: %(default)s)')
+    parser.add_argument('--unit-size', type=int, default=1,
+        help='bytes per sample (default: %(default)s)')
+    parser.add_argument('--channels', type=int, default=8,
+        help='number of channels (default: %(default)s)')
+    parser.add_argument('--samples', type=int, default=1000000,
+        help='samples per stream, 0 for endless (default: %(default)s)')
+    parser.add_argument('--rate', type=float, default=0,
+        help='samples per second to send, 0 for unthrottled')
+    args = parser.parse_args()
+
+    if not 1 <= args.channels <= args.unit_size * 8:
+        parser.error('the channels must fit into the unit size')
+
+    if args.fifo:
+        if not (os.path.exists(args.path) and
+                stat.S_ISFIFO(os.stat(args.path).st_mode)):
+            os.mkfifo(args.path)
+        while True:
+            # Blocks until PulseView opened the pipe
+            with open(args.path, 'wb') as f:
+                try:
+                    stream(f.write, args)
+                except BrokenPipeError:
+                    pass
+
+    if os.path.exists(args.path):
+        os.unlink(args.path)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(args.path)
+    server.listen(1)
+    try:
+        while True:
+            conn, _ = server.accept()
+            with conn:
+                try:
+                    stream(conn.sendall, args)
+                except (BrokenPipeError, ConnectionResetError):
+                    pass
+    finally:
+        os.unlink(args.path)
+
+if __name__ == '__main__':
+    main()
@@ -22,6 +22,7 @@
 #endif
 
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <getopt.h>
 #include <vector>
@@ -40,6 +41,8 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
 
 #include "config.h"
 
@@ -54,6 +57,11 @@
 #endif
 
 #include "pv/application.hpp"
+#ifdef ENABLE_DECODE
+#include "pv/batchdecoder.hpp"
+#include "pv/decodercatalog.hpp"
+#include "pv/data/decode/worker.hpp"
+#endif
 #include "pv/devicemanager.hpp"
 #include "pv/globalsettings.hpp"
 #include "pv/logging.hpp"
@@ -165,6 +173,14 @@ void usage()
 		"  -s, --settings                  Load PulseView session setup from file\n"
 		"  -I, --input-format              Input format\n"
 		"  -c, --clean                     Don't restore previous sessions on startup\n"
+		"\n"
+		"Batch Decode Options:\n"
+		"  -b, --batch                     Decode the input files without GUI, using the\n"
+		"                                  decoders of the session setup (-s or <FILE>.pvs)\n"
+		"  -o, --output                    Directory to write the decoder output to, or -\n"
+		"                                  for stdout (default)\n"
+		"  -B, --binary-output             Write binary decoder output, not annotations\n"
+		"  -j, --jobs                      Number of files to decode in parallel\n"
 		"\n", PV_BIN_NAME);
 }
 
@@ -177,6 +193,16 @@ int main(int argc, char *argv[])
 	bool restore_sessions = true;
 	bool do_scan = true;
 	bool show_version = false;
+	bool batch_mode = false;
+	bool binary_output = false;
+	string batch_output = "-";
+	int batch_jobs = QThread::idealThreadCount();
+
+#ifdef ENABLE_DECODE
+	// Decoder worker processes only need libsigrokdecode, see pv::data::decode::Worker
+	if ((argc == 2) && !strcmp(argv[1], pv::data::decode::Worker::Argument))
+		return pv::data::decode::Worker::run();
+#endif
 
 #ifdef ENABLE_FLOW
 	// Initialise gstreamermm. Must be called before any other GLib stuff.
@@ -186,6 +212,13 @@ int main(int argc, char *argv[])
 	Srf::init();
 #endif
 
+	// Batch mode must also work without a display, so unless the user chose
+	// a Qt platform plugin, use one that doesn't need one
+	for (int i = 1; i < argc; i++)
+		if ((!strcmp(argv[i], "-b") || !strcmp(argv[i], "--batch")) &&
+			!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+			qputenv("QT_QPA_PLATFORM", "offscreen");
+
 	Application a(argc, argv);
 
 #ifdef ANDROID
@@ -206,12 +239,16 @@ int main(int argc, char *argv[])
 			{"settings", required_argument, nullptr, 's'},
 			{"input-format", required_argument, nullptr, 'I'},
 			{"clean", no_argument, nullptr, 'c'},
+			{"batch", no_argument, nullptr, 'b'},
+			{"output", required_argument, nullptr, 'o'},
+			{"binary-output", no_argument, nullptr, 'B'},
+			{"jobs", required_argument, nullptr, 'j'},
 			{"log-to-stdout", no_argument, nullptr, 's'},
 			{nullptr, 0, nullptr, 0}
 		};
 
 		const int c = getopt_long(argc, argv,
-			"h?VDcl:d:i:s:I:", long_options, nullptr);
+			"h?VDcbBl:d:i:s:I:o:j:", long_options, nullptr);
 		if (c == -1)
 			break;
 
@@ -269,6 +306,26 @@ int main(int argc, char *argv[])
 		case 'c':
 			restore_sessions = false;
 			break;
+
+		case 'b':
+			batch_mode = true;
+			break;
+
+		case 'o':
+			batch_output = optarg;
+			break;
+
+		case 'B':
+			binary_output = true;
+			break;
+
+		case 'j':
+			batch_jobs = atoi(optarg);
+			if (batch_jobs < 1) {
+				qDebug() << "ERROR: invalid number of jobs.";
+				return 1;
+			}
+			break;
 		}
 	}
 	argc -= optind;
@@ -277,6 +334,22 @@ int main(int argc, char *argv[])
 	for (int i = 0; i < argc; i++)
 		open_files.emplace_back(argv[i]);
 
+	if (batch_mode) {
+#ifdef ENABLE_DECODE
+		if (open_files.empty()) {
+			qDebug() << "ERROR: batch mode requires at least one input file.";
+			return 1;
+		}
+
+		// Scanning for hardware is of no use when decoding files
+		do_scan = false;
+		a.set_headless(true);
+#else
+		qDebug() << "ERROR: batch mode requires protocol decoder support.";
+		return 1;
+#endif
+	}
+
 	qRegisterMetaType<uint64_t>("uint64_t");
 	qRegisterMetaType<pv::util::Timestamp>("util::Timestamp");
 	qRegisterMetaType<SharedPtrToSegment>("SharedPtrToSegment");
@@ -321,8 +394,12 @@ int main(int argc, char *argv[])
 			break;
 		}
 
-		// Load the protocol decoders
-		srd_decoder_load_all();
+		// Read the protocol decoder metadata. The decoders themselves are
+		// loaded when they're first used. Batch mode doesn't need the metadata.
+		if (!batch_mode)
+			pv::decoder_catalog.init();
+		if (show_version)
+			pv::decoder_catalog.wait();
 #endif
 
 #ifndef ENABLE_STACKTRACE
@@ -335,6 +412,19 @@ int main(int argc, char *argv[])
 		a.collect_version_info(device_manager);
 		if (show_version) {
 			a.print_version_info();
+#ifdef ENABLE_DECODE
+		} else if (batch_mode) {
+			pv::BatchDecoder batch_decoder(device_manager, open_files,
+				open_file_format, open_setup_file, batch_output, binary_output,
+				batch_jobs);
+
+			QObject::connect(&batch_decoder, &pv::BatchDecoder::finished,
+				&a, &QCoreApplication::quit, Qt::QueuedConnection);
+			QTimer::singleShot(0, &batch_decoder, &pv::BatchDecoder::start);
+
+			a.exec();
+			ret = (batch_decoder.failed_count() > 0) ? 1 : 0;
+#endif
 		} else {
 			// Initialise the main window
 			pv::MainWindow w(device_manager);
@@ -371,6 +461,7 @@ int main(int argc, char *argv[])
 
 #ifdef ENABLE_DECODE
 		// Destroy libsigrokdecode
+		pv::decoder_catalog.stop();
 		srd_exit();
 #endif
 
@@ -37,6 +37,9 @@
 #endif
 
 #include <pv/exprtk.hpp>
+#ifdef ENABLE_DECODE
+#include <pv/decodercatalog.hpp>
+#endif
 
 #include "application.hpp"
 #include "config.h"
@@ -47,19 +50,9 @@ using std::endl;
 using std::exception;
 using std::shared_ptr;
 
-#ifdef ENABLE_DECODE
-static gint sort_pds(gconstpointer a, gconstpointer b)
-{
-	const struct srd_decoder *sda, *sdb;
-
-	sda = (const struct srd_decoder *)a;
-	sdb = (const struct srd_decoder *)b;
-	return strcmp(sda->id, sdb->id);
-}
-#endif
-
 Application::Application(int &argc, char* argv[]) :
-	QApplication(argc, argv)
+	QApplication(argc, argv),
+	headless_(false)
 {
 	setApplicationVersion(PV_VERSION_STRING);
 	setApplicationName("PulseView");
@@ -149,6 +142,16 @@ void Application::on_setting_changed(const QString &key, const QVariant &value)
 		switch_language(value.toString());
 }
 
+bool Application::is_headless() const
+{
+	return headless_;
+}
+
+void Application::set_headless(bool headless)
+{
+	headless_ = headless;
+}
+
 void Application::collect_version_info(pv::DeviceManager &device_manager)
 {
 	// Library versions and features
@@ -181,8 +184,6 @@ void Application::collect_version_info(pv::DeviceManager &device_manager)
 	g_free(scpi_backends);
 
 #ifdef ENABLE_DECODE
-	struct srd_decoder *dec;
-
 	version_info_.emplace_back("libsigrokdecode", QString("%1/%2 (rt: %3/%4)")
 		.arg(SRD_PACKAGE_VERSION_STRING, SRD_LIB_VERSION_STRING,
 		srd_package_version_string_get(), srd_lib_version_string_get()));
@@ -231,18 +232,6 @@ void Application::collect_version_info(pv::DeviceManager &device_manager)
 	for (auto& entry : device_manager.context()->output_formats())
 		output_format_list_.emplace_back(QString::fromUtf8(entry.first.c_str()),
 			QString::fromUtf8(entry.second->description().c_str()));
-
-	// Protocol decoders
-#ifdef ENABLE_DECODE
-	GSList *sl = g_slist_copy((GSList *)srd_decoder_list());
-	sl = g_slist_sort(sl, sort_pds);
-	for (const GSList *l = sl; l; l = l->next) {
-		dec = (struct srd_decoder *)l->data;
-		pd_list_.emplace_back(QString::fromUtf8(dec->id),
-			QString::fromUtf8(dec->longname));
-	}
-	g_slist_free(sl);
-#endif
 }
 
 void Application::print_version_info()
@@ -278,7 +267,7 @@ void Application::print_version_info()
 
 #ifdef ENABLE_DECODE
 	cout << endl << "Supported protocol decoders:" << endl;
-	for (pair<QString, QString>& entry : pd_list_)
+	for (pair<QString, QString>& entry : get_pd_list())
 		cout << "  " << entry.first.leftJustified(21, ' ').toStdString() <<
 		entry.second.toStdString() << endl;
 #endif
@@ -316,7 +305,15 @@ vector< pair<QString, QString> > Application::get_output_format_list() const
 
 vector< pair<QString, QString> > Application::get_pd_list() const
 {
-	return pd_list_;
+	vector< pair<QString, QString> > pd_list;
+
+	// Queried on demand as the metadata may still be loading in the background
+#ifdef ENABLE_DECODE
+	for (const pv::DecoderCatalog::Info& info : pv::decoder_catalog.decoders())
+		pd_list.emplace_back(info.id, info.longname);
+#endif
+
+	return pd_list;
 }
 
 bool Application::notify(QObject *receiver, QEvent *event)
@@ -48,6 +48,13 @@ public:
 
 	void on_setting_changed(const QString &key, const QVariant &value);
 
+	/**
+	 * When running headless (e.g. in batch mode), errors are only logged
+	 * instead of being shown in message boxes.
+	 */
+	bool is_headless() const;
+	void set_headless(bool headless);
+
 	void collect_version_info(pv::DeviceManager &device_manager);
 	void print_version_info();
 
@@ -68,7 +75,8 @@ private:
 	vector< pair<QString, QString> > driver_list_;
 	vector< pair<QString, QString> > input_format_list_;
 	vector< pair<QString, QString> > output_format_list_;
-	vector< pair<QString, QString> > pd_list_;
+
+	bool headless_;
 
 	QTranslator app_translator_, qt_translator_, qtbase_translator_;
 };
@@ -0,0 +1,344 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "batchdecoder.hpp"
+#include "globalsettings.hpp"
+#include "session.hpp"
+
+#include <pv/data/decodesignal.hpp>
+#include <pv/data/decode/decoder.hpp>
+
+using std::all_of;
+using std::dynamic_pointer_cast;
+using std::make_shared;
+
+using pv::data::DecodeBinaryClass;
+using pv::data::DecodeSignal;
+using pv::data::SignalBase;
+using pv::data::decode::Annotation;
+using pv::data::decode::DecodeBinaryClassInfo;
+using pv::data::decode::Decoder;
+
+namespace pv {
+
+const string BatchDecoder::StdoutDestination = "-";
+
+BatchDecoder::BatchDecoder(DeviceManager &device_manager,
+	const vector<string> &file_names, const string &format,
+	const string &setup_file_name, const string &output, bool binary_output,
+	unsigned int max_jobs) :
+	device_manager_(device_manager),
+	format_(format),
+	setup_file_name_(setup_file_name),
+	output_(QString::fromStdString(output)),
+	binary_output_(binary_output),
+	max_jobs_(max_jobs > 0 ? max_jobs : 1),
+	// Make the output of different files distinguishable on stdout
+	prefix_output_((output == StdoutDestination) && (file_names.size() > 1)),
+	pending_files_(file_names.begin(), file_names.end()),
+	failed_count_(0)
+{
+}
+
+BatchDecoder::~BatchDecoder()
+{
+	// Destroying the sessions stops their acquisition and decoding threads
+	running_jobs_.clear();
+}
+
+void BatchDecoder::start()
+{
+	if ((output_.toStdString() != StdoutDestination) && !QDir().mkpath(output_)) {
+		qWarning() << "Batch decode: Can't create output directory" << output_;
+		failed_count_ += pending_files_.size();
+		pending_files_.clear();
+	}
+
+	start_next_jobs();
+}
+
+unsigned int BatchDecoder::failed_count() const
+{
+	return failed_count_;
+}
+
+void BatchDecoder::start_next_jobs()
+{
+	while ((running_jobs_.size() < max_jobs_) && !pending_files_.empty()) {
+		const string file_name = pending_files_.front();
+		pending_files_.pop_front();
+		start_job(file_name);
+	}
+
+	if (running_jobs_.empty() && pending_files_.empty())
+		finished();
+}
+
+void BatchDecoder::start_job(const string &file_name)
+{
+	const QString name = QString::fromStdString(file_name);
+
+	shared_ptr<Job> job = make_shared<Job>();
+	job->file_name = file_name;
+	job->output_name = QFileInfo(name).completeBaseName();
+	job->session = make_shared<Session>(device_manager_, name);
+	job->capture_stopped = false;
+	running_jobs_.push_back(job);
+
+	connect(job->session.get(), SIGNAL(capture_state_changed(int)),
+		this, SLOT(on_capture_state_changed(int)));
+	// Errors may be raised while loading the file, so defer handling them
+	connect(job->session.get(), SIGNAL(session_error_raised(const QString, const QString)),
+		this, SLOT(on_session_error_raised(const QString, const QString)),
+		Qt::QueuedConnection);
+
+	qDebug() << "Batch decode: Processing" << name;
+
+	// This also restores the decoder stack from the setup file and starts
+	// the acquisition, which in turn makes the decoders start decoding
+	job->session->load_init_file(file_name, format_, setup_file_name_);
+
+	if (!job->session->device()) {
+		finish_job(job, tr("Failed to load file"));
+		return;
+	}
+
+	for (const shared_ptr<SignalBase>& base : job->session->signalbases()) {
+		shared_ptr<DecodeSignal> signal = dynamic_pointer_cast<DecodeSignal>(base);
+		if (!signal)
+			continue;
+
+		job->decode_signals.push_back(signal);
+
+		connect(signal.get(), SIGNAL(decode_finished()),
+			this, SLOT(on_decode_finished()));
+		connect(signal.get(), SIGNAL(error_message_changed(QString)),
+			this, SLOT(on_error_message_changed(QString)));
+	}
+
+	if (job->decode_signals.empty()) {
+		finish_job(job, tr("No protocol decoders are set up for this file"));
+		return;
+	}
+
+	// Small files may have been decoded completely before the signals above
+	// were connected, so check for that now
+	check_job(job);
+}
+
+void BatchDecoder::finish_job(shared_ptr<Job> job, const QString &error)
+{
+	bool success = error.isEmpty();
+
+	if (success)
+		success = binary_output_ ? write_binary_data(*job) : write_annotations(*job);
+
+	if (!success) {
+		failed_count_++;
+		qWarning().nospace() << "Batch decode: Failed to decode " <<
+			QString::fromStdString(job->file_name) << ": " <<
+			(error.isEmpty() ? tr("Output could not be written") : error);
+	}
+
+	// Free the session and its data before the next file is loaded
+	running_jobs_.remove(job);
+}
+
+void BatchDecoder::check_job(shared_ptr<Job> job)
+{
+	const bool all_finished = all_of(job->decode_signals.begin(),
+		job->decode_signals.end(), [](const shared_ptr<DecodeSignal>& signal) {
+			return signal->is_decode_finished(); });
+
+	if (all_finished) {
+		finish_job(job);
+		return;
+	}
+
+	// Decode signals that failed won't ever finish, so once the acquisition
+	// is done, an error message means that this file can't be decoded
+	if (!job->capture_stopped)
+		return;
+
+	for (const shared_ptr<DecodeSignal>& signal : job->decode_signals)
+		if (!signal->is_decode_finished() &&
+			!signal->get_error_message().isEmpty()) {
+			finish_job(job, signal->name() + ": " + signal->get_error_message());
+			return;
+		}
+}
+
+shared_ptr<BatchDecoder::Job> BatchDecoder::find_job(const QObject *object) const
+{
+	for (const shared_ptr<Job>& job : running_jobs_) {
+		if (job->session.get() == object)
+			return job;
+
+		for (const shared_ptr<DecodeSignal>& signal : job->decode_signals)
+			if (signal.get() == object)
+				return job;
+	}
+
+	return nullptr;
+}
+
+bool BatchDecoder::write_annotations(const Job &job) const
+{
+	GlobalSettings settings;
+	const QString format = settings.value(GlobalSettings::Key_Dec_ExportFormat).toString();
+
+	// Make the output of different files distinguishable on stdout
+	const QString line_prefix = prefix_output_ ?
+		(QString::fromStdString(job.file_name) + ": ") : QString();
+
+	for (size_t i = 0; i < job.decode_signals.size(); i++) {
+		const shared_ptr<DecodeSignal>& signal = job.decode_signals[i];
+
+		QString file_name = job.output_name;
+		if (job.decode_signals.size() > 1)
+			file_name += "-" + QString::number(i);
+
+		QFile file;
+		if (!open_destination(file, file_name + ".txt"))
+			return false;
+
+		// The stream passes the annotations on to the file as they're
+		// formatted instead of collecting the output of the whole signal
+		QTextStream out_stream(&file);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+		out_stream.setCodec("UTF-8");
+#endif
+
+		uint32_t segment_id = 0;
+		while (const deque<const Annotation*>* annotations =
+			signal->get_all_annotations_by_segment(segment_id++))
+			DecodeSignal::export_annotations(out_stream, *annotations, format,
+				line_prefix);
+
+		out_stream.flush();
+
+		if ((out_stream.status() != QTextStream::Ok) || !file.flush())
+			return false;
+	}
+
+	return true;
+}
+
+bool BatchDecoder::write_binary_data(const Job &job) const
+{
+	for (size_t i = 0; i < job.decode_signals.size(); i++) {
+		const shared_ptr<DecodeSignal>& signal = job.decode_signals[i];
+
+		for (const shared_ptr<Decoder>& dec : signal->decoder_stack())
+			for (uint32_t id = 0; id < dec->get_binary_class_count(); id++) {
+				const DecodeBinaryClassInfo* class_info = dec->get_binary_class(id);
+
+				QString file_name = job.output_name;
+				if (job.decode_signals.size() > 1)
+					file_name += "-" + QString::number(i);
+				file_name += QString("-%1-%2.bin").arg(QString::fromUtf8(dec->name()),
+					QString::fromUtf8(class_info->name));
+
+				// Only open the file once there is data, so that classes
+				// without any data don't leave empty files behind
+				QFile file;
+
+				uint32_t segment_id = 0;
+				while (const DecodeBinaryClass* bin_class =
+					signal->get_binary_data_class(segment_id++, dec.get(), id))
+					for (const data::DecodeBinaryDataChunk& chunk : bin_class->chunks) {
+						if (chunk.data.empty())
+							continue;
+
+						if (!file.isOpen() && !open_destination(file, file_name))
+							return false;
+
+						if (file.write((const char*)chunk.data.data(),
+							chunk.data.size()) != (qint64)chunk.data.size())
+							return false;
+					}
+
+				if (file.isOpen() && !file.flush())
+					return false;
+			}
+	}
+
+	return true;
+}
+
+bool BatchDecoder::open_destination(QFile &file, const QString &file_name) const
+{
+	// Closing the file doesn't close stdout, so it may be opened repeatedly
+	if (output_.toStdString() == StdoutDestination)
+		return file.open(stdout, QIODevice::WriteOnly);
+
+	file.setFileName(QDir(output_).filePath(file_name));
+
+	return file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+void BatchDecoder::on_capture_state_changed(int state)
+{
+	shared_ptr<Job> job = find_job(sender());
+	if (!job)
+		return;
+
+	job->capture_stopped = (state == Session::Stopped);
+	check_job(job);
+	start_next_jobs();
+}
+
+void BatchDecoder::on_session_error_raised(const QString text, const QString info_text)
+{
+	shared_ptr<Job> job = find_job(sender());
+	if (!job)
+		return;
+
+	finish_job(job, text + ": " + info_text);
+	start_next_jobs();
+}
+
+void BatchDecoder::on_decode_finished()
+{
+	shared_ptr<Job> job = find_job(sender());
+	if (!job)
+		return;
+
+	check_job(job);
+	start_next_jobs();
+}
+
+void BatchDecoder::on_error_message_changed(QString msg)
+{
+	shared_ptr<Job> job = find_job(sender());
+	if (!job || msg.isEmpty())
+		return;
+
+	check_job(job);
+	start_next_jobs();
+}
+
+} // namespace pv
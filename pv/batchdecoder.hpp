@@ -0,0 +1,139 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_BATCHDECODER_HPP
+#define PULSEVIEW_PV_BATCHDECODER_HPP
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QObject>
+#include <QString>
+
+using std::deque;
+using std::list;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+class QFile;
+
+namespace pv {
+
+class DeviceManager;
+class Session;
+
+namespace data {
+class DecodeSignal;
+}
+
+/**
+ * Decodes a list of input files without any GUI: each file is loaded into
+ * its own session, the decoder stack is restored from the setup file and
+ * the decoder output is written to files or stdout once decoding finished.
+ * The output is written piece by piece, so it's never held in memory as a
+ * whole.
+ *
+ * At most max_jobs files are processed at the same time, which also bounds
+ * the number of acquisition and decoder threads that run concurrently.
+ */
+class BatchDecoder : public QObject
+{
+	Q_OBJECT
+
+public:
+	/// Output destination that makes the decoder output go to stdout
+	static const string StdoutDestination;
+
+private:
+	struct Job
+	{
+		string file_name;
+		QString output_name;
+		shared_ptr<Session> session;
+		vector< shared_ptr<data::DecodeSignal> > decode_signals;
+		bool capture_stopped;
+	};
+
+public:
+	/**
+	 * @param output Directory to write the output files to or
+	 *        StdoutDestination to write everything to stdout.
+	 * @param binary_output If true, binary decoder output is written
+	 *        instead of the annotations.
+	 */
+	BatchDecoder(DeviceManager &device_manager, const vector<string> &file_names,
+		const string &format, const string &setup_file_name,
+		const string &output, bool binary_output, unsigned int max_jobs);
+
+	~BatchDecoder();
+
+	/**
+	 * Starts processing the input files. finished() is emitted once all of
+	 * them have been handled.
+	 */
+	void start();
+
+	/**
+	 * Returns the number of input files that couldn't be decoded.
+	 */
+	unsigned int failed_count() const;
+
+private:
+	void start_next_jobs();
+	void start_job(const string &file_name);
+	/// Writes the output of a job (unless it failed) and removes it
+	void finish_job(shared_ptr<Job> job, const QString &error = QString());
+	void check_job(shared_ptr<Job> job);
+
+	shared_ptr<Job> find_job(const QObject *object) const;
+
+	bool write_annotations(const Job &job) const;
+	bool write_binary_data(const Job &job) const;
+	/// Opens the output file of the given name or stdout for writing
+	bool open_destination(QFile &file, const QString &file_name) const;
+
+Q_SIGNALS:
+	void finished();
+
+private Q_SLOTS:
+	void on_capture_state_changed(int state);
+	void on_session_error_raised(const QString text, const QString info_text);
+	void on_decode_finished();
+	void on_error_message_changed(QString msg);
+
+private:
+	DeviceManager &device_manager_;
+
+	const string format_, setup_file_name_;
+	const QString output_;
+	const bool binary_output_;
+	const unsigned int max_jobs_;
+	const bool prefix_output_;
+
+	deque<string> pending_files_;
+	list< shared_ptr<Job> > running_jobs_;
+
+	unsigned int failed_count_;
+};
+
+} // namespace pv
+
+#endif // PULSEVIEW_PV_BATCHDECODER_HPP
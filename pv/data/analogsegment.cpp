@@ -26,19 +26,22 @@
 #include <memory>
 
 #include <algorithm>
+#include <limits>
 
 #include "analog.hpp"
 #include "analogsegment.hpp"
 
-using std::lock_guard;
 using std::recursive_mutex;
 using std::make_pair;
 using std::max;
 using std::max_element;
 using std::min;
 using std::min_element;
+using std::numeric_limits;
 using std::pair;
-using std::unique_ptr;
+using std::shared_ptr;
+using std::swap;
+using std::vector;
 
 namespace pv {
 namespace data {
@@ -46,44 +49,71 @@ namespace data {
 const int AnalogSegment::EnvelopeScalePower = 4;
 const int AnalogSegment::EnvelopeScaleFactor = 1 << EnvelopeScalePower;
 const float AnalogSegment::LogEnvelopeScaleFactor = logf(EnvelopeScaleFactor);
-const uint64_t AnalogSegment::EnvelopeDataUnit = 64 * 1024;	// bytes
+const uint64_t AnalogSegment::EnvelopeDataUnit = 64 * 1024;	// samples per chunk
+const uint64_t AnalogSegment::DeinterleaveBlockSize = 2048;	// samples
+const uint64_t AnalogSegment::ConversionBlockSize = 4096;	// samples
 
-AnalogSegment::AnalogSegment(Analog& owner, uint32_t segment_id, uint64_t samplerate) :
-	Segment(segment_id, samplerate, sizeof(float)),
+AnalogSegment::AnalogSegment(Analog& owner, uint32_t segment_id,
+	uint64_t samplerate, StorageFormat format, float scale, float offset) :
+	Segment(segment_id, samplerate, storage_format_unit_size(format)),
 	owner_(owner),
+	storage_format_(format),
+	scale_(scale),
+	offset_(offset),
 	min_value_(0),
 	max_value_(0)
 {
-	lock_guard<recursive_mutex> lock(mutex_);
-	memset(envelope_levels_, 0, sizeof(envelope_levels_));
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+	for (Envelope &e : envelope_levels_)
+		e.length = 0;
 }
 
 AnalogSegment::~AnalogSegment()
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 	for (Envelope &e : envelope_levels_)
-		free(e.samples);
+		for (EnvelopeSample* chunk : e.data_chunks)
+			delete[] chunk;
+}
+
+AnalogSegment::StorageFormat AnalogSegment::storage_format() const
+{
+	return storage_format_;
+}
+
+float AnalogSegment::scale() const
+{
+	return scale_;
+}
+
+float AnalogSegment::offset() const
+{
+	return offset_;
+}
+
+unsigned int AnalogSegment::storage_format_unit_size(StorageFormat format)
+{
+	switch (format) {
+	case StorageFormat::Int8:
+	case StorageFormat::UInt8:
+		return sizeof(uint8_t);
+	case StorageFormat::Int16:
+	case StorageFormat::UInt16:
+		return sizeof(uint16_t);
+	default:
+		return sizeof(float);
+	}
 }
 
 void AnalogSegment::append_interleaved_samples(const float *data,
 	size_t sample_count, size_t stride)
 {
-	assert(unit_size_ == sizeof(float));
-
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	uint64_t prev_sample_count = sample_count_;
 
 	// Deinterleave the samples and add them
-	unique_ptr<float[]> deint_data(new float[sample_count]);
-	float *deint_data_ptr = deint_data.get();
-	for (uint32_t i = 0; i < sample_count; i++) {
-		*deint_data_ptr = (float)(*data);
-		deint_data_ptr++;
-		data += stride;
-	}
-
-	append_samples(deint_data.get(), sample_count);
+	append_strided_samples(data, sample_count, stride);
 
 	// Generate the first mip-map from the data
 	append_payload_to_envelope_levels();
@@ -96,14 +126,108 @@ void AnalogSegment::append_interleaved_samples(const float *data,
 			prev_sample_count + 1, prev_sample_count + 1);
 }
 
+void AnalogSegment::append_interleaved_samples(
+	const vector< shared_ptr<AnalogSegment> >& segments,
+	const float *data, size_t sample_count)
+{
+	const size_t stride = segments.size();
+
+	vector<uint64_t> prev_sample_counts;
+	prev_sample_counts.reserve(stride);
+	for (const shared_ptr<AnalogSegment>& segment : segments)
+		prev_sample_counts.push_back(segment->get_sample_count());
+
+	// Process the data block by block so that the interleaved source
+	// data is fetched from memory only once for all channels
+	for (size_t block_start = 0; block_start < sample_count;
+			block_start += DeinterleaveBlockSize) {
+		const size_t block_length =
+			min((size_t)DeinterleaveBlockSize, sample_count - block_start);
+		const float *block_data = data + block_start * stride;
+
+		for (size_t ch = 0; ch < stride; ch++) {
+			AnalogSegment& segment = *segments[ch];
+
+			ProfiledLockGuard<recursive_mutex> lock(segment.mutex_, lock_wait_stage());
+
+			segment.append_strided_samples(block_data + ch, block_length, stride);
+			segment.append_payload_to_envelope_levels();
+		}
+	}
+
+	for (size_t ch = 0; ch < stride; ch++) {
+		AnalogSegment& segment = *segments[ch];
+		const uint64_t prev_sample_count = prev_sample_counts[ch];
+
+		if (sample_count > 1)
+			segment.owner_.notify_samples_added(
+				shared_ptr<Segment>(segment.shared_from_this()),
+				prev_sample_count + 1, prev_sample_count + 1 + sample_count);
+		else
+			segment.owner_.notify_samples_added(
+				shared_ptr<Segment>(segment.shared_from_this()),
+				prev_sample_count + 1, prev_sample_count + 1);
+	}
+}
+
+void AnalogSegment::append_interleaved_codes(
+	const vector< shared_ptr<AnalogSegment> >& segments,
+	const void *data, size_t sample_count)
+{
+	const size_t stride = segments.size();
+	const unsigned int unit_size = segments.front()->unit_size_;
+
+	vector<uint64_t> prev_sample_counts;
+	prev_sample_counts.reserve(stride);
+	for (const shared_ptr<AnalogSegment>& segment : segments) {
+		assert(segment->storage_format_ == segments.front()->storage_format_);
+		prev_sample_counts.push_back(segment->get_sample_count());
+	}
+
+	for (size_t block_start = 0; block_start < sample_count;
+			block_start += DeinterleaveBlockSize) {
+		const size_t block_length =
+			min((size_t)DeinterleaveBlockSize, sample_count - block_start);
+		const uint8_t *block_data =
+			(const uint8_t*)data + block_start * stride * unit_size;
+
+		for (size_t ch = 0; ch < stride; ch++) {
+			AnalogSegment& segment = *segments[ch];
+
+			ProfiledLockGuard<recursive_mutex> lock(segment.mutex_, lock_wait_stage());
+
+			segment.append_strided_codes(block_data + ch * unit_size,
+				block_length, stride);
+			segment.append_payload_to_envelope_levels();
+		}
+	}
+
+	for (size_t ch = 0; ch < stride; ch++) {
+		AnalogSegment& segment = *segments[ch];
+		const uint64_t prev_sample_count = prev_sample_counts[ch];
+
+		if (sample_count > 1)
+			segment.owner_.notify_samples_added(
+				shared_ptr<Segment>(segment.shared_from_this()),
+				prev_sample_count + 1, prev_sample_count + 1 + sample_count);
+		else
+			segment.owner_.notify_samples_added(
+				shared_ptr<Segment>(segment.shared_from_this()),
+				prev_sample_count + 1, prev_sample_count + 1);
+	}
+}
+
 float AnalogSegment::get_sample(int64_t sample_num) const
 {
 	assert(sample_num >= 0);
 	assert(sample_num <= (int64_t)sample_count_);
 
-	lock_guard<recursive_mutex> lock(mutex_);  // Because of free_unused_memory()
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());  // Because of free_unused_memory()
 
-	return *((const float*)get_raw_sample(sample_num));
+	if (storage_format_ == StorageFormat::Float)
+		return *((const float*)get_raw_sample(sample_num));
+	else
+		return code_to_value(get_raw_sample(sample_num));
 }
 
 void AnalogSegment::get_samples(int64_t start_sample, int64_t end_sample,
@@ -116,9 +240,12 @@ void AnalogSegment::get_samples(int64_t start_sample, int64_t end_sample,
 	assert(start_sample <= end_sample);
 	assert(dest != nullptr);
 
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
-	get_raw_samples(start_sample, (end_sample - start_sample), (uint8_t*)dest);
+	if (storage_format_ == StorageFormat::Float)
+		get_raw_samples(start_sample, (end_sample - start_sample), (uint8_t*)dest);
+	else
+		get_codes_as_values(start_sample, (end_sample - start_sample), dest);
 }
 
 const pair<float, float> AnalogSegment::get_min_max() const
@@ -126,10 +253,86 @@ const pair<float, float> AnalogSegment::get_min_max() const
 	return make_pair(min_value_, max_value_);
 }
 
+const pair<float, float> AnalogSegment::get_min_max(uint64_t start,
+	uint64_t end) const
+{
+	assert(start <= end);
+	assert(end <= sample_count_);
+
+	if (start == end)
+		return make_pair(0.0f, 0.0f);
+
+	float min_value = numeric_limits<float>::max();
+	float max_value = numeric_limits<float>::lowest();
+
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	// Level -1 denotes the individual samples
+	int level = -1;
+	uint64_t pos = start;
+
+	while (pos < end) {
+		// Zoom out as long as pos is at the beginning of a complete block of
+		// the next level that lies within the range
+		while (level + 1 < (int)ScaleStepCount) {
+			const int power = (level + 2) * EnvelopeScalePower;
+			if (((pos & ((UINT64_C(1) << power) - 1)) != 0) ||
+				(pos + (UINT64_C(1) << power) > end) ||
+				((pos >> power) >= envelope_levels_[level + 1].length))
+				break;
+			level++;
+		}
+
+		// Zoom in until a block of the current level lies within the range
+		while (level >= 0) {
+			const int power = (level + 1) * EnvelopeScalePower;
+			if ((pos + (UINT64_C(1) << power) <= end) &&
+				((pos >> power) < envelope_levels_[level].length))
+				break;
+			level--;
+		}
+
+		if (level < 0) {
+			// Scan the samples up to the beginning of the next envelope block
+			const uint64_t block_end = min(end,
+				(pos | (EnvelopeScaleFactor - 1)) + 1);
+			for (; pos < block_end; pos++) {
+				const float sample = get_sample(pos);
+				min_value = min(min_value, sample);
+				max_value = max(max_value, sample);
+			}
+		} else {
+			const int power = (level + 1) * EnvelopeScalePower;
+			const EnvelopeSample *const e =
+				get_envelope_entry(envelope_levels_[level], pos >> power);
+			min_value = min(min_value, e->min);
+			max_value = max(max_value, e->max);
+			pos += UINT64_C(1) << power;
+		}
+	}
+
+	return make_pair(min_value, max_value);
+}
+
+uint64_t AnalogSegment::get_memory_used() const
+{
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	uint64_t size = Segment::get_memory_used();
+
+	for (const Envelope &e : envelope_levels_)
+		size += e.data_chunks.size() * EnvelopeDataUnit * sizeof(EnvelopeSample);
+
+	return size;
+}
+
 float* AnalogSegment::get_iterator_value_ptr(SegmentDataIterator* it)
 {
 	assert(it->sample_index <= (sample_count_ - 1));
 
+	if (storage_format_ != StorageFormat::Float)
+		return nullptr;
+
 	return (float*)(it->chunk + it->chunk_offs);
 }
 
@@ -140,7 +343,7 @@ void AnalogSegment::get_envelope_section(EnvelopeSection &s,
 	assert(start <= end);
 	assert(min_length > 0);
 
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	const unsigned int min_level = max((int)floorf(logf(min_length) /
 		LogEnvelopeScaleFactor) - 1, 0);
@@ -153,26 +356,227 @@ void AnalogSegment::get_envelope_section(EnvelopeSection &s,
 	s.scale = 1 << scale_power;
 	s.length = end - start;
 	s.samples = new EnvelopeSample[s.length];
-	memcpy(s.samples, envelope_levels_[min_level].samples + start,
-		s.length * sizeof(EnvelopeSample));
+
+	const Envelope &e = envelope_levels_[min_level];
+	for (uint64_t i = 0; i < s.length;) {
+		const uint64_t offset = start + i;
+		const uint64_t count = min(s.length - i,
+			EnvelopeDataUnit - (offset % EnvelopeDataUnit));
+		memcpy(s.samples + i, get_envelope_entry(e, offset),
+			count * sizeof(EnvelopeSample));
+		i += count;
+	}
 }
 
-void AnalogSegment::reallocate_envelope(Envelope &e)
+void AnalogSegment::append_strided_samples(const float *data,
+	uint64_t sample_count, size_t stride)
+{
+	switch (storage_format_) {
+	case StorageFormat::Int8:
+		append_strided_quantized<int8_t>(data, sample_count, stride);
+		break;
+	case StorageFormat::UInt8:
+		append_strided_quantized<uint8_t>(data, sample_count, stride);
+		break;
+	case StorageFormat::Int16:
+		append_strided_quantized<int16_t>(data, sample_count, stride);
+		break;
+	case StorageFormat::UInt16:
+		append_strided_quantized<uint16_t>(data, sample_count, stride);
+		break;
+	default:
+		append_strided_values<float>(data, sample_count, stride);
+	}
+}
+
+void AnalogSegment::append_strided_codes(const void *data,
+	uint64_t sample_count, size_t stride)
 {
-	const uint64_t new_data_length = ((e.length + EnvelopeDataUnit - 1) /
-		EnvelopeDataUnit) * EnvelopeDataUnit;
-	if (new_data_length > e.data_length) {
-		e.data_length = new_data_length;
-		e.samples = (EnvelopeSample*)realloc(e.samples,
-			new_data_length * sizeof(EnvelopeSample));
+	switch (storage_format_) {
+	case StorageFormat::Int8:
+		append_strided_values<int8_t>((const int8_t*)data, sample_count, stride);
+		break;
+	case StorageFormat::UInt8:
+		append_strided_values<uint8_t>((const uint8_t*)data, sample_count, stride);
+		break;
+	case StorageFormat::Int16:
+		append_strided_values<int16_t>((const int16_t*)data, sample_count, stride);
+		break;
+	case StorageFormat::UInt16:
+		append_strided_values<uint16_t>((const uint16_t*)data, sample_count, stride);
+		break;
+	default:
+		append_strided_values<float>((const float*)data, sample_count, stride);
 	}
 }
 
+template <class T>
+void AnalogSegment::append_strided_values(const T *data,
+	uint64_t sample_count, size_t stride)
+{
+	assert(unit_size_ == sizeof(T));
+
+	// Write the samples directly into the data chunks, which saves us
+	// the temporary buffer append_samples() would require
+	while (sample_count > 0) {
+		uint64_t free_samples;
+		T *dest_ptr = (T*)get_free_chunk_space(free_samples);
+		const uint64_t count = min(sample_count, free_samples);
+
+		if (stride == 1) {
+			memcpy(dest_ptr, data, count * sizeof(T));
+			data += count;
+		} else
+			for (uint64_t i = 0; i < count; i++) {
+				dest_ptr[i] = *data;
+				data += stride;
+			}
+
+		commit_free_chunk_space(count);
+		sample_count -= count;
+	}
+}
+
+template <class T>
+void AnalogSegment::append_strided_quantized(const float *data,
+	uint64_t sample_count, size_t stride)
+{
+	assert(unit_size_ == sizeof(T));
+
+	// Only used when the values we receive don't match our scale and
+	// offset, so we convert them back to codes as good as we can
+	const float lowest = numeric_limits<T>::lowest();
+	const float highest = numeric_limits<T>::max();
+
+	while (sample_count > 0) {
+		uint64_t free_samples;
+		T *dest_ptr = (T*)get_free_chunk_space(free_samples);
+		const uint64_t count = min(sample_count, free_samples);
+
+		for (uint64_t i = 0; i < count; i++) {
+			const float code = roundf((*data - offset_) / scale_);
+			dest_ptr[i] = (T)min(max(code, lowest), highest);
+			data += stride;
+		}
+
+		commit_free_chunk_space(count);
+		sample_count -= count;
+	}
+}
+
+float AnalogSegment::code_to_value(const uint8_t *ptr) const
+{
+	switch (storage_format_) {
+	case StorageFormat::Int8:
+		return *(const int8_t*)ptr * scale_ + offset_;
+	case StorageFormat::UInt8:
+		return *(const uint8_t*)ptr * scale_ + offset_;
+	case StorageFormat::Int16:
+		return *(const int16_t*)ptr * scale_ + offset_;
+	case StorageFormat::UInt16:
+		return *(const uint16_t*)ptr * scale_ + offset_;
+	default:
+		return *(const float*)ptr;
+	}
+}
+
+template <class T>
+void AnalogSegment::convert_codes(const T *src, float *dest,
+	uint64_t count) const
+{
+	// Kept free of branches so that the compiler can vectorize it
+	const float scale = scale_, offset = offset_;
+	for (uint64_t i = 0; i < count; i++)
+		dest[i] = src[i] * scale + offset;
+}
+
+void AnalogSegment::get_codes_as_values(uint64_t start, uint64_t count,
+	float *dest) const
+{
+	uint8_t codes[ConversionBlockSize * sizeof(uint16_t)];
+
+	while (count > 0) {
+		const uint64_t block_length = min(count, ConversionBlockSize);
+
+		get_raw_samples(start, block_length, codes);
+
+		switch (storage_format_) {
+		case StorageFormat::Int8:
+			convert_codes<int8_t>((const int8_t*)codes, dest, block_length);
+			break;
+		case StorageFormat::UInt8:
+			convert_codes<uint8_t>((const uint8_t*)codes, dest, block_length);
+			break;
+		case StorageFormat::Int16:
+			convert_codes<int16_t>((const int16_t*)codes, dest, block_length);
+			break;
+		case StorageFormat::UInt16:
+			convert_codes<uint16_t>((const uint16_t*)codes, dest, block_length);
+			break;
+		default:
+			assert(false);
+		}
+
+		start += block_length;
+		count -= block_length;
+		dest += block_length;
+	}
+}
+
+template <class T>
+void AnalogSegment::append_codes_to_envelope(uint64_t start_sample,
+	uint64_t end_sample, uint64_t dest_offset)
+{
+	const Envelope &e0 = envelope_levels_[0];
+
+	SegmentDataIterator* it = begin_sample_iteration(start_sample);
+
+	for (uint64_t i = start_sample; i < end_sample; i += EnvelopeScaleFactor) {
+		const T* codes = (const T*)get_iterator_value(it);
+
+		// Find the extremes on the codes, then convert only those
+		const T min_code = *min_element(codes, codes + EnvelopeScaleFactor);
+		const T max_code = *max_element(codes, codes + EnvelopeScaleFactor);
+
+		EnvelopeSample sub_sample = {
+			min_code * scale_ + offset_,
+			max_code * scale_ + offset_
+		};
+		if (scale_ < 0)
+			swap(sub_sample.min, sub_sample.max);
+
+		if (sub_sample.min < min_value_)
+			min_value_ = sub_sample.min;
+		if (sub_sample.max > max_value_)
+			max_value_ = sub_sample.max;
+
+		continue_sample_iteration(it, EnvelopeScaleFactor);
+		*get_envelope_entry(e0, dest_offset++) = sub_sample;
+	}
+	end_sample_iteration(it);
+}
+
+void AnalogSegment::reallocate_envelope(Envelope &e)
+{
+	const uint64_t chunk_count =
+		(e.length + EnvelopeDataUnit - 1) / EnvelopeDataUnit;
+
+	while (e.data_chunks.size() < chunk_count)
+		e.data_chunks.push_back(new EnvelopeSample[EnvelopeDataUnit]);
+}
+
+AnalogSegment::EnvelopeSample* AnalogSegment::get_envelope_entry(
+	const Envelope &e, uint64_t offset) const
+{
+	return e.data_chunks[offset / EnvelopeDataUnit] +
+		(offset % EnvelopeDataUnit);
+}
+
 void AnalogSegment::append_payload_to_envelope_levels()
 {
 	Envelope &e0 = envelope_levels_[0];
 	uint64_t prev_length;
-	EnvelopeSample *dest_ptr;
+	uint64_t dest_offset;
 	SegmentDataIterator* it;
 
 	// Expand the data buffer to fit the new samples
@@ -184,7 +588,7 @@ void AnalogSegment::append_payload_to_envelope_levels()
 	if (sample_count_ < EnvelopeScaleFactor) {
 		it = begin_sample_iteration(0);
 		for (uint64_t i = 0; i < sample_count_; i++) {
-			const float sample = *get_iterator_value_ptr(it);
+			const float sample = code_to_value(get_iterator_value(it));
 			if (sample < min_value_)
 				min_value_ = sample;
 			if (sample > max_value_)
@@ -200,30 +604,45 @@ void AnalogSegment::append_payload_to_envelope_levels()
 
 	reallocate_envelope(e0);
 
-	dest_ptr = e0.samples + prev_length;
+	dest_offset = prev_length;
 
 	// Iterate through the samples to populate the first level mipmap
 	uint64_t start_sample = prev_length * EnvelopeScaleFactor;
 	uint64_t end_sample = e0.length * EnvelopeScaleFactor;
 
-	it = begin_sample_iteration(start_sample);
-	for (uint64_t i = start_sample; i < end_sample; i += EnvelopeScaleFactor) {
-		const float* samples = get_iterator_value_ptr(it);
-
-		const EnvelopeSample sub_sample = {
-			*min_element(samples, samples + EnvelopeScaleFactor),
-			*max_element(samples, samples + EnvelopeScaleFactor),
-		};
-
-		if (sub_sample.min < min_value_)
-			min_value_ = sub_sample.min;
-		if (sub_sample.max > max_value_)
-			max_value_ = sub_sample.max;
-
-		continue_sample_iteration(it, EnvelopeScaleFactor);
-		*dest_ptr++ = sub_sample;
+	switch (storage_format_) {
+	case StorageFormat::Int8:
+		append_codes_to_envelope<int8_t>(start_sample, end_sample, dest_offset);
+		break;
+	case StorageFormat::UInt8:
+		append_codes_to_envelope<uint8_t>(start_sample, end_sample, dest_offset);
+		break;
+	case StorageFormat::Int16:
+		append_codes_to_envelope<int16_t>(start_sample, end_sample, dest_offset);
+		break;
+	case StorageFormat::UInt16:
+		append_codes_to_envelope<uint16_t>(start_sample, end_sample, dest_offset);
+		break;
+	default:
+		it = begin_sample_iteration(start_sample);
+		for (uint64_t i = start_sample; i < end_sample; i += EnvelopeScaleFactor) {
+			const float* samples = get_iterator_value_ptr(it);
+
+			const EnvelopeSample sub_sample = {
+				*min_element(samples, samples + EnvelopeScaleFactor),
+				*max_element(samples, samples + EnvelopeScaleFactor),
+			};
+
+			if (sub_sample.min < min_value_)
+				min_value_ = sub_sample.min;
+			if (sub_sample.max > max_value_)
+				max_value_ = sub_sample.max;
+
+			continue_sample_iteration(it, EnvelopeScaleFactor);
+			*get_envelope_entry(e0, dest_offset++) = sub_sample;
+		}
+		end_sample_iteration(it);
 	}
-	end_sample_iteration(it);
 
 	// Compute higher level mipmaps
 	for (unsigned int level = 1; level < ScaleStepCount; level++) {
@@ -240,13 +659,11 @@ void AnalogSegment::append_payload_to_envelope_levels()
 
 		reallocate_envelope(e);
 
-		// Subsample the lower level
-		const EnvelopeSample *src_ptr =
-			el.samples + prev_length * EnvelopeScaleFactor;
-		const EnvelopeSample *const end_dest_ptr = e.samples + e.length;
-
-		for (dest_ptr = e.samples + prev_length;
-				dest_ptr < end_dest_ptr; dest_ptr++) {
+		// Subsample the lower level. The source samples for one
+		// destination sample never cross a chunk boundary
+		for (dest_offset = prev_length; dest_offset < e.length; dest_offset++) {
+			const EnvelopeSample *src_ptr =
+				get_envelope_entry(el, dest_offset * EnvelopeScaleFactor);
 			const EnvelopeSample *const end_src_ptr =
 				src_ptr + EnvelopeScaleFactor;
 
@@ -257,7 +674,7 @@ void AnalogSegment::append_payload_to_envelope_levels()
 				src_ptr++;
 			}
 
-			*dest_ptr = sub_sample;
+			*get_envelope_entry(e, dest_offset) = sub_sample;
 		}
 	}
 
@@ -22,13 +22,17 @@
 
 #include "segment.hpp"
 
+#include <deque>
 #include <utility>
 #include <vector>
 
 #include <QObject>
 
+using std::deque;
 using std::enable_shared_from_this;
 using std::pair;
+using std::shared_ptr;
+using std::vector;
 
 namespace AnalogSegmentTest {
 struct Basic;
@@ -44,6 +48,20 @@ class AnalogSegment : public Segment, public enable_shared_from_this<Segment>
 	Q_OBJECT
 
 public:
+	/**
+	 * The format the samples are stored in. Besides 32-bit floats,
+	 * the raw integer codes of an ADC can be stored together with a
+	 * per-segment scale and offset, reducing memory use to a half or
+	 * a quarter. Samples are converted to float on access.
+	 */
+	enum class StorageFormat {
+		Float,	///< 32-bit floating point values
+		Int8,	///< Signed 8-bit integer codes
+		UInt8,	///< Unsigned 8-bit integer codes
+		Int16,	///< Signed 16-bit integer codes
+		UInt16	///< Unsigned 16-bit integer codes
+	};
+
 	struct EnvelopeSample
 	{
 		float min;
@@ -59,11 +77,15 @@ public:
 	};
 
 private:
+	/**
+	 * An envelope level is stored in chunks of EnvelopeDataUnit samples.
+	 * Chunks are never moved or resized, so appending to a level is
+	 * cheap and pointers to envelope samples remain valid.
+	 */
 	struct Envelope
 	{
 		uint64_t length;
-		uint64_t data_length;
-		EnvelopeSample *samples;
+		deque<EnvelopeSample*> data_chunks;
 	};
 
 private:
@@ -72,33 +94,109 @@ private:
 	static const int EnvelopeScaleFactor;
 	static const float LogEnvelopeScaleFactor;
 	static const uint64_t EnvelopeDataUnit;
+	static const uint64_t DeinterleaveBlockSize;
+	static const uint64_t ConversionBlockSize;
 
 public:
-	AnalogSegment(Analog& owner, uint32_t segment_id, uint64_t samplerate);
+	AnalogSegment(Analog& owner, uint32_t segment_id, uint64_t samplerate,
+		StorageFormat format = StorageFormat::Float, float scale = 1.0f,
+		float offset = 0.0f);
 
 	virtual ~AnalogSegment();
 
+	StorageFormat storage_format() const;
+
+	/**
+	 * Returns the factor and offset used to convert the stored integer
+	 * codes to values: value = code * scale + offset.
+	 */
+	float scale() const;
+	float offset() const;
+
+	static unsigned int storage_format_unit_size(StorageFormat format);
+
 	void append_interleaved_samples(const float *data,
 		size_t sample_count, size_t stride);
 
+	/**
+	 * Appends the samples of a multi-channel packet to the segments of
+	 * all channels at once. The interleaved data is processed in blocks
+	 * that fit into the CPU cache and each block is de-interleaved
+	 * directly into the segments' data chunks, followed by an update of
+	 * the envelopes while the samples are still hot.
+	 * @param[in] segments The segments, one for each channel in the order
+	 * in which the channels appear in the interleaved data.
+	 * @param[in] data The interleaved sample data.
+	 * @param[in] sample_count The number of samples per channel.
+	 */
+	static void append_interleaved_samples(
+		const vector< shared_ptr<AnalogSegment> >& segments,
+		const float *data, size_t sample_count);
+
+	/**
+	 * Same as above, but the data consists of raw integer codes in the
+	 * storage format of the segments, which must all use the same one.
+	 */
+	static void append_interleaved_codes(
+		const vector< shared_ptr<AnalogSegment> >& segments,
+		const void *data, size_t sample_count);
+
 	float get_sample(int64_t sample_num) const;
 	void get_samples(int64_t start_sample, int64_t end_sample, float* dest) const;
 
 	const pair<float, float> get_min_max() const;
 
+	/**
+	 * Returns the minimum and maximum value of the samples in the range
+	 * [start, end). The interior of the range is covered by the coarsest
+	 * fitting envelope entries, only the unaligned edges are scanned
+	 * sample by sample, so the cost is logarithmic in the range length.
+	 */
+	const pair<float, float> get_min_max(uint64_t start, uint64_t end) const;
+
+	uint64_t get_memory_used() const;
+
+	/**
+	 * Returns a pointer to the sample the iterator points at, or
+	 * @c nullptr if the segment stores integer codes, which can only be
+	 * read converted through get_sample() and get_samples().
+	 */
 	float* get_iterator_value_ptr(SegmentDataIterator* it);
 
 	void get_envelope_section(EnvelopeSection &s,
 		uint64_t start, uint64_t end, float min_length) const;
 
 private:
+	void append_strided_samples(const float *data, uint64_t sample_count,
+		size_t stride);
+	void append_strided_codes(const void *data, uint64_t sample_count,
+		size_t stride);
+
+	template <class T> void append_strided_values(const T *data,
+		uint64_t sample_count, size_t stride);
+	template <class T> void append_strided_quantized(const float *data,
+		uint64_t sample_count, size_t stride);
+
+	float code_to_value(const uint8_t *ptr) const;
+	template <class T> void convert_codes(const T *src, float *dest,
+		uint64_t count) const;
+	void get_codes_as_values(uint64_t start, uint64_t count,
+		float *dest) const;
+
+	template <class T> void append_codes_to_envelope(uint64_t start_sample,
+		uint64_t end_sample, uint64_t dest_offset);
+
 	void reallocate_envelope(Envelope &e);
+	EnvelopeSample* get_envelope_entry(const Envelope &e, uint64_t offset) const;
 
 	void append_payload_to_envelope_levels();
 
 private:
 	Analog& owner_;
 
+	const StorageFormat storage_format_;
+	const float scale_, offset_;
+
 	struct Envelope envelope_levels_[ScaleStepCount];
 
 	float min_value_, max_value_;
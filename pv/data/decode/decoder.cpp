@@ -41,7 +41,8 @@ AnnotationClass::AnnotationClass(size_t _id, char* _name, char* _description, Ro
 	name(_name),
 	description(_description),
 	row(_row),
-	visible_(true)
+	visible_(true),
+	recorded_(true)
 {
 }
 
@@ -57,6 +58,16 @@ void AnnotationClass::set_visible(bool visible)
 	visibility_changed();
 }
 
+bool AnnotationClass::recorded() const
+{
+	return recorded_;
+}
+
+void AnnotationClass::set_recorded(bool recorded)
+{
+	recorded_ = recorded;
+}
+
 
 Decoder::Decoder(const srd_decoder *const dec, uint8_t stack_level) :
 	srd_decoder_(dec),
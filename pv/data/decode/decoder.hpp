@@ -20,6 +20,7 @@
 #ifndef PULSEVIEW_PV_DATA_DECODE_DECODER_HPP
 #define PULSEVIEW_PV_DATA_DECODE_DECODER_HPP
 
+#include <atomic>
 #include <deque>
 #include <map>
 #include <memory>
@@ -32,6 +33,7 @@
 
 #include <pv/data/decode/row.hpp>
 
+using std::atomic;
 using std::deque;
 using std::map;
 using std::shared_ptr;
@@ -64,6 +66,14 @@ public:
 	bool visible() const;
 	void set_visible(bool visible);
 
+	/**
+	 * Annotations of classes that aren't recorded are dropped as soon as the
+	 * decoder reports them. May be read by the decode thread at any time,
+	 * see DecodeSignal::set_ann_classes_recorded().
+	 */
+	bool recorded() const;
+	void set_recorded(bool recorded);
+
 Q_SIGNALS:
 	void visibility_changed();
 
@@ -75,6 +85,7 @@ public:
 
 private:
 	bool visible_;
+	atomic<bool> recorded_;
 };
 
 struct DecodeChannel
@@ -186,6 +186,15 @@ bool Row::has_hidden_classes() const
 	return false;
 }
 
+bool Row::has_unrecorded_classes() const
+{
+	for (const AnnotationClass* c : ann_classes())
+		if (!c->recorded())
+			return true;
+
+	return false;
+}
+
 bool Row::class_is_visible(uint32_t ann_class_id) const
 {
 	return decoder_->get_ann_class_by_id(ann_class_id)->visible();
@@ -100,12 +100,8 @@ const deque<Annotation>& RowData::annotations() const
 	return annotations_;
 }
 
-const Annotation* RowData::emplace_annotation(srd_proto_data *pdata)
+const vector<QString>* RowData::store_ann_texts(const srd_proto_data_annotation *pda)
 {
-	const srd_proto_data_annotation *const pda = (const srd_proto_data_annotation*)pdata->data;
-
-	uint32_t ann_class_id = pda->ann_class;
-
 	// Look up the longest annotation text to see if we have it in storage.
 	// This implies that if the longest text is the same, the shorter texts
 	// are expected to be the same, too. PDs that violate this assumption
@@ -122,33 +118,38 @@ const Annotation* RowData::emplace_annotation(srd_proto_data *pdata)
 		storage_entry->shrink_to_fit();
 	}
 
+	return storage_entry;
+}
 
+const Annotation* RowData::emplace_annotation(uint64_t start_sample,
+	uint64_t end_sample, const vector<QString>* texts, uint32_t ann_class_id)
+{
 	const Annotation* result = nullptr;
 
 	// We insert the annotation in a way so that the annotation list
 	// is sorted by start sample. Otherwise, we'd have to sort when
 	// painting, which is expensive
 
-	if (pdata->start_sample < prev_ann_start_sample_) {
+	if (start_sample < prev_ann_start_sample_) {
 		// Find location to insert the annotation at
 
 		auto it = annotations_.end();
 		do {
 			it--;
-		} while ((it->start_sample() > pdata->start_sample) && (it != annotations_.begin()));
+		} while ((it->start_sample() > start_sample) && (it != annotations_.begin()));
 
 		// Allow inserting at the front
 		if (it != annotations_.begin())
 			it++;
 
-		it = annotations_.emplace(it, pdata->start_sample, pdata->end_sample,
-			storage_entry, ann_class_id, this);
+		it = annotations_.emplace(it, start_sample, end_sample,
+			texts, ann_class_id, this);
 		result = &(*it);
 	} else {
-		annotations_.emplace_back(pdata->start_sample, pdata->end_sample,
-			storage_entry, ann_class_id, this);
+		annotations_.emplace_back(start_sample, end_sample,
+			texts, ann_class_id, this);
 		result = &(annotations_.back());
-		prev_ann_start_sample_ = pdata->start_sample;
+		prev_ann_start_sample_ = start_sample;
 	}
 
 	return result;
@@ -71,7 +71,14 @@ public:
 
 	const deque<Annotation>& annotations() const;
 
-	const Annotation* emplace_annotation(srd_proto_data *pdata);
+	/**
+	 * Returns the stored copy of the texts of an annotation, adding them to
+	 * the storage if needed. Must only be called from the decode thread.
+	 */
+	const vector<QString>* store_ann_texts(const srd_proto_data_annotation *pda);
+
+	const Annotation* emplace_annotation(uint64_t start_sample, uint64_t end_sample,
+		const vector<QString>* texts, uint32_t ann_class_id);
 
 private:
 	deque<Annotation> annotations_;
@@ -0,0 +1,318 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libsigrokdecode/libsigrokdecode.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include "sweep.hpp"
+#include "worker.hpp"
+
+#include <pv/data/logicsegment.hpp>
+
+using std::lock_guard;
+using std::make_shared;
+using std::max;
+using std::min;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+const int64_t Sweep::ChunkLength = 256 * 1024;
+
+Sweep::Sweep(const vector< shared_ptr<Decoder> > &stack, size_t decoder_index,
+	const string &option_id, const vector<GVariant*> &values,
+	shared_ptr<const LogicSegment> input, uint64_t input_start,
+	uint64_t start_sample, uint64_t end_sample) :
+	decoder_index_(decoder_index),
+	srd_decoder_(stack.at(decoder_index)->get_srd_decoder()),
+	option_id_(option_id),
+	input_(input),
+	input_start_(input_start),
+	start_sample_(max(start_sample, input_start)),
+	end_sample_(end_sample),
+	next_run_(0),
+	active_threads_(0),
+	interrupt_(false)
+{
+	assert(decoder_index < stack.size());
+	assert(input_);
+
+	// Copy the channels so that the decoder stack of the signal may change
+	// while the sweep is running
+	for (const shared_ptr<Decoder>& dec : stack)
+		for (const DecodeChannel* ch : dec->channels())
+			channels_.push_back(*ch);
+
+	for (GVariant* value : values) {
+		g_variant_ref_sink(value);
+		results_.push_back({value, 0, 0, 0, false, false});
+
+		runs_.push_back({this, runs_.size(), nullptr, {}, {}, 0, 0});
+		Run& run = runs_.back();
+
+		auto ch_it = channels_.begin();
+		for (const shared_ptr<Decoder>& dec : stack) {
+			shared_ptr<Decoder> copy =
+				make_shared<Decoder>(dec->get_srd_decoder(), dec->get_stack_level());
+
+			for (const auto& option : dec->options())
+				copy->set_option(option.first.c_str(), option.second);
+
+			if (run.stack.size() == decoder_index)
+				copy->set_option(option_id.c_str(), value);
+
+			vector<DecodeChannel*> channels;
+			for (size_t i = 0; i < dec->channels().size(); i++)
+				channels.push_back(&(*ch_it++));
+			copy->set_channels(channels);
+
+			vector<bool> error_classes;
+			for (const AnnotationClass* ann_class : copy->ann_classes())
+				error_classes.push_back(is_error_class(ann_class));
+
+			run.stack.push_back(copy);
+			run.error_classes.push_back(error_classes);
+		}
+	}
+}
+
+Sweep::~Sweep()
+{
+	cancel();
+
+	for (Result& result : results_)
+		g_variant_unref(result.value);
+}
+
+size_t Sweep::decoder_index() const
+{
+	return decoder_index_;
+}
+
+const srd_decoder* Sweep::get_srd_decoder() const
+{
+	return srd_decoder_;
+}
+
+const string& Sweep::option_id() const
+{
+	return option_id_;
+}
+
+uint64_t Sweep::start_sample() const
+{
+	return start_sample_;
+}
+
+uint64_t Sweep::end_sample() const
+{
+	return end_sample_;
+}
+
+void Sweep::start()
+{
+	assert(threads_.empty());
+
+	// Each thread drives one worker process at a time
+	const unsigned int thread_count = min((size_t)max(1U,
+		std::thread::hardware_concurrency()), runs_.size());
+
+	interrupt_ = false;
+	active_threads_ = thread_count;
+
+	// Without any values to try there's nothing to wait for
+	if (thread_count == 0)
+		QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+
+	for (unsigned int i = 0; i < thread_count; i++)
+		threads_.emplace_back(&Sweep::run_proc, this);
+}
+
+void Sweep::cancel()
+{
+	interrupt_ = true;
+
+	for (std::thread& t : threads_)
+		t.join();
+
+	threads_.clear();
+}
+
+bool Sweep::is_running() const
+{
+	return active_threads_ > 0;
+}
+
+vector<Sweep::Result> Sweep::results() const
+{
+	lock_guard<mutex> lock(results_mutex_);
+	return results_;
+}
+
+int Sweep::best_result() const
+{
+	lock_guard<mutex> lock(results_mutex_);
+	return best_result(results_);
+}
+
+int Sweep::best_result(const vector<Result> &results)
+{
+	int best = -1;
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+
+		// A configuration that doesn't decode anything isn't a candidate,
+		// even though it doesn't report any errors either
+		if (!r.done || r.failed || (r.annotation_count == 0))
+			continue;
+
+		if (best >= 0) {
+			const Result& b = results[best];
+			if ((r.error_count > b.error_count) || ((r.error_count == b.error_count) &&
+				(r.annotation_count <= b.annotation_count)))
+				continue;
+		}
+
+		best = i;
+	}
+
+	return best;
+}
+
+bool Sweep::is_error_class(const AnnotationClass *ann_class)
+{
+	assert(ann_class);
+
+	// Decoders don't flag error classes, but their names are telling. Only
+	// whole words count, so that e.g. "interrupt" or "warmup" don't match
+	static const QRegularExpression separators("[^a-z0-9]+");
+	static const QStringList error_words = {"err", "errs", "error", "errors",
+		"warn", "warns", "warning", "warnings", "invalid"};
+
+	for (const char* text : {ann_class->name, ann_class->description}) {
+		if (!text)
+			continue;
+
+		for (const QString& word : QString::fromUtf8(text).toLower().split(separators))
+			if (error_words.contains(word))
+				return true;
+	}
+
+	return false;
+}
+
+void Sweep::run_proc()
+{
+	for (size_t i = next_run_++; !interrupt_ && (i < runs_.size()); i = next_run_++)
+		decode(runs_[i]);
+
+	// Emitted through the event loop so that the signal can't get lost
+	// before the receiver connected to it
+	if (--active_threads_ == 0)
+		QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+void Sweep::decode(Run &run)
+{
+	const int64_t unit_size = input_->unit_size();
+	const int64_t chunk_sample_count = ChunkLength / unit_size;
+	const uint64_t end_sample = min(end_sample_, input_start_ + input_->get_sample_count());
+
+	Worker worker(ChunkLength, annotation_callback, ignore_output, ignore_output,
+		&run, interrupt_);
+	run.worker = &worker;
+
+	bool ok = worker.start(run.stack, input_->samplerate());
+
+	for (uint64_t i = start_sample_; ok && !interrupt_ && (i < end_sample);
+		i += chunk_sample_count) {
+		const uint64_t chunk_end = min(i + chunk_sample_count, end_sample);
+
+		input_->get_samples(i - input_start_, chunk_end - input_start_, worker.buffer());
+		ok = worker.send(i, chunk_end, (chunk_end - i) * unit_size, unit_size);
+
+		{
+			lock_guard<mutex> lock(results_mutex_);
+			Result& result = results_[run.index];
+			result.samples_decoded = chunk_end - start_sample_;
+			result.annotation_count = run.annotation_count;
+			result.error_count = run.error_count;
+		}
+
+		progress_changed();
+	}
+
+	if (ok && !interrupt_)
+		ok = worker.send_eof();
+
+	if (!ok && !interrupt_)
+		qWarning() << "Decoder sweep failed:" << worker.error_message();
+
+	run.worker = nullptr;
+
+	lock_guard<mutex> lock(results_mutex_);
+	Result& result = results_[run.index];
+	result.annotation_count = run.annotation_count;
+	result.error_count = run.error_count;
+	result.done = !interrupt_;
+	result.failed = !ok;
+}
+
+void Sweep::annotation_callback(srd_proto_data *pdata, void *cb_data)
+{
+	Run *const run = (Run*)cb_data;
+	assert(run);
+
+	const srd_proto_data_annotation *const pda =
+		(const srd_proto_data_annotation*)pdata->data;
+	assert(pda);
+
+	// The stack may contain the same decoder several times, so the worker
+	// tells which instance the annotation is from
+	assert(run->worker);
+	const int index = run->worker->output_decoder_index();
+	if ((index < 0) || ((size_t)index >= run->error_classes.size()))
+		return;
+
+	const vector<bool>& error_classes = run->error_classes[index];
+	if ((pda->ann_class < 0) || ((size_t)pda->ann_class >= error_classes.size()))
+		return;
+
+	if (error_classes[pda->ann_class])
+		run->error_count++;
+	else
+		run->annotation_count++;
+}
+
+void Sweep::ignore_output(srd_proto_data *pdata, void *cb_data)
+{
+	(void)pdata;
+	(void)cb_data;
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
@@ -0,0 +1,170 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_SWEEP_HPP
+#define PULSEVIEW_PV_DATA_DECODE_SWEEP_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glib.h>
+
+#include <QObject>
+
+#include <pv/data/decode/decoder.hpp>
+
+using std::atomic;
+using std::deque;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+struct srd_decoder;
+struct srd_proto_data;
+
+namespace pv {
+namespace data {
+
+class LogicSegment;
+
+namespace decode {
+
+class Worker;
+
+/**
+ * Decodes a sample window once for each of several values of one decoder
+ * option to find the value that suits the data best. Every configuration
+ * runs in its own worker process, so that they aren't serialized by the
+ * lock of the shared Python interpreter.
+ *
+ * A configuration is better than another one if its decoders report fewer
+ * annotations of error classes or, for the same number of errors, more
+ * other annotations.
+ */
+class Sweep : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Result
+	{
+		GVariant *value;
+		uint64_t samples_decoded;
+		uint64_t annotation_count;  ///< Annotations not of an error class
+		uint64_t error_count;
+		bool done, failed;
+	};
+
+private:
+	static const int64_t ChunkLength;
+
+	struct Run
+	{
+		Sweep *sweep;
+		size_t index;
+		const Worker *worker;                    ///< Only set while decoding
+		vector< shared_ptr<Decoder> > stack;
+		vector< vector<bool> > error_classes;    ///< Per decoder, by class ID
+		uint64_t annotation_count, error_count;  ///< Only used by the decoding thread
+	};
+
+public:
+	/**
+	 * @param stack The decoder stack to copy. Its channels must stay valid
+	 *        until the constructor returns.
+	 * @param decoder_index The decoder in the stack whose option is varied.
+	 * @param values The option values to try, they are referenced by the sweep.
+	 * @param input The muxed decoder input as created by DecodeSignal.
+	 * @param input_start The sample number of the first sample of @a input.
+	 *        Samples before it are not decoded.
+	 */
+	Sweep(const vector< shared_ptr<Decoder> > &stack, size_t decoder_index,
+		const string &option_id, const vector<GVariant*> &values,
+		shared_ptr<const LogicSegment> input, uint64_t input_start,
+		uint64_t start_sample, uint64_t end_sample);
+	~Sweep();
+
+	size_t decoder_index() const;
+	const srd_decoder* get_srd_decoder() const;
+	const string& option_id() const;
+	uint64_t start_sample() const;
+	uint64_t end_sample() const;
+
+	/**
+	 * Starts decoding. finished() is always emitted through the event loop
+	 * of the sweep's thread, so it can be connected to after start().
+	 */
+	void start();
+	void cancel();
+	bool is_running() const;
+
+	vector<Result> results() const;
+
+	/// Returns the index of the best result or -1 if there is none (yet)
+	int best_result() const;
+	static int best_result(const vector<Result> &results);
+
+	/**
+	 * Returns true if the annotation class denotes a decoding error, that
+	 * is if a word of its name or description is "err", "error", "warn",
+	 * "warning" or "invalid" or their plural.
+	 */
+	static bool is_error_class(const AnnotationClass *ann_class);
+
+private:
+	void run_proc();
+	void decode(Run &run);
+
+	static void annotation_callback(srd_proto_data *pdata, void *cb_data);
+	static void ignore_output(srd_proto_data *pdata, void *cb_data);
+
+Q_SIGNALS:
+	void progress_changed();
+	void finished();
+
+private:
+	const size_t decoder_index_;
+	const srd_decoder *const srd_decoder_;
+	const string option_id_;
+	const shared_ptr<const LogicSegment> input_;
+	const uint64_t input_start_;
+	const uint64_t start_sample_, end_sample_;
+
+	deque<DecodeChannel> channels_;
+	deque<Run> runs_;
+
+	mutable mutex results_mutex_;
+	vector<Result> results_;
+
+	vector<std::thread> threads_;
+	atomic<size_t> next_run_;
+	atomic<unsigned int> active_threads_;
+	atomic<bool> interrupt_;
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_SWEEP_HPP
@@ -0,0 +1,687 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libsigrokdecode/libsigrokdecode.h>
+
+#include "config.h"
+
+#include <cstring>
+
+#include <unistd.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QList>
+#include <QStringList>
+
+#include "decoder.hpp"
+#include "worker.hpp"
+
+namespace pv {
+namespace data {
+namespace decode {
+
+namespace {
+
+/// State of the worker process
+struct WorkerState
+{
+	int out_fd;
+	srd_session *session;
+	vector<srd_decoder_inst*> instances;
+	vector<GHashTable*> options;
+	vector< vector<bool> > unrecorded_classes;  ///< Per instance, by class ID
+};
+
+bool read_all(int fd, char *data, size_t size)
+{
+	while (size > 0) {
+		const ssize_t n = ::read(fd, data, size);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+bool write_all(int fd, const char *data, size_t size)
+{
+	while (size > 0) {
+		const ssize_t n = ::write(fd, data, size);
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+bool write_message(int fd, const QByteArray &message)
+{
+	const quint32 size = message.size();
+
+	return write_all(fd, (const char*)&size, sizeof(size)) &&
+		write_all(fd, message.constData(), message.size());
+}
+
+qint32 instance_index(const WorkerState *state, const srd_proto_data *pdata)
+{
+	qint32 index = 0;
+	while (((size_t)index < state->instances.size()) &&
+		(state->instances[index] != pdata->pdo->di))
+		index++;
+
+	return index;
+}
+
+/// Starts an output message with the fields all decoder outputs have in common
+void begin_output(QDataStream &stream, Worker::MessageType type,
+	qint32 index, const srd_proto_data *pdata)
+{
+	stream << (qint32)type << index << (quint64)pdata->start_sample <<
+		(quint64)pdata->end_sample;
+}
+
+void annotation_output(srd_proto_data *pdata, void *cb_data)
+{
+	const WorkerState *const state = (const WorkerState*)cb_data;
+	const srd_proto_data_annotation *const pda = (const srd_proto_data_annotation*)pdata->data;
+
+	const qint32 index = instance_index(state, pdata);
+
+	// Don't bother sending annotations that would be dropped anyway
+	if ((size_t)index < state->unrecorded_classes.size()) {
+		const vector<bool> &unrecorded = state->unrecorded_classes[index];
+		if ((pda->ann_class >= 0) && ((size_t)pda->ann_class < unrecorded.size()) &&
+			unrecorded[pda->ann_class])
+			return;
+	}
+
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	begin_output(stream, Worker::Message_Annotation, index, pdata);
+
+	QList<QByteArray> texts;
+	for (char **text = (char**)pda->ann_text; *text; text++)
+		texts << QByteArray(*text);
+
+	stream << (qint32)pda->ann_class << texts;
+
+	write_message(state->out_fd, message);
+}
+
+void binary_output(srd_proto_data *pdata, void *cb_data)
+{
+	const WorkerState *const state = (const WorkerState*)cb_data;
+	const srd_proto_data_binary *const pdb = (const srd_proto_data_binary*)pdata->data;
+
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	begin_output(stream, Worker::Message_Binary, instance_index(state, pdata), pdata);
+
+	stream << (qint32)pdb->bin_class << QByteArray((const char*)pdb->data, pdb->size);
+
+	write_message(state->out_fd, message);
+}
+
+void logic_output(srd_proto_data *pdata, void *cb_data)
+{
+	const WorkerState *const state = (const WorkerState*)cb_data;
+	const srd_proto_data_logic *const pdl = (const srd_proto_data_logic*)pdata->data;
+
+	const unsigned int channel_count =
+		g_slist_length(pdata->pdo->di->decoder->logic_output_channels);
+
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	begin_output(stream, Worker::Message_Logic, instance_index(state, pdata), pdata);
+
+	stream << (qint32)pdl->logic_group << (quint64)pdl->repeat_count <<
+		QByteArray((const char*)pdl->data, (channel_count + 7) / 8);
+
+	write_message(state->out_fd, message);
+}
+
+bool configure(WorkerState &state, QDataStream &stream, QSharedMemory &buffer,
+	QString &error)
+{
+	QString key;
+	quint64 samplerate;
+	quint32 decoder_count;
+	stream >> key >> samplerate >> decoder_count;
+
+	buffer.setKey(key);
+	if (!buffer.attach(QSharedMemory::ReadOnly)) {
+		error = buffer.errorString();
+		return false;
+	}
+
+	srd_session_new(&state.session);
+
+	srd_decoder_inst *prev_di = nullptr;
+	for (quint32 i = 0; i < decoder_count; i++) {
+		QByteArray id;
+		quint32 option_count;
+		stream >> id >> option_count;
+
+		if (!srd_decoder_get_by_id(id.constData()) &&
+			(srd_decoder_load(id.constData()) != SRD_OK)) {
+			error = QString("Failed to load protocol decoder %1").arg(QString::fromUtf8(id));
+			return false;
+		}
+
+		// Keep the options, they must be applied again after every reset
+		GHashTable *const opt_hash = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+		state.options.push_back(opt_hash);
+
+		for (quint32 j = 0; j < option_count; j++) {
+			QByteArray name, value;
+			stream >> name >> value;
+
+			GVariant *const gvar = g_variant_parse(nullptr, value.constData(),
+				nullptr, nullptr, nullptr);
+			if (gvar)
+				g_hash_table_replace(opt_hash, (void*)g_strdup(name.constData()), gvar);
+		}
+
+		QList<qint32> unrecorded_ids;
+		stream >> unrecorded_ids;
+
+		vector<bool> unrecorded;
+		for (qint32 ann_class_id : unrecorded_ids) {
+			if (ann_class_id < 0)
+				continue;
+			if ((size_t)ann_class_id >= unrecorded.size())
+				unrecorded.resize(ann_class_id + 1, false);
+			unrecorded[ann_class_id] = true;
+		}
+		state.unrecorded_classes.push_back(unrecorded);
+
+		srd_decoder_inst *const di = srd_inst_new(state.session, id.constData(), opt_hash);
+		if (!di) {
+			error = QString("Failed to create decoder instance");
+			return false;
+		}
+		state.instances.push_back(di);
+
+		// Setup the channels
+		quint32 channel_count, assigned_count;
+		stream >> channel_count >> assigned_count;
+
+		GArray *const init_pin_states = g_array_sized_new(false, true,
+			sizeof(uint8_t), channel_count);
+		g_array_set_size(init_pin_states, channel_count);
+
+		GHashTable *const channels = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+
+		for (quint32 j = 0; j < assigned_count; j++) {
+			QByteArray channel_id;
+			quint16 index, bit_id;
+			qint32 initial_pin_state;
+			stream >> channel_id >> index >> bit_id >> initial_pin_state;
+
+			if (index < channel_count)
+				init_pin_states->data[index] = initial_pin_state;
+
+			GVariant *const gvar = g_variant_new_int32(bit_id);
+			g_variant_ref_sink(gvar);
+			g_hash_table_insert(channels, (void*)g_strdup(channel_id.constData()), gvar);
+		}
+
+		srd_inst_channel_set_all(di, channels);
+		g_hash_table_destroy(channels);
+
+		srd_inst_initial_pins_set_all(di, init_pin_states);
+		g_array_free(init_pin_states, true);
+
+		if (prev_di)
+			srd_inst_stack(state.session, prev_di, di);
+
+		prev_di = di;
+	}
+
+	if (samplerate)
+		srd_session_metadata_set(state.session, SRD_CONF_SAMPLERATE,
+			g_variant_new_uint64(samplerate));
+
+	srd_pd_output_callback_add(state.session, SRD_OUTPUT_ANN, annotation_output, &state);
+	srd_pd_output_callback_add(state.session, SRD_OUTPUT_BINARY, binary_output, &state);
+	srd_pd_output_callback_add(state.session, SRD_OUTPUT_LOGIC, logic_output, &state);
+
+	srd_session_start(state.session);
+
+	return true;
+}
+
+}  // namespace
+
+const char *const Worker::Argument = "--decode-worker";
+
+const int Worker::PollInterval = 100;  // ms
+
+Worker::Worker(uint64_t buffer_size, OutputCallback annotation_callback,
+	OutputCallback binary_callback, OutputCallback logic_callback,
+	void *cb_data, const atomic<bool> &interrupt) :
+	annotation_callback_(annotation_callback),
+	binary_callback_(binary_callback),
+	logic_callback_(logic_callback),
+	cb_data_(cb_data),
+	interrupt_(interrupt),
+	output_decoder_index_(-1)
+{
+	// The key only needs to be unique among the buffers of this process
+	static atomic<unsigned int> buffer_count(0);
+	buffer_.setKey(QString("pulseview-decode-%1-%2")
+		.arg(QCoreApplication::applicationPid()).arg(buffer_count++));
+
+	bool created = buffer_.create(buffer_size);
+
+	// A crashed process may have left a buffer with the same key behind,
+	// attaching to and detaching from it releases it
+	if (!created && (buffer_.error() == QSharedMemory::AlreadyExists)) {
+		if (buffer_.attach())
+			buffer_.detach();
+		created = buffer_.create(buffer_size);
+	}
+
+	if (!created)
+		error_message_ = buffer_.errorString();
+}
+
+Worker::~Worker()
+{
+	if (process_ && (process_->state() != QProcess::NotRunning)) {
+		// The worker exits when its input is closed
+		process_->closeWriteChannel();
+
+		if (!process_->waitForFinished(1000)) {
+			process_->kill();
+			process_->waitForFinished();
+		}
+	}
+}
+
+bool Worker::start(const vector< shared_ptr<Decoder> > &stack, uint64_t samplerate)
+{
+	if (!buffer_.isAttached())
+		return false;
+
+	process_.reset(new QProcess());
+	process_->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+	process_->start(QCoreApplication::applicationFilePath(), QStringList(Argument));
+
+	if (!process_->waitForStarted()) {
+		error_message_ = process_->errorString();
+		return false;
+	}
+
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	stream << (qint32)Message_Config << buffer_.key() << (quint64)samplerate <<
+		(quint32)stack.size();
+
+	decoders_.clear();
+	for (const shared_ptr<Decoder>& dec : stack) {
+		decoders_.push_back(dec->get_srd_decoder());
+
+		stream << QByteArray(dec->get_srd_decoder()->id) << (quint32)dec->options().size();
+
+		for (const auto& option : dec->options()) {
+			gchar *const value = g_variant_print(option.second, true);
+			stream << QByteArray(option.first.c_str()) << QByteArray(value);
+			g_free(value);
+		}
+
+		// Classes that are unrecorded later on are still dropped by the caller
+		QList<qint32> unrecorded_ids;
+		for (const AnnotationClass* ann_class : dec->ann_classes())
+			if (!ann_class->recorded())
+				unrecorded_ids << (qint32)ann_class->id;
+		stream << unrecorded_ids;
+
+		vector<const DecodeChannel*> assigned_channels;
+		for (const DecodeChannel *ch : dec->channels())
+			if (ch->assigned_signal)
+				assigned_channels.push_back(ch);
+
+		stream << (quint32)dec->channels().size() << (quint32)assigned_channels.size();
+
+		for (const DecodeChannel *ch : assigned_channels)
+			stream << QByteArray(ch->pdch_->id) << (quint16)ch->id <<
+				(quint16)ch->bit_id << (qint32)ch->initial_pin_state;
+	}
+
+	return write_message(message) && wait_until_done();
+}
+
+uint8_t* Worker::buffer()
+{
+	return (uint8_t*)buffer_.data();
+}
+
+bool Worker::send(uint64_t start_sample, uint64_t end_sample, uint64_t size,
+	uint64_t unit_size)
+{
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	stream << (qint32)Message_Send << (quint64)start_sample <<
+		(quint64)end_sample << (quint64)size << (quint64)unit_size;
+
+	return write_message(message) && wait_until_done();
+}
+
+bool Worker::send_eof()
+{
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	stream << (qint32)Message_SendEof;
+
+	return write_message(message) && wait_until_done();
+}
+
+bool Worker::reset(uint64_t samplerate)
+{
+	QByteArray message;
+	QDataStream stream(&message, QIODevice::WriteOnly);
+	stream << (qint32)Message_Reset << (quint64)samplerate;
+
+	return write_message(message) && wait_until_done();
+}
+
+const QString& Worker::error_message() const
+{
+	return error_message_;
+}
+
+int Worker::output_decoder_index() const
+{
+	return output_decoder_index_;
+}
+
+int Worker::run()
+{
+	WorkerState state;
+	state.session = nullptr;
+
+	// Decoders may print to stdout, so use a separate descriptor for the
+	// messages and redirect stdout to stderr
+	state.out_fd = dup(STDOUT_FILENO);
+	dup2(STDERR_FILENO, STDOUT_FILENO);
+
+#ifdef _WIN32
+	_setmode(STDIN_FILENO, _O_BINARY);
+	_setmode(state.out_fd, _O_BINARY);
+#endif
+
+	if (srd_init(nullptr) != SRD_OK)
+		return 1;
+
+	QSharedMemory buffer;
+	QByteArray message;
+	quint32 message_size;
+
+	// Process the messages until the input is closed
+	while (read_all(STDIN_FILENO, (char*)&message_size, sizeof(message_size))) {
+		message.resize(message_size);
+		if (!read_all(STDIN_FILENO, message.data(), message_size))
+			break;
+
+		QDataStream stream(message);
+		qint32 type;
+		stream >> type;
+
+		bool ok = true;
+		QString error;
+
+		switch (type) {
+		case Message_Config:
+			ok = !state.session && configure(state, stream, buffer, error);
+			break;
+
+		case Message_Send:
+		{
+			quint64 start_sample, end_sample, size, unit_size;
+			stream >> start_sample >> end_sample >> size >> unit_size;
+
+			ok = state.session && (size <= (quint64)buffer.size()) &&
+				(srd_session_send(state.session, start_sample, end_sample,
+					(const uint8_t*)buffer.constData(), size, unit_size) == SRD_OK);
+			if (!ok)
+				error = QString("Decoder reported an error");
+			break;
+		}
+
+		case Message_SendEof:
+#if defined HAVE_SRD_SESSION_SEND_EOF && HAVE_SRD_SESSION_SEND_EOF
+			if (state.session)
+				(void)srd_session_send_eof(state.session);
+#endif
+			break;
+
+		case Message_Reset:
+		{
+			quint64 samplerate;
+			stream >> samplerate;
+
+			if (!state.session)
+				break;
+
+			srd_session_terminate_reset(state.session);
+
+			// Metadata and options are cleared also, so re-set them
+			if (samplerate)
+				srd_session_metadata_set(state.session, SRD_CONF_SAMPLERATE,
+					g_variant_new_uint64(samplerate));
+			for (size_t i = 0; i < state.instances.size(); i++)
+				srd_inst_option_set(state.instances[i], state.options[i]);
+			break;
+		}
+
+		default:
+			ok = false;
+			error = QString("Unknown message type %1").arg(type);
+		}
+
+		QByteArray reply;
+		QDataStream reply_stream(&reply, QIODevice::WriteOnly);
+		if (ok)
+			reply_stream << (qint32)Message_Done;
+		else
+			reply_stream << (qint32)Message_Error << error;
+
+		if (!write_message(state.out_fd, reply))
+			break;
+	}
+
+	if (state.session)
+		srd_session_destroy(state.session);
+
+	for (GHashTable *opt_hash : state.options)
+		g_hash_table_destroy(opt_hash);
+
+	buffer.detach();
+	srd_exit();
+
+	return 0;
+}
+
+bool Worker::write_message(const QByteArray &message)
+{
+	const quint32 size = message.size();
+
+	process_->write((const char*)&size, sizeof(size));
+	process_->write(message);
+
+	while (process_->bytesToWrite() > 0)
+		if (!process_->waitForBytesWritten(PollInterval) &&
+			(interrupt_ || (process_->state() == QProcess::NotRunning))) {
+			error_message_ = process_->errorString();
+			return false;
+		}
+
+	return true;
+}
+
+bool Worker::read_bytes(char *data, qint64 size)
+{
+	while (process_->bytesAvailable() < size) {
+		if (interrupt_)
+			return false;
+
+		if (!process_->waitForReadyRead(PollInterval) &&
+			(process_->state() == QProcess::NotRunning)) {
+			error_message_ = QString("Worker process exited unexpectedly");
+			return false;
+		}
+	}
+
+	return (process_->read(data, size) == size);
+}
+
+bool Worker::wait_until_done()
+{
+	QByteArray message;
+	quint32 message_size;
+
+	// Hand all decoder output to the callbacks until the worker is done
+	while (read_bytes((char*)&message_size, sizeof(message_size))) {
+		message.resize(message_size);
+		if (!read_bytes(message.data(), message_size))
+			return false;
+
+		QDataStream stream(message);
+		qint32 type;
+		stream >> type;
+
+		if (type == Message_Done)
+			return true;
+
+		if (type == Message_Error) {
+			stream >> error_message_;
+			return false;
+		}
+
+		dispatch_output(type, stream);
+	}
+
+	return false;
+}
+
+void Worker::dispatch_output(int type, QDataStream &stream)
+{
+	qint32 index;
+	quint64 start_sample, end_sample;
+	stream >> index >> start_sample >> end_sample;
+
+	if ((index < 0) || ((size_t)index >= decoders_.size())) {
+		qWarning() << "Decoder worker sent output for unknown decoder" << index;
+		return;
+	}
+
+	// Only the decoder of the instance is used by the callbacks
+	srd_decoder_inst di;
+	memset(&di, 0, sizeof(di));
+	di.decoder = (srd_decoder*)decoders_[index];
+
+	srd_pd_output pdo;
+	memset(&pdo, 0, sizeof(pdo));
+	pdo.di = &di;
+
+	srd_proto_data pdata;
+	memset(&pdata, 0, sizeof(pdata));
+	pdata.start_sample = start_sample;
+	pdata.end_sample = end_sample;
+	pdata.pdo = &pdo;
+
+	output_decoder_index_ = index;
+
+	switch (type) {
+	case Message_Annotation:
+	{
+		qint32 ann_class;
+		QList<QByteArray> texts;
+		stream >> ann_class >> texts;
+
+		vector<char*> ann_text;
+		for (QByteArray& text : texts)
+			ann_text.push_back(text.data());
+		ann_text.push_back(nullptr);
+
+		srd_proto_data_annotation pda;
+		pda.ann_class = ann_class;
+		pda.ann_text = ann_text.data();
+
+		pdo.output_type = SRD_OUTPUT_ANN;
+		pdata.data = &pda;
+		annotation_callback_(&pdata, cb_data_);
+		break;
+	}
+
+	case Message_Binary:
+	{
+		qint32 bin_class;
+		QByteArray data;
+		stream >> bin_class >> data;
+
+		srd_proto_data_binary pdb;
+		pdb.bin_class = bin_class;
+		pdb.size = data.size();
+		pdb.data = (unsigned char*)data.data();
+
+		pdo.output_type = SRD_OUTPUT_BINARY;
+		pdata.data = &pdb;
+		binary_callback_(&pdata, cb_data_);
+		break;
+	}
+
+	case Message_Logic:
+	{
+		qint32 logic_group;
+		quint64 repeat_count;
+		QByteArray data;
+		stream >> logic_group >> repeat_count >> data;
+
+		srd_proto_data_logic pdl;
+		pdl.logic_group = logic_group;
+		pdl.repeat_count = repeat_count;
+		pdl.data = (uint8_t*)data.data();
+
+		pdo.output_type = SRD_OUTPUT_LOGIC;
+		pdata.data = &pdl;
+		logic_callback_(&pdata, cb_data_);
+		break;
+	}
+
+	default:
+		qWarning() << "Decoder worker sent unknown message type" << type;
+	}
+
+	output_decoder_index_ = -1;
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
@@ -0,0 +1,133 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_WORKER_HPP
+#define PULSEVIEW_PV_DATA_DECODE_WORKER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QString>
+
+using std::atomic;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+struct srd_decoder;
+struct srd_proto_data;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+class Decoder;
+
+/**
+ * Runs a decoder stack in a separate PulseView process so that decoder
+ * stacks aren't serialized by the lock of the shared Python interpreter.
+ *
+ * The samples of each chunk are passed through shared memory, the decoder
+ * output is streamed back through a pipe and handed to the same callbacks
+ * libsigrokdecode would call. All calls are synchronous and must be made
+ * from the same thread, which owns the process.
+ */
+class Worker
+{
+public:
+	/// The command line argument that makes PulseView run as a worker
+	static const char *const Argument;
+
+	typedef void (*OutputCallback)(srd_proto_data *pdata, void *cb_data);
+
+	enum MessageType {
+		Message_Config,
+		Message_Send,
+		Message_SendEof,
+		Message_Reset,
+		Message_Done,
+		Message_Error,
+		Message_Annotation,
+		Message_Binary,
+		Message_Logic
+	};
+
+private:
+	static const int PollInterval;
+
+public:
+	Worker(uint64_t buffer_size, OutputCallback annotation_callback,
+		OutputCallback binary_callback, OutputCallback logic_callback,
+		void *cb_data, const atomic<bool> &interrupt);
+	~Worker();
+
+	/// Starts the worker process and creates the decoder stack in it
+	bool start(const vector< shared_ptr<Decoder> > &stack, uint64_t samplerate);
+
+	/// The shared memory the samples must be put in before calling send()
+	uint8_t* buffer();
+
+	bool send(uint64_t start_sample, uint64_t end_sample, uint64_t size,
+		uint64_t unit_size);
+	bool send_eof();
+
+	/// Resets the decoder state but keeps the decoder stack intact
+	bool reset(uint64_t samplerate);
+
+	const QString& error_message() const;
+
+	/**
+	 * Returns the position in the stack of the decoder whose output is
+	 * being passed to a callback, or -1 outside of the callbacks. Unlike
+	 * the decoder of the output, it tells apart several instances of the
+	 * same decoder.
+	 */
+	int output_decoder_index() const;
+
+	/// Entry point of the worker process
+	static int run();
+
+private:
+	bool write_message(const QByteArray &message);
+	bool read_bytes(char *data, qint64 size);
+	bool wait_until_done();
+	void dispatch_output(int type, QDataStream &stream);
+
+private:
+	const OutputCallback annotation_callback_, binary_callback_, logic_callback_;
+	void *const cb_data_;
+	const atomic<bool> &interrupt_;
+
+	QSharedMemory buffer_;
+	unique_ptr<QProcess> process_;
+	vector<const srd_decoder*> decoders_;
+	int output_decoder_index_;
+
+	QString error_message_;
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_WORKER_HPP
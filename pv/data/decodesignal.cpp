@@ -35,13 +35,17 @@
 
 #include <pv/data/decode/decoder.hpp>
 #include <pv/data/decode/row.hpp>
+#include <pv/decodercatalog.hpp>
 #include <pv/globalsettings.hpp>
+#include <pv/profiling.hpp>
 #include <pv/session.hpp>
 
 using std::dynamic_pointer_cast;
 using std::lock_guard;
 using std::make_shared;
+using std::max;
 using std::min;
+using std::numeric_limits;
 using std::out_of_range;
 using std::shared_ptr;
 using std::unique_lock;
@@ -54,15 +58,23 @@ namespace data {
 const double DecodeSignal::DecodeMargin = 1.0;
 const double DecodeSignal::DecodeThreshold = 0.2;
 const int64_t DecodeSignal::DecodeChunkLength = 256 * 1024;
+const uint64_t DecodeSignal::DefaultDecodePreroll = 100000;
 
 
 DecodeSignal::DecodeSignal(pv::Session &session) :
 	SignalBase(nullptr, SignalBase::DecodeChannel),
 	session_(session),
 	srd_session_(nullptr),
+	use_worker_(false),
 	logic_mux_data_invalid_(false),
+	logic_mux_start_(0),
 	stack_config_changed_(true),
-	current_segment_id_(0)
+	current_segment_id_(0),
+	decode_finished_(false),
+	decode_range_enabled_(false),
+	decode_range_start_(0),
+	decode_range_end_(0),
+	decode_preroll_(DefaultDecodePreroll)
 {
 	connect(&session_, SIGNAL(capture_state_changed(int)),
 		this, SLOT(on_capture_state_changed(int)));
@@ -185,14 +197,18 @@ void DecodeSignal::reset_decode(bool shutting_down)
 	}
 
 	current_segment_id_ = 0;
+	decode_finished_ = false;
 	segments_.clear();
+	staged_annotations_.clear();
 
 	for (const shared_ptr<decode::Decoder>& dec : stack_)
 		if (dec->has_logic_output())
 			output_logic_[dec->get_srd_decoder()]->clear();
 
-	logic_mux_data_.reset();
-	logic_mux_data_invalid_ = true;
+	// The muxed input data is kept unless the input changed, so that
+	// changing the decoder stack or its options re-decodes immediately
+	if (logic_mux_data_invalid_)
+		logic_mux_data_.reset();
 
 	if (!error_message_.isEmpty()) {
 		error_message_.clear();
@@ -246,6 +262,21 @@ void DecodeSignal::begin_decode()
 			return;
 		}
 
+	// Muxing can only continue at the end of the last segment, so earlier
+	// segments that were cut off at the end of a decode range can't be reused.
+	// Neither can segments that start after the first sample to decode
+	const uint64_t decode_start = decode_start_sample();
+	if (logic_mux_data_ && !logic_mux_data_invalid_) {
+		const deque< shared_ptr<LogicSegment> >& mux_segments =
+			logic_mux_data_->logic_segments();
+		for (size_t i = 0; (i + 1) < mux_segments.size(); i++)
+			if (!mux_segments[i]->is_complete())
+				logic_mux_data_invalid_ = true;
+
+		if (logic_mux_start_ > decode_start)
+			logic_mux_data_invalid_ = true;
+	}
+
 	// Free the logic data and its segment(s) if it needs to be updated
 	if (logic_mux_data_invalid_)
 		logic_mux_data_.reset();
@@ -254,6 +285,9 @@ void DecodeSignal::begin_decode()
 		const uint32_t ch_count = get_assigned_signal_count();
 		logic_mux_unit_size_ = (ch_count + 7) / 8;
 		logic_mux_data_ = make_shared<Logic>(ch_count);
+
+		// Nothing before the decode range and its pre-roll needs to be muxed
+		logic_mux_start_ = decode_start;
 	}
 
 	if (get_input_segment_count() == 0)
@@ -263,6 +297,9 @@ void DecodeSignal::begin_decode()
 	logic_mux_interrupt_ = false;
 	logic_mux_thread_ = std::thread(&DecodeSignal::logic_mux_proc, this);
 
+	GlobalSettings settings;
+	use_worker_ = settings.value(GlobalSettings::Key_Dec_UseWorkerProcesses).toBool();
+
 	// Decode the muxed logic data
 	decode_interrupt_ = false;
 	decode_thread_ = std::thread(&DecodeSignal::decode_proc, this);
@@ -287,6 +324,147 @@ bool DecodeSignal::is_paused() const
 	return decode_paused_;
 }
 
+bool DecodeSignal::is_decode_finished() const
+{
+	return decode_finished_;
+}
+
+void DecodeSignal::set_decode_range(uint64_t start_sample, uint64_t end_sample)
+{
+	assert(start_sample < end_sample);
+
+	// Stop the decode threads before they see the new range
+	reset_decode();
+
+	decode_range_enabled_ = true;
+	decode_range_start_ = start_sample;
+	decode_range_end_ = end_sample;
+
+	begin_decode();
+}
+
+void DecodeSignal::clear_decode_range()
+{
+	if (!decode_range_enabled_)
+		return;
+
+	reset_decode();
+	decode_range_enabled_ = false;
+	begin_decode();
+}
+
+bool DecodeSignal::has_decode_range() const
+{
+	return decode_range_enabled_;
+}
+
+uint64_t DecodeSignal::decode_range_start() const
+{
+	return decode_range_start_;
+}
+
+uint64_t DecodeSignal::decode_range_end() const
+{
+	return decode_range_end_;
+}
+
+void DecodeSignal::set_decode_preroll(uint64_t sample_count)
+{
+	if (sample_count == decode_preroll_)
+		return;
+
+	// The pre-roll doesn't matter if the entire input is decoded
+	if (!decode_range_enabled_) {
+		decode_preroll_ = sample_count;
+		return;
+	}
+
+	reset_decode();
+	decode_preroll_ = sample_count;
+	begin_decode();
+}
+
+uint64_t DecodeSignal::decode_preroll() const
+{
+	return decode_preroll_;
+}
+
+shared_ptr<decode::Sweep> DecodeSignal::start_sweep(size_t decoder_index,
+	const string &option_id, const vector<GVariant*> &values,
+	uint32_t segment_id, uint64_t start_sample, uint64_t end_sample)
+{
+	cancel_sweep();
+
+	if ((decoder_index >= stack_.size()) || values.empty() || !logic_mux_data_ ||
+		(segment_id >= logic_mux_data_->logic_segments().size()))
+		return nullptr;
+
+	const shared_ptr<const LogicSegment> input =
+		logic_mux_data_->logic_segments()[segment_id]->get_shared_ptr();
+
+	if (!input || (max(start_sample, logic_mux_start_) >=
+		min(end_sample, logic_mux_start_ + input->get_sample_count())))
+		return nullptr;
+
+	sweep_ = make_shared<decode::Sweep>(stack_, decoder_index, option_id, values,
+		input, logic_mux_start_, start_sample, end_sample);
+	sweep_->start();
+
+	return sweep_;
+}
+
+void DecodeSignal::cancel_sweep()
+{
+	if (sweep_)
+		sweep_->cancel();
+
+	sweep_.reset();
+}
+
+shared_ptr<decode::Sweep> DecodeSignal::sweep() const
+{
+	return sweep_;
+}
+
+bool DecodeSignal::apply_sweep_result(size_t result_index)
+{
+	if (!sweep_)
+		return false;
+
+	const vector<decode::Sweep::Result> results = sweep_->results();
+	const size_t decoder_index = sweep_->decoder_index();
+
+	if ((result_index >= results.size()) || (decoder_index >= stack_.size()) ||
+		(stack_[decoder_index]->get_srd_decoder() != sweep_->get_srd_decoder()))
+		return false;
+
+	stack_[decoder_index]->set_option(sweep_->option_id().c_str(),
+		results[result_index].value);
+	begin_decode();
+
+	return true;
+}
+
+void DecodeSignal::set_ann_classes_recorded(
+	const vector<AnnotationClass*> &ann_classes, bool recorded)
+{
+	bool restart = false;
+
+	for (AnnotationClass* ann_class : ann_classes) {
+		if (ann_class->recorded() == recorded)
+			continue;
+
+		ann_class->set_recorded(recorded);
+
+		// The annotations dropped so far must be decoded again
+		if (recorded)
+			restart = true;
+	}
+
+	if (restart)
+		begin_decode();
+}
+
 const vector<decode::DecodeChannel> DecodeSignal::get_channels() const
 {
 	return channels_;
@@ -747,6 +925,83 @@ const deque<const Annotation*>* DecodeSignal::get_all_annotations_by_segment(
 	return &(segment->all_annotations);
 }
 
+uint64_t DecodeSignal::get_first_changed_annotation_index(uint32_t segment_id,
+	uint64_t prev_count, uint64_t &count) const
+{
+	lock_guard<mutex> lock(output_mutex_);
+
+	count = 0;
+
+	if (segment_id >= segments_.size())
+		return 0;
+
+	const DecodeSegment &segment = segments_[segment_id];
+	count = segment.all_annotations.size();
+
+	// The list only grows, so only the most recent batches are of interest
+	uint64_t result = min(prev_count, count);
+	for (auto it = segment.all_annotations_changes.rbegin();
+		(it != segment.all_annotations_changes.rend()) && (it->first > prev_count); it++)
+		result = min(result, it->second);
+
+	return result;
+}
+
+void DecodeSignal::export_annotations(QTextStream &out_stream,
+	const deque<const Annotation*> &annotations, QString format,
+	const QString &line_prefix)
+{
+	const QString quote = format.contains("%q") ? "\"" : "";
+	format = format.remove("%q");
+
+	const bool has_sample_range   = format.contains("%s");
+	const bool has_row_name       = format.contains("%r");
+	const bool has_dec_name       = format.contains("%d");
+	const bool has_class_name     = format.contains("%c");
+	const bool has_first_ann_text = format.contains("%1");
+	const bool has_all_ann_text   = format.contains("%a");
+
+	for (const Annotation* ann : annotations) {
+		QString out_text = format;
+
+		if (has_sample_range) {
+			const QString sample_range = QString("%1-%2") \
+				.arg(QString::number(ann->start_sample()), QString::number(ann->end_sample()));
+			out_text = out_text.replace("%s", sample_range);
+		}
+
+		if (has_dec_name)
+			out_text = out_text.replace("%d",
+				quote + QString::fromUtf8(ann->row()->decoder()->name()) + quote);
+
+		if (has_row_name) {
+			const QString row_name = quote + ann->row()->description() + quote;
+			out_text = out_text.replace("%r", row_name);
+		}
+
+		if (has_class_name) {
+			const QString class_name = quote + ann->ann_class_name() + quote;
+			out_text = out_text.replace("%c", class_name);
+		}
+
+		if (has_first_ann_text) {
+			const QString first_ann_text = quote + ann->annotations()->front() + quote;
+			out_text = out_text.replace("%1", first_ann_text);
+		}
+
+		if (has_all_ann_text) {
+			QString all_ann_text;
+			for (const QString &s : *(ann->annotations()))
+				all_ann_text = all_ann_text + quote + s + quote + ",";
+			all_ann_text.chop(1);
+
+			out_text = out_text.replace("%a", all_ann_text);
+		}
+
+		out_stream << line_prefix << out_text << '\n';
+	}
+}
+
 void DecodeSignal::save_settings(QSettings &settings) const
 {
 	SignalBase::save_settings(settings);
@@ -795,6 +1050,7 @@ void DecodeSignal::save_settings(QSettings &settings) const
 		for (const AnnotationClass* ann_class : decoder->ann_classes()) {
 			settings.beginGroup("ann_class" + QString::number(i));
 			settings.setValue("visible", ann_class->visible());
+			settings.setValue("recorded", ann_class->recorded());
 			settings.endGroup();
 			i++;
 		}
@@ -825,6 +1081,11 @@ void DecodeSignal::save_settings(QSettings &settings) const
 		settings.endGroup();
 	}
 
+	settings.setValue("decode_range", decode_range_enabled_);
+	settings.setValue("decode_range_start", (qulonglong)decode_range_start_);
+	settings.setValue("decode_range_end", (qulonglong)decode_range_end_);
+	settings.setValue("decode_preroll", (qulonglong)decode_preroll_);
+
 	// TODO Save logic output signal settings
 }
 
@@ -833,8 +1094,6 @@ void DecodeSignal::restore_settings(QSettings &settings)
 	SignalBase::restore_settings(settings);
 
 	// Restore decoder stack
-	GSList *dec_list = g_slist_copy((GSList*)srd_decoder_list());
-
 	int decoders = settings.value("decoders").toInt();
 
 	for (int decoder_idx = 0; decoder_idx < decoders; decoder_idx++) {
@@ -842,53 +1101,49 @@ void DecodeSignal::restore_settings(QSettings &settings)
 
 		QString id = settings.value("id").toString();
 
-		for (GSList *entry = dec_list; entry; entry = entry->next) {
-			const srd_decoder *dec = (srd_decoder*)entry->data;
-			if (!dec)
-				continue;
-
-			if (QString::fromUtf8(dec->id) == id) {
-				shared_ptr<Decoder> decoder = make_shared<Decoder>(dec, stack_.size());
+		// The decoder module is imported when it is first used
+		const srd_decoder *dec = decoder_catalog.get_decoder(id);
 
-				connect(decoder.get(), SIGNAL(annotation_visibility_changed()),
-					this, SLOT(on_annotation_visibility_changed()));
+		if (dec) {
+			shared_ptr<Decoder> decoder = make_shared<Decoder>(dec, stack_.size());
 
-				stack_.push_back(decoder);
-				decoder->set_visible(settings.value("visible", true).toBool());
+			connect(decoder.get(), SIGNAL(annotation_visibility_changed()),
+				this, SLOT(on_annotation_visibility_changed()));
 
-				// Restore decoder options that differ from their default
-				int options = settings.value("options").toInt();
+			stack_.push_back(decoder);
+			decoder->set_visible(settings.value("visible", true).toBool());
 
-				for (int i = 0; i < options; i++) {
-					settings.beginGroup("option" + QString::number(i));
-					QString name = settings.value("name").toString();
-					GVariant *value = GlobalSettings::restore_gvariant(settings);
-					decoder->set_option(name.toUtf8(), value);
-					settings.endGroup();
-				}
+			// Restore decoder options that differ from their default
+			int options = settings.value("options").toInt();
 
-				// Include the newly created decode channels in the channel lists
-				update_channel_list();
+			for (int i = 0; i < options; i++) {
+				settings.beginGroup("option" + QString::number(i));
+				QString name = settings.value("name").toString();
+				GVariant *value = GlobalSettings::restore_gvariant(settings);
+				decoder->set_option(name.toUtf8(), value);
+				settings.endGroup();
+			}
 
-				// Restore row properties
-				int i = 0;
-				for (Row* row : decoder->get_rows()) {
-					settings.beginGroup("row" + QString::number(i));
-					row->set_visible(settings.value("visible", true).toBool());
-					settings.endGroup();
-					i++;
-				}
+			// Include the newly created decode channels in the channel lists
+			update_channel_list();
 
-				// Restore class properties
-				i = 0;
-				for (AnnotationClass* ann_class : decoder->ann_classes()) {
-					settings.beginGroup("ann_class" + QString::number(i));
-					ann_class->set_visible(settings.value("visible", true).toBool());
-					settings.endGroup();
-					i++;
-				}
+			// Restore row properties
+			int i = 0;
+			for (Row* row : decoder->get_rows()) {
+				settings.beginGroup("row" + QString::number(i));
+				row->set_visible(settings.value("visible", true).toBool());
+				settings.endGroup();
+				i++;
+			}
 
-				break;
+			// Restore class properties
+			i = 0;
+			for (AnnotationClass* ann_class : decoder->ann_classes()) {
+				settings.beginGroup("ann_class" + QString::number(i));
+				ann_class->set_visible(settings.value("visible", true).toBool());
+				ann_class->set_recorded(settings.value("recorded", true).toBool());
+				settings.endGroup();
+				i++;
 			}
 		}
 
@@ -932,6 +1187,13 @@ void DecodeSignal::restore_settings(QSettings &settings)
 	commit_decoder_channels();
 	update_output_signals();
 
+	decode_range_start_ = settings.value("decode_range_start").toULongLong();
+	decode_range_end_ = settings.value("decode_range_end").toULongLong();
+	decode_range_enabled_ = settings.value("decode_range", false).toBool() &&
+		(decode_range_start_ < decode_range_end_);
+	decode_preroll_ = settings.value("decode_preroll",
+		(qulonglong)DefaultDecodePreroll).toULongLong();
+
 	// TODO Restore logic output signal settings
 
 	begin_decode();
@@ -1116,12 +1378,25 @@ void DecodeSignal::commit_decoder_channels()
 			ch.bit_id = id++;
 }
 
+uint64_t DecodeSignal::decode_start_sample() const
+{
+	// Decoding starts early by the pre-roll so that the decoders are in sync
+	// with the data once the decode range begins
+	if (!decode_range_enabled_ || (decode_range_start_ <= decode_preroll_))
+		return 0;
+
+	return decode_range_start_ - decode_preroll_;
+}
+
 void DecodeSignal::mux_logic_samples(uint32_t segment_id, const int64_t start, const int64_t end)
 {
 	// Enforce end to be greater than start
 	if (end <= start)
 		return;
 
+	ProfilingScope profiling_scope(profiling_stage(DecodeMuxProfilingStage),
+		end - start);
+
 	// Fetch the channel segments and their data
 	vector<shared_ptr<const LogicSegment> > segments;
 	vector<const uint8_t*> signal_data;
@@ -1222,23 +1497,39 @@ void DecodeSignal::logic_mux_proc()
 
 	assert(logic_mux_data_);
 
-	uint32_t segment_id = 0;
+	uint32_t segment_id;
+	shared_ptr<LogicSegment> output_segment;
 
-	// Create initial logic mux segment
-	shared_ptr<LogicSegment> output_segment =
-		make_shared<LogicSegment>(*logic_mux_data_, segment_id, logic_mux_unit_size_, 0);
-	logic_mux_data_->push_segment(output_segment);
+	if (logic_mux_data_->logic_segments().empty()) {
+		// Create initial logic mux segment
+		segment_id = 0;
+		output_segment = make_shared<LogicSegment>(*logic_mux_data_, segment_id,
+			logic_mux_unit_size_, 0);
+		logic_mux_data_->push_segment(output_segment);
 
-	output_segment->set_samplerate(get_input_samplerate(0));
+		output_segment->set_samplerate(get_input_samplerate(0));
+	} else {
+		// Continue where the previous run left off
+		segment_id = logic_mux_data_->logic_segments().size() - 1;
+		output_segment = logic_mux_data_->logic_segments().back();
+	}
 
 	// Logic mux data is being updated
 	logic_mux_data_invalid_ = false;
 
+	// Nothing beyond the decode range needs to be muxed
+	const uint64_t mux_end = decode_range_enabled_ ?
+		decode_range_end_ : numeric_limits<uint64_t>::max();
+
 	uint64_t samples_to_process;
 	do {
 		do {
-			const uint64_t input_sample_count = get_working_sample_count(segment_id);
-			const uint64_t output_sample_count = output_segment->get_sample_count();
+			const uint64_t input_sample_count =
+				min((uint64_t)get_working_sample_count(segment_id), mux_end);
+
+			// The output segments start at logic_mux_start_
+			const uint64_t output_sample_count =
+				logic_mux_start_ + output_segment->get_sample_count();
 
 			samples_to_process =
 				(input_sample_count > output_sample_count) ?
@@ -1268,7 +1559,10 @@ void DecodeSignal::logic_mux_proc()
 
 			// If the input segments are complete, we've completed this segment
 			if (all_input_segments_complete(segment_id)) {
-				if (!output_segment->is_complete())
+				// A segment cut off at the end of the decode range isn't complete
+				if (!output_segment->is_complete() &&
+					((int64_t)(logic_mux_start_ + output_segment->get_sample_count()) >=
+						get_working_sample_count(segment_id)))
 					output_segment->set_complete();
 
 				if (segment_id < get_input_segment_count() - 1) {
@@ -1303,6 +1597,8 @@ void DecodeSignal::decode_data(
 	const int64_t unit_size = input_segment->unit_size();
 	const int64_t chunk_sample_count = DecodeChunkLength / unit_size;
 
+	Profiling::Stage* const decode_stage = profiling_stage(DecodeProfilingStage);
+
 	for (int64_t i = abs_start_samplenum;
 		!decode_interrupt_ && (i < (abs_start_samplenum + sample_count));
 		i += chunk_sample_count) {
@@ -1316,20 +1612,35 @@ void DecodeSignal::decode_data(
 			segments_.at(current_segment_id_).samples_decoded_incl = chunk_end;
 		}
 
+		// The worker reads the samples directly from its shared memory.
+		// The muxed input starts at logic_mux_start_, while the decoders
+		// get the sample numbers of the input signals
 		int64_t data_size = (chunk_end - i) * unit_size;
-		uint8_t* chunk = new uint8_t[data_size];
-		input_segment->get_samples(i, chunk_end, chunk);
+		uint8_t* chunk = worker_ ? worker_->buffer() : new uint8_t[data_size];
+		input_segment->get_samples(i - logic_mux_start_, chunk_end - logic_mux_start_, chunk);
 
-		if (srd_session_send(srd_session_, i, chunk_end, chunk,
-				data_size, unit_size) != SRD_OK) {
-			set_error_message(tr("Decoder reported an error"));
-			decode_interrupt_ = true;
+		{
+			ProfilingScope profiling_scope(decode_stage, chunk_end - i);
+
+			const bool ok = worker_ ?
+				worker_->send(i, chunk_end, data_size, unit_size) :
+				(srd_session_send(srd_session_, i, chunk_end, chunk,
+					data_size, unit_size) == SRD_OK);
+
+			if (!ok && !decode_interrupt_) {
+				if (worker_)
+					qWarning().nospace() << name() << ": " << worker_->error_message();
+				set_error_message(tr("Decoder reported an error"));
+				decode_interrupt_ = true;
+			}
 		}
 
-		delete[] chunk;
+		if (!worker_)
+			delete[] chunk;
 
 		{
 			lock_guard<mutex> lock(output_mutex_);
+			publish_annotations();
 			// Now that all samples are processed, the exclusive sample count catches up
 			segments_.at(current_segment_id_).samples_decoded_excl = chunk_end;
 		}
@@ -1346,6 +1657,14 @@ void DecodeSignal::decode_data(
 }
 
 void DecodeSignal::decode_proc()
+{
+	decode_segments();
+
+	// The worker process must be stopped by the thread that started it
+	worker_.reset();
+}
+
+void DecodeSignal::decode_segments()
 {
 	current_segment_id_ = 0;
 
@@ -1370,14 +1689,24 @@ void DecodeSignal::decode_proc()
 	segments_.at(current_segment_id_).samplerate = input_segment->samplerate();
 	segments_.at(current_segment_id_).start_time = input_segment->start_time();
 
+	const uint64_t decode_start = decode_start_sample();
+	const uint64_t decode_end = decode_range_enabled_ ?
+		decode_range_end_ : numeric_limits<uint64_t>::max();
+
+	segments_.at(current_segment_id_).samples_decoded_incl = decode_start;
+	segments_.at(current_segment_id_).samples_decoded_excl = decode_start;
+
 	start_srd_session();
 
 	uint64_t samples_to_process = 0;
-	uint64_t abs_start_samplenum = 0;
+	uint64_t abs_start_samplenum = decode_start;
 	do {
 		// Keep processing new samples until we exhaust the input data
 		do {
-			samples_to_process = input_segment->get_sample_count() - abs_start_samplenum;
+			const uint64_t end_samplenum =
+				min(logic_mux_start_ + input_segment->get_sample_count(), decode_end);
+			samples_to_process = (end_samplenum > abs_start_samplenum) ?
+				(end_samplenum - abs_start_samplenum) : 0;
 
 			if (samples_to_process > 0) {
 				decode_data(abs_start_samplenum, samples_to_process, input_segment);
@@ -1388,13 +1717,21 @@ void DecodeSignal::decode_proc()
 		if (!decode_interrupt_) {
 			// samples_to_process is now 0, we've exhausted the currently available input data
 
-			// If the input segment is complete, we've exhausted this segment
-			if (input_segment->is_complete()) {
+			// If the input segment is complete or we reached the end of the
+			// decode range, we've exhausted this segment
+			if (input_segment->is_complete() || (abs_start_samplenum >= decode_end)) {
 #if defined HAVE_SRD_SESSION_SEND_EOF && HAVE_SRD_SESSION_SEND_EOF
 				// Tell protocol decoders about the end of
 				// the input data, which may result in more
 				// annotations being emitted
-				(void)srd_session_send_eof(srd_session_);
+				if (worker_)
+					(void)worker_->send_eof();
+				else
+					(void)srd_session_send_eof(srd_session_);
+				{
+					lock_guard<mutex> lock(output_mutex_);
+					publish_annotations();
+				}
 				new_annotations();
 #endif
 
@@ -1406,24 +1743,31 @@ void DecodeSignal::decode_proc()
 						input_segment = logic_mux_data_->logic_segments().at(current_segment_id_);
 					} catch (out_of_range&) {
 						qDebug() << "Decode error for" << name() << ": no logic mux segment" \
-							<< current_segment_id_ << "in decode_proc(), mux segments size is" \
+							<< current_segment_id_ << "in decode_segments(), mux segments size is" \
 							<< logic_mux_data_->logic_segments().size();
 						decode_interrupt_ = true;
 						return;
 					}
-					abs_start_samplenum = 0;
+					abs_start_samplenum = decode_start;
 
 					// Create the next segment and set its metadata
 					create_decode_segment();
 					segments_.at(current_segment_id_).samplerate = input_segment->samplerate();
 					segments_.at(current_segment_id_).start_time = input_segment->start_time();
+					segments_.at(current_segment_id_).samples_decoded_incl = decode_start;
+					segments_.at(current_segment_id_).samples_decoded_excl = decode_start;
 
 					// Reset decoder state but keep the decoder stack intact
-					terminate_srd_session();
+					if (worker_)
+						(void)worker_->reset(segments_.at(current_segment_id_).samplerate);
+					else
+						terminate_srd_session();
 				} else {
 					// All segments have been processed
-					if (!decode_interrupt_)
+					if (!decode_interrupt_) {
+						decode_finished_ = true;
 						decode_finished();
+					}
 
 					// Wait for more input data
 					unique_lock<mutex> input_wait_lock(input_mutex_);
@@ -1441,6 +1785,11 @@ void DecodeSignal::decode_proc()
 
 void DecodeSignal::start_srd_session()
 {
+	if (use_worker_) {
+		start_worker();
+		return;
+	}
+
 	// If there were stack changes, the session has been destroyed by now, so if
 	// it hasn't been destroyed, we can just reset and re-use it
 	if (srd_session_) {
@@ -1513,6 +1862,26 @@ void DecodeSignal::start_srd_session()
 	stack_config_changed_ = false;
 }
 
+void DecodeSignal::start_worker()
+{
+	// Update the samplerates for the output logic channels
+	update_output_signals();
+
+	worker_.reset(new decode::Worker(DecodeChunkLength, annotation_callback,
+		binary_callback, logic_output_callback, this, decode_interrupt_));
+
+	uint64_t samplerate = 0;
+	if (segments_.size() > 0)
+		samplerate = segments_.at(current_segment_id_).samplerate;
+
+	if (!worker_->start(stack_, samplerate)) {
+		qWarning().nospace() << name() << ": " << worker_->error_message();
+		set_error_message(tr("Failed to start decoder worker process"));
+		worker_.reset();
+		decode_interrupt_ = true;
+	}
+}
+
 void DecodeSignal::terminate_srd_session()
 {
 	// Call the "terminate and reset" routine for the decoder stack
@@ -1605,6 +1974,87 @@ void DecodeSignal::create_decode_segment()
 	}
 }
 
+void DecodeSignal::publish_annotations()
+{
+	if (staged_annotations_.empty())
+		return;
+
+	deque<const Annotation*>& all_annotations =
+		segments_[current_segment_id_].all_annotations;
+
+	uint64_t first_changed = all_annotations.size();
+
+	for (const StagedAnnotation& staged : staged_annotations_) {
+		RowData& row_data = *staged.row_data;
+
+		// Add the annotation to the row
+		const Annotation* ann = row_data.emplace_annotation(staged.start_sample,
+			staged.end_sample, staged.texts, staged.ann_class_id);
+
+		// We insert the annotation into the global annotation list in a way so that
+		// the annotation list is sorted by start sample and length. Otherwise, we'd
+		// have to sort the model, which is expensive
+		if (all_annotations.empty()) {
+			all_annotations.emplace_back(ann);
+		} else {
+			const uint64_t new_ann_len = (staged.end_sample - staged.start_sample);
+			bool ann_has_earlier_start = (staged.start_sample < all_annotations.back()->start_sample());
+			bool ann_is_longer = (new_ann_len >
+				(all_annotations.back()->end_sample() - all_annotations.back()->start_sample()));
+
+			if (ann_has_earlier_start && ann_is_longer) {
+				bool ann_has_same_start;
+				auto it = all_annotations.end();
+
+				do {
+					it--;
+					ann_has_earlier_start = (staged.start_sample < (*it)->start_sample());
+					ann_has_same_start = (staged.start_sample == (*it)->start_sample());
+					ann_is_longer = (new_ann_len > (*it)->length());
+				} while ((ann_has_earlier_start || (ann_has_same_start && ann_is_longer)) && (it != all_annotations.begin()));
+
+				// Allow inserting at the front
+				if (it != all_annotations.begin())
+					it++;
+
+				first_changed = min(first_changed, (uint64_t)(it - all_annotations.begin()));
+				all_annotations.emplace(it, ann);
+			} else
+				all_annotations.emplace_back(ann);
+		}
+
+		// When emplace_annotation() inserts instead of appends an annotation,
+		// the pointers in all_annotations that follow the inserted annotation and
+		// point to annotations for this row are off by one and must be updated
+		if (&(row_data.annotations().back()) != ann) {
+			// Search backwards until we find the annotation we just added
+			auto row_it = row_data.annotations().end();
+			auto all_it = all_annotations.end();
+			do {
+				all_it--;
+				if ((*all_it)->row_data() == &row_data)
+					row_it--;
+			} while (&(*row_it) != ann);
+
+			first_changed = min(first_changed, (uint64_t)(all_it - all_annotations.begin()));
+
+			// Update the annotation addresses for this row's annotations until the end
+			do {
+				if ((*all_it)->row_data() == &row_data) {
+					*all_it = &(*row_it);
+					row_it++;
+				}
+				all_it++;
+			} while (all_it != all_annotations.end());
+		}
+	}
+
+	segments_[current_segment_id_].all_annotations_changes.emplace_back(
+		all_annotations.size(), first_changed);
+
+	staged_annotations_.clear();
+}
+
 void DecodeSignal::annotation_callback(srd_proto_data *pdata, void *decode_signal)
 {
 	assert(pdata);
@@ -1619,7 +2069,9 @@ void DecodeSignal::annotation_callback(srd_proto_data *pdata, void *decode_signa
 	if (ds->segments_.empty())
 		return;
 
-	lock_guard<mutex> lock(ds->output_mutex_);
+	// Annotations of the pre-roll are of no interest
+	if (ds->decode_range_enabled_ && (pdata->end_sample < ds->decode_range_start_))
+		return;
 
 	// Get the decoder and the annotation data
 	assert(pdata->pdo);
@@ -1642,6 +2094,9 @@ void DecodeSignal::annotation_callback(srd_proto_data *pdata, void *decode_signa
 		return;
 	}
 
+	if (!ann_class->recorded())
+		return;
+
 	const Row* row = ann_class->row;
 
 	if (!row)
@@ -1649,65 +2104,10 @@ void DecodeSignal::annotation_callback(srd_proto_data *pdata, void *decode_signa
 
 	RowData& row_data = ds->segments_[ds->current_segment_id_].annotation_rows.at(row);
 
-	// Add the annotation to the row
-	const Annotation* ann = row_data.emplace_annotation(pdata);
-
-	// We insert the annotation into the global annotation list in a way so that
-	// the annotation list is sorted by start sample and length. Otherwise, we'd
-	// have to sort the model, which is expensive
-	deque<const Annotation*>& all_annotations =
-		ds->segments_[ds->current_segment_id_].all_annotations;
-
-	if (all_annotations.empty()) {
-		all_annotations.emplace_back(ann);
-	} else {
-		const uint64_t new_ann_len = (pdata->end_sample - pdata->start_sample);
-		bool ann_has_earlier_start = (pdata->start_sample < all_annotations.back()->start_sample());
-		bool ann_is_longer = (new_ann_len >
-			(all_annotations.back()->end_sample() - all_annotations.back()->start_sample()));
-
-		if (ann_has_earlier_start && ann_is_longer) {
-			bool ann_has_same_start;
-			auto it = all_annotations.end();
-
-			do {
-				it--;
-				ann_has_earlier_start = (pdata->start_sample < (*it)->start_sample());
-				ann_has_same_start = (pdata->start_sample == (*it)->start_sample());
-				ann_is_longer = (new_ann_len > (*it)->length());
-			} while ((ann_has_earlier_start || (ann_has_same_start && ann_is_longer)) && (it != all_annotations.begin()));
-
-			// Allow inserting at the front
-			if (it != all_annotations.begin())
-				it++;
-
-			all_annotations.emplace(it, ann);
-		} else
-			all_annotations.emplace_back(ann);
-	}
-
-	// When emplace_annotation() inserts instead of appends an annotation,
-	// the pointers in all_annotations that follow the inserted annotation and
-	// point to annotations for this row are off by one and must be updated
-	if (&(row_data.annotations().back()) != ann) {
-		// Search backwards until we find the annotation we just added
-		auto row_it = row_data.annotations().end();
-		auto all_it = all_annotations.end();
-		do {
-			all_it--;
-			if ((*all_it)->row_data() == &row_data)
-				row_it--;
-		} while (&(*row_it) != ann);
-
-		// Update the annotation addresses for this row's annotations until the end
-		do {
-			if ((*all_it)->row_data() == &row_data) {
-				*all_it = &(*row_it);
-				row_it++;
-			}
-			all_it++;
-		} while (all_it != all_annotations.end());
-	}
+	// Only stage the annotation, it's published together with the others of
+	// this decode chunk so that we don't need to lock output_mutex_ here
+	ds->staged_annotations_.push_back({&row_data, pdata->start_sample,
+		pdata->end_sample, row_data.store_ann_texts(pda), (uint32_t)pda->ann_class});
 }
 
 void DecodeSignal::binary_callback(srd_proto_data *pdata, void *decode_signal)
@@ -1803,29 +2203,9 @@ void DecodeSignal::logic_output_callback(srd_proto_data *pdata, void *decode_sig
 		output_logic->push_segment(last_segment);
 	}
 
-	if (pdata->start_sample < pdata->end_sample) {
-		vector<uint8_t> data;
-		const unsigned int unit_size = last_segment->unit_size();
-		data.resize(unit_size * (1 + pdl->repeat_count));
-
-		if (unit_size == 1)
-			for (unsigned int i = 0; i <= pdl->repeat_count; i++)
-				data.data()[i * unit_size] = *((uint8_t*)pdl->data);
-		else if (unit_size == 2)
-			for (unsigned int i = 0; i <= pdl->repeat_count; i++)
-				data.data()[i * unit_size] = *((uint16_t*)pdl->data);
-		else if (unit_size <= 4)
-			for (unsigned int i = 0; i <= pdl->repeat_count; i++)
-				data.data()[i * unit_size] = *((uint32_t*)pdl->data);
-		else if (unit_size <= 8)
-			for (unsigned int i = 0; i <= pdl->repeat_count; i++)
-				data.data()[i * unit_size] = *((uint64_t*)pdl->data);
-		else
-			for (unsigned int i = 0; i <= pdl->repeat_count; i++)
-				memcpy((void*)&data.data()[i * unit_size], (void*)pdl->data, unit_size);
-
-		last_segment->append_payload(data.data(), data.size());
-	} else
+	if (pdata->start_sample < pdata->end_sample)
+		last_segment->append_run(pdl->data, 1 + pdl->repeat_count);
+	else
 		qWarning() << "Ignoring malformed logic output state change for group" << pdl->logic_group << "from decoder" \
 			<< QString::fromUtf8(decc->name) << "from" << pdata->start_sample << "to" << pdata->end_sample;
 }
@@ -1841,6 +2221,7 @@ void DecodeSignal::on_capture_state_changed(int state)
 
 void DecodeSignal::on_data_cleared()
 {
+	logic_mux_data_invalid_ = true;
 	reset_decode();
 }
 
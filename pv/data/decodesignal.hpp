@@ -28,12 +28,15 @@
 
 #include <QDebug>
 #include <QSettings>
+#include <QTextStream>
 
 #include <libsigrokdecode/libsigrokdecode.h>
 
 #include <pv/data/decode/decoder.hpp>
 #include <pv/data/decode/row.hpp>
 #include <pv/data/decode/rowdata.hpp>
+#include <pv/data/decode/sweep.hpp>
+#include <pv/data/decode/worker.hpp>
 #include <pv/data/signalbase.hpp>
 #include <pv/util.hpp>
 
@@ -42,8 +45,10 @@ using std::condition_variable;
 using std::deque;
 using std::map;
 using std::mutex;
+using std::pair;
 using std::vector;
 using std::shared_ptr;
+using std::unique_ptr;
 
 using pv::data::decode::Annotation;
 using pv::data::decode::DecodeBinaryClassInfo;
@@ -88,6 +93,22 @@ struct DecodeSegment
 	int64_t samples_decoded_incl, samples_decoded_excl;
 	vector<DecodeBinaryClass> binary_classes;
 	deque<const Annotation*> all_annotations;
+
+	/// For every batch of published annotations, the size of all_annotations
+	/// afterwards and the lowest index the batch changed
+	deque< pair<uint64_t, uint64_t> > all_annotations_changes;
+};
+
+/**
+ * An annotation that was reported by a decoder but isn't published yet,
+ * see DecodeSignal::publish_annotations()
+ */
+struct StagedAnnotation
+{
+	RowData* row_data;
+	uint64_t start_sample, end_sample;
+	const vector<QString>* texts;
+	uint32_t ann_class_id;
 };
 
 class DecodeSignal : public SignalBase
@@ -98,6 +119,7 @@ private:
 	static const double DecodeMargin;
 	static const double DecodeThreshold;
 	static const int64_t DecodeChunkLength;
+	static const uint64_t DefaultDecodePreroll;
 
 public:
 	DecodeSignal(pv::Session &session);
@@ -126,6 +148,52 @@ public:
 	void resume_decode();
 	bool is_paused() const;
 
+	/**
+	 * Returns true if all input segments have been decoded, i.e. if
+	 * decode_finished() has been emitted since the decode was last reset.
+	 */
+	bool is_decode_finished() const;
+
+	/**
+	 * Restricts decoding to the samples [start_sample, end_sample) of each
+	 * segment. Decoding begins decode_preroll() samples earlier so that the
+	 * decoders can synchronize to the data. Annotations ending before
+	 * start_sample are dropped. Restarts the decode.
+	 */
+	void set_decode_range(uint64_t start_sample, uint64_t end_sample);
+	void clear_decode_range();
+	bool has_decode_range() const;
+	uint64_t decode_range_start() const;
+	uint64_t decode_range_end() const;
+
+	void set_decode_preroll(uint64_t sample_count);
+	uint64_t decode_preroll() const;
+
+	/**
+	 * Decodes the given sample range once for each of the values of a
+	 * decoder option, see decode::Sweep. Only the input that has been
+	 * muxed so far is used. Returns nullptr if there is none.
+	 */
+	shared_ptr<decode::Sweep> start_sweep(size_t decoder_index,
+		const string &option_id, const vector<GVariant*> &values,
+		uint32_t segment_id, uint64_t start_sample, uint64_t end_sample);
+	void cancel_sweep();
+	shared_ptr<decode::Sweep> sweep() const;
+
+	/**
+	 * Sets the option to the value of the given sweep result and restarts
+	 * the decode. Returns false if the decoder stack changed since.
+	 */
+	bool apply_sweep_result(size_t result_index);
+
+	/**
+	 * Sets whether the annotations of the given classes are recorded.
+	 * Unrecording takes effect immediately, recording a class again
+	 * restarts the decode so that its annotations become available.
+	 */
+	void set_ann_classes_recorded(const vector<decode::AnnotationClass*> &ann_classes,
+		bool recorded);
+
 	const vector<decode::DecodeChannel> get_channels() const;
 	void auto_assign_signals(const shared_ptr<Decoder> dec);
 	void assign_signal(const uint16_t channel_id, shared_ptr<const SignalBase> signal);
@@ -195,6 +263,24 @@ public:
 
 	const deque<const Annotation*>* get_all_annotations_by_segment(uint32_t segment_id) const;
 
+	/**
+	 * Returns the lowest index at which the list returned by
+	 * get_all_annotations_by_segment() changed since it had prev_count
+	 * entries. Annotations are mostly appended but may also be inserted
+	 * before the end of the list. count receives the current list size.
+	 */
+	uint64_t get_first_changed_annotation_index(uint32_t segment_id,
+		uint64_t prev_count, uint64_t &count) const;
+
+	/**
+	 * Writes the given annotations to a text stream, one per line. The format
+	 * string uses the placeholders of GlobalSettings::Key_Dec_ExportFormat.
+	 * Every line starts with @a line_prefix.
+	 */
+	static void export_annotations(QTextStream &out_stream,
+		const deque<const Annotation*> &annotations, QString format,
+		const QString &line_prefix = QString());
+
 	virtual void save_settings(QSettings &settings) const;
 
 	virtual void restore_settings(QSettings &settings);
@@ -210,14 +296,22 @@ private:
 
 	void commit_decoder_channels();
 
+	/**
+	 * Returns the first sample to decode, i.e. the start of the decode
+	 * range less the pre-roll, or 0 if the entire input is decoded.
+	 */
+	uint64_t decode_start_sample() const;
+
 	void mux_logic_samples(uint32_t segment_id, const int64_t start, const int64_t end);
 	void logic_mux_proc();
 
 	void decode_data(const int64_t abs_start_samplenum, const int64_t sample_count,
 		const shared_ptr<const LogicSegment> input_segment);
 	void decode_proc();
+	void decode_segments();
 
 	void start_srd_session();
+	void start_worker();
 	void terminate_srd_session();
 	void stop_srd_session();
 
@@ -226,6 +320,14 @@ private:
 
 	void create_decode_segment();
 
+	/**
+	 * Adds the annotations staged by annotation_callback() to the current
+	 * segment. Readers see all annotations of a decode chunk at once and
+	 * the decoder doesn't contend with them for each annotation.
+	 * output_mutex_ must be held by the caller.
+	 */
+	void publish_annotations();
+
 	static void annotation_callback(srd_proto_data *pdata, void *decode_signal);
 	static void binary_callback(srd_proto_data *pdata, void *decode_signal);
 	static void logic_output_callback(srd_proto_data *pdata, void *decode_signal);
@@ -255,25 +357,41 @@ private:
 
 	struct srd_session *srd_session_;
 
+	/// Runs the decoder stack instead of srd_session_ if enabled. Owned by the decode thread.
+	bool use_worker_;
+	unique_ptr<decode::Worker> worker_;
+
 	shared_ptr<Logic> logic_mux_data_;
 	uint32_t logic_mux_unit_size_;
 	bool logic_mux_data_invalid_;
 
+	/// The input sample that the first sample of each muxed segment holds
+	uint64_t logic_mux_start_;
+
 	vector< shared_ptr<Decoder> > stack_;
 	bool stack_config_changed_;
 
 	deque<DecodeSegment> segments_;
 	uint32_t current_segment_id_;
 
+	vector<StagedAnnotation> staged_annotations_;  ///< Only used by the decode thread
+
 	mutable mutex input_mutex_, output_mutex_, decode_pause_mutex_, logic_mux_mutex_;
 	mutable condition_variable decode_input_cond_, decode_pause_cond_,
 		logic_mux_cond_;
 
 	std::thread decode_thread_, logic_mux_thread_;
 	atomic<bool> decode_interrupt_, logic_mux_interrupt_;
+	atomic<bool> decode_finished_;
 
 	bool decode_paused_;
 
+	/// Only changed while the decode threads are stopped, see begin_decode()
+	bool decode_range_enabled_;
+	uint64_t decode_range_start_, decode_range_end_, decode_preroll_;
+
+	shared_ptr<decode::Sweep> sweep_;
+
 	map<const srd_decoder*, shared_ptr<Logic>> output_logic_;
 	map<const srd_decoder*, vector<uint8_t>> output_logic_muxed_data_;
 	vector< shared_ptr<SignalBase>> output_signals_;
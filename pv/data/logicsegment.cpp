@@ -32,7 +32,6 @@
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
 
-using std::lock_guard;
 using std::recursive_mutex;
 using std::max;
 using std::min;
@@ -47,7 +46,7 @@ namespace data {
 const int LogicSegment::MipMapScalePower = 4;
 const int LogicSegment::MipMapScaleFactor = 1 << MipMapScalePower;
 const float LogicSegment::LogMipMapScaleFactor = logf(MipMapScaleFactor);
-const uint64_t LogicSegment::MipMapDataUnit = 64 * 1024; // bytes
+const uint64_t LogicSegment::MipMapDataUnit = 64 * 1024; // entries per chunk
 
 LogicSegment::LogicSegment(pv::data::Logic& owner, uint32_t segment_id,
 	unsigned int unit_size,	uint64_t samplerate) :
@@ -57,15 +56,22 @@ LogicSegment::LogicSegment(pv::data::Logic& owner, uint32_t segment_id,
 	last_append_accumulator_(0),
 	last_append_extra_(0)
 {
-	memset(mip_map_, 0, sizeof(mip_map_));
+	for (MipMapLevel &l : mip_map_)
+		l.length = 0;
+
+	if (unit_size > 8) {
+		last_append_wide_sample_.resize(unit_size, 0);
+		last_append_wide_accumulator_.resize(unit_size, 0);
+	}
 }
 
 LogicSegment::~LogicSegment()
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	for (MipMapLevel &l : mip_map_)
-		free(l.data);
+		for (uint8_t* chunk : l.data_chunks)
+			delete[] chunk;
 }
 
 shared_ptr<const LogicSegment> LogicSegment::get_shared_ptr() const
@@ -161,7 +167,7 @@ void LogicSegment::downsampleT(const uint8_t *in_, uint8_t *&out_, uint64_t len)
 			last_append_extra_++;
 			len--;
 		}
-		if (!len) {
+		if (last_append_extra_ < MipMapScaleFactor) {
 			// Not enough samples available to complete downsample
 			last_append_sample_ = prev;
 			last_append_accumulator_ = acc;
@@ -214,7 +220,7 @@ void LogicSegment::downsampleGeneric(const uint8_t *in, uint8_t *&out, uint64_t
 			last_append_extra_++;
 			len--;
 		}
-		if (!len) {
+		if (last_append_extra_ < MipMapScaleFactor) {
 			// Not enough samples available to complete downsample
 			last_append_sample_ = prev;
 			last_append_accumulator_ = acc;
@@ -258,6 +264,47 @@ void LogicSegment::downsampleGeneric(const uint8_t *in, uint8_t *&out, uint64_t
 	last_append_accumulator_ = acc;
 }
 
+void LogicSegment::downsampleWide(const uint8_t *in, uint8_t *&out, uint64_t len)
+{
+	// Samples wider than 64 bits are processed byte-wise. Only bitwise
+	// operations are applied to them, so the byte order doesn't matter.
+	// The byte loops have no dependencies between iterations, which lets
+	// the compiler vectorize them with the full SIMD register width.
+	// Each sample is compared to the previous one in place, so only the
+	// last sample needs to be kept for the next call
+	uint8_t *const acc = last_append_wide_accumulator_.data();
+	const uint8_t *prev = last_append_wide_sample_.data();
+
+	while (len > 0) {
+		// Process the samples up to the end of the current downsample
+		const uint64_t count = min(len, MipMapScaleFactor - last_append_extra_);
+
+		for (uint64_t s = 0; s < count; s++) {
+			for (unsigned int i = 0; i < unit_size_; i++)
+				acc[i] |= prev[i] ^ in[i];
+			prev = in;
+			in += unit_size_;
+		}
+
+		len -= count;
+		last_append_extra_ += count;
+
+		if (last_append_extra_ == MipMapScaleFactor) {
+			// We have a complete downsample
+			for (unsigned int i = 0; i < unit_size_; i++) {
+				out[i] = acc[i];
+				acc[i] = 0;
+			}
+			out += unit_size_;
+			last_append_extra_ = 0;
+		}
+	}
+
+	// Update context
+	if (prev != last_append_wide_sample_.data())
+		memcpy(last_append_wide_sample_.data(), prev, unit_size_);
+}
+
 inline uint64_t LogicSegment::unpack_sample(const uint8_t *ptr) const
 {
 #ifdef HAVE_UNALIGNED_LITTLE_ENDIAN_ACCESS
@@ -332,6 +379,18 @@ inline void LogicSegment::pack_sample(uint8_t *ptr, uint64_t value)
 #endif
 }
 
+uint64_t LogicSegment::get_memory_used() const
+{
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	uint64_t size = Segment::get_memory_used();
+
+	for (const MipMapLevel &l : mip_map_)
+		size += l.data_chunks.size() * (MipMapDataUnit * unit_size_ + sizeof(uint64_t));
+
+	return size;
+}
+
 void LogicSegment::append_payload(shared_ptr<sigrok::Logic> logic)
 {
 	assert(unit_size_ == logic->unit_size());
@@ -345,7 +404,7 @@ void LogicSegment::append_payload(void *data, uint64_t data_size)
 	assert(unit_size_ > 0);
 	assert((data_size % unit_size_) == 0);
 
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	const uint64_t prev_sample_count = sample_count_;
 	const uint64_t sample_count = data_size / unit_size_;
@@ -363,6 +422,68 @@ void LogicSegment::append_payload(void *data, uint64_t data_size)
 			prev_sample_count + 1, prev_sample_count + 1);
 }
 
+int64_t LogicSegment::append_received(
+	const function<int64_t (uint8_t*, uint64_t)> &receive, unsigned int &partial_bytes)
+{
+	assert(unit_size_ > 0);
+	assert(partial_bytes < unit_size_);
+
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	const uint64_t prev_sample_count = sample_count_;
+
+	// There is room for at least one sample, so the incomplete one fits
+	uint64_t free_samples;
+	uint8_t *dest = get_free_chunk_space(free_samples);
+
+	const int64_t received = receive(dest + partial_bytes,
+		free_samples * unit_size_ - partial_bytes);
+	if (received <= 0)
+		return received;
+
+	const uint64_t byte_count = partial_bytes + received;
+	const uint64_t sample_count = byte_count / unit_size_;
+
+	// An incomplete sample stays in place right behind the complete ones.
+	// It can't be at the end of a full chunk as the chunk ends on a sample
+	partial_bytes = byte_count % unit_size_;
+
+	if (sample_count == 0)
+		return received;
+
+	commit_free_chunk_space(sample_count);
+
+	append_payload_to_mipmap();
+
+	owner_.notify_samples_added(SharedPtrToSegment(shared_from_this()),
+		prev_sample_count + 1, prev_sample_count + sample_count);
+
+	return received;
+}
+
+void LogicSegment::append_run(const void *value, uint64_t count)
+{
+	assert(unit_size_ > 0);
+
+	if (count == 0)
+		return;
+
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	const uint64_t prev_sample_count = sample_count_;
+
+	append_repeated_samples(value, count);
+
+	append_run_to_mipmap(prev_sample_count, value);
+
+	if (count > 1)
+		owner_.notify_samples_added(SharedPtrToSegment(shared_from_this()),
+			prev_sample_count + 1, prev_sample_count + 1 + count);
+	else
+		owner_.notify_samples_added(SharedPtrToSegment(shared_from_this()),
+			prev_sample_count + 1, prev_sample_count + 1);
+}
+
 void LogicSegment::append_subsignal_payload(unsigned int index, void *data,
 	uint64_t data_size, vector<uint8_t>& destination)
 {
@@ -398,7 +519,7 @@ void LogicSegment::get_samples(int64_t start_sample,
 	assert(start_sample <= end_sample);
 	assert(dest != nullptr);
 
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	get_raw_samples(start_sample, (end_sample - start_sample), dest);
 }
@@ -416,9 +537,9 @@ void LogicSegment::get_subsampled_edges(
 	assert(start <= end);
 	assert(min_length > 0);
 	assert(sig_index >= 0);
-	assert(sig_index < 64);
+	assert(sig_index < (int)unit_size_ * 8);
 
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	// Make sure we only process as many samples as we have
 	if (end > get_sample_count())
@@ -427,10 +548,8 @@ void LogicSegment::get_subsampled_edges(
 	const uint64_t block_length = (uint64_t)max(min_length, 1.0f);
 	const unsigned int min_level = max((int)floorf(logf(min_length) /
 		LogMipMapScaleFactor) - 1, 0);
-	const uint64_t sig_mask = 1ULL << sig_index;
-
 	// Store the initial state
-	last_sample = (get_unpacked_sample(start) & sig_mask) != 0;
+	last_sample = get_sample_bit(start, sig_index);
 	if (!first_change_only)
 		edges.emplace_back(index++, last_sample);
 
@@ -440,7 +559,7 @@ void LogicSegment::get_subsampled_edges(
 
 		// We cannot fast-forward if there is no mip-map data at
 		// the minimum level.
-		fast_forward = (mip_map_[level].data != nullptr);
+		fast_forward = !mip_map_[level].data_chunks.empty();
 
 		if (min_length < MipMapScaleFactor) {
 			// Search individual samples up to the beginning of
@@ -451,7 +570,7 @@ void LogicSegment::get_subsampled_edges(
 					(index & ~((uint64_t)(~0) << MipMapScalePower)) != 0;
 					index++) {
 
-				const bool sample = (get_unpacked_sample(index) & sig_mask) != 0;
+				const bool sample = get_sample_bit(index, sig_index);
 
 				// If there was a change we cannot fast forward
 				if (sample != last_sample) {
@@ -469,7 +588,7 @@ void LogicSegment::get_subsampled_edges(
 				break;
 
 			// We can fast forward only if there was no change
-			const bool sample = (get_unpacked_sample(index) & sig_mask) != 0;
+			const bool sample = get_sample_bit(index, sig_index);
 			if (last_sample != sample)
 				fast_forward = false;
 		}
@@ -490,14 +609,14 @@ void LogicSegment::get_subsampled_edges(
 				// Check if we reached the last block at this
 				// level, or if there was a change in this block
 				if (offset >= mip_map_[level].length ||
-					(get_subsample(level, offset) &	sig_mask))
+					get_subsample_bit(level, offset, sig_index))
 					break;
 
 				if ((offset & ~((uint64_t)(~0) << MipMapScalePower)) == 0) {
 					// If we are now at the beginning of a
 					// higher level mip-map block ascend one
 					// level
-					if ((level + 1 >= ScaleStepCount) || (!mip_map_[level + 1].data))
+					if ((level + 1 >= ScaleStepCount) || mip_map_[level + 1].data_chunks.empty())
 						break;
 
 					level++;
@@ -511,7 +630,7 @@ void LogicSegment::get_subsampled_edges(
 			// Zoom in, and slide right until we encounter a change,
 			// and repeat until we reach min_level
 			while (true) {
-				assert(mip_map_[level].data);
+				assert(!mip_map_[level].data_chunks.empty());
 
 				const int level_scale_power = (level + 1) * MipMapScalePower;
 				const uint64_t offset = index >> level_scale_power;
@@ -519,7 +638,7 @@ void LogicSegment::get_subsampled_edges(
 				// Check if we reached the last block at this
 				// level, or if there was a change in this block
 				if (offset >= mip_map_[level].length ||
-						(get_subsample(level, offset) & sig_mask)) {
+						get_subsample_bit(level, offset, sig_index)) {
 					// Zoom in unless we reached the minimum
 					// zoom
 					if (level == min_level)
@@ -538,7 +657,7 @@ void LogicSegment::get_subsampled_edges(
 			// block
 			if (min_length < MipMapScaleFactor) {
 				for (; index < end; index++) {
-					const bool sample = (get_unpacked_sample(index) & sig_mask) != 0;
+					const bool sample = get_sample_bit(index, sig_index);
 					if (sample != last_sample)
 						break;
 				}
@@ -553,7 +672,7 @@ void LogicSegment::get_subsampled_edges(
 			break;
 
 		// Store the final state
-		const bool final_sample = (get_unpacked_sample(final_index - 1) & sig_mask) != 0;
+		const bool final_sample = get_sample_bit(final_index - 1, sig_index);
 		edges.emplace_back(index, final_sample);
 
 		index = final_index;
@@ -565,7 +684,7 @@ void LogicSegment::get_subsampled_edges(
 
 	// Add the final state
 	if (!first_change_only) {
-		const bool end_sample = get_unpacked_sample(end) & sig_mask;
+		const bool end_sample = get_sample_bit(end, sig_index);
 		if (last_sample != end_sample)
 			edges.emplace_back(end, end_sample);
 		edges.emplace_back(end + 1, end_sample);
@@ -614,52 +733,41 @@ void LogicSegment::get_surrounding_edges(vector<EdgePair> &dest,
 
 void LogicSegment::reallocate_mipmap_level(MipMapLevel &m)
 {
-	lock_guard<recursive_mutex> lock(mutex_);
-
-	const uint64_t new_data_length = ((m.length + MipMapDataUnit - 1) /
-		MipMapDataUnit) * MipMapDataUnit;
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
-	if (new_data_length > m.data_length) {
-		m.data_length = new_data_length;
+	const uint64_t chunk_count = (m.length + MipMapDataUnit - 1) / MipMapDataUnit;
 
-		// Padding is added to allow for the uint64_t write word
-		m.data = realloc(m.data, new_data_length * unit_size_ +
-			sizeof(uint64_t));
-	}
+	// Padding is added to allow for the uint64_t write word
+	while (m.data_chunks.size() < chunk_count)
+		m.data_chunks.push_back(
+			new uint8_t[MipMapDataUnit * unit_size_ + sizeof(uint64_t)]);
 }
 
-void LogicSegment::append_payload_to_mipmap()
+uint8_t* LogicSegment::get_mipmap_entry(const MipMapLevel &m,
+	uint64_t offset) const
 {
-	MipMapLevel &m0 = mip_map_[0];
-	uint64_t prev_length;
-	uint8_t *dest_ptr;
-	SegmentDataIterator* it;
-	uint64_t accumulator;
-	unsigned int diff_counter;
-
-	// Expand the data buffer to fit the new samples
-	prev_length = m0.length;
-	m0.length = sample_count_ / MipMapScaleFactor;
-
-	// Break off if there are no new samples to compute
-	if (m0.length == prev_length)
-		return;
-
-	reallocate_mipmap_level(m0);
+	return m.data_chunks[offset / MipMapDataUnit] +
+		(offset % MipMapDataUnit) * unit_size_;
+}
 
-	dest_ptr = (uint8_t*)m0.data + prev_length * unit_size_;
+void LogicSegment::downsample_samples(uint64_t start_sample,
+	uint64_t len_sample, uint64_t dest_offset)
+{
+	const MipMapLevel &m0 = mip_map_[0];
 
-	// Iterate through the samples to populate the first level mipmap
-	const uint64_t start_sample = prev_length * MipMapScaleFactor;
-	const uint64_t end_sample = m0.length * MipMapScaleFactor;
-	uint64_t len_sample = end_sample - start_sample;
-	it = begin_sample_iteration(start_sample);
+	SegmentDataIterator* it = begin_sample_iteration(start_sample);
 	while (len_sample > 0) {
 		// Number of samples available in this chunk
 		uint64_t count = get_iterator_valid_length(it);
 		// Reduce if less than asked for
 		count = std::min(count, len_sample);
+		// Reduce so that the output doesn't cross a mip-map chunk boundary
+		const uint64_t dest_free = MipMapDataUnit - (dest_offset % MipMapDataUnit);
+		count = std::min(count, dest_free * MipMapScaleFactor - last_append_extra_);
+		const uint64_t dest_count = (last_append_extra_ + count) / MipMapScaleFactor;
 		uint8_t *src_ptr = get_iterator_value(it);
+		uint8_t *dest_ptr = (dest_count > 0) ?
+			get_mipmap_entry(m0, dest_offset) : nullptr;
 		// Submit these contiguous samples to downsampling in bulk
 		if (unit_size_ == 1)
 			downsampleT<uint8_t>(src_ptr, dest_ptr, count);
@@ -669,15 +777,94 @@ void LogicSegment::append_payload_to_mipmap()
 			downsampleT<uint32_t>(src_ptr, dest_ptr, count);
 		else if (unit_size_ == 8)
 			downsampleT<uint64_t>(src_ptr, dest_ptr, count);
+		else if (unit_size_ > 8)
+			downsampleWide(src_ptr, dest_ptr, count);
 		else
 			downsampleGeneric(src_ptr, dest_ptr, count);
 		len_sample -= count;
+		dest_offset += dest_count;
 		// Advance iterator, should move to start of next chunk
 		continue_sample_iteration(it, count);
 	}
 	end_sample_iteration(it);
+}
+
+void LogicSegment::append_payload_to_mipmap()
+{
+	MipMapLevel &m0 = mip_map_[0];
+	uint64_t prev_length;
+
+	// Expand the data buffer to fit the new samples
+	prev_length = m0.length;
+	m0.length = sample_count_ / MipMapScaleFactor;
+
+	// Break off if there are no new samples to compute
+	if (m0.length == prev_length)
+		return;
+
+	reallocate_mipmap_level(m0);
+
+	// Iterate through the samples to populate the first level mipmap
+	const uint64_t start_sample = prev_length * MipMapScaleFactor;
+	const uint64_t end_sample = m0.length * MipMapScaleFactor;
+	downsample_samples(start_sample, end_sample - start_sample, prev_length);
+
+	append_to_higher_mipmap_levels();
+}
+
+void LogicSegment::append_run_to_mipmap(uint64_t run_start, const void *value)
+{
+	MipMapLevel &m0 = mip_map_[0];
+	uint64_t prev_length;
+
+	// Expand the data buffer to fit the new samples
+	prev_length = m0.length;
+	m0.length = sample_count_ / MipMapScaleFactor;
+
+	// Break off if there are no new samples to compute
+	if (m0.length == prev_length)
+		return;
+
+	reallocate_mipmap_level(m0);
+
+	// Only the block containing the first sample of the run can contain
+	// a transition, so we compute everything up to and including that
+	// block the regular way. All following blocks hold nothing but the
+	// run value and hence have no transitions
+	const uint64_t start_sample = prev_length * MipMapScaleFactor;
+	const uint64_t end_sample = m0.length * MipMapScaleFactor;
+	const uint64_t head_end_sample =
+		min(end_sample, pow2_ceil(run_start + 1, MipMapScalePower));
+
+	downsample_samples(start_sample, head_end_sample - start_sample, prev_length);
+
+	if (end_sample > head_end_sample) {
+		uint64_t offset = head_end_sample / MipMapScaleFactor;
+		while (offset < m0.length) {
+			const uint64_t count = min(m0.length - offset,
+				MipMapDataUnit - (offset % MipMapDataUnit));
+			memset(get_mipmap_entry(m0, offset), 0, count * unit_size_);
+			offset += count;
+		}
+		if (unit_size_ > 8) {
+			memcpy(last_append_wide_sample_.data(), value, unit_size_);
+		} else {
+			// unpack_sample() may read up to 8 bytes, so don't use value directly
+			uint8_t sample[8] = {0};
+			memcpy(sample, value, unit_size_);
+			last_append_sample_ = unpack_sample(sample);
+		}
+	}
+
+	append_to_higher_mipmap_levels();
+}
+
+void LogicSegment::append_to_higher_mipmap_levels()
+{
+	uint64_t prev_length;
+	uint64_t accumulator;
+	unsigned int diff_counter;
 
-	// Compute higher level mipmaps
 	for (unsigned int level = 1; level < ScaleStepCount; level++) {
 		MipMapLevel &m = mip_map_[level];
 		const MipMapLevel &ml = mip_map_[level - 1];
@@ -692,16 +879,25 @@ void LogicSegment::append_payload_to_mipmap()
 
 		reallocate_mipmap_level(m);
 
-		// Subsample the lower level
-		const uint8_t* src_ptr = (uint8_t*)ml.data +
-			unit_size_ * prev_length * MipMapScaleFactor;
-		const uint8_t *const end_dest_ptr =
-			(uint8_t*)m.data + unit_size_ * m.length;
+		// Subsample the lower level. The source entries for one
+		// destination entry never cross a chunk boundary
+		for (uint64_t offset = prev_length; offset < m.length; offset++) {
+			const uint8_t* src_ptr =
+				get_mipmap_entry(ml, offset * MipMapScaleFactor);
+
+			if (unit_size_ > 8) {
+				// OR the wide entries together byte-wise, which the
+				// compiler vectorizes
+				uint8_t* dest_ptr = get_mipmap_entry(m, offset);
+				memcpy(dest_ptr, src_ptr, unit_size_);
+				for (diff_counter = 1; diff_counter < MipMapScaleFactor; diff_counter++) {
+					src_ptr += unit_size_;
+					for (unsigned int i = 0; i < unit_size_; i++)
+						dest_ptr[i] |= src_ptr[i];
+				}
+				continue;
+			}
 
-		for (dest_ptr = (uint8_t*)m.data +
-				unit_size_ * prev_length;
-				dest_ptr < end_dest_ptr;
-				dest_ptr += unit_size_) {
 			accumulator = 0;
 			diff_counter = MipMapScaleFactor;
 			while (diff_counter-- > 0) {
@@ -709,7 +905,7 @@ void LogicSegment::append_payload_to_mipmap()
 				src_ptr += unit_size_;
 			}
 
-			pack_sample(dest_ptr, accumulator);
+			pack_sample(get_mipmap_entry(m, offset), accumulator);
 		}
 	}
 }
@@ -726,12 +922,34 @@ uint64_t LogicSegment::get_unpacked_sample(uint64_t index) const
 	return unpack_sample(data);
 }
 
+bool LogicSegment::get_sample_bit(uint64_t index, int sig_index) const
+{
+	assert(index < sample_count_);
+
+	if (unit_size_ <= 8)
+		return (get_unpacked_sample(index) >> sig_index) & 1;
+
+	// Samples have the same layout as mip-map entries, see get_subsample_bit()
+	const uint8_t* sample = get_raw_sample(index);
+	return (sample[sig_index / 8] >> (sig_index % 8)) & 1;
+}
+
 uint64_t LogicSegment::get_subsample(int level, uint64_t offset) const
 {
 	assert(level >= 0);
-	assert(mip_map_[level].data);
-	return unpack_sample((uint8_t*)mip_map_[level].data +
-		unit_size_ * offset);
+	assert(!mip_map_[level].data_chunks.empty());
+	return unpack_sample(get_mipmap_entry(mip_map_[level], offset));
+}
+
+bool LogicSegment::get_subsample_bit(int level, uint64_t offset, int sig_index) const
+{
+	assert(level >= 0);
+	assert(!mip_map_[level].data_chunks.empty());
+
+	// Mip-map entries are stored with the sample layout, i.e. channel n
+	// is bit (n % 8) of byte (n / 8)
+	const uint8_t* entry = get_mipmap_entry(mip_map_[level], offset);
+	return (entry[sig_index / 8] >> (sig_index % 8)) & 1;
 }
 
 uint64_t LogicSegment::pow2_ceil(uint64_t x, unsigned int power)
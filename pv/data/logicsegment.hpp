@@ -22,11 +22,15 @@
 
 #include "segment.hpp"
 
+#include <deque>
+#include <functional>
 #include <vector>
 
 #include <QObject>
 
+using std::deque;
 using std::enable_shared_from_this;
+using std::function;
 using std::pair;
 using std::shared_ptr;
 using std::vector;
@@ -43,6 +47,14 @@ struct Pulses;
 struct LongPulses;
 }
 
+namespace LogicSegmentWideTest {
+struct MipMapLevels;
+}
+
+namespace LogicSegmentDownsampleTest {
+struct BlockBoundaries;
+}
+
 namespace pv {
 namespace data {
 
@@ -62,11 +74,15 @@ public:
 	static const uint64_t MipMapDataUnit;
 
 private:
+	/**
+	 * A mip-map level is stored in chunks of MipMapDataUnit entries.
+	 * Chunks are never moved or resized, so appending to a level is
+	 * cheap and pointers to entries remain valid.
+	 */
 	struct MipMapLevel
 	{
 		uint64_t length;
-		uint64_t data_length;
-		void *data;
+		deque<uint8_t*> data_chunks;
 	};
 
 public:
@@ -83,9 +99,37 @@ public:
 	 */
 	shared_ptr<const LogicSegment> get_shared_ptr() const;
 
+	uint64_t get_memory_used() const;
+
 	void append_payload(shared_ptr<sigrok::Logic> logic);
 	void append_payload(void *data, uint64_t data_size);
 
+	/**
+	 * Appends a run of identical samples, e.g. a logic level that is
+	 * held for a number of samples. The sample data is filled in bulk
+	 * and since a constant run contains no transitions, the mip-map
+	 * blocks covering it are synthesized instead of being computed
+	 * from the sample data.
+	 * @param[in] value Pointer to a single sample of unit_size() bytes.
+	 * @param[in] count The number of samples in the run.
+	 */
+	void append_run(const void *value, uint64_t count);
+
+	/**
+	 * Lets @a receive write sample data straight into the free space at
+	 * the end of the current data chunk, saving the copy append_payload()
+	 * makes. @a receive gets the destination and the number of bytes it
+	 * may write and must return the number of bytes written or a value
+	 * <= 0, which is returned unchanged. It is called with the segment
+	 * locked and thus must not block.
+	 * @param[in,out] partial_bytes The number of bytes of an incomplete
+	 * sample that a previous call left at the destination. Must be 0 for
+	 * the first call.
+	 * @return The value returned by @a receive.
+	 */
+	int64_t append_received(const function<int64_t (uint8_t*, uint64_t)> &receive,
+		unsigned int &partial_bytes);
+
 	/**
 	 * Appends sample data for a single channel where each byte
 	 * represents one sample - if it's 0 the state is low, if 1 high.
@@ -123,17 +167,26 @@ private:
 	void pack_sample(uint8_t *ptr, uint64_t value);
 
 	void reallocate_mipmap_level(MipMapLevel &m);
+	uint8_t* get_mipmap_entry(const MipMapLevel &m, uint64_t offset) const;
 
 	void append_payload_to_mipmap();
+	void append_run_to_mipmap(uint64_t run_start, const void *value);
+	void append_to_higher_mipmap_levels();
+
+	void downsample_samples(uint64_t start_sample, uint64_t len_sample,
+		uint64_t dest_offset);
 
 	uint64_t get_unpacked_sample(uint64_t index) const;
+	bool get_sample_bit(uint64_t index, int sig_index) const;
 
 	template <class T> void downsampleTmain(const T*&in, T &acc, T &prev);
 	template <class T> void downsampleT(const uint8_t *in, uint8_t *&out, uint64_t len);
 	void downsampleGeneric(const uint8_t *in, uint8_t *&out, uint64_t len);
+	void downsampleWide(const uint8_t *in, uint8_t *&out, uint64_t len);
 
 private:
 	uint64_t get_subsample(int level, uint64_t offset) const;
+	bool get_subsample_bit(int level, uint64_t offset, int sig_index) const;
 
 	static uint64_t pow2_ceil(uint64_t x, unsigned int power);
 
@@ -145,11 +198,17 @@ private:
 	uint64_t last_append_accumulator_;
 	uint64_t last_append_extra_;
 
+	/// Downsampling state for samples wider than 64 bits, one byte per entry
+	vector<uint8_t> last_append_wide_sample_;
+	vector<uint8_t> last_append_wide_accumulator_;
+
 	friend struct LogicSegmentTest::Pow2;
 	friend struct LogicSegmentTest::Basic;
 	friend struct LogicSegmentTest::LargeData;
 	friend struct LogicSegmentTest::Pulses;
 	friend struct LogicSegmentTest::LongPulses;
+	friend struct LogicSegmentWideTest::MipMapLevels;
+	friend struct LogicSegmentDownsampleTest::BlockBoundaries;
 };
 
 } // namespace data
@@ -25,6 +25,7 @@
 
 #include <extdef.h>
 #include <pv/globalsettings.hpp>
+#include <pv/profiling.hpp>
 #include <pv/session.hpp>
 #include <pv/data/analogsegment.hpp>
 #include <pv/data/signalbase.hpp>
@@ -386,6 +387,8 @@ void MathSignal::begin_generation()
 uint64_t MathSignal::generate_samples(uint32_t segment_id, const uint64_t start_sample,
 	const int64_t sample_count)
 {
+	ProfilingScope profiling_scope(profiling_stage(MathProfilingStage));
+
 	uint64_t count = 0;
 
 	shared_ptr<Analog> analog = dynamic_pointer_cast<Analog>(data_);
@@ -424,6 +427,8 @@ uint64_t MathSignal::generate_samples(uint32_t segment_id, const uint64_t start_
 
 	delete[] sample_data;
 
+	profiling_scope.set_units(count);
+
 	return count;
 }
 
@@ -20,6 +20,7 @@
 
 #include "segment.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
@@ -27,13 +28,15 @@
 #include <QDebug>
 
 using std::bad_alloc;
-using std::lock_guard;
+using std::max;
 using std::min;
 using std::recursive_mutex;
+using std::upper_bound;
 
 namespace pv {
 namespace data {
 
+const uint64_t Segment::MinChunkSize = 64 * 1024;  /* 64KiB */
 const uint64_t Segment::MaxChunkSize = 10 * 1024 * 1024;  /* 10MiB */
 
 Segment::Segment(uint32_t segment_id, uint64_t samplerate, unsigned int unit_size) :
@@ -42,6 +45,7 @@ Segment::Segment(uint32_t segment_id, uint64_t samplerate, unsigned int unit_siz
 	start_time_(0),
 	samplerate_(samplerate),
 	unit_size_(unit_size),
+	chunk_memory_(0),
 	iterator_count_(0),
 	mem_optimization_requested_(false),
 	is_complete_(false)
@@ -52,16 +56,24 @@ Segment::Segment(uint32_t segment_id, uint64_t samplerate, unsigned int unit_siz
 	// without exceeding MaxChunkSize
 	chunk_size_ = min(MaxChunkSize, (MaxChunkSize / unit_size_) * unit_size_);
 
+	// Let the chunks grow from MinChunkSize to chunk_size_ by doubling
+	ramp_chunk_starts_.push_back(0);
+	for (uint64_t size = MinChunkSize; size < chunk_size_; size *= 2)
+		ramp_chunk_starts_.push_back(ramp_chunk_starts_.back() +
+			max(size / unit_size_, (uint64_t)1));
+
 	// Create the initial chunk
-	current_chunk_ = new uint8_t[chunk_size_ + 7];  /* FIXME +7 is workaround for #1284 */
+	const uint64_t chunk_bytes = chunk_capacity(0) * unit_size_;
+	current_chunk_ = new uint8_t[chunk_bytes + 7];  /* FIXME +7 is workaround for #1284 */
 	data_chunks_.push_back(current_chunk_);
+	chunk_memory_ += chunk_bytes;
 	used_samples_ = 0;
-	unused_samples_ = chunk_size_ / unit_size_;
+	unused_samples_ = chunk_capacity(0);
 }
 
 Segment::~Segment()
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	for (uint8_t* chunk : data_chunks_)
 		delete[] chunk;
@@ -101,6 +113,10 @@ void Segment::set_complete()
 {
 	is_complete_ = true;
 
+	// Release the unused memory now instead of when the acquisition
+	// ends, which matters when many segments are captured
+	free_unused_memory();
+
 	completed();
 }
 
@@ -111,7 +127,7 @@ bool Segment::is_complete() const
 
 void Segment::free_unused_memory()
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	// Do not mess with the data chunks if we have iterators pointing at them
 	if (iterator_count_ > 0) {
@@ -119,7 +135,7 @@ void Segment::free_unused_memory()
 		return;
 	}
 
-	if (current_chunk_) {
+	if (current_chunk_ && (unused_samples_ > 0)) {
 		// No more data will come in, so re-create the last chunk accordingly
 		uint8_t* resized_chunk = new uint8_t[used_samples_ * unit_size_ + 7];  /* FIXME +7 is workaround for #1284 */
 		memcpy(resized_chunk, current_chunk_, used_samples_ * unit_size_);
@@ -129,12 +145,30 @@ void Segment::free_unused_memory()
 
 		data_chunks_.pop_back();
 		data_chunks_.push_back(resized_chunk);
+
+		chunk_memory_ -= unused_samples_ * unit_size_;
+
+		// The chunk is full now, which also makes repeated calls no-ops
+		unused_samples_ = 0;
 	}
 }
 
+uint64_t Segment::get_memory_used() const
+{
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	return chunk_memory_;
+}
+
+Profiling::Stage* Segment::lock_wait_stage()
+{
+	static Profiling::Stage* const stage = profiling.stage("Segment lock wait", "waits");
+	return stage;
+}
+
 void Segment::append_single_sample(void *data)
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	// There will always be space for at least one sample in
 	// the current chunk, so we do not need to test for space
@@ -143,19 +177,15 @@ void Segment::append_single_sample(void *data)
 	used_samples_++;
 	unused_samples_--;
 
-	if (unused_samples_ == 0) {
-		current_chunk_ = new uint8_t[chunk_size_ + 7];  /* FIXME +7 is workaround for #1284 */
-		data_chunks_.push_back(current_chunk_);
-		used_samples_ = 0;
-		unused_samples_ = chunk_size_ / unit_size_;
-	}
+	if (unused_samples_ == 0)
+		allocate_new_chunk();
 
 	sample_count_++;
 }
 
 void Segment::append_samples(void* data, uint64_t samples)
 {
-	lock_guard<recursive_mutex> lock(mutex_);
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
 
 	const uint8_t* data_byte_ptr = (uint8_t*)data;
 	uint64_t remaining_samples = samples;
@@ -181,44 +211,134 @@ void Segment::append_samples(void* data, uint64_t samples)
 		remaining_samples -= copy_count;
 		data_offset += (copy_count * unit_size_);
 
-		if (unused_samples_ == 0) {
-			try {
-				// If we're out of memory, allocating a chunk will throw
-				// std::bad_alloc. To give the application some usable memory
-				// to work with in case chunk allocation fails, we allocate
-				// extra memory and throw it away if it all succeeded.
-				// This way, memory allocation will fail early enough to let
-				// PV remain alive. Otherwise, PV will crash in a random
-				// memory-allocating part of the application.
-				current_chunk_ = new uint8_t[chunk_size_ + 7];  /* FIXME +7 is workaround for #1284 */
-
-				const int dummy_size = 2 * chunk_size_;
-				auto dummy_chunk = new uint8_t[dummy_size];
-				memset(dummy_chunk, 0xFF, dummy_size);
-				delete[] dummy_chunk;
-			} catch (bad_alloc&) {
-				delete[] current_chunk_;  // The new may have succeeded
-				current_chunk_ = nullptr;
-				throw;
-			}
+		if (unused_samples_ == 0)
+			allocate_new_chunk();
+	} while (remaining_samples > 0);
 
-			data_chunks_.push_back(current_chunk_);
-			used_samples_ = 0;
-			unused_samples_ = chunk_size_ / unit_size_;
+	sample_count_ += samples;
+}
+
+void Segment::append_repeated_samples(const void *data, uint64_t samples)
+{
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());
+
+	uint64_t remaining_samples = samples;
+
+	while (remaining_samples > 0) {
+		const uint64_t fill_count = min(remaining_samples, unused_samples_);
+		uint8_t* dest = &(current_chunk_[used_samples_ * unit_size_]);
+
+		if (unit_size_ == 1)
+			memset(dest, *(const uint8_t*)data, fill_count);
+		else {
+			// Place one sample, then keep doubling the filled area
+			memcpy(dest, data, unit_size_);
+			uint64_t filled = 1;
+			while (filled < fill_count) {
+				const uint64_t copy_count = min(filled, fill_count - filled);
+				memcpy(dest + filled * unit_size_, dest, copy_count * unit_size_);
+				filled += copy_count;
+			}
 		}
-	} while (remaining_samples > 0);
+
+		used_samples_ += fill_count;
+		unused_samples_ -= fill_count;
+		remaining_samples -= fill_count;
+
+		if (unused_samples_ == 0)
+			allocate_new_chunk();
+	}
 
 	sample_count_ += samples;
 }
 
+uint8_t* Segment::get_free_chunk_space(uint64_t& free_samples)
+{
+	// There will always be space for at least one sample in
+	// the current chunk, see append_single_sample()
+	free_samples = unused_samples_;
+
+	return current_chunk_ + (used_samples_ * unit_size_);
+}
+
+void Segment::commit_free_chunk_space(uint64_t samples)
+{
+	assert(samples <= unused_samples_);
+
+	used_samples_ += samples;
+	unused_samples_ -= samples;
+
+	if (unused_samples_ == 0)
+		allocate_new_chunk();
+
+	sample_count_ += samples;
+}
+
+void Segment::allocate_new_chunk()
+{
+	const uint64_t capacity = chunk_capacity(data_chunks_.size());
+	const uint64_t chunk_bytes = capacity * unit_size_;
+
+	try {
+		// If we're out of memory, allocating a chunk will throw
+		// std::bad_alloc. To give the application some usable memory
+		// to work with in case chunk allocation fails, we allocate
+		// extra memory and throw it away if it all succeeded.
+		// This way, memory allocation will fail early enough to let
+		// PV remain alive. Otherwise, PV will crash in a random
+		// memory-allocating part of the application.
+		current_chunk_ = new uint8_t[chunk_bytes + 7];  /* FIXME +7 is workaround for #1284 */
+
+		const uint64_t dummy_size = 2 * chunk_bytes;
+		auto dummy_chunk = new uint8_t[dummy_size];
+		memset(dummy_chunk, 0xFF, dummy_size);
+		delete[] dummy_chunk;
+	} catch (bad_alloc&) {
+		delete[] current_chunk_;  // The new may have succeeded
+		current_chunk_ = nullptr;
+		throw;
+	}
+
+	data_chunks_.push_back(current_chunk_);
+	chunk_memory_ += chunk_bytes;
+	used_samples_ = 0;
+	unused_samples_ = capacity;
+}
+
+uint64_t Segment::chunk_capacity(uint64_t chunk_num) const
+{
+	if (chunk_num + 1 < ramp_chunk_starts_.size())
+		return ramp_chunk_starts_[chunk_num + 1] - ramp_chunk_starts_[chunk_num];
+
+	return chunk_size_ / unit_size_;
+}
+
+void Segment::locate_sample(uint64_t sample_num, uint64_t &chunk_num,
+	uint64_t &chunk_offs) const
+{
+	const uint64_t ramp_chunks = ramp_chunk_starts_.size() - 1;
+	const uint64_t ramp_end = ramp_chunk_starts_.back();
+
+	if (sample_num >= ramp_end) {
+		// All chunks past the ramp have the full size
+		const uint64_t offs = (sample_num - ramp_end) * unit_size_;
+		chunk_num = ramp_chunks + offs / chunk_size_;
+		chunk_offs = offs % chunk_size_;
+	} else {
+		chunk_num = (upper_bound(ramp_chunk_starts_.begin(),
+			ramp_chunk_starts_.end(), sample_num) - ramp_chunk_starts_.begin()) - 1;
+		chunk_offs = (sample_num - ramp_chunk_starts_[chunk_num]) * unit_size_;
+	}
+}
+
 const uint8_t* Segment::get_raw_sample(uint64_t sample_num) const
 {
 	assert(sample_num <= sample_count_);
 
-	uint64_t chunk_num = (sample_num * unit_size_) / chunk_size_;
-	uint64_t chunk_offs = (sample_num * unit_size_) % chunk_size_;
+	uint64_t chunk_num, chunk_offs;
+	locate_sample(sample_num, chunk_num, chunk_offs);
 
-	lock_guard<recursive_mutex> lock(mutex_);  // Because of free_unused_memory()
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());  // Because of free_unused_memory()
 
 	const uint8_t* chunk = data_chunks_[chunk_num];
 
@@ -234,16 +354,16 @@ void Segment::get_raw_samples(uint64_t start, uint64_t count, uint8_t* dest) con
 
 	uint8_t* dest_ptr = dest;
 
-	uint64_t chunk_num = (start * unit_size_) / chunk_size_;
-	uint64_t chunk_offs = (start * unit_size_) % chunk_size_;
+	uint64_t chunk_num, chunk_offs;
+	locate_sample(start, chunk_num, chunk_offs);
 
-	lock_guard<recursive_mutex> lock(mutex_);  // Because of free_unused_memory()
+	ProfiledLockGuard<recursive_mutex> lock(mutex_, lock_wait_stage());  // Because of free_unused_memory()
 
 	while (count > 0) {
 		const uint8_t* chunk = data_chunks_[chunk_num];
 
 		uint64_t copy_size = min(count * unit_size_,
-			chunk_size_ - chunk_offs);
+			chunk_capacity(chunk_num) * unit_size_ - chunk_offs);
 
 		memcpy(dest_ptr, chunk + chunk_offs, copy_size);
 
@@ -264,8 +384,7 @@ SegmentDataIterator* Segment::begin_sample_iteration(uint64_t start)
 	iterator_count_++;
 
 	it->sample_index = start;
-	it->chunk_num = (start * unit_size_) / chunk_size_;
-	it->chunk_offs = (start * unit_size_) % chunk_size_;
+	locate_sample(start, it->chunk_num, it->chunk_offs);
 	it->chunk = data_chunks_[it->chunk_num];
 
 	return it;
@@ -276,9 +395,10 @@ void Segment::continue_sample_iteration(SegmentDataIterator* it, uint64_t increa
 	it->sample_index += increase;
 	it->chunk_offs += (increase * unit_size_);
 
-	if (it->chunk_offs > (chunk_size_ - 1)) {
+	const uint64_t chunk_bytes = chunk_capacity(it->chunk_num) * unit_size_;
+	if (it->chunk_offs > (chunk_bytes - 1)) {
 		it->chunk_num++;
-		it->chunk_offs -= chunk_size_;
+		it->chunk_offs -= chunk_bytes;
 		it->chunk = data_chunks_[it->chunk_num];
 	}
 }
@@ -306,7 +426,7 @@ uint64_t Segment::get_iterator_valid_length(SegmentDataIterator* it)
 {
 	assert(it->sample_index <= (sample_count_ - 1));
 
-	return ((chunk_size_ - it->chunk_offs) / unit_size_);
+	return ((chunk_capacity(it->chunk_num) * unit_size_ - it->chunk_offs) / unit_size_);
 }
 
 } // namespace data
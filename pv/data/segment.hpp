@@ -21,6 +21,7 @@
 #ifndef PULSEVIEW_PV_DATA_SEGMENT_HPP
 #define PULSEVIEW_PV_DATA_SEGMENT_HPP
 
+#include "pv/profiling.hpp"
 #include "pv/util.hpp"
 
 #include <atomic>
@@ -28,12 +29,14 @@
 #include <mutex>
 #include <thread>
 #include <deque>
+#include <vector>
 
 #include <QObject>
 
 using std::atomic;
 using std::recursive_mutex;
 using std::deque;
+using std::vector;
 
 namespace SegmentTest {
 struct SmallSize8Single;
@@ -46,6 +49,8 @@ struct MediumSize32Multi;
 struct MaxSize32Multi;
 struct MaxSize32MultiAtOnce;
 struct MaxSize32MultiIterated;
+struct RampChunks;
+struct RampIteration;
 }  // namespace SegmentTest
 
 namespace pv {
@@ -61,6 +66,7 @@ class Segment : public QObject
 	Q_OBJECT
 
 private:
+	static const uint64_t MinChunkSize;
 	static const uint64_t MaxChunkSize;
 
 public:
@@ -79,17 +85,30 @@ public:
 
 	uint32_t segment_id() const;
 
+	/**
+	 * Marks the segment as complete and releases the unused part of the
+	 * last data chunk. No more samples may be appended afterwards.
+	 */
 	void set_complete();
 	bool is_complete() const;
 
 	void free_unused_memory();
 
+	/**
+	 * Returns the number of bytes allocated for the sample data and any
+	 * additional data structures derived from it.
+	 */
+	virtual uint64_t get_memory_used() const;
+
 Q_SIGNALS:
 	void completed();
 
 protected:
 	void append_single_sample(void *data);
 	void append_samples(void *data, uint64_t samples);
+	void append_repeated_samples(const void *data, uint64_t samples);
+	uint8_t* get_free_chunk_space(uint64_t& free_samples);
+	void commit_free_chunk_space(uint64_t samples);
 	const uint8_t* get_raw_sample(uint64_t sample_num) const;
 	void get_raw_samples(uint64_t start, uint64_t count, uint8_t *dest) const;
 
@@ -99,6 +118,20 @@ protected:
 	uint8_t* get_iterator_value(SegmentDataIterator* it);
 	uint64_t get_iterator_valid_length(SegmentDataIterator* it);
 
+	/// Profiling stage that collects the time spent waiting for mutex_
+	static Profiling::Stage* lock_wait_stage();
+
+private:
+	void allocate_new_chunk();
+
+	/// Returns the number of samples the given data chunk can hold
+	uint64_t chunk_capacity(uint64_t chunk_num) const;
+
+	/// Determines the data chunk and the byte offset within it of a sample
+	void locate_sample(uint64_t sample_num, uint64_t &chunk_num,
+		uint64_t &chunk_offs) const;
+
+protected:
 	uint32_t segment_id_;
 	mutable recursive_mutex mutex_;
 	deque<uint8_t*> data_chunks_;
@@ -109,6 +142,15 @@ protected:
 	double samplerate_;
 	uint64_t chunk_size_;
 	unsigned int unit_size_;
+
+	/**
+	 * Data chunks start at MinChunkSize and double in size until they
+	 * reach chunk_size_, so that short segments don't occupy a full-size
+	 * chunk. ramp_chunk_starts_ holds the first sample of each of these
+	 * smaller chunks plus the first sample of the first full-size chunk.
+	 */
+	vector<uint64_t> ramp_chunk_starts_;
+	uint64_t chunk_memory_;
 	int iterator_count_;
 	bool mem_optimization_requested_;
 	bool is_complete_;
@@ -123,6 +165,8 @@ protected:
 	friend struct SegmentTest::MaxSize32Multi;
 	friend struct SegmentTest::MaxSize32MultiAtOnce;
 	friend struct SegmentTest::MaxSize32MultiIterated;
+	friend struct SegmentTest::RampChunks;
+	friend struct SegmentTest::RampIteration;
 };
 
 } // namespace data
@@ -29,6 +29,7 @@
 #include <QDebug>
 
 #include <extdef.h>
+#include <pv/profiling.hpp>
 #include <pv/session.hpp>
 #include <pv/binding/decoder.hpp>
 
@@ -127,6 +128,9 @@ SignalBase::SignalBase(shared_ptr<sigrok::Channel> channel, ChannelType channel_
 	index_(0),
 	error_message_("")
 {
+	for (atomic<Profiling::Stage*>& stage : profiling_stages_)
+		stage = nullptr;
+
 	if (channel_) {
 		set_internal_name(QString::fromStdString(channel_->name()));
 		set_index(channel_->index());
@@ -233,6 +237,24 @@ QString SignalBase::display_name() const
 		return name();
 }
 
+Profiling::Stage* SignalBase::profiling_stage(ProfilingStageType type) const
+{
+	static const char* const prefixes[ProfilingStageTypeCount] =
+		{"Conversion: ", "Decode: ", "Decode mux: ", "Math: ", "Paint: "};
+
+	Profiling::Stage* stage = profiling_stages_[type];
+
+	// Concurrent first calls get the same stage unless the signal was renamed
+	// in between, which is harmless
+	if (!stage) {
+		stage = profiling.stage(prefixes[type] + name(),
+			(type == PaintProfilingStage) ? "frames" : "samples");
+		profiling_stages_[type] = stage;
+	}
+
+	return stage;
+}
+
 void SignalBase::set_name(QString name)
 {
 	if (channel_)
@@ -633,6 +655,9 @@ void SignalBase::convert_single_segment_range(shared_ptr<AnalogSegment> asegment
 	shared_ptr<LogicSegment> lsegment, uint64_t start_sample, uint64_t end_sample)
 {
 	if (end_sample > start_sample) {
+		ProfilingScope profiling_scope(profiling_stage(ConversionProfilingStage),
+			end_sample - start_sample);
+
 		tie(min_value_, max_value_) = asegment->get_min_max();
 
 		// Create sigrok::Analog instance
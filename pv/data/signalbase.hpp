@@ -36,6 +36,8 @@
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
 
+#include <pv/profiling.hpp>
+
 #include "segment.hpp"
 
 using std::atomic;
@@ -113,6 +115,16 @@ public:
 		DynamicPreset = 0  ///< Conversion uses calculated values
 	};
 
+	/// The pipeline stages that are profiled per signal
+	enum ProfilingStageType {
+		ConversionProfilingStage = 0,
+		DecodeProfilingStage,
+		DecodeMuxProfilingStage,
+		MathProfilingStage,
+		PaintProfilingStage,
+		ProfilingStageTypeCount  // Indicates how many types there are, must always be last
+	};
+
 	static const QColor AnalogSignalColors[8];
 	static const QColor LogicSignalColors[10];
 
@@ -200,6 +212,14 @@ public:
 	 */
 	void set_internal_name(QString internal_name);
 
+	/**
+	 * Returns the profiling stage of the given type for this signal. The
+	 * stage is looked up once and named after the signal at that time, so
+	 * the per-chunk and per-frame callers don't take the stage map lock and
+	 * renaming the signal doesn't split its statistics.
+	 */
+	Profiling::Stage* profiling_stage(ProfilingStageType type) const;
+
 	/**
 	 * Produces a string for this signal that can be used for display,
 	 * i.e. it contains one or both of the signal/internal names.
@@ -424,6 +444,8 @@ protected:
 	unsigned int index_;
 
 	QString error_message_;
+
+	mutable atomic<Profiling::Stage*> profiling_stages_[ProfilingStageTypeCount];
 };
 
 } // namespace data
@@ -17,10 +17,21 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "segment.hpp"
 #include "signaldata.hpp"
 
 namespace pv {
 namespace data {
 
+uint64_t SignalData::get_memory_used() const
+{
+	uint64_t size = 0;
+
+	for (const shared_ptr<Segment>& segment : segments())
+		size += segment->get_memory_used();
+
+	return size;
+}
+
 } // namespace data
 } // namespace pv
@@ -55,6 +55,11 @@ public:
 
 	virtual double get_samplerate() const = 0;
 
+	/**
+	 * Returns the number of bytes allocated by all segments.
+	 */
+	uint64_t get_memory_used() const;
+
 Q_SIGNALS:
 	void segment_completed();
 };
@@ -0,0 +1,406 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStandardPaths>
+
+#include <libsigrokdecode/libsigrokdecode.h>
+
+#include "decodercatalog.hpp"
+
+#define DECODERS_HAVE_TAGS \
+	((SRD_PACKAGE_VERSION_MAJOR > 0) || \
+	 (SRD_PACKAGE_VERSION_MAJOR == 0) && (SRD_PACKAGE_VERSION_MINOR > 5))
+
+using std::lock_guard;
+using std::move;
+using std::sort;
+
+namespace pv {
+
+DecoderCatalog decoder_catalog;
+
+const int DecoderCatalog::CacheVersion = 1;
+
+DecoderCatalog::DecoderCatalog() :
+	loading_(false),
+	load_interrupt_(false)
+{
+}
+
+DecoderCatalog::~DecoderCatalog()
+{
+	stop();
+}
+
+void DecoderCatalog::init()
+{
+	QString signature;
+	const QStringList ids = decoder_ids(signature);
+
+	if (load_cache(signature))
+		return;
+
+	qDebug() << "Protocol decoder cache is outdated, loading decoders in the background";
+
+	loading_ = true;
+	load_interrupt_ = false;
+	load_thread_ = std::thread(&DecoderCatalog::load_proc, this, ids, signature);
+}
+
+void DecoderCatalog::wait()
+{
+	if (load_thread_.joinable())
+		load_thread_.join();
+}
+
+void DecoderCatalog::stop()
+{
+	load_interrupt_ = true;
+	wait();
+}
+
+bool DecoderCatalog::is_loading() const
+{
+	return loading_;
+}
+
+vector<DecoderCatalog::Info> DecoderCatalog::decoders() const
+{
+	lock_guard<mutex> lock(info_mutex_);
+	return decoders_;
+}
+
+DecoderCatalog::Info DecoderCatalog::decoder_info(const QString &id) const
+{
+	lock_guard<mutex> lock(info_mutex_);
+
+	for (const Info& info : decoders_)
+		if (info.id == id)
+			return info;
+
+	return Info();
+}
+
+vector<DecoderCatalog::Info> DecoderCatalog::decoders_providing(const QString &output) const
+{
+	lock_guard<mutex> lock(info_mutex_);
+
+	// TODO For now we ignore that outputs is actually a list
+	vector<Info> result;
+	for (const Info& info : decoders_)
+		if (!info.outputs.isEmpty() && (info.outputs.first() == output))
+			result.push_back(info);
+
+	return result;
+}
+
+srd_decoder* DecoderCatalog::get_decoder(const QString &id)
+{
+	const QByteArray id_utf8 = id.toUtf8();
+
+	// libsigrokdecode only ever appends to its decoder list, so readers of
+	// the list elsewhere aren't disturbed by this
+	lock_guard<mutex> lock(load_mutex_);
+
+	srd_decoder *d = srd_decoder_get_by_id(id_utf8.constData());
+	if (d)
+		return d;
+
+	if (srd_decoder_load(id_utf8.constData()) != SRD_OK) {
+		qWarning() << "Failed to load protocol decoder" << id;
+		return nullptr;
+	}
+
+	return srd_decoder_get_by_id(id_utf8.constData());
+}
+
+QStringList DecoderCatalog::decoder_ids(QString &signature)
+{
+	QStringList ids;
+
+	// The signature changes whenever libsigrokdecode or any decoder changes
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(QByteArray(srd_lib_version_string_get()));
+
+	GSList *paths = srd_searchpaths_get();
+	for (GSList *l = paths; l; l = l->next) {
+		const QDir dir(QString::fromUtf8((char*)l->data));
+
+		for (const QFileInfo& entry : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+			const QString id = entry.fileName();
+			if (id.startsWith('_') || id.startsWith('.') || ids.contains(id))
+				continue;
+
+			ids << id;
+
+			for (const QFileInfo& file : QDir(entry.filePath()).entryInfoList(QStringList("*.py"), QDir::Files, QDir::Name))
+				hash.addData(QString("%1:%2:%3;").arg(file.filePath())
+					.arg(file.lastModified().toMSecsSinceEpoch())
+					.arg(file.size()).toUtf8());
+		}
+	}
+	g_slist_free_full(paths, g_free);
+
+	signature = QString::fromLatin1(hash.result().toHex());
+
+	return ids;
+}
+
+QString DecoderCatalog::cache_file_name()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+		"/decoders.json";
+}
+
+bool DecoderCatalog::load_cache(const QString &signature)
+{
+	QFile file(cache_file_name());
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+	if ((root.value("version").toInt() != CacheVersion) ||
+		(root.value("signature").toString() != signature))
+		return false;
+
+	vector<Info> decoders;
+	for (const QJsonValue& value : root.value("decoders").toArray())
+		decoders.push_back(info_from_json(value.toObject()));
+
+	if (decoders.empty())
+		return false;
+
+	lock_guard<mutex> lock(info_mutex_);
+	decoders_ = move(decoders);
+
+	return true;
+}
+
+void DecoderCatalog::save_cache(const QString &signature) const
+{
+	QJsonArray decoders;
+	{
+		lock_guard<mutex> lock(info_mutex_);
+		for (const Info& info : decoders_)
+			decoders.append(info_to_json(info));
+	}
+
+	QJsonObject root;
+	root["version"] = CacheVersion;
+	root["signature"] = signature;
+	root["decoders"] = decoders;
+
+	const QString file_name = cache_file_name();
+	QDir().mkpath(QFileInfo(file_name).absolutePath());
+
+	QFile file(file_name);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+		(file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0))
+		qWarning() << "Failed to write protocol decoder cache" << file_name;
+}
+
+DecoderCatalog::Info DecoderCatalog::make_info(const srd_decoder *d)
+{
+	Info info;
+
+	info.id = QString::fromUtf8(d->id);
+	info.name = QString::fromUtf8(d->name);
+	info.longname = QString::fromUtf8(d->longname);
+	info.desc = QString::fromUtf8(d->desc);
+	info.license = QString::fromUtf8(d->license);
+
+	char *doc = srd_decoder_doc_get(d);
+	info.doc = QString::fromUtf8(doc).trimmed();
+	g_free(doc);
+
+#if DECODERS_HAVE_TAGS
+	for (const GSList *l = d->tags; l; l = l->next)
+		info.tags << QString::fromUtf8((char*)l->data);
+#endif
+
+	for (const GSList *l = d->inputs; l; l = l->next)
+		info.inputs << QString::fromUtf8((char*)l->data);
+
+	for (const GSList *l = d->outputs; l; l = l->next)
+		info.outputs << QString::fromUtf8((char*)l->data);
+
+	for (const GSList *l = d->channels; l; l = l->next) {
+		const srd_channel *ch = (srd_channel*)l->data;
+		info.channels.push_back({QString::fromUtf8(ch->id),
+			QString::fromUtf8(ch->name), QString::fromUtf8(ch->desc)});
+	}
+
+	for (const GSList *l = d->opt_channels; l; l = l->next) {
+		const srd_channel *ch = (srd_channel*)l->data;
+		info.opt_channels.push_back({QString::fromUtf8(ch->id),
+			QString::fromUtf8(ch->name), QString::fromUtf8(ch->desc)});
+	}
+
+	for (const GSList *l = d->options; l; l = l->next) {
+		const srd_decoder_option *opt = (srd_decoder_option*)l->data;
+
+		QString default_value;
+		if (opt->def) {
+			char *s = g_variant_print(opt->def, FALSE);
+			default_value = QString::fromUtf8(s);
+			g_free(s);
+		}
+
+		info.options.push_back({QString::fromUtf8(opt->id),
+			QString::fromUtf8(opt->desc), default_value});
+	}
+
+	return info;
+}
+
+QJsonObject DecoderCatalog::info_to_json(const Info &info)
+{
+	QJsonObject obj;
+
+	obj["id"] = info.id;
+	obj["name"] = info.name;
+	obj["longname"] = info.longname;
+	obj["desc"] = info.desc;
+	obj["license"] = info.license;
+	obj["doc"] = info.doc;
+	obj["tags"] = QJsonArray::fromStringList(info.tags);
+	obj["inputs"] = QJsonArray::fromStringList(info.inputs);
+	obj["outputs"] = QJsonArray::fromStringList(info.outputs);
+
+	const auto channel_to_json = [](const Channel& ch) {
+		QJsonObject ch_obj;
+		ch_obj["id"] = ch.id;
+		ch_obj["name"] = ch.name;
+		ch_obj["desc"] = ch.desc;
+		return ch_obj;
+	};
+
+	QJsonArray channels, opt_channels, options;
+
+	for (const Channel& ch : info.channels)
+		channels.append(channel_to_json(ch));
+
+	for (const Channel& ch : info.opt_channels)
+		opt_channels.append(channel_to_json(ch));
+
+	for (const Option& opt : info.options) {
+		QJsonObject opt_obj;
+		opt_obj["id"] = opt.id;
+		opt_obj["desc"] = opt.desc;
+		opt_obj["default"] = opt.default_value;
+		options.append(opt_obj);
+	}
+
+	obj["channels"] = channels;
+	obj["opt_channels"] = opt_channels;
+	obj["options"] = options;
+
+	return obj;
+}
+
+DecoderCatalog::Info DecoderCatalog::info_from_json(const QJsonObject &obj)
+{
+	Info info;
+
+	info.id = obj.value("id").toString();
+	info.name = obj.value("name").toString();
+	info.longname = obj.value("longname").toString();
+	info.desc = obj.value("desc").toString();
+	info.license = obj.value("license").toString();
+	info.doc = obj.value("doc").toString();
+
+	for (const QJsonValue& value : obj.value("tags").toArray())
+		info.tags << value.toString();
+
+	for (const QJsonValue& value : obj.value("inputs").toArray())
+		info.inputs << value.toString();
+
+	for (const QJsonValue& value : obj.value("outputs").toArray())
+		info.outputs << value.toString();
+
+	for (const QJsonValue& value : obj.value("channels").toArray()) {
+		const QJsonObject ch = value.toObject();
+		info.channels.push_back({ch.value("id").toString(),
+			ch.value("name").toString(), ch.value("desc").toString()});
+	}
+
+	for (const QJsonValue& value : obj.value("opt_channels").toArray()) {
+		const QJsonObject ch = value.toObject();
+		info.opt_channels.push_back({ch.value("id").toString(),
+			ch.value("name").toString(), ch.value("desc").toString()});
+	}
+
+	for (const QJsonValue& value : obj.value("options").toArray()) {
+		const QJsonObject opt = value.toObject();
+		info.options.push_back({opt.value("id").toString(),
+			opt.value("desc").toString(), opt.value("default").toString()});
+	}
+
+	return info;
+}
+
+void DecoderCatalog::load_proc(QStringList ids, QString signature)
+{
+	if (ids.isEmpty()) {
+		// The decoders may e.g. reside in a zip file that can't be listed
+		lock_guard<mutex> lock(load_mutex_);
+		srd_decoder_load_all();
+	} else {
+		// Load the decoders one by one so that get_decoder() isn't blocked for long
+		for (const QString& id : ids) {
+			if (load_interrupt_) {
+				loading_ = false;
+				return;
+			}
+
+			get_decoder(id);
+		}
+	}
+
+	vector<Info> decoders;
+	{
+		lock_guard<mutex> lock(load_mutex_);
+		for (const GSList *l = srd_decoder_list(); l; l = l->next)
+			decoders.push_back(make_info((const srd_decoder*)l->data));
+	}
+
+	sort(decoders.begin(), decoders.end(),
+		[](const Info& a, const Info& b) { return a.id < b.id; });
+
+	{
+		lock_guard<mutex> lock(info_mutex_);
+		decoders_ = move(decoders);
+	}
+
+	save_cache(signature);
+	loading_ = false;
+
+	decoders_changed();
+}
+
+} // namespace pv
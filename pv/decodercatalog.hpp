@@ -0,0 +1,136 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DECODERCATALOG_HPP
+#define PULSEVIEW_PV_DECODERCATALOG_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+using std::atomic;
+using std::mutex;
+using std::vector;
+
+struct srd_decoder;
+
+namespace pv {
+
+/**
+ * Provides the metadata of all available protocol decoders without having
+ * to import their Python modules. The metadata is kept in a cache file that
+ * is only rebuilt - on a background thread - when the installed decoders
+ * changed. A decoder's module is imported when the decoder is first used.
+ */
+class DecoderCatalog : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Channel
+	{
+		QString id, name, desc;
+	};
+
+	struct Option
+	{
+		QString id, desc, default_value;
+	};
+
+	struct Info
+	{
+		QString id, name, longname, desc, license, doc;
+		QStringList tags, inputs, outputs;
+		vector<Channel> channels, opt_channels;
+		vector<Option> options;
+	};
+
+private:
+	static const int CacheVersion;
+
+public:
+	DecoderCatalog();
+	~DecoderCatalog();
+
+	/**
+	 * Reads the metadata cache. If it is missing or outdated, the decoders
+	 * are loaded on a background thread and decoders_changed() is emitted
+	 * once their metadata is available.
+	 */
+	void init();
+
+	/// Blocks until the background loading finished
+	void wait();
+
+	/// Interrupts the background loading, must be called before srd_exit()
+	void stop();
+
+	bool is_loading() const;
+
+	/// Returns the metadata of all decoders, sorted by ID
+	vector<Info> decoders() const;
+
+	/// Returns the metadata of the given decoder or an Info with an empty ID
+	Info decoder_info(const QString &id) const;
+
+	/// Returns the metadata of all decoders whose first output is @a output
+	vector<Info> decoders_providing(const QString &output) const;
+
+	/**
+	 * Returns the decoder with the given ID, importing its Python module
+	 * if this hasn't happened yet. Returns nullptr if it can't be loaded.
+	 */
+	srd_decoder* get_decoder(const QString &id);
+
+private:
+	static QStringList decoder_ids(QString &signature);
+	static QString cache_file_name();
+
+	bool load_cache(const QString &signature);
+	void save_cache(const QString &signature) const;
+
+	static Info make_info(const srd_decoder *d);
+	static QJsonObject info_to_json(const Info &info);
+	static Info info_from_json(const QJsonObject &obj);
+
+	void load_proc(QStringList ids, QString signature);
+
+Q_SIGNALS:
+	void decoders_changed();
+
+private:
+	mutable mutex info_mutex_;
+	vector<Info> decoders_;
+
+	/// Serializes loading decoders, which modifies libsigrokdecode's decoder list
+	mutex load_mutex_;
+
+	std::thread load_thread_;
+	atomic<bool> loading_, load_interrupt_;
+};
+
+extern DecoderCatalog decoder_catalog;
+
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DECODERCATALOG_HPP
@@ -20,6 +20,7 @@
 #include "devicemanager.hpp"
 #include "session.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <memory>
@@ -32,21 +33,25 @@
 #include <QApplication>
 #include <QDebug>
 #include <QObject>
-#include <QProgressDialog>
+#include <QSettings>
 
 #include <boost/filesystem.hpp>
 
 #include <pv/devices/hardwaredevice.hpp>
 #include <pv/util.hpp>
 
+using std::any_of;
 using std::bind;
 using std::list;
+using std::lock_guard;
+using std::make_shared;
 using std::map;
+using std::min;
 using std::placeholders::_1;
 using std::placeholders::_2;
 using std::shared_ptr;
 using std::string;
-using std::unique_ptr;
+using std::unique_lock;
 using std::vector;
 
 using Glib::VariantBase;
@@ -57,17 +62,29 @@ using sigrok::Driver;
 
 namespace pv {
 
-DeviceManager::DeviceManager(shared_ptr<Context> context,
-	std::string driver, bool do_scan) :
-	context_(context)
+struct DeviceManager::ScanJob
 {
-	unique_ptr<QProgressDialog> progress(new QProgressDialog("",
-		QObject::tr("Cancel"), 0, context->drivers().size() + 1));
-	progress->setWindowModality(Qt::WindowModal);
-	progress->setMinimumDuration(1);  // To show the dialog immediately
+	shared_ptr<Driver> driver;
+	map<const ConfigKey *, VariantBase> options;
+	bool user_spec;
+	uint64_t generation;
+};
 
-	int entry_num = 1;
+struct DeviceManager::ScanResult
+{
+	shared_ptr<ScanJob> job;
+	vector< shared_ptr<sigrok::HardwareDevice> > devices;
+};
 
+// Scans mostly wait for USB and serial I/O, so use more threads than cores
+const unsigned int DeviceManager::MaxScanThreads = 8;
+
+DeviceManager::DeviceManager(shared_ptr<Context> context,
+	std::string driver, bool do_scan) :
+	context_(context),
+	pending_scans_(0),
+	scan_interrupt_(false)
+{
 	/*
 	 * Check the presence of an optional user spec for device scans.
 	 * Determine the driver name and options (in generic format) when
@@ -81,72 +98,91 @@ DeviceManager::DeviceManager(shared_ptr<Context> context,
 		user_opts.erase(user_opts.begin());
 	}
 
-	/*
-	 * Scan for devices. No specific options apply here, this is
-	 * best effort auto detection.
-	 */
-	for (auto& entry : context->drivers()) {
-		if (!do_scan)
-			break;
-
-		// Skip drivers we won't scan anyway
-		if (!driver_supported(entry.second))
-			continue;
-
-		progress->setLabelText(QObject::tr("Scanning for devices that driver %1 can access...")
-			.arg(QString::fromStdString(entry.first)));
-
-		if (entry.first == user_name)
-			continue;
-		driver_scan(entry.second, map<const ConfigKey *, VariantBase>());
-
-		progress->setValue(entry_num++);
-		QApplication::processEvents();
-		if (progress->wasCanceled())
-			break;
-	}
-
 	/*
 	 * Optionally run another scan with potentially more specific
 	 * options when requested by the user. This is motivated by
 	 * several different uses: It can find devices that are not
-	 * covered by the above auto detection (UART, TCP). It can
+	 * covered by the auto detection below (UART, TCP). It can
 	 * prefer one out of multiple found devices, and have this
 	 * device pre-selected for new sessions upon user's request.
 	 */
 	user_spec_device_.reset();
 	if (!driver.empty()) {
-		shared_ptr<sigrok::Driver> scan_drv;
-		map<const ConfigKey *, VariantBase> scan_opts;
-
 		/*
 		 * Lookup the device driver name.
 		 */
 		map<string, shared_ptr<Driver>> drivers = context->drivers();
 		auto entry = drivers.find(user_name);
-		scan_drv = (entry != drivers.end()) ? entry->second : nullptr;
-
-		/*
-		 * Convert generic string representation of options
-		 * to the driver specific data types.
-		 */
-		if (scan_drv && !user_opts.empty()) {
-			auto drv_opts = scan_drv->scan_options();
-			scan_opts = drive_scan_options(user_opts, drv_opts);
+		shared_ptr<Driver> scan_drv = (entry != drivers.end()) ? entry->second : nullptr;
+
+		if (scan_drv && driver_supported(scan_drv)) {
+			shared_ptr<ScanJob> job = make_shared<ScanJob>();
+			job->driver = scan_drv;
+			job->user_spec = true;
+			job->generation = scan_generations_[scan_drv.get()];
+
+			/*
+			 * Convert generic string representation of options
+			 * to the driver specific data types.
+			 */
+			if (!user_opts.empty()) {
+				auto drv_opts = scan_drv->scan_options();
+				job->options = drive_scan_options(user_opts, drv_opts);
+			}
+
+			scan_jobs_.push_back(job);
 		}
+	}
 
-		/*
-		 * Run another scan for the specified driver, passing
-		 * user provided scan options this time.
-		 */
-		list< shared_ptr<devices::HardwareDevice> > found;
-		if (scan_drv) {
-			found = driver_scan(scan_drv, scan_opts);
-			if (!found.empty())
-				user_spec_device_ = found.front();
+	/*
+	 * Scan for devices. No specific options apply here, this is
+	 * best effort auto detection. Drivers that found devices during
+	 * the previous run are scanned first so that these show up early.
+	 */
+	if (do_scan) {
+		load_device_cache();
+
+		deque< shared_ptr<ScanJob> > other_jobs;
+
+		for (auto& entry : context->drivers()) {
+			// Skip drivers we won't scan anyway
+			if (!driver_supported(entry.second) || (entry.first == user_name))
+				continue;
+
+			shared_ptr<ScanJob> job = make_shared<ScanJob>();
+			job->driver = entry.second;
+			job->user_spec = false;
+			job->generation = scan_generations_[entry.second.get()];
+
+			const bool cached = any_of(cached_devices_.begin(), cached_devices_.end(),
+				[&](const CachedDevice &d) { return d.driver_name == entry.first; });
+
+			if (cached)
+				scan_jobs_.push_back(job);
+			else
+				other_jobs.push_back(job);
 		}
+
+		scan_jobs_.insert(scan_jobs_.end(), other_jobs.begin(), other_jobs.end());
+	}
+
+	pending_scans_ = scan_jobs_.size();
+
+	const unsigned int thread_count = min((size_t)MaxScanThreads, scan_jobs_.size());
+	for (unsigned int i = 0; i < thread_count; i++)
+		scan_threads_.emplace_back(&DeviceManager::scan_proc, this);
+}
+
+DeviceManager::~DeviceManager()
+{
+	{
+		lock_guard<mutex> lock(scan_mutex_);
+		scan_interrupt_ = true;
 	}
-	progress->setValue(entry_num++);
+
+	// Scans that are already running can't be aborted, so wait for them
+	for (std::thread& thread : scan_threads_)
+		thread.join();
 }
 
 const shared_ptr<sigrok::Context>& DeviceManager::context() const
@@ -174,6 +210,21 @@ DeviceManager::user_spec_device() const
 	return user_spec_device_;
 }
 
+bool DeviceManager::is_scanning() const
+{
+	return pending_scans_ > 0;
+}
+
+vector<QString> DeviceManager::pending_cached_devices() const
+{
+	vector<QString> result;
+
+	for (const CachedDevice& device : cached_devices_)
+		result.push_back(device.display_name);
+
+	return result;
+}
+
 /**
  * Convert generic options to data types that are specific to Driver::scan().
  *
@@ -241,43 +292,171 @@ list< shared_ptr<devices::HardwareDevice> >
 DeviceManager::driver_scan(
 	shared_ptr<Driver> driver, map<const ConfigKey *, VariantBase> drvopts)
 {
-	list< shared_ptr<devices::HardwareDevice> > driver_devices;
-
 	assert(driver);
 
 	if (!driver_supported(driver))
-		return driver_devices;
+		return list< shared_ptr<devices::HardwareDevice> >();
+
+	// Background scans of this driver that haven't reported yet are
+	// superseded by this one and their results must not replace ours
+	{
+		lock_guard<mutex> lock(scan_mutex_);
+		scan_generations_[driver.get()]++;
+	}
 
 	// Remove any device instances from this driver from the device
 	// list. They will not be valid after the scan.
 	devices_.remove_if([&](shared_ptr<devices::HardwareDevice> device) {
 		return device->hardware_device()->driver() == driver; });
 
-	try {
-		// Do the scan
-		auto devices = driver->scan(drvopts);
-
-		// Add the scanned devices to the main list, set display names and sort.
-		for (shared_ptr<sigrok::HardwareDevice>& device : devices) {
-			const shared_ptr<devices::HardwareDevice> d(
-				new devices::HardwareDevice(context_, device));
-			driver_devices.push_back(d);
-		}
+	const list< shared_ptr<devices::HardwareDevice> > driver_devices =
+		add_scanned_devices(driver, scan_driver_devices(driver, drvopts));
 
-		devices_.insert(devices_.end(), driver_devices.begin(),
-			driver_devices.end());
-		devices_.sort(bind(&DeviceManager::compare_devices, this, _1, _2));
-		driver_devices.sort(bind(
-			&DeviceManager::compare_devices, this, _1, _2));
+	devices_changed();
 
+	return driver_devices;
+}
+
+vector< shared_ptr<sigrok::HardwareDevice> > DeviceManager::scan_driver_devices(
+	shared_ptr<Driver> driver, const map<const ConfigKey *, VariantBase> &drvopts)
+{
+	vector< shared_ptr<sigrok::HardwareDevice> > devices;
+
+	{
+		unique_lock<mutex> lock(scan_mutex_);
+		scan_cond_.wait(lock, [&] { return drivers_scanning_.count(driver.get()) == 0; });
+		drivers_scanning_.insert(driver.get());
+	}
+
+	try {
+		devices = driver->scan(drvopts);
 	} catch (const sigrok::Error &e) {
 		qWarning() << QApplication::tr("Error when scanning device driver '%1': %2").
 			arg(QString::fromStdString(driver->name()), e.what());
 	}
 
+	{
+		lock_guard<mutex> lock(scan_mutex_);
+		drivers_scanning_.erase(driver.get());
+	}
+	scan_cond_.notify_all();
+
+	return devices;
+}
+
+list< shared_ptr<devices::HardwareDevice> > DeviceManager::add_scanned_devices(
+	shared_ptr<Driver> driver,
+	const vector< shared_ptr<sigrok::HardwareDevice> > &scanned_devices)
+{
+	list< shared_ptr<devices::HardwareDevice> > driver_devices;
+
+	devices_.remove_if([&](shared_ptr<devices::HardwareDevice> device) {
+		return device->hardware_device()->driver() == driver; });
+
+	// Add the scanned devices to the main list, set display names and sort.
+	for (const shared_ptr<sigrok::HardwareDevice>& device : scanned_devices) {
+		const shared_ptr<devices::HardwareDevice> d(
+			new devices::HardwareDevice(context_, device));
+		driver_devices.push_back(d);
+	}
+
+	devices_.insert(devices_.end(), driver_devices.begin(),
+		driver_devices.end());
+	devices_.sort(bind(&DeviceManager::compare_devices, this, _1, _2));
+	driver_devices.sort(bind(
+		&DeviceManager::compare_devices, this, _1, _2));
+
+	// The devices of this driver are known now, so the cached ones are obsolete
+	cached_devices_.remove_if([&](const CachedDevice &d) {
+		return d.driver_name == driver->name(); });
+
 	return driver_devices;
 }
 
+bool DeviceManager::is_superseded(const ScanJob &job) const
+{
+	const auto entry = scan_generations_.find(job.driver.get());
+	return (entry != scan_generations_.end()) && (entry->second != job.generation);
+}
+
+void DeviceManager::scan_proc()
+{
+	while (true) {
+		shared_ptr<ScanJob> job;
+		bool superseded;
+
+		{
+			lock_guard<mutex> lock(scan_mutex_);
+			if (scan_interrupt_ || scan_jobs_.empty())
+				return;
+
+			job = scan_jobs_.front();
+			scan_jobs_.pop_front();
+			superseded = is_superseded(*job);
+		}
+
+		// Superseded jobs are still reported so that they are counted
+		shared_ptr<ScanResult> result = make_shared<ScanResult>();
+		result->job = job;
+		if (!superseded)
+			result->devices = scan_driver_devices(job->driver, job->options);
+
+		{
+			lock_guard<mutex> lock(scan_mutex_);
+			scan_results_.push_back(result);
+		}
+
+		// The device list may only be modified from the GUI thread
+		QMetaObject::invokeMethod(this, "on_scan_results_available",
+			Qt::QueuedConnection);
+	}
+}
+
+void DeviceManager::load_device_cache()
+{
+	QSettings settings;
+	settings.beginGroup("DeviceManager");
+
+	const int count = settings.beginReadArray("cached_devices");
+	for (int i = 0; i < count; i++) {
+		settings.setArrayIndex(i);
+
+		CachedDevice device;
+		device.driver_name = settings.value("driver").toString().toStdString();
+		device.display_name = settings.value("name").toString();
+
+		if (!device.driver_name.empty())
+			cached_devices_.push_back(device);
+	}
+	settings.endArray();
+
+	settings.endGroup();
+}
+
+void DeviceManager::save_device_cache() const
+{
+	QSettings settings;
+	settings.beginGroup("DeviceManager");
+
+	settings.beginWriteArray("cached_devices");
+
+	int i = 0;
+	for (const shared_ptr<devices::HardwareDevice>& device : devices_) {
+		const string driver_name = device->hardware_device()->driver()->name();
+
+		// The demo device is always there, there's no use in caching it
+		if (driver_name == "demo")
+			continue;
+
+		settings.setArrayIndex(i++);
+		settings.setValue("driver", QString::fromStdString(driver_name));
+		settings.setValue("name", QString::fromStdString(device->display_name(*this)));
+	}
+
+	settings.endArray();
+	settings.endGroup();
+}
+
 const map<string, string> DeviceManager::get_device_info(
 	shared_ptr<devices::Device> device)
 {
@@ -351,6 +530,62 @@ const shared_ptr<devices::HardwareDevice> DeviceManager::find_device_from_info(
 	return last_resort_dev;
 }
 
+void DeviceManager::on_scan_results_available()
+{
+	deque< shared_ptr<ScanResult> > results;
+
+	{
+		lock_guard<mutex> lock(scan_mutex_);
+		results.swap(scan_results_);
+
+		// Drop the results of scans that were started before a rescan of
+		// the same driver, they would replace the newer devices
+		for (shared_ptr<ScanResult>& result : results)
+			if (is_superseded(*result->job))
+				result = nullptr;
+	}
+
+	if (results.empty())
+		return;
+
+	// Most drivers don't find anything, which needn't be reported
+	bool changed = false;
+
+	for (const shared_ptr<ScanResult>& result : results) {
+		pending_scans_--;
+
+		if (!result)
+			continue;
+
+		const size_t prev_device_count = devices_.size();
+		const size_t prev_cached_count = cached_devices_.size();
+
+		const list< shared_ptr<devices::HardwareDevice> > found =
+			add_scanned_devices(result->job->driver, result->devices);
+
+		if (result->job->user_spec && !found.empty())
+			user_spec_device_ = found.front();
+
+		changed |= !found.empty() || (devices_.size() != prev_device_count) ||
+			(cached_devices_.size() != prev_cached_count);
+	}
+
+	if (pending_scans_ == 0) {
+		changed = true;
+
+		for (std::thread& thread : scan_threads_)
+			thread.join();
+		scan_threads_.clear();
+
+		// Whatever wasn't found by now isn't there anymore
+		cached_devices_.clear();
+		save_device_cache();
+	}
+
+	if (changed)
+		devices_changed();
+}
+
 bool DeviceManager::compare_devices(shared_ptr<devices::Device> a,
 	shared_ptr<devices::Device> b)
 {
@@ -20,15 +20,26 @@
 #ifndef PULSEVIEW_PV_DEVICEMANAGER_HPP
 #define PULSEVIEW_PV_DEVICEMANAGER_HPP
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <QObject>
+#include <QString>
+
+using std::condition_variable;
+using std::deque;
 using std::list;
 using std::map;
+using std::mutex;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -42,6 +53,7 @@ namespace sigrok {
 class ConfigKey;
 class Context;
 class Driver;
+class HardwareDevice;
 }
 
 using sigrok::ConfigKey;
@@ -55,13 +67,35 @@ class HardwareDevice;
 
 class Session;
 
-class DeviceManager
+/**
+ * Keeps track of the hardware devices. The drivers are scanned for devices
+ * in the background on a pool of threads, so the UI is available right
+ * away. The devices found during the previous run are remembered and are
+ * reported by pending_cached_devices() until their driver has been scanned.
+ *
+ * Unless noted otherwise, the methods must be called from the GUI thread.
+ */
+class DeviceManager : public QObject
 {
+	Q_OBJECT
+
+private:
+	struct ScanJob;
+	struct ScanResult;
+
+	struct CachedDevice
+	{
+		string driver_name;
+		QString display_name;
+	};
+
+	static const unsigned int MaxScanThreads;
+
 public:
 	DeviceManager(shared_ptr<sigrok::Context> context,
 		std::string driver, bool do_scan);
 
-	~DeviceManager() = default;
+	~DeviceManager();
 
 	const shared_ptr<sigrok::Context>& context() const;
 
@@ -70,8 +104,23 @@ public:
 	const list< shared_ptr<devices::HardwareDevice> >& devices() const;
 	shared_ptr<devices::HardwareDevice> user_spec_device() const;
 
+	/**
+	 * Returns true until all background driver scans have completed.
+	 */
+	bool is_scanning() const;
+
+	/**
+	 * Returns the names of the devices that were found during the
+	 * previous run and whose driver hasn't been scanned yet.
+	 */
+	vector<QString> pending_cached_devices() const;
+
 	bool driver_supported(shared_ptr<sigrok::Driver> driver) const;
 
+	/**
+	 * Scans a driver synchronously. If a background scan of the same
+	 * driver is in progress, it is waited for first.
+	 */
 	list< shared_ptr<devices::HardwareDevice> > driver_scan(
 		shared_ptr<sigrok::Driver> driver,
 		map<const sigrok::ConfigKey *, Glib::VariantBase> drvopts);
@@ -90,10 +139,58 @@ private:
 	drive_scan_options(vector<string> user_spec,
 		set<const ConfigKey *> driver_opts);
 
+	/**
+	 * Runs the driver's scan. Scans of different drivers may run at the
+	 * same time, scans of the same driver are serialized. Thread-safe.
+	 */
+	vector< shared_ptr<sigrok::HardwareDevice> > scan_driver_devices(
+		shared_ptr<sigrok::Driver> driver,
+		const map<const sigrok::ConfigKey *, Glib::VariantBase> &drvopts);
+
+	/**
+	 * Replaces the devices of a driver by the ones found by a scan.
+	 */
+	list< shared_ptr<devices::HardwareDevice> > add_scanned_devices(
+		shared_ptr<sigrok::Driver> driver,
+		const vector< shared_ptr<sigrok::HardwareDevice> > &scanned_devices);
+
+	/**
+	 * Returns true if the driver was rescanned after the job was queued.
+	 * Must be called with scan_mutex_ held.
+	 */
+	bool is_superseded(const ScanJob &job) const;
+
+	void scan_proc();
+
+	void load_device_cache();
+	void save_device_cache() const;
+
+Q_SIGNALS:
+	/**
+	 * Emitted whenever devices were added or removed.
+	 */
+	void devices_changed();
+
+private Q_SLOTS:
+	void on_scan_results_available();
+
 protected:
 	shared_ptr<sigrok::Context> context_;
 	list< shared_ptr<devices::HardwareDevice> > devices_;
 	shared_ptr<devices::HardwareDevice> user_spec_device_;
+
+private:
+	list<CachedDevice> cached_devices_;
+	unsigned int pending_scans_;
+
+	mutable mutex scan_mutex_;
+	condition_variable scan_cond_;
+	deque< shared_ptr<ScanJob> > scan_jobs_;
+	deque< shared_ptr<ScanResult> > scan_results_;
+	set<const sigrok::Driver*> drivers_scanning_;
+	map<const sigrok::Driver*, uint64_t> scan_generations_;
+	bool scan_interrupt_;
+	vector<std::thread> scan_threads_;
 };
 
 } // namespace pv
@@ -0,0 +1,522 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include <QDebug>
+#include <QString>
+
+#include <libsigrokcxx/libsigrokcxx.hpp>
+
+#include "csvloader.hpp"
+#include "datasink.hpp"
+
+#include <pv/profiling.hpp>
+#include <pv/data/analogsegment.hpp>
+#include <pv/data/logicsegment.hpp>
+
+using std::max;
+using std::min;
+using std::none_of;
+using std::shared_ptr;
+using std::to_string;
+
+namespace pv {
+namespace devices {
+
+const uint64_t CsvLoader::BlockSize = 8 * 1024 * 1024;
+
+static inline bool is_blank(char c)
+{
+	return (c == ' ') || (c == '\t');
+}
+
+static inline bool is_digit(char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+unique_ptr<FileLoader> CsvLoader::create(const string &file_name,
+	const map<string, Glib::VariantBase> &options)
+{
+	const char *const known_options[] = {"column_formats", "single_column",
+		"first_column", "logic_channels", "single_format", "start_line",
+		"header", "samplerate", "column_separator", "comment_leader"};
+
+	for (const auto& entry : options) {
+		bool known = false;
+		for (const char* name : known_options)
+			known = known || (entry.first == name);
+		if (!known)
+			return nullptr;
+	}
+
+	// These are the defaults of the libsigrok input module
+	string column_formats, separator = ",", comment_leader = ";";
+	int64_t single_column = 0, first_column = 1, logic_channels = 0;
+	int64_t start_line = 1, samplerate = 0;
+	bool header = false;
+
+	if (!get_string_option(options, "column_formats", column_formats) ||
+		!get_int_option(options, "single_column", single_column) ||
+		!get_int_option(options, "first_column", first_column) ||
+		!get_int_option(options, "logic_channels", logic_channels) ||
+		!get_int_option(options, "start_line", start_line) ||
+		!get_bool_option(options, "header", header) ||
+		!get_int_option(options, "samplerate", samplerate) ||
+		!get_string_option(options, "column_separator", separator) ||
+		!get_string_option(options, "comment_leader", comment_leader))
+		return nullptr;
+
+	// Multi-bit values in a single column are left to libsigrok
+	if ((single_column != 0) || (separator.size() != 1))
+		return nullptr;
+
+	unique_ptr<CsvLoader> loader(new CsvLoader(file_name,
+		max(first_column, (int64_t)1), max(logic_channels, (int64_t)0),
+		max(start_line, (int64_t)1), header, max(samplerate, (int64_t)0),
+		separator[0], comment_leader));
+
+	if (!column_formats.empty() && !loader->parse_column_formats(column_formats))
+		return nullptr;
+
+	return unique_ptr<FileLoader>(loader.release());
+}
+
+CsvLoader::CsvLoader(const string &file_name, int64_t first_column,
+	int64_t logic_channels, int64_t start_line, bool header,
+	uint64_t samplerate, char separator, const string &comment_leader) :
+	file_name_(file_name),
+	first_column_(first_column),
+	logic_channels_(logic_channels),
+	start_line_(start_line),
+	header_(header),
+	samplerate_(samplerate),
+	separator_(separator),
+	comment_leader_(comment_leader),
+	body_(nullptr),
+	end_(nullptr),
+	block_size_(BlockSize),
+	logic_count_(0),
+	analog_count_(0)
+{
+}
+
+void CsvLoader::read_header()
+{
+	file_.close();
+	file_.setFileName(QString::fromStdString(file_name_));
+	if (!file_.open(QIODevice::ReadOnly) || (file_.size() == 0))
+		throw QString("Failed to read file");
+
+	const char *p = (const char*)file_.map(0, file_.size());
+	if (!p)
+		throw QString("Failed to map file into memory");
+
+	end_ = p + file_.size();
+
+	for (int64_t i = 1; (i < start_line_) && (p < end_); i++)
+		next_line(p, end_);
+
+	vector<Field> names, fields;
+
+	// The header line holds the channel names
+	if (header_) {
+		while (p < end_) {
+			const char *const line = p;
+			const char *const line_end = next_line(p, end_);
+			if (is_data_line(line, line_end)) {
+				split_fields(line, line_end, names);
+				break;
+			}
+		}
+	}
+
+	body_ = p;
+
+	// Look at the first data lines for the column count and the timestamps
+	vector<double> timestamps;
+	while ((p < end_) && (timestamps.size() < 2)) {
+		const char *const line = p;
+		const char *const line_end = next_line(p, end_);
+		if (!is_data_line(line, line_end))
+			continue;
+
+		split_fields(line, line_end, fields);
+
+		// Without column formats, all columns from the first one are logic
+		if (columns_.empty()) {
+			columns_.resize(min((size_t)first_column_ - 1, fields.size()),
+				{IgnoredColumn, 0});
+
+			size_t count = fields.size() - columns_.size();
+			if (logic_channels_ > 0)
+				count = min(count, (size_t)logic_channels_);
+
+			for (size_t i = 0; i < count; i++)
+				columns_.push_back({LogicColumn, (unsigned int)i});
+		}
+
+		for (size_t i = 0; (i < columns_.size()) && (i < fields.size()); i++)
+			if (columns_[i].type == TimestampColumn)
+				timestamps.push_back(parse_number(fields[i].first, fields[i].second));
+
+		if (none_of(columns_.begin(), columns_.end(),
+			[](const Column& c) { return c.type == TimestampColumn; }))
+			break;
+	}
+
+	// Derive the samplerate from the first two timestamps if not given
+	if ((samplerate_ == 0) && (timestamps.size() == 2) &&
+		(timestamps[1] > timestamps[0]))
+		samplerate_ = llround(1.0 / (timestamps[1] - timestamps[0]));
+
+	// The logic channels come first as their index is their bit in a sample
+	channels_.clear();
+	logic_count_ = analog_count_ = 0;
+
+	for (const ColumnType type : {LogicColumn, AnalogColumn})
+		for (size_t i = 0; i < columns_.size(); i++) {
+			if (columns_[i].type != type)
+				continue;
+
+			string name;
+			if (i < names.size())
+				name = string(names[i].first, names[i].second);
+			if (name.empty())
+				name = "CH" + to_string(i + 1);
+
+			channels_.push_back({name, (type == LogicColumn) ?
+				sigrok::ChannelType::LOGIC : sigrok::ChannelType::ANALOG});
+
+			columns_[i].index = (type == LogicColumn) ?
+				logic_count_++ : analog_count_++;
+		}
+
+	if (channels_.empty())
+		throw QString("The file doesn't contain any logic or analog columns");
+}
+
+const vector<FileLoader::Channel>& CsvLoader::channels() const
+{
+	return channels_;
+}
+
+void CsvLoader::run(DataSink &sink, const atomic<bool> &interrupt)
+{
+	assert(body_);
+
+	const unsigned int unit_size = (logic_count_ + 7) / 8;
+	const unsigned int thread_count = max(1U, std::thread::hardware_concurrency());
+
+	if (samplerate_)
+		sink.set_samplerate(samplerate_);
+
+	shared_ptr<data::LogicSegment> logic_segment;
+	if (logic_count_ > 0)
+		logic_segment = sink.begin_logic_segment(unit_size);
+
+	// The analog channels follow the logic channels
+	vector< shared_ptr<data::AnalogSegment> > analog_segments;
+	for (unsigned int i = 0; i < analog_count_; i++)
+		analog_segments.push_back(sink.begin_analog_segment(logic_count_ + i));
+
+	const auto start_parsing = [&](const char *begin, vector<Block> &blocks,
+		vector<std::thread> &threads) {
+		for (unsigned int i = 0; (i < thread_count) && (begin < end_); i++) {
+			const char *const block_end = find_block_end(begin);
+			blocks.push_back({begin, block_end, 0, {}, {}});
+			begin = block_end;
+		}
+
+		for (Block& block : blocks)
+			threads.emplace_back(&CsvLoader::parse_block, this, std::ref(block));
+
+		return begin;
+	};
+
+	vector<Block> blocks, next_blocks;
+	vector<std::thread> threads, next_threads;
+	const char *pos = start_parsing(body_, blocks, threads);
+
+	while (!blocks.empty() && !interrupt) {
+		pos = start_parsing(pos, next_blocks, next_threads);
+
+		for (std::thread& t : threads)
+			t.join();
+		threads.clear();
+
+		for (Block& block : blocks) {
+			if (block.sample_count == 0)
+				continue;
+
+			// Every column is appended by a thread of its own, which also
+			// builds the envelope or mip-map of its segment
+			vector<std::thread> append_threads;
+
+			if (logic_segment)
+				append_threads.emplace_back([&]() {
+					logic_segment->append_payload(block.logic.data(), block.logic.size());
+				});
+
+			for (unsigned int i = 0; i < analog_count_; i++)
+				if (analog_segments[i])
+					append_threads.emplace_back([&, i]() {
+						analog_segments[i]->append_interleaved_samples(
+							block.analog[i].data(), block.sample_count, 1);
+					});
+
+			for (std::thread& t : append_threads)
+				t.join();
+
+			sink.samples_appended();
+		}
+
+		blocks.swap(next_blocks);
+		next_blocks.clear();
+		threads.swap(next_threads);
+		next_threads.clear();
+	}
+
+	for (std::thread& t : threads)
+		t.join();
+
+	sink.end_segments();
+}
+
+bool CsvLoader::parse_column_formats(const string &formats)
+{
+	columns_.clear();
+
+	const char *p = formats.c_str();
+	while (*p) {
+		while (is_blank(*p))
+			p++;
+
+		unsigned long count = 1;
+		if (is_digit(*p))
+			count = strtoul(p, (char**)&p, 10);
+
+		ColumnType type;
+		switch (*p) {
+		case '-': case '*': type = IgnoredColumn; break;
+		case 't': type = TimestampColumn; break;
+		case 'l': type = LogicColumn; break;
+		case 'a': type = AnalogColumn; break;
+		default:
+			// Multi-bit logic columns are left to libsigrok
+			return false;
+		}
+		p++;
+
+		// Analog columns may specify their number of significant digits
+		while (is_digit(*p))
+			p++;
+
+		while (is_blank(*p))
+			p++;
+
+		if (*p == ',')
+			p++;
+		else if (*p)
+			return false;
+
+		columns_.insert(columns_.end(), count, {type, 0});
+	}
+
+	return !columns_.empty();
+}
+
+const char* CsvLoader::next_line(const char *&p, const char *end)
+{
+	const char *const begin = p;
+
+	const char *line_end = (const char*)memchr(p, '\n', end - p);
+	if (!line_end)
+		line_end = end;
+
+	p = (line_end < end) ? (line_end + 1) : end;
+
+	if ((line_end > begin) && (line_end[-1] == '\r'))
+		line_end--;
+
+	return line_end;
+}
+
+bool CsvLoader::is_data_line(const char *begin, const char *end) const
+{
+	while ((begin < end) && is_blank(*begin))
+		begin++;
+
+	if (begin == end)
+		return false;
+
+	return comment_leader_.empty() ||
+		((size_t)(end - begin) < comment_leader_.size()) ||
+		(memcmp(begin, comment_leader_.data(), comment_leader_.size()) != 0);
+}
+
+void CsvLoader::split_fields(const char *begin, const char *end,
+	vector<Field> &fields) const
+{
+	fields.clear();
+
+	while (true) {
+		const char *field_end = (const char*)memchr(begin, separator_, end - begin);
+		if (!field_end)
+			field_end = end;
+
+		const char *b = begin, *e = field_end;
+		while ((b < e) && is_blank(*b))
+			b++;
+		while ((e > b) && is_blank(e[-1]))
+			e--;
+		fields.emplace_back(b, e);
+
+		if (field_end == end)
+			break;
+		begin = field_end + 1;
+	}
+}
+
+double CsvLoader::parse_number(const char *begin, const char *end)
+{
+	static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+		1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+		1e19, 1e20, 1e21, 1e22};
+
+	const char *p = begin;
+	bool negative = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+		negative = (*p++ == '-');
+
+	// Up to 19 significant digits fit into the mantissa
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0;
+	bool any_digit = false;
+
+	for (; (p < end) && is_digit(*p); p++, any_digit = true) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += (mantissa > 0);
+		} else
+			exponent++;
+	}
+
+	if ((p < end) && (*p == '.'))
+		for (p++; (p < end) && is_digit(*p); p++, any_digit = true)
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += (mantissa > 0);
+				exponent--;
+			}
+
+	if (any_digit && (p < end) && ((*p == 'e') || (*p == 'E'))) {
+		const char *q = p + 1;
+		bool negative_exponent = false;
+		if ((q < end) && ((*q == '-') || (*q == '+')))
+			negative_exponent = (*q++ == '-');
+
+		if ((q < end) && is_digit(*q)) {
+			int e = 0;
+			for (; (q < end) && is_digit(*q); q++)
+				e = min(e * 10 + (*q - '0'), 100000);
+			exponent += negative_exponent ? -e : e;
+			p = q;
+		}
+	}
+
+	// Anything else, e.g. "nan" or hexadecimal values, is left to strtod().
+	// So are exponents for which there is no exact power of ten, as the
+	// result could be off or even underflow.
+	if (!any_digit || (p != end) || (exponent < -22) || (exponent > 22)) {
+		const string text(begin, end);
+		return strtod(text.c_str(), nullptr);
+	}
+
+	double value = mantissa;
+	if (exponent >= 0)
+		value *= powers_of_ten[exponent];
+	else
+		value /= powers_of_ten[-exponent];
+
+	return negative ? -value : value;
+}
+
+const char* CsvLoader::find_block_end(const char *begin) const
+{
+	if ((uint64_t)(end_ - begin) <= block_size_)
+		return end_;
+
+	const char *const p = (const char*)memchr(begin + block_size_, '\n',
+		end_ - (begin + block_size_));
+
+	return p ? (p + 1) : end_;
+}
+
+void CsvLoader::parse_block(Block &block) const
+{
+	static Profiling::Stage* const profiling_stage =
+		profiling.stage("CSV parsing", "bytes");
+	ProfilingScope profiling_scope(profiling_stage, block.end - block.begin);
+
+	const unsigned int unit_size = (logic_count_ + 7) / 8;
+
+	block.analog.resize(analog_count_);
+
+	vector<Field> fields;
+	const char *p = block.begin;
+
+	while (p < block.end) {
+		const char *const line = p;
+		const char *const line_end = next_line(p, block.end);
+		if (!is_data_line(line, line_end))
+			continue;
+
+		split_fields(line, line_end, fields);
+
+		block.logic.resize(block.logic.size() + unit_size, 0);
+		uint8_t *const sample = block.logic.data() + block.logic.size() - unit_size;
+
+		for (vector<float>& column : block.analog)
+			column.push_back(0.0f);
+
+		const size_t column_count = min(columns_.size(), fields.size());
+		for (size_t i = 0; i < column_count; i++) {
+			const Column& column = columns_[i];
+			const Field& field = fields[i];
+
+			if (column.type == LogicColumn) {
+				if ((field.first < field.second) && (*field.first == '1'))
+					sample[column.index / 8] |= 1 << (column.index % 8);
+			} else if (column.type == AnalogColumn)
+				block.analog[column.index].back() =
+					parse_number(field.first, field.second);
+		}
+
+		block.sample_count++;
+	}
+}
+
+} // namespace devices
+} // namespace pv
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DEVICES_CSVLOADER_HPP
+#define PULSEVIEW_PV_DEVICES_CSVLOADER_HPP
+
+#include <cstdint>
+#include <utility>
+
+#include <QFile>
+
+#include "fileloader.hpp"
+
+using std::pair;
+
+namespace CsvLoaderTest {
+struct ParseNumber;
+struct ParseColumnFormats;
+struct MultiBlock;
+}
+
+namespace pv {
+namespace devices {
+
+/**
+ * Loads CSV files with logic and analog columns, using the column
+ * options of the CSV input module of libsigrok.
+ *
+ * The file is memory-mapped and split into blocks at line boundaries,
+ * which are parsed in parallel into column-wise sample buffers. Each
+ * column is then appended to its segment on a thread of its own, so the
+ * envelopes and mip-maps of all columns are built in parallel, while the
+ * next blocks are being parsed.
+ */
+class CsvLoader : public FileLoader
+{
+private:
+	/// The approximate amount of text a thread parses at a time
+	static const uint64_t BlockSize;
+
+	enum ColumnType {
+		IgnoredColumn,
+		TimestampColumn,
+		LogicColumn,
+		AnalogColumn
+	};
+
+	struct Column
+	{
+		ColumnType type;
+		unsigned int index;  ///< Index among the columns of the same type
+	};
+
+	struct Block
+	{
+		const char *begin, *end;
+		uint64_t sample_count;
+		vector<uint8_t> logic;
+		vector< vector<float> > analog;
+	};
+
+	typedef pair<const char*, const char*> Field;
+
+public:
+	/// Returns nullptr if an option isn't supported
+	static unique_ptr<FileLoader> create(const string &file_name,
+		const map<string, Glib::VariantBase> &options);
+
+	CsvLoader(const string &file_name, int64_t first_column,
+		int64_t logic_channels, int64_t start_line, bool header,
+		uint64_t samplerate, char separator, const string &comment_leader);
+
+	void read_header() override;
+
+	const vector<Channel>& channels() const override;
+
+	void run(DataSink &sink, const atomic<bool> &interrupt) override;
+
+private:
+	/**
+	 * Parses a list like "t,2a,-,8l": t is a timestamp, a an analog and
+	 * l a logic column, - is ignored. A count may precede each type.
+	 */
+	bool parse_column_formats(const string &formats);
+
+	static const char* next_line(const char *&p, const char *end);
+	bool is_data_line(const char *begin, const char *end) const;
+	void split_fields(const char *begin, const char *end,
+		vector<Field> &fields) const;
+
+	/// A fast parser for decimal numbers, rarer formats use strtod()
+	static double parse_number(const char *begin, const char *end);
+
+	const char* find_block_end(const char *begin) const;
+	void parse_block(Block &block) const;
+
+private:
+	const string file_name_;
+	const int64_t first_column_, logic_channels_, start_line_;
+	const bool header_;
+	uint64_t samplerate_;
+	const char separator_;
+	const string comment_leader_;
+
+	QFile file_;
+	const char *body_, *end_;
+
+	/// BlockSize, only the unit tests use smaller blocks
+	uint64_t block_size_;
+
+	vector<Column> columns_;
+	vector<Channel> channels_;
+	unsigned int logic_count_, analog_count_;
+
+	friend struct CsvLoaderTest::ParseNumber;
+	friend struct CsvLoaderTest::ParseColumnFormats;
+	friend struct CsvLoaderTest::MultiBlock;
+};
+
+} // namespace devices
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DEVICES_CSVLOADER_HPP
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DEVICES_DATASINK_HPP
+#define PULSEVIEW_PV_DEVICES_DATASINK_HPP
+
+#include <cstdint>
+#include <memory>
+
+using std::shared_ptr;
+
+namespace pv {
+
+namespace data {
+class AnalogSegment;
+class LogicSegment;
+}
+
+namespace devices {
+
+/**
+ * Receives the samples of devices that write them directly into the
+ * segments instead of sending a datafeed packet per chunk of data.
+ * All functions must be called from within Device::run().
+ */
+class DataSink
+{
+public:
+	virtual ~DataSink() = default;
+
+	/// Sets the samplerate of the segments that are created afterwards
+	virtual void set_samplerate(uint64_t samplerate) = 0;
+
+	/**
+	 * Creates a logic segment holding @a unit_size bytes per sample and
+	 * makes it the current one. Returns nullptr if the device doesn't
+	 * have any logic channels.
+	 */
+	virtual shared_ptr<data::LogicSegment> begin_logic_segment(
+		unsigned int unit_size) = 0;
+
+	/**
+	 * Creates a segment for the analog channel with the given index and
+	 * makes it the current one of that channel. Returns nullptr if there
+	 * is no such analog channel.
+	 */
+	virtual shared_ptr<data::AnalogSegment> begin_analog_segment(
+		unsigned int channel_index) = 0;
+
+	/// Must be called after samples were appended to the current segments
+	virtual void samples_appended() = 0;
+
+	/// Marks the current segments as complete
+	virtual void end_segments() = 0;
+};
+
+} // namespace devices
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DEVICES_DATASINK_HPP
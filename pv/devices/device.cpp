@@ -114,5 +114,10 @@ void Device::stop()
 	session_->stop();
 }
 
+void Device::set_data_sink(DataSink *sink)
+{
+	data_sink_ = sink;
+}
+
 } // namespace devices
 } // namespace pv
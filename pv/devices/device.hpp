@@ -38,6 +38,8 @@ class DeviceManager;
 
 namespace devices {
 
+class DataSink;
+
 class Device
 {
 protected:
@@ -76,9 +78,16 @@ public:
 
 	virtual void stop();
 
+	/**
+	 * Sets the sink that devices which bypass the datafeed packets write
+	 * their samples to while running.
+	 */
+	void set_data_sink(DataSink *sink);
+
 protected:
 	shared_ptr<sigrok::Session> session_;
 	shared_ptr<sigrok::Device> device_;
+	DataSink *data_sink_ = nullptr;
 };
 
 } // namespace devices
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+#include "csvloader.hpp"
+#include "fileloader.hpp"
+#include "vcdloader.hpp"
+
+namespace pv {
+namespace devices {
+
+unique_ptr<FileLoader> FileLoader::create(const string &format_name,
+	const string &file_name, const map<string, Glib::VariantBase> &options)
+{
+	if (format_name == "vcd")
+		return VcdLoader::create(file_name, options);
+
+	if (format_name == "csv")
+		return CsvLoader::create(file_name, options);
+
+	return nullptr;
+}
+
+bool FileLoader::get_int_option(const map<string, Glib::VariantBase> &options,
+	const string &name, int64_t &value)
+{
+	const auto iter = options.find(name);
+	if (iter == options.end())
+		return true;
+
+	GVariant *const v = iter->second.gobj();
+	if (!v)
+		return true;
+
+	if (g_variant_is_of_type(v, G_VARIANT_TYPE_INT32))
+		value = g_variant_get_int32(v);
+	else if (g_variant_is_of_type(v, G_VARIANT_TYPE_UINT32))
+		value = g_variant_get_uint32(v);
+	else if (g_variant_is_of_type(v, G_VARIANT_TYPE_INT64))
+		value = g_variant_get_int64(v);
+	else if (g_variant_is_of_type(v, G_VARIANT_TYPE_UINT64))
+		value = g_variant_get_uint64(v);
+	else
+		return false;
+
+	return true;
+}
+
+bool FileLoader::get_bool_option(const map<string, Glib::VariantBase> &options,
+	const string &name, bool &value)
+{
+	const auto iter = options.find(name);
+	if ((iter == options.end()) || !iter->second.gobj())
+		return true;
+
+	if (!g_variant_is_of_type(iter->second.gobj(), G_VARIANT_TYPE_BOOLEAN))
+		return false;
+
+	value = g_variant_get_boolean(iter->second.gobj());
+
+	return true;
+}
+
+bool FileLoader::get_string_option(const map<string, Glib::VariantBase> &options,
+	const string &name, string &value)
+{
+	const auto iter = options.find(name);
+	if ((iter == options.end()) || !iter->second.gobj())
+		return true;
+
+	if (!g_variant_is_of_type(iter->second.gobj(), G_VARIANT_TYPE_STRING))
+		return false;
+
+	value = g_variant_get_string(iter->second.gobj(), nullptr);
+
+	return true;
+}
+
+} // namespace devices
+} // namespace pv
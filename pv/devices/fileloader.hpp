@@ -0,0 +1,94 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DEVICES_FILELOADER_HPP
+#define PULSEVIEW_PV_DEVICES_FILELOADER_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glibmm/variant.h>
+
+using std::atomic;
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace sigrok {
+class ChannelType;
+}
+
+namespace pv {
+namespace devices {
+
+class DataSink;
+
+/**
+ * Loads a file format natively instead of passing it through the input
+ * module of libsigrok, which tokenizes on a single thread and creates a
+ * datafeed packet for every chunk. The samples are written directly into
+ * the segments through a DataSink.
+ */
+class FileLoader
+{
+public:
+	struct Channel
+	{
+		string name;
+		const sigrok::ChannelType *type;
+	};
+
+public:
+	/**
+	 * Returns a loader for the given libsigrok input format or nullptr if
+	 * there is no native loader for it or it doesn't support one of the
+	 * options, in which case libsigrok must be used.
+	 */
+	static unique_ptr<FileLoader> create(const string &format_name,
+		const string &file_name, const map<string, Glib::VariantBase> &options);
+
+	virtual ~FileLoader() = default;
+
+	/// Reads the channels from the file, throws a QString on failure
+	virtual void read_header() = 0;
+
+	virtual const vector<Channel>& channels() const = 0;
+
+	/// Loads the samples, returns early if @a interrupt is set
+	virtual void run(DataSink &sink, const atomic<bool> &interrupt) = 0;
+
+protected:
+	/**
+	 * Reads an integer option. Returns false if the option is set but
+	 * isn't an integer.
+	 */
+	static bool get_int_option(const map<string, Glib::VariantBase> &options,
+		const string &name, int64_t &value);
+	static bool get_bool_option(const map<string, Glib::VariantBase> &options,
+		const string &name, bool &value);
+	static bool get_string_option(const map<string, Glib::VariantBase> &options,
+		const string &name, string &value);
+};
+
+} // namespace devices
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DEVICES_FILELOADER_HPP
@@ -26,6 +26,7 @@
 
 #include <pv/globalsettings.hpp>
 
+#include "datasink.hpp"
 #include "inputfile.hpp"
 
 using sigrok::InputFormat;
@@ -120,6 +121,15 @@ void InputFile::open()
 	if (!format_)
 		return;
 
+	loader_.reset();
+	if (GlobalSettings().value(GlobalSettings::Key_General_NativeFileImport).toBool())
+		loader_ = FileLoader::create(format_->name(), file_name_, options_);
+
+	if (loader_) {
+		open_native();
+		return;
+	}
+
 	input_ = format_->create_input(options_);
 
 	if (!input_)
@@ -148,6 +158,23 @@ void InputFile::open()
 	session_->add_device(device_);
 }
 
+void InputFile::open_native()
+{
+	assert(loader_);
+
+	loader_->read_header();
+
+	const shared_ptr<sigrok::UserDevice> user_device =
+		context_->create_user_device("", format_->name(), "");
+
+	unsigned int index = 0;
+	for (const FileLoader::Channel& channel : loader_->channels())
+		user_device->add_channel(index++, channel.type, channel.name);
+
+	device_ = user_device;
+	session_->add_device(device_);
+}
+
 void InputFile::close()
 {
 	if (session_)
@@ -160,6 +187,13 @@ void InputFile::start()
 
 void InputFile::run()
 {
+	if (loader_) {
+		assert(data_sink_);
+		interrupt_ = false;
+		loader_->run(*data_sink_, interrupt_);
+		return;
+	}
+
 	if (!input_)
 		return;
 
@@ -21,10 +21,12 @@
 #define PULSEVIEW_PV_DEVICES_INPUTFILE_HPP
 
 #include <atomic>
+#include <memory>
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
 
 #include "file.hpp"
+#include "fileloader.hpp"
 
 #include <QSettings>
 
@@ -34,6 +36,7 @@ using std::map;
 using std::shared_ptr;
 using std::streamsize;
 using std::string;
+using std::unique_ptr;
 
 namespace pv {
 namespace devices {
@@ -68,12 +71,19 @@ public:
 
 	void stop();
 
+private:
+	/// Creates a device with the channels the native loader found
+	void open_native();
+
 private:
 	const shared_ptr<sigrok::Context> context_;
 	shared_ptr<sigrok::InputFormat> format_;
 	map<string, Glib::VariantBase> options_;
 	shared_ptr<sigrok::Input> input_;
 
+	/// Used instead of input_ if there is a native loader for the format
+	unique_ptr<FileLoader> loader_;
+
 	ifstream *f;
 	atomic<bool> interrupt_;
 };
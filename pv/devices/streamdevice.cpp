@@ -0,0 +1,401 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <QString>
+#include <QtEndian>
+
+#include <boost/filesystem.hpp>
+
+#include <libsigrokcxx/libsigrokcxx.hpp>
+
+#include "datasink.hpp"
+#include "streamdevice.hpp"
+
+#include <pv/data/logicsegment.hpp>
+
+using std::bad_alloc;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::shared_ptr;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace pv {
+namespace devices {
+
+const char StreamDevice::Magic[] = "PVSTREAM";
+const uint32_t StreamDevice::Version = 1;
+const uint32_t StreamDevice::MaxUnitSize = 64;
+const uint32_t StreamDevice::MaxNameLength = 256;
+const int StreamDevice::HeaderTimeout = 5000;
+const int StreamDevice::PollInterval = 100;
+
+StreamDevice::StreamDevice(const shared_ptr<sigrok::Context> &context,
+	const string &path) :
+	context_(context),
+	path_(path),
+	fd_(-1),
+	samplerate_(0),
+	unit_size_(0),
+	interrupt_(false)
+{
+}
+
+StreamDevice::~StreamDevice()
+{
+	disconnect_stream();
+}
+
+string StreamDevice::full_name() const
+{
+	return path_;
+}
+
+string StreamDevice::display_name(const DeviceManager&) const
+{
+	return boost::filesystem::path(path_).filename().string();
+}
+
+void StreamDevice::open()
+{
+	if (session_)
+		close();
+	else
+		session_ = context_->create_session();
+
+	// Waiting for the header would block the GUI, so it's read when the
+	// acquisition runs. The channels are known already if the device was
+	// opened before
+	check_path();
+
+	user_device_ = context_->create_user_device("", "Stream", "");
+	add_channels();
+
+	device_ = user_device_;
+	session_->add_device(device_);
+}
+
+void StreamDevice::close()
+{
+	disconnect_stream();
+
+	if (session_)
+		session_->remove_devices();
+}
+
+void StreamDevice::start()
+{
+}
+
+void StreamDevice::run()
+{
+	assert(data_sink_);
+
+	interrupt_ = false;
+
+	// Every acquisition uses up the stream, so connect anew
+	const vector<string> channel_names = channel_names_;
+	if (!connect_stream())
+		return;
+
+	if (channel_names.empty()) {
+		// The session picks the channels up when the segment is created
+		add_channels();
+	} else if (channel_names_ != channel_names) {
+		disconnect_stream();
+		channel_names_ = channel_names;
+		throw QString("The channels of the stream changed, please reconnect");
+	}
+
+	data_sink_->set_samplerate(samplerate_);
+
+	const shared_ptr<data::LogicSegment> segment =
+		data_sink_->begin_logic_segment(unit_size_);
+	if (!segment) {
+		disconnect_stream();
+		return;
+	}
+
+	const int fd = fd_;
+	const auto receive = [fd](uint8_t *dest, uint64_t size) -> int64_t {
+#ifdef _WIN32
+		(void)fd;
+		(void)dest;
+		(void)size;
+		return -1;
+#else
+		return ::read(fd, dest, size);
+#endif
+	};
+
+	QString error;
+	unsigned int partial_bytes = 0;
+	auto last_notification = steady_clock::now();
+
+	while (!interrupt_) {
+		if (wait_readable(PollInterval)) {
+			int64_t received;
+
+			try {
+				received = segment->append_received(receive, partial_bytes);
+			} catch (bad_alloc&) {
+				error = "Out of memory, acquisition stopped.";
+				break;
+			}
+
+			// The front-end closed the stream
+			if (received == 0)
+				break;
+
+			if ((received < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+				error = QString("Failed to read from the stream: %1")
+					.arg(strerror(errno));
+				break;
+			}
+		}
+
+		// Limit the update rate, a pipe delivers just a few kB per read
+		const auto now = steady_clock::now();
+		if (now - last_notification >= milliseconds(PollInterval)) {
+			data_sink_->samples_appended();
+			last_notification = now;
+		}
+	}
+
+	data_sink_->samples_appended();
+	data_sink_->end_segments();
+
+	disconnect_stream();
+
+	if (!error.isEmpty())
+		throw error;
+}
+
+void StreamDevice::stop()
+{
+	interrupt_ = true;
+}
+
+bool StreamDevice::check_path() const
+{
+#ifdef _WIN32
+	throw QString("Sample streams aren't supported on this platform");
+#else
+	const QString path = QString::fromStdString(path_);
+
+	struct stat st;
+	if (::stat(path_.c_str(), &st) != 0)
+		throw QString("Can't access %1: %2").arg(path, strerror(errno));
+
+	if (!S_ISFIFO(st.st_mode) && !S_ISSOCK(st.st_mode))
+		throw QString("%1 is neither a socket nor a named pipe").arg(path);
+
+	return S_ISFIFO(st.st_mode);
+#endif
+}
+
+bool StreamDevice::connect_stream()
+{
+	disconnect_stream();
+
+	const bool is_pipe = check_path();
+
+#ifdef _WIN32
+	(void)is_pipe;
+	return false;
+#else
+	const QString path = QString::fromStdString(path_);
+
+	if (is_pipe) {
+		// Opening the pipe would block until the front-end opened it too,
+		// the header timeout applies instead
+		fd_ = ::open(path_.c_str(), O_RDONLY | O_NONBLOCK);
+	} else {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+
+		if (path_.size() >= sizeof(addr.sun_path))
+			throw QString("The socket path %1 is too long").arg(path);
+		memcpy(addr.sun_path, path_.c_str(), path_.size());
+
+		fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((fd_ >= 0) && (::connect(fd_, (struct sockaddr*)&addr, sizeof(addr)) != 0)) {
+			const int connect_errno = errno;
+			::close(fd_);
+			fd_ = -1;
+			errno = connect_errno;
+		}
+
+		if (fd_ >= 0)
+			fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+	}
+
+	if (fd_ < 0)
+		throw QString("Failed to connect to %1: %2").arg(path, strerror(errno));
+
+	try {
+		if (!wait_for_header()) {
+			disconnect_stream();
+			return false;
+		}
+
+		char magic[8];
+		read_header_bytes(magic, sizeof(magic));
+		if (memcmp(magic, Magic, sizeof(magic)) != 0)
+			throw QString("%1 doesn't provide a sample stream").arg(path);
+
+		quint32 version, unit_size, channel_count;
+		quint64 samplerate;
+
+		read_header_bytes(&version, sizeof(version));
+		if (qFromLittleEndian(version) != Version)
+			throw QString("Unsupported stream version %1").arg(qFromLittleEndian(version));
+
+		read_header_bytes(&samplerate, sizeof(samplerate));
+		read_header_bytes(&unit_size, sizeof(unit_size));
+		read_header_bytes(&channel_count, sizeof(channel_count));
+
+		samplerate_ = qFromLittleEndian(samplerate);
+		unit_size_ = qFromLittleEndian(unit_size);
+		channel_count = qFromLittleEndian(channel_count);
+
+		if ((unit_size_ == 0) || (unit_size_ > MaxUnitSize))
+			throw QString("Invalid unit size %1").arg(unit_size_);
+
+		if ((channel_count == 0) || (channel_count > unit_size_ * 8))
+			throw QString("Invalid channel count %1").arg(channel_count);
+
+		channel_names_.clear();
+		for (uint32_t i = 0; i < channel_count; i++) {
+			quint32 length;
+			read_header_bytes(&length, sizeof(length));
+			length = qFromLittleEndian(length);
+
+			if (length > MaxNameLength)
+				throw QString("The name of channel %1 is too long").arg(i);
+
+			string name(length, '\0');
+			read_header_bytes(&name[0], length);
+
+			channel_names_.push_back(name.empty() ? ("D" + to_string(i)) : name);
+		}
+	} catch (QString&) {
+		disconnect_stream();
+		throw;
+	}
+
+	return true;
+#endif
+}
+
+void StreamDevice::disconnect_stream()
+{
+#ifndef _WIN32
+	if (fd_ >= 0)
+		::close(fd_);
+#endif
+
+	fd_ = -1;
+}
+
+void StreamDevice::add_channels()
+{
+	if (!user_device_ || !user_device_->channels().empty())
+		return;
+
+	for (unsigned int i = 0; i < channel_names_.size(); i++)
+		user_device_->add_channel(i, sigrok::ChannelType::LOGIC, channel_names_[i]);
+}
+
+bool StreamDevice::wait_for_header()
+{
+	// Wait in short steps, so that stopping the acquisition doesn't have
+	// to wait for the timeout
+	for (int waited = 0; waited < HeaderTimeout; waited += PollInterval) {
+		if (wait_readable(PollInterval))
+			return true;
+
+		if (interrupt_)
+			return false;
+	}
+
+	throw QString("Timeout while waiting for the stream header");
+}
+
+void StreamDevice::read_header_bytes(void *data, size_t size)
+{
+#ifdef _WIN32
+	(void)data;
+	(void)size;
+#else
+	char *dest = (char*)data;
+
+	while (size > 0) {
+		if (!wait_readable(HeaderTimeout))
+			throw QString("Timeout while waiting for the stream header");
+
+		const ssize_t n = ::read(fd_, dest, size);
+
+		if (n == 0)
+			throw QString("The stream ended within the header");
+
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			throw QString("Failed to read the stream header: %1").arg(strerror(errno));
+		}
+
+		dest += n;
+		size -= n;
+	}
+#endif
+}
+
+bool StreamDevice::wait_readable(int timeout)
+{
+#ifdef _WIN32
+	(void)timeout;
+	return false;
+#else
+	struct pollfd pfd;
+	pfd.fd = fd_;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	// A hang-up is reported as readable too, the read then returns 0
+	return ::poll(&pfd, 1, timeout) > 0;
+#endif
+}
+
+} // namespace devices
+} // namespace pv
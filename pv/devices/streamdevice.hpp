@@ -0,0 +1,167 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DEVICES_STREAMDEVICE_HPP
+#define PULSEVIEW_PV_DEVICES_STREAMDEVICE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "device.hpp"
+
+using std::atomic;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace sigrok {
+class Context;
+class UserDevice;
+} // namespace sigrok
+
+namespace StreamDeviceTest {
+struct Samples;
+struct WideSamples;
+struct HeaderErrors;
+struct ChannelsChanged;
+}
+
+namespace pv {
+namespace devices {
+
+/**
+ * Receives a raw logic sample stream from a local acquisition front-end
+ * through a Unix domain socket, which the front-end listens on, or a named
+ * pipe, which it writes to. The samples are received straight into the
+ * logic segment without going through sigrok datafeed packets.
+ *
+ * The stream starts with a header, all integers are little endian:
+ *
+ * | Field       | Type    | Description                              |
+ * |-------------|---------|------------------------------------------|
+ * | magic       | char[8] | "PVSTREAM"                               |
+ * | version     | uint32  | 1                                        |
+ * | samplerate  | uint64  | Samples per second, 0 if unknown         |
+ * | unit size   | uint32  | Bytes per sample, 1 to 64                |
+ * | channels    | uint32  | Number of channels, 1 to 8 * unit size   |
+ * | names       |         | Per channel: uint32 length, UTF-8 name   |
+ *
+ * Channel n is bit n of a sample. The samples follow until the front-end
+ * closes the stream. Every acquisition reconnects and reads the header in
+ * the acquisition thread. The first one adds the channels to the device,
+ * the later ones expect a header describing the same channels.
+ * contrib/stream_generator.py is a sample front-end.
+ */
+class StreamDevice final : public Device
+{
+private:
+	static const char Magic[];
+	static const uint32_t Version;
+	/// Bounds the channels to 512, so a corrupt header is rejected before
+	/// it makes the segments allocate huge samples
+	static const uint32_t MaxUnitSize;
+	static const uint32_t MaxNameLength;
+
+	/// Time in ms the front-end may take to send the header, or a part of it
+	static const int HeaderTimeout;
+
+	/// Time in ms between checks whether the acquisition was stopped
+	static const int PollInterval;
+
+public:
+	StreamDevice(const shared_ptr<sigrok::Context> &context,
+		const string &path);
+
+	~StreamDevice();
+
+	/**
+	 * Builds the full name. It contains the path of the socket or pipe.
+	 */
+	string full_name() const;
+
+	/**
+	 * Builds the display name. It only contains the file name of the path.
+	 */
+	string display_name(const DeviceManager&) const;
+
+	void open();
+
+	void close();
+
+	void start();
+
+	void run();
+
+	void stop();
+
+private:
+	/**
+	 * Throws unless the path is a socket or a named pipe. Returns true for
+	 * a named pipe.
+	 */
+	bool check_path() const;
+
+	/**
+	 * Connects to the socket or opens the pipe and reads the header.
+	 * Returns false if the acquisition was stopped before the header
+	 * arrived.
+	 */
+	bool connect_stream();
+
+	void disconnect_stream();
+
+	/// Adds the channels of the header unless the device has them already
+	void add_channels();
+
+	/**
+	 * Waits until the front-end starts sending the header or throws on
+	 * timeout. Returns false if the acquisition was stopped meanwhile.
+	 */
+	bool wait_for_header();
+
+	/// Reads exactly @a size bytes of the header or throws
+	void read_header_bytes(void *data, size_t size);
+
+	/// Waits until data arrives, returns false on timeout
+	bool wait_readable(int timeout);
+
+private:
+	const shared_ptr<sigrok::Context> context_;
+	const string path_;
+
+	shared_ptr<sigrok::UserDevice> user_device_;
+
+	int fd_;
+	uint64_t samplerate_;
+	uint32_t unit_size_;
+	vector<string> channel_names_;
+
+	atomic<bool> interrupt_;
+
+	friend struct StreamDeviceTest::Samples;
+	friend struct StreamDeviceTest::WideSamples;
+	friend struct StreamDeviceTest::HeaderErrors;
+	friend struct StreamDeviceTest::ChannelsChanged;
+};
+
+} // namespace devices
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DEVICES_STREAMDEVICE_HPP
@@ -0,0 +1,442 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include <QDebug>
+#include <QString>
+
+#include <libsigrokcxx/libsigrokcxx.hpp>
+
+#include "datasink.hpp"
+#include "vcdloader.hpp"
+
+#include <pv/profiling.hpp>
+#include <pv/data/logicsegment.hpp>
+
+using std::max;
+using std::pair;
+using std::shared_ptr;
+
+namespace pv {
+namespace devices {
+
+const uint64_t VcdLoader::BlockSize = 16 * 1024 * 1024;
+const uint64_t VcdLoader::MinRunLength = 1024;
+const uint64_t VcdLoader::MaxBufferSize = 4 * 1024 * 1024;
+const uint64_t VcdLoader::TimestampFlag = (uint64_t)1 << 63;
+
+static inline bool is_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static inline bool is_digit(char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+/**
+ * Returns the next whitespace-delimited token in [p, end) and advances
+ * @a p past it. Returns false if there are no more tokens.
+ */
+static inline bool next_token(const char *&p, const char *end,
+	const char *&token, size_t &length)
+{
+	while ((p < end) && is_space(*p))
+		p++;
+
+	if (p == end)
+		return false;
+
+	token = p;
+	while ((p < end) && !is_space(*p))
+		p++;
+	length = p - token;
+
+	return true;
+}
+
+static inline bool token_is(const char *token, size_t length, const char *text)
+{
+	return (strlen(text) == length) && (memcmp(token, text, length) == 0);
+}
+
+unique_ptr<FileLoader> VcdLoader::create(const string &file_name,
+	const map<string, Glib::VariantBase> &options)
+{
+	for (const auto& entry : options)
+		if ((entry.first != "numchannels") && (entry.first != "skip") &&
+			(entry.first != "downsample") && (entry.first != "compress"))
+			return nullptr;
+
+	// These are the defaults of the libsigrok input module
+	int64_t max_channels = 0, skip = -1, downsample = 1, compress = 0;
+
+	if (!get_int_option(options, "numchannels", max_channels) ||
+		!get_int_option(options, "skip", skip) ||
+		!get_int_option(options, "downsample", downsample) ||
+		!get_int_option(options, "compress", compress))
+		return nullptr;
+
+	return unique_ptr<FileLoader>(new VcdLoader(file_name,
+		max(max_channels, (int64_t)0), skip, max(downsample, (int64_t)1),
+		max(compress, (int64_t)0)));
+}
+
+VcdLoader::VcdLoader(const string &file_name, int64_t max_channels,
+	int64_t skip, int64_t downsample, int64_t compress) :
+	file_name_(file_name),
+	max_channels_(max_channels),
+	// Like libsigrok, the skip position is given in timestamps of the file
+	// but compared against downsampled ones
+	skip_((skip > 0) ? (skip / downsample) : skip),
+	downsample_(downsample),
+	compress_(compress),
+	body_(nullptr),
+	end_(nullptr),
+	block_size_(BlockSize),
+	samplerate_(0)
+{
+}
+
+void VcdLoader::read_header()
+{
+	channels_.clear();
+	identifiers_.clear();
+	samplerate_ = 0;
+
+	file_.close();
+	file_.setFileName(QString::fromStdString(file_name_));
+	if (!file_.open(QIODevice::ReadOnly) || (file_.size() == 0))
+		throw QString("Failed to read file");
+
+	const char *p = (const char*)file_.map(0, file_.size());
+	if (!p)
+		throw QString("Failed to map file into memory");
+
+	end_ = p + file_.size();
+	body_ = nullptr;
+
+	// The header consists of "$keyword contents $end" sections
+	const char *token;
+	size_t length;
+	while (!body_) {
+		if (!next_token(p, end_, token, length))
+			throw QString("The file has no $enddefinitions section");
+
+		if ((token[0] != '$') || (length < 2))
+			throw QString("Unexpected text in the file header");
+
+		const string keyword(token + 1, length - 1);
+
+		vector<string> contents;
+		bool section_ended = false;
+		while (next_token(p, end_, token, length)) {
+			if (token_is(token, length, "$end")) {
+				section_ended = true;
+				break;
+			}
+			contents.emplace_back(token, length);
+		}
+
+		if (!section_ended)
+			throw QString("The $%1 section has no $end").arg(
+				QString::fromStdString(keyword));
+
+		if (keyword == "enddefinitions") {
+			body_ = p;
+		} else if (keyword == "timescale") {
+			string text;
+			for (const string& part : contents)
+				text += part;
+
+			if (!parse_timescale(text, samplerate_))
+				qWarning() << "Unsupported VCD timescale" << QString::fromStdString(text);
+		} else if (keyword == "var")
+			parse_var(contents);
+	}
+
+	if (channels_.empty())
+		throw QString("The file doesn't contain any supported signals");
+}
+
+const vector<FileLoader::Channel>& VcdLoader::channels() const
+{
+	return channels_;
+}
+
+void VcdLoader::run(DataSink &sink, const atomic<bool> &interrupt)
+{
+	assert(body_);
+
+	const unsigned int unit_size = (channels_.size() + 7) / 8;
+	const unsigned int thread_count = max(1U, std::thread::hardware_concurrency());
+
+	if (samplerate_)
+		sink.set_samplerate(samplerate_ / downsample_);
+
+	shared_ptr<data::LogicSegment> segment;
+	vector<uint8_t> levels(unit_size, 0);
+	vector<uint8_t> buffer;
+	uint64_t prev_timestamp = 0;
+	int64_t skip = skip_;
+
+	const auto flush_buffer = [&]() {
+		if (!buffer.empty()) {
+			segment->append_payload(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	};
+
+	// Repeats the current levels from the previous timestamp to this one
+	const auto add_samples = [&](uint64_t count) {
+		if (!segment) {
+			segment = sink.begin_logic_segment(unit_size);
+			if (!segment)
+				return;
+		}
+
+		if (count >= MinRunLength) {
+			flush_buffer();
+			segment->append_run(levels.data(), count);
+			return;
+		}
+
+		for (uint64_t i = 0; i < count; i++)
+			buffer.insert(buffer.end(), levels.begin(), levels.end());
+
+		if (buffer.size() >= MaxBufferSize)
+			flush_buffer();
+	};
+
+	const auto start_tokenizing = [&](const char *begin, vector<Block> &blocks,
+		vector<std::thread> &threads) {
+		for (unsigned int i = 0; (i < thread_count) && (begin < end_); i++) {
+			const char *const block_end = find_block_end(begin);
+			blocks.push_back({begin, block_end, {}});
+			begin = block_end;
+		}
+
+		for (Block& block : blocks)
+			threads.emplace_back(&VcdLoader::tokenize, this, std::ref(block));
+
+		return begin;
+	};
+
+	vector<Block> blocks, next_blocks;
+	vector<std::thread> threads, next_threads;
+	const char *pos = start_tokenizing(body_, blocks, threads);
+
+	while (!blocks.empty() && !interrupt) {
+		pos = start_tokenizing(pos, next_blocks, next_threads);
+
+		for (std::thread& t : threads)
+			t.join();
+		threads.clear();
+
+		for (const Block& block : blocks) {
+			for (const uint64_t event : block.events) {
+				if (!(event & TimestampFlag)) {
+					const uint64_t channel = event >> 1;
+					const uint8_t mask = 1 << (channel % 8);
+					if (event & 1)
+						levels[channel / 8] |= mask;
+					else
+						levels[channel / 8] &= ~mask;
+					continue;
+				}
+
+				const uint64_t timestamp = (event & ~TimestampFlag) / downsample_;
+
+				// skip < 0 skips until the first timestamp, skip > 0 until the
+				// given timestamp, skip = 0 doesn't skip anything
+				if (skip < 0) {
+					skip = timestamp;
+					prev_timestamp = timestamp;
+				} else if ((skip > 0) && (timestamp < (uint64_t)skip)) {
+					prev_timestamp = skip;
+				} else if (timestamp > prev_timestamp) {
+					if (compress_ && (timestamp - prev_timestamp > (uint64_t)compress_))
+						prev_timestamp = timestamp - compress_;
+
+					add_samples(timestamp - prev_timestamp);
+					prev_timestamp = timestamp;
+				}
+			}
+
+			if (segment) {
+				flush_buffer();
+				sink.samples_appended();
+			}
+		}
+
+		blocks.swap(next_blocks);
+		next_blocks.clear();
+		threads.swap(next_threads);
+		next_threads.clear();
+	}
+
+	for (std::thread& t : threads)
+		t.join();
+
+	sink.end_segments();
+}
+
+bool VcdLoader::parse_timescale(const string &text, uint64_t &samplerate)
+{
+	// The standard allows 1, 10 or 100 of s, ms, us, ns, ps or fs
+	char *unit;
+	const uint64_t count = strtoull(text.c_str(), &unit, 10);
+	if (count == 0)
+		return false;
+
+	const pair<const char*, uint64_t> units[] = {
+		{"s", 1ULL}, {"ms", 1000ULL}, {"us", 1000000ULL},
+		{"ns", 1000000000ULL}, {"ps", 1000000000000ULL},
+		{"fs", 1000000000000000ULL}};
+
+	for (const auto& u : units)
+		if (strcmp(unit, u.first) == 0) {
+			samplerate = u.second / count;
+			return true;
+		}
+
+	return false;
+}
+
+void VcdLoader::parse_var(const vector<string> &parts)
+{
+	// Only single-bit signals are supported: $var type size identifier name $end
+	if (parts.size() != 4) {
+		qWarning() << "VCD $var section should have 4 items";
+		return;
+	}
+
+	if ((parts[0] != "reg") && (parts[0] != "wire")) {
+		qDebug() << "Unsupported VCD signal type" << QString::fromStdString(parts[0]);
+		return;
+	}
+
+	if (strtol(parts[1].c_str(), nullptr, 10) != 1) {
+		qDebug() << "Unsupported VCD signal size" << QString::fromStdString(parts[1]);
+		return;
+	}
+
+	if (max_channels_ && ((int64_t)channels_.size() >= max_channels_)) {
+		qDebug() << "Skipping VCD signal" << QString::fromStdString(parts[3]) <<
+			"because only" << max_channels_ << "channels were requested";
+		return;
+	}
+
+	// An identifier may be used by several signals, its changes only
+	// apply to the first one of them
+	identifiers_.emplace(parts[2], channels_.size());
+	channels_.push_back({parts[3], sigrok::ChannelType::LOGIC});
+}
+
+const char* VcdLoader::find_block_end(const char *begin) const
+{
+	if ((uint64_t)(end_ - begin) <= block_size_)
+		return end_;
+
+	// Split before a timestamp at the beginning of a line, which can't be
+	// part of a section that spans the split
+	const char *p = begin + block_size_;
+	while ((p = (const char*)memchr(p, '\n', end_ - p))) {
+		p++;
+		if ((p < end_) && (*p == '#'))
+			return p;
+	}
+
+	return end_;
+}
+
+void VcdLoader::tokenize(Block &block) const
+{
+	static Profiling::Stage* const profiling_stage =
+		profiling.stage("VCD tokenizing", "bytes");
+	ProfilingScope profiling_scope(profiling_stage, block.end - block.begin);
+
+	const char *p = block.begin;
+	const char *token;
+	size_t length;
+	bool skip_section = false;
+	string identifier;
+
+	while (next_token(p, block.end, token, length)) {
+		if (skip_section) {
+			skip_section = !token_is(token, length, "$end");
+			continue;
+		}
+
+		switch (token[0]) {
+		case '#':
+			if ((length > 1) && is_digit(token[1])) {
+				uint64_t timestamp = 0;
+				for (size_t i = 1; (i < length) && is_digit(token[i]); i++)
+					timestamp = timestamp * 10 + (token[i] - '0');
+				block.events.push_back(TimestampFlag | timestamp);
+			}
+			break;
+
+		case '$':
+			// The contents of all sections except these are ignored
+			if ((length > 1) && !token_is(token, length, "$dumpvars") &&
+				!token_is(token, length, "$dumpon") &&
+				!token_is(token, length, "$dumpoff") &&
+				!token_is(token, length, "$end"))
+				skip_section = true;
+			break;
+
+		case 'b': case 'B': case 'r': case 'R':
+			// Vector and real values aren't supported, skip the identifier
+			next_token(p, block.end, token, length);
+			break;
+
+		case '0': case '1': case 'x': case 'X': case 'z': case 'Z':
+		{
+			const bool level = (token[0] == '1');
+
+			// The identifier follows the level, possibly after whitespace
+			if (length == 1) {
+				if (!next_token(p, block.end, token, length))
+					break;
+				identifier.assign(token, length);
+			} else
+				identifier.assign(token + 1, length - 1);
+
+			const auto iter = identifiers_.find(identifier);
+			if (iter != identifiers_.end())
+				block.events.push_back(((uint64_t)iter->second << 1) | level);
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
+
+} // namespace devices
+} // namespace pv
@@ -0,0 +1,108 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DEVICES_VCDLOADER_HPP
+#define PULSEVIEW_PV_DEVICES_VCDLOADER_HPP
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <QFile>
+
+#include "fileloader.hpp"
+
+using std::unordered_map;
+
+namespace VcdLoaderTest {
+struct BlockSplit;
+}
+
+namespace pv {
+namespace devices {
+
+/**
+ * Loads Value Change Dump files like the VCD input module of libsigrok
+ * does, producing the same samples for the same options.
+ *
+ * The file is memory-mapped and its body is split into blocks at
+ * timestamps that begin a line. The blocks are tokenized in parallel into
+ * lists of events, which are then applied in order to build the samples.
+ * Blocks are tokenized while the samples of the previous ones are written,
+ * and long periods without changes are appended as runs.
+ */
+class VcdLoader : public FileLoader
+{
+private:
+	/// The approximate amount of text a thread tokenizes at a time
+	static const uint64_t BlockSize;
+
+	/// Shorter runs are collected in a buffer instead of being appended one by one
+	static const uint64_t MinRunLength;
+	static const uint64_t MaxBufferSize;
+
+	/// Marks timestamp events, all other events are (channel << 1) | level
+	static const uint64_t TimestampFlag;
+
+	struct Block
+	{
+		const char *begin, *end;
+		vector<uint64_t> events;
+	};
+
+public:
+	/// Returns nullptr if an option isn't supported
+	static unique_ptr<FileLoader> create(const string &file_name,
+		const map<string, Glib::VariantBase> &options);
+
+	VcdLoader(const string &file_name, int64_t max_channels, int64_t skip,
+		int64_t downsample, int64_t compress);
+
+	void read_header() override;
+
+	const vector<Channel>& channels() const override;
+
+	void run(DataSink &sink, const atomic<bool> &interrupt) override;
+
+private:
+	static bool parse_timescale(const string &text, uint64_t &samplerate);
+
+	void parse_var(const vector<string> &parts);
+
+	const char* find_block_end(const char *begin) const;
+	void tokenize(Block &block) const;
+
+private:
+	const string file_name_;
+	const int64_t max_channels_, skip_, downsample_, compress_;
+
+	QFile file_;
+	const char *body_, *end_;
+
+	/// BlockSize, only the unit tests use smaller blocks
+	uint64_t block_size_;
+
+	uint64_t samplerate_;
+	vector<Channel> channels_;
+	unordered_map<string, unsigned int> identifiers_;
+
+	friend struct VcdLoaderTest::BlockSplit;
+};
+
+} // namespace devices
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DEVICES_VCDLOADER_HPP
@@ -0,0 +1,318 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libsigrokdecode/libsigrokdecode.h>
+
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+#include "decodersweep.hpp"
+
+#include <pv/data/decodesignal.hpp>
+#include <pv/data/decode/decoder.hpp>
+#include <pv/data/decode/sweep.hpp>
+
+using std::string;
+using std::vector;
+
+using pv::data::decode::Decoder;
+using pv::data::decode::Sweep;
+
+namespace pv {
+namespace dialogs {
+
+const int DecoderSweep::UpdateInterval = 100;
+
+static QString value_to_string(GVariant *value)
+{
+	if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+		return QString::fromUtf8(g_variant_get_string(value, nullptr));
+
+	char *s = g_variant_print(value, FALSE);
+	const QString result = QString::fromUtf8(s);
+	g_free(s);
+
+	return result;
+}
+
+static GVariant* value_from_string(const QString &text, const GVariantType *type)
+{
+	if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING))
+		return g_variant_new_string(text.toUtf8().constData());
+
+	return g_variant_parse(type, text.toUtf8().constData(), nullptr, nullptr, nullptr);
+}
+
+DecoderSweep::DecoderSweep(shared_ptr<data::DecodeSignal> decode_signal,
+	uint32_t segment_id, uint64_t start_sample, uint64_t end_sample,
+	QWidget *parent) :
+	QDialog(parent),
+	decode_signal_(decode_signal),
+	segment_id_(segment_id),
+	start_sample_(start_sample),
+	end_sample_(end_sample),
+	decoder_selector_(new QComboBox(this)),
+	option_selector_(new QComboBox(this)),
+	values_edit_(new QLineEdit(this)),
+	status_label_(new QLabel(this)),
+	results_table_(new QTableWidget(0, 4, this)),
+	button_box_(new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, this))
+{
+	assert(decode_signal_);
+
+	setWindowTitle(tr("Find Best Decoder Option"));
+
+	QVBoxLayout *const layout = new QVBoxLayout(this);
+	QFormLayout *const form = new QFormLayout();
+	layout->addLayout(form);
+
+	form->addRow(tr("Samples"), new QLabel(
+		tr("%1 to %2").arg(start_sample_).arg(end_sample_), this));
+	form->addRow(tr("Decoder"), decoder_selector_);
+	form->addRow(tr("Option"), option_selector_);
+	form->addRow(tr("Values"), values_edit_);
+
+	values_edit_->setPlaceholderText(tr("Comma-separated values to try"));
+
+	results_table_->setHorizontalHeaderLabels(QStringList() << tr("Value")
+		<< tr("Annotations") << tr("Errors") << tr("Status"));
+	results_table_->horizontalHeader()->setStretchLastSection(true);
+	results_table_->verticalHeader()->hide();
+	results_table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	results_table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+	results_table_->setSelectionMode(QAbstractItemView::SingleSelection);
+	layout->addWidget(results_table_);
+	layout->addWidget(status_label_);
+
+	start_button_ = button_box_->addButton(tr("Start"), QDialogButtonBox::ActionRole);
+	apply_button_ = button_box_->addButton(tr("Apply"), QDialogButtonBox::AcceptRole);
+	apply_button_->setEnabled(false);
+	layout->addWidget(button_box_);
+
+	for (const shared_ptr<Decoder>& dec : decode_signal_->decoder_stack())
+		decoder_selector_->addItem(QString::fromUtf8(dec->name()));
+
+	connect(decoder_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_decoder_changed(int)));
+	connect(option_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_option_changed(int)));
+	connect(start_button_, SIGNAL(clicked()), this, SLOT(on_start()));
+	connect(button_box_, SIGNAL(accepted()), this, SLOT(on_apply()));
+	connect(button_box_, SIGNAL(rejected()), this, SLOT(reject()));
+
+	// Only the result of the latest progress update is of interest
+	update_timer_.setSingleShot(true);
+	update_timer_.setInterval(UpdateInterval);
+	connect(&update_timer_, SIGNAL(timeout()), this, SLOT(on_update_timer()));
+
+	on_decoder_changed(decoder_selector_->currentIndex());
+
+	resize(500, 400);
+}
+
+DecoderSweep::~DecoderSweep()
+{
+	decode_signal_->cancel_sweep();
+}
+
+const srd_decoder_option* DecoderSweep::selected_option() const
+{
+	const vector< shared_ptr<Decoder> >& stack = decode_signal_->decoder_stack();
+	const int dec_index = decoder_selector_->currentIndex();
+	const int opt_index = option_selector_->currentIndex();
+
+	if ((dec_index < 0) || ((size_t)dec_index >= stack.size()) || (opt_index < 0))
+		return nullptr;
+
+	const GSList *l = g_slist_nth(stack[dec_index]->get_srd_decoder()->options, opt_index);
+	return l ? (const srd_decoder_option*)l->data : nullptr;
+}
+
+void DecoderSweep::update_results()
+{
+	const shared_ptr<Sweep> sweep = decode_signal_->sweep();
+	if (!sweep)
+		return;
+
+	const vector<Sweep::Result> results = sweep->results();
+	const int best = sweep->is_running() ? -1 : sweep->best_result();
+	const uint64_t sample_count = sweep->end_sample() - sweep->start_sample();
+
+	results_table_->setRowCount(results.size());
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const Sweep::Result& r = results[i];
+
+		QString status;
+		if (r.failed)
+			status = tr("Failed");
+		else if (r.done)
+			status = ((int)i == best) ? tr("Best match") : tr("Done");
+		else if (sample_count > 0)
+			status = QString("%1%").arg(r.samples_decoded * 100 / sample_count);
+
+		const QStringList columns = QStringList() << value_to_string(r.value)
+			<< QString::number(r.annotation_count)
+			<< QString::number(r.error_count) << status;
+
+		for (int col = 0; col < columns.size(); col++) {
+			QTableWidgetItem *item = results_table_->item(i, col);
+			if (!item) {
+				item = new QTableWidgetItem();
+				results_table_->setItem(i, col, item);
+			}
+			item->setText(columns[col]);
+		}
+	}
+
+	if (best >= 0)
+		results_table_->selectRow(best);
+}
+
+void DecoderSweep::on_decoder_changed(int index)
+{
+	option_selector_->clear();
+
+	const vector< shared_ptr<Decoder> >& stack = decode_signal_->decoder_stack();
+	if ((index < 0) || ((size_t)index >= stack.size()))
+		return;
+
+	for (const GSList *l = stack[index]->get_srd_decoder()->options; l; l = l->next) {
+		const srd_decoder_option *const opt = (srd_decoder_option*)l->data;
+		option_selector_->addItem(QString::fromUtf8(opt->desc));
+	}
+}
+
+void DecoderSweep::on_option_changed(int index)
+{
+	(void)index;
+
+	values_edit_->clear();
+
+	const srd_decoder_option *const opt = selected_option();
+	if (!opt)
+		return;
+
+	// Suggest all values if the option has a fixed set of them, or else
+	// the current value as a starting point
+	QStringList values;
+	if (opt->values) {
+		for (const GSList *l = opt->values; l; l = l->next)
+			values << value_to_string((GVariant*)l->data);
+	} else {
+		const shared_ptr<Decoder>& dec =
+			decode_signal_->decoder_stack()[decoder_selector_->currentIndex()];
+		const auto iter = dec->options().find(opt->id);
+		values << value_to_string((iter != dec->options().end()) ?
+			iter->second : opt->def);
+	}
+
+	values_edit_->setText(values.join(", "));
+}
+
+void DecoderSweep::on_start()
+{
+	const srd_decoder_option *const opt = selected_option();
+	if (!opt || !opt->def)
+		return;
+
+	const GVariantType *const type = g_variant_get_type(opt->def);
+
+	vector<GVariant*> values;
+	for (const QString& text : values_edit_->text().split(',')) {
+		const QString s = text.trimmed();
+		if (s.isEmpty())
+			continue;
+
+		GVariant *const value = value_from_string(s, type);
+		if (!value) {
+			for (GVariant* v : values)
+				g_variant_unref(g_variant_ref_sink(v));
+			status_label_->setText(tr("\"%1\" isn't a valid value for this option").arg(s));
+			return;
+		}
+		values.push_back(value);
+	}
+
+	if (values.empty()) {
+		status_label_->setText(tr("Enter at least one value to try"));
+		return;
+	}
+
+	results_table_->setRowCount(0);
+	apply_button_->setEnabled(false);
+
+	const shared_ptr<Sweep> sweep = decode_signal_->start_sweep(
+		decoder_selector_->currentIndex(), opt->id, values, segment_id_,
+		start_sample_, end_sample_);
+
+	if (!sweep) {
+		for (GVariant* v : values)
+			g_variant_unref(g_variant_ref_sink(v));
+		status_label_->setText(tr("There is no decoder input in this range yet"));
+		return;
+	}
+
+	connect(sweep.get(), SIGNAL(progress_changed()), this, SLOT(on_sweep_progress()));
+	connect(sweep.get(), SIGNAL(finished()), this, SLOT(on_sweep_finished()));
+
+	status_label_->setText(tr("Decoding..."));
+	update_results();
+}
+
+void DecoderSweep::on_apply()
+{
+	const shared_ptr<Sweep> sweep = decode_signal_->sweep();
+	const int best = sweep ? sweep->best_result() : -1;
+
+	if ((best >= 0) && decode_signal_->apply_sweep_result(best))
+		accept();
+	else
+		status_label_->setText(tr("The decoder stack changed, the result can't be applied"));
+}
+
+void DecoderSweep::on_sweep_progress()
+{
+	if (!update_timer_.isActive())
+		update_timer_.start();
+}
+
+void DecoderSweep::on_sweep_finished()
+{
+	// A cancelled sweep may finish after the next one started
+	const shared_ptr<Sweep> sweep = decode_signal_->sweep();
+	if (!sweep || sweep->is_running())
+		return;
+
+	update_timer_.stop();
+	update_results();
+
+	const int best = sweep->best_result();
+
+	apply_button_->setEnabled(best >= 0);
+	status_label_->setText((best >= 0) ? tr("Finished") :
+		tr("Finished, none of the values produced any annotations"));
+}
+
+void DecoderSweep::on_update_timer()
+{
+	update_results();
+}
+
+} // namespace dialogs
+} // namespace pv
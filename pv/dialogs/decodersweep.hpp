@@ -0,0 +1,93 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_DIALOGS_DECODERSWEEP_HPP
+#define PULSEVIEW_PV_DIALOGS_DECODERSWEEP_HPP
+
+#include <cstdint>
+#include <memory>
+
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+
+using std::shared_ptr;
+
+struct srd_decoder_option;
+
+namespace pv {
+
+namespace data {
+class DecodeSignal;
+}
+
+namespace dialogs {
+
+/**
+ * Lets the user decode a sample range with several values of a decoder
+ * option in parallel and apply the value that suits the data best.
+ */
+class DecoderSweep : public QDialog
+{
+	Q_OBJECT
+
+private:
+	static const int UpdateInterval;
+
+public:
+	DecoderSweep(shared_ptr<data::DecodeSignal> decode_signal,
+		uint32_t segment_id, uint64_t start_sample, uint64_t end_sample,
+		QWidget *parent = nullptr);
+	~DecoderSweep();
+
+private:
+	const srd_decoder_option* selected_option() const;
+	void update_results();
+
+private Q_SLOTS:
+	void on_decoder_changed(int index);
+	void on_option_changed(int index);
+	void on_start();
+	void on_apply();
+	void on_sweep_progress();
+	void on_sweep_finished();
+	void on_update_timer();
+
+private:
+	shared_ptr<data::DecodeSignal> decode_signal_;
+	const uint32_t segment_id_;
+	const uint64_t start_sample_, end_sample_;
+
+	QComboBox *decoder_selector_, *option_selector_;
+	QLineEdit *values_edit_;
+	QLabel *status_label_;
+	QTableWidget *results_table_;
+	QDialogButtonBox *button_box_;
+	QPushButton *start_button_, *apply_button_;
+
+	QTimer update_timer_;
+};
+
+} // namespace dialogs
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DIALOGS_DECODERSWEEP_HPP
@@ -285,6 +285,18 @@ QWidget *Settings::get_general_settings_form(QWidget *parent) const
 		SLOT(on_general_start_all_sessions_changed(int)));
 	general_layout->addRow(tr("Start acquisition for all open sessions when clicking 'Run'"), cb);
 
+	cb = create_checkbox(GlobalSettings::Key_General_CompactAnalogStorage,
+		SLOT(on_general_compact_analog_storage_changed(int)));
+	general_layout->addRow(tr("Store analog samples as raw integer codes if the device provides them"), cb);
+#if !(defined HAVE_SR_ANALOG_NATIVE_FORMAT && HAVE_SR_ANALOG_NATIVE_FORMAT)
+	// libsigrokcxx is too old to expose the raw codes
+	cb->setEnabled(false);
+#endif
+
+	cb = create_checkbox(GlobalSettings::Key_General_NativeFileImport,
+		SLOT(on_general_native_file_import_changed(int)));
+	general_layout->addRow(tr("Use the built-in importers for VCD and CSV files instead of libsigrok's"), cb);
+
 
 	return form;
 }
@@ -426,6 +438,10 @@ QWidget *Settings::get_decoder_settings_form(QWidget *parent)
 		SLOT(on_dec_alwaysshowallrows_changed(int)));
 	decoder_layout->addRow(tr("Always show all &rows, even if no annotation is visible"), cb);
 
+	cb = create_checkbox(GlobalSettings::Key_Dec_UseWorkerProcesses,
+		SLOT(on_dec_useWorkerProcesses_changed(int)));
+	decoder_layout->addRow(tr("Run decoders in separate &worker processes to use all CPU cores"), cb);
+
 	// Annotation export settings
 	ann_export_format_ = new QLineEdit();
 	ann_export_format_->setText(
@@ -703,6 +719,18 @@ void Settings::on_general_start_all_sessions_changed(int state)
 	settings.setValue(GlobalSettings::Key_General_StartAllSessions, state ? true : false);
 }
 
+void Settings::on_general_compact_analog_storage_changed(int state)
+{
+	GlobalSettings settings;
+	settings.setValue(GlobalSettings::Key_General_CompactAnalogStorage, state ? true : false);
+}
+
+void Settings::on_general_native_file_import_changed(int state)
+{
+	GlobalSettings settings;
+	settings.setValue(GlobalSettings::Key_General_NativeFileImport, state ? true : false);
+}
+
 void Settings::on_view_zoomToFitDuringAcq_changed(int state)
 {
 	GlobalSettings settings;
@@ -823,6 +851,12 @@ void Settings::on_dec_alwaysshowallrows_changed(int state)
 	GlobalSettings settings;
 	settings.setValue(GlobalSettings::Key_Dec_AlwaysShowAllRows, state ? true : false);
 }
+
+void Settings::on_dec_useWorkerProcesses_changed(int state)
+{
+	GlobalSettings settings;
+	settings.setValue(GlobalSettings::Key_Dec_UseWorkerProcesses, state ? true : false);
+}
 #endif
 
 void Settings::on_log_logLevel_changed(int value)
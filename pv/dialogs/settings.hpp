@@ -63,6 +63,8 @@ private Q_SLOTS:
 	void on_general_style_changed(int value);
 	void on_general_save_with_setup_changed(int state);
 	void on_general_start_all_sessions_changed(int state);
+	void on_general_compact_analog_storage_changed(int state);
+	void on_general_native_file_import_changed(int state);
 	void on_view_zoomToFitDuringAcq_changed(int state);
 	void on_view_zoomToFitAfterAcq_changed(int state);
 	void on_view_triggerIsZero_changed(int state);
@@ -84,6 +86,7 @@ private Q_SLOTS:
 	void on_dec_initialStateConfigurable_changed(int state);
 	void on_dec_exportFormat_changed(const QString &text);
 	void on_dec_alwaysshowallrows_changed(int state);
+	void on_dec_useWorkerProcesses_changed(int state);
 #endif
 	void on_log_logLevel_changed(int value);
 	void on_log_bufferSize_changed(int value);
@@ -53,6 +53,8 @@ const QString GlobalSettings::Key_General_Theme = "General_Theme";
 const QString GlobalSettings::Key_General_Style = "General_Style";
 const QString GlobalSettings::Key_General_SaveWithSetup = "General_SaveWithSetup";
 const QString GlobalSettings::Key_General_StartAllSessions = "General_StartAllSessions";
+const QString GlobalSettings::Key_General_CompactAnalogStorage = "General_CompactAnalogStorage";
+const QString GlobalSettings::Key_General_NativeFileImport = "General_NativeFileImport";
 const QString GlobalSettings::Key_View_ZoomToFitDuringAcq = "View_ZoomToFitDuringAcq";
 const QString GlobalSettings::Key_View_ZoomToFitAfterAcq = "View_ZoomToFitAfterAcq";
 const QString GlobalSettings::Key_View_TriggerIsZeroTime = "View_TriggerIsZeroTime";
@@ -76,6 +78,7 @@ const QString GlobalSettings::Key_View_CursorShowSamples = "View_CursorShowSampl
 const QString GlobalSettings::Key_Dec_InitialStateConfigurable = "Dec_InitialStateConfigurable";
 const QString GlobalSettings::Key_Dec_ExportFormat = "Dec_ExportFormat";
 const QString GlobalSettings::Key_Dec_AlwaysShowAllRows = "Dec_AlwaysShowAllRows";
+const QString GlobalSettings::Key_Dec_UseWorkerProcesses = "Dec_UseWorkerProcesses";
 const QString GlobalSettings::Key_Log_BufferSize = "Log_BufferSize";
 const QString GlobalSettings::Key_Log_NotifyOfStacktrace = "Log_NotifyOfStacktrace";
 
@@ -122,6 +125,10 @@ void GlobalSettings::set_defaults_where_needed()
 	if (!contains(Key_General_SaveWithSetup))
 		setValue(Key_General_SaveWithSetup, true);
 
+	// Use the built-in file importers where available by default
+	if (!contains(Key_General_NativeFileImport))
+		setValue(Key_General_NativeFileImport, true);
+
 	// Enable zoom-to-fit after acquisition by default
 	if (!contains(Key_View_ZoomToFitAfterAcq))
 		setValue(Key_View_ZoomToFitAfterAcq, true);
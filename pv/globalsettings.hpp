@@ -58,6 +58,8 @@ public:
 	static const QString Key_General_Style;
 	static const QString Key_General_SaveWithSetup;
 	static const QString Key_General_StartAllSessions;
+	static const QString Key_General_CompactAnalogStorage;
+	static const QString Key_General_NativeFileImport;
 	static const QString Key_View_ZoomToFitDuringAcq;
 	static const QString Key_View_ZoomToFitAfterAcq;
 	static const QString Key_View_TriggerIsZeroTime;
@@ -81,6 +83,7 @@ public:
 	static const QString Key_Dec_InitialStateConfigurable;
 	static const QString Key_Dec_ExportFormat;
 	static const QString Key_Dec_AlwaysShowAllRows;
+	static const QString Key_Dec_UseWorkerProcesses;
 	static const QString Key_Log_BufferSize;
 	static const QString Key_Log_NotifyOfStacktrace;
 
@@ -45,8 +45,11 @@
 #include "devices/hardwaredevice.hpp"
 #include "dialogs/settings.hpp"
 #include "globalsettings.hpp"
+#include "subwindows/profiling/subwindow.hpp"
 #include "toolbars/mainbar.hpp"
 #include "util.hpp"
+#include "views/eye_diagram/view.hpp"
+#include "views/spectrum/view.hpp"
 #include "views/trace/view.hpp"
 #include "views/trace/standardbar.hpp"
 
@@ -81,6 +84,8 @@ MainWindow::MainWindow(DeviceManager &device_manager, QWidget *parent) :
 	restore_ui_settings();
 	connect(this, SIGNAL(session_error_raised(const QString, const QString)),
 		this, SLOT(on_session_error_raised(const QString, const QString)));
+	connect(&device_manager_, SIGNAL(devices_changed()),
+		this, SLOT(on_devices_changed()));
 }
 
 MainWindow::~MainWindow()
@@ -99,6 +104,10 @@ void MainWindow::show_session_error(const QString text, const QString info_text)
 	// TODO Emulate noquote()
 	qDebug() << "Notifying user of session error: " << text << "; " << info_text;
 
+	const Application* app = qobject_cast<Application*>(QCoreApplication::instance());
+	if (app && app->is_headless())
+		return;
+
 	QMessageBox msg;
 	msg.setText(text + "\n\n" + info_text);
 	msg.setStandardButtons(QMessageBox::Ok);
@@ -170,6 +179,10 @@ shared_ptr<views::ViewBase> MainWindow::add_view(views::ViewType type,
 	if (type == views::ViewTypeTabularDecoder)
 		v = make_shared<views::tabular_decoder::View>(session, false, dock_main);
 #endif
+	if (type == views::ViewTypeSpectrum)
+		v = make_shared<views::spectrum::View>(session, false, dock_main);
+	if (type == views::ViewTypeEyeDiagram)
+		v = make_shared<views::eye_diagram::View>(session, false, dock_main);
 
 	if (!v)
 		return nullptr;
@@ -284,6 +297,9 @@ shared_ptr<subwindows::SubWindowBase> MainWindow::add_subwindow(
 			title = tr("Decoder Selector");
 			break;
 #endif
+		case subwindows::SubWindowTypeProfiling:
+			title = tr("Performance");
+			break;
 		default:
 			break;
 	}
@@ -301,6 +317,9 @@ shared_ptr<subwindows::SubWindowBase> MainWindow::add_subwindow(
 		w = make_shared<subwindows::decoder_selector::SubWindow>(session, dock_main);
 #endif
 
+	if (type == subwindows::SubWindowTypeProfiling)
+		w = make_shared<subwindows::profiling::SubWindow>(session, dock_main);
+
 	if (!w)
 		return nullptr;
 
@@ -423,28 +442,10 @@ void MainWindow::add_default_session()
 	if (sessions_.size() > 0)
 		return;
 
-	shared_ptr<Session> session = add_session();
+	default_session_ = add_session();
+	default_device_.reset();
 
-	// Check the list of available devices. Prefer the one that was
-	// found with user supplied scan specs (if applicable). Then try
-	// one of the auto detected devices that are not the demo device.
-	// Pick demo in the absence of "genuine" hardware devices.
-	shared_ptr<devices::HardwareDevice> user_device, other_device, demo_device;
-	for (const shared_ptr<devices::HardwareDevice>& dev : device_manager_.devices()) {
-		if (dev == device_manager_.user_spec_device()) {
-			user_device = dev;
-		} else if (dev->hardware_device()->driver()->name() == "demo") {
-			demo_device = dev;
-		} else {
-			other_device = dev;
-		}
-	}
-	if (user_device)
-		session->select_device(user_device);
-	else if (other_device)
-		session->select_device(other_device);
-	else
-		session->select_device(demo_device);
+	select_default_device();
 }
 
 void MainWindow::save_sessions()
@@ -512,6 +513,13 @@ void MainWindow::setup_ui()
 	view_colored_bg_shortcut_ = new QShortcut(QKeySequence(Qt::Key_B), this, SLOT(on_view_colored_bg_shortcut()));
 	view_colored_bg_shortcut_->setAutoRepeat(false);
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	show_profiling_shortcut_ = new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_P), this, SLOT(on_show_profiling_shortcut()));
+#else
+	show_profiling_shortcut_ = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_P), this, SLOT(on_show_profiling_shortcut()));
+#endif
+	show_profiling_shortcut_->setAutoRepeat(false);
+
 	// Set up the tab area
 	new_session_button_ = new QToolButton();
 	new_session_button_->setIcon(QIcon::fromTheme("document-new",
@@ -598,6 +606,54 @@ void MainWindow::update_acq_button(Session *session)
 		run_caption : tr("Stop"));
 }
 
+void MainWindow::select_default_device()
+{
+	shared_ptr<Session> session = default_session_.lock();
+	if (!session)
+		return;
+
+	// Leave the session alone once the user took over
+	if ((session->device() != default_device_) ||
+		(session->get_capture_state() != Session::Stopped)) {
+		default_session_.reset();
+		default_device_.reset();
+		return;
+	}
+
+	// Check the list of available devices. Prefer the one that was
+	// found with user supplied scan specs (if applicable). Then try
+	// one of the auto detected devices that are not the demo device.
+	// Pick demo in the absence of "genuine" hardware devices.
+	shared_ptr<devices::HardwareDevice> user_device, other_device, demo_device;
+	for (const shared_ptr<devices::HardwareDevice>& dev : device_manager_.devices()) {
+		if (dev == device_manager_.user_spec_device()) {
+			user_device = dev;
+		} else if (dev->hardware_device()->driver()->name() == "demo") {
+			demo_device = dev;
+		} else {
+			other_device = dev;
+		}
+	}
+
+	shared_ptr<devices::Device> device;
+	if (user_device)
+		device = user_device;
+	else if (other_device)
+		device = other_device;
+	else
+		device = demo_device;
+
+	if (device && (device != default_device_)) {
+		session->select_device(device);
+		default_device_ = session->device();
+	}
+
+	if (!device_manager_.is_scanning()) {
+		default_session_.reset();
+		default_device_.reset();
+	}
+}
+
 void MainWindow::save_ui_settings()
 {
 	QSettings settings;
@@ -724,6 +780,11 @@ void MainWindow::on_add_view(views::ViewType type, Session *session)
 			add_view(type, *s);
 }
 
+void MainWindow::on_devices_changed()
+{
+	select_default_device();
+}
+
 void MainWindow::on_focus_changed()
 {
 	shared_ptr<views::ViewBase> view = get_active_view();
@@ -924,6 +985,27 @@ void MainWindow::on_show_decoder_selector(Session *session)
 #endif
 }
 
+void MainWindow::on_show_profiling(Session *session)
+{
+	// Close dock widget if it's already showing and return
+	for (auto& entry : sub_windows_) {
+		QDockWidget* dock = entry.first;
+		shared_ptr<subwindows::SubWindowBase> profiling =
+			dynamic_pointer_cast<subwindows::profiling::SubWindow>(entry.second);
+
+		if (profiling && (&profiling->session() == session)) {
+			sub_windows_.erase(dock);
+			dock->close();
+			return;
+		}
+	}
+
+	// We get a pointer and need a reference
+	for (shared_ptr<Session>& s : sessions_)
+		if (s.get() == session)
+			add_subwindow(subwindows::SubWindowTypeProfiling, *s);
+}
+
 void MainWindow::on_sub_window_close_clicked()
 {
 	// Find the dock widget that contains the close button that was clicked
@@ -945,6 +1027,12 @@ void MainWindow::on_sub_window_close_clicked()
 		last_focused_session_->main_view()->setFocus();
 }
 
+void MainWindow::on_show_profiling_shortcut()
+{
+	if (last_focused_session_)
+		on_show_profiling(last_focused_session_.get());
+}
+
 void MainWindow::on_view_colored_bg_shortcut()
 {
 	GlobalSettings settings;
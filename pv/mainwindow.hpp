@@ -36,6 +36,7 @@ using std::list;
 using std::map;
 using std::shared_ptr;
 using std::string;
+using std::weak_ptr;
 
 struct srd_decoder;
 
@@ -104,6 +105,13 @@ private:
 	void setup_ui();
 	void update_acq_button(Session *session);
 
+	/**
+	 * Selects the preferred device for the default session. While the
+	 * device scan is in progress, this is repeated whenever a better
+	 * device is found unless the user picked a device in the meantime.
+	 */
+	void select_default_device();
+
 	void save_ui_settings();
 	void restore_ui_settings();
 
@@ -128,6 +136,8 @@ private Q_SLOTS:
 	void on_focus_changed();
 	void on_focused_session_changed(shared_ptr<Session> session);
 
+	void on_devices_changed();
+
 	void on_new_session_clicked();
 	void on_settings_clicked();
 
@@ -142,8 +152,10 @@ private Q_SLOTS:
 	void on_tab_close_requested(int index);
 
 	void on_show_decoder_selector(Session *session);
+	void on_show_profiling(Session *session);
 	void on_sub_window_close_clicked();
 
+	void on_show_profiling_shortcut();
 	void on_view_colored_bg_shortcut();
 	void on_view_sticky_scrolling_shortcut();
 	void on_view_show_sampling_points_shortcut();
@@ -157,6 +169,9 @@ private:
 	list< shared_ptr<Session> > sessions_;
 	shared_ptr<Session> last_focused_session_;
 
+	weak_ptr<Session> default_session_;
+	shared_ptr<devices::Device> default_device_;
+
 	map< QDockWidget*, shared_ptr<views::ViewBase> > view_docks_;
 	map< QDockWidget*, shared_ptr<subwindows::SubWindowBase> > sub_windows_;
 
@@ -174,6 +189,7 @@ private:
 	QShortcut *view_show_sampling_points_shortcut_;
 	QShortcut *view_show_analog_minor_grid_shortcut_;
 	QShortcut *view_colored_bg_shortcut_;
+	QShortcut *show_profiling_shortcut_;
 	QShortcut *run_stop_shortcut_;
 	QShortcut *close_application_shortcut_;
 	QShortcut *close_current_tab_shortcut_;
@@ -0,0 +1,266 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <thread>
+
+#include <QFile>
+#include <QTextStream>
+
+#include "profiling.hpp"
+
+using std::hash;
+using std::lock_guard;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace pv {
+
+Profiling profiling;
+
+const size_t Profiling::MaxTraceEvents = 1000000;
+
+Profiling::Stage::Stage(const QString &name, const QString &unit) :
+	name_(name),
+	unit_(unit)
+{
+	reset();
+}
+
+const QString& Profiling::Stage::name() const
+{
+	return name_;
+}
+
+const QString& Profiling::Stage::unit() const
+{
+	return unit_;
+}
+
+void Profiling::Stage::add(uint64_t duration_ns, uint64_t units)
+{
+	call_count_++;
+	unit_count_ += units;
+	total_ns_ += duration_ns;
+
+	uint64_t max = max_ns_;
+	while ((duration_ns > max) && !max_ns_.compare_exchange_weak(max, duration_ns));
+
+	unsigned int bucket = 0;
+	while ((duration_ns >> bucket) && (bucket < HistogramBuckets - 1))
+		bucket++;
+	histogram_[bucket]++;
+}
+
+void Profiling::Stage::reset()
+{
+	call_count_ = 0;
+	unit_count_ = 0;
+	total_ns_ = 0;
+	max_ns_ = 0;
+
+	for (atomic<uint64_t>& count : histogram_)
+		count = 0;
+}
+
+uint64_t Profiling::Stage::call_count() const
+{
+	return call_count_;
+}
+
+uint64_t Profiling::Stage::unit_count() const
+{
+	return unit_count_;
+}
+
+uint64_t Profiling::Stage::total_ns() const
+{
+	return total_ns_;
+}
+
+uint64_t Profiling::Stage::max_ns() const
+{
+	return max_ns_;
+}
+
+uint64_t Profiling::Stage::percentile_ns(double percentile) const
+{
+	uint64_t total = 0;
+	for (const atomic<uint64_t>& count : histogram_)
+		total += count;
+
+	if (total == 0)
+		return 0;
+
+	const uint64_t threshold = (uint64_t)(percentile * total);
+
+	uint64_t sum = 0;
+	for (unsigned int bucket = 0; bucket < HistogramBuckets; bucket++) {
+		sum += histogram_[bucket];
+		if (sum > threshold)
+			return (bucket < HistogramBuckets - 1) ? ((uint64_t)1 << bucket) : max_ns_.load();
+	}
+
+	return max_ns_;
+}
+
+Profiling::Profiling() :
+	start_time_(steady_clock::now()),
+	trace_recording_(false)
+{
+}
+
+Profiling::Stage* Profiling::stage(const QString &name, const QString &unit)
+{
+	lock_guard<mutex> lock(stages_mutex_);
+
+	const auto iter = stage_map_.find(name);
+	if (iter != stage_map_.end())
+		return iter->second;
+
+	stages_.emplace_back(name, unit);
+	stage_map_[name] = &stages_.back();
+
+	return &stages_.back();
+}
+
+vector<Profiling::Stage*> Profiling::stages() const
+{
+	lock_guard<mutex> lock(stages_mutex_);
+
+	vector<Stage*> result;
+	for (const auto& entry : stage_map_)
+		result.push_back(entry.second);
+
+	return result;
+}
+
+void Profiling::reset()
+{
+	{
+		lock_guard<mutex> lock(stages_mutex_);
+		for (Stage& stage : stages_)
+			stage.reset();
+	}
+
+	lock_guard<mutex> lock(trace_mutex_);
+	trace_events_.clear();
+}
+
+uint64_t Profiling::now_ns() const
+{
+	return duration_cast<nanoseconds>(steady_clock::now() - start_time_).count();
+}
+
+void Profiling::set_trace_recording(bool enabled)
+{
+	trace_recording_ = enabled;
+}
+
+bool Profiling::is_trace_recording() const
+{
+	return trace_recording_;
+}
+
+size_t Profiling::trace_event_count() const
+{
+	lock_guard<mutex> lock(trace_mutex_);
+	return trace_events_.size();
+}
+
+void Profiling::record_trace_event(const Stage *stage, uint64_t start_ns,
+	uint64_t duration_ns, uint64_t units)
+{
+	const uint64_t thread_id = hash<std::thread::id>()(std::this_thread::get_id());
+
+	lock_guard<mutex> lock(trace_mutex_);
+
+	// Stop recording instead of growing without bounds
+	if (trace_events_.size() >= MaxTraceEvents) {
+		trace_recording_ = false;
+		return;
+	}
+
+	trace_events_.push_back({stage, thread_id, start_ns, duration_ns, units});
+}
+
+bool Profiling::export_trace(const QString &file_name) const
+{
+	QFile file(file_name);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+		return false;
+
+	QTextStream out_stream(&file);
+	out_stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	lock_guard<mutex> lock(trace_mutex_);
+
+	// Chrome expects small thread IDs, so number the threads in order of appearance
+	map<uint64_t, unsigned int> thread_ids;
+
+	bool first = true;
+	for (const TraceEvent& event : trace_events_) {
+		const auto tid = thread_ids.emplace(event.thread_id, thread_ids.size() + 1).first;
+
+		QString name = event.stage->name();
+		name.replace('\\', "\\\\").replace('"', "\\\"");
+
+		if (!first)
+			out_stream << ",\n";
+		first = false;
+
+		// Timestamps and durations are in microseconds
+		out_stream << "{\"name\":\"" << name << "\",\"cat\":\"pulseview\",\"ph\":\"X\"," <<
+			"\"pid\":1,\"tid\":" << tid->second <<
+			",\"ts\":" << QString::number(event.start_ns / 1000.0, 'f', 3) <<
+			",\"dur\":" << QString::number(event.duration_ns / 1000.0, 'f', 3) <<
+			",\"args\":{\"" << (event.stage->unit().isEmpty() ? QString("units") : event.stage->unit()) <<
+			"\":" << event.units << "}}";
+	}
+
+	out_stream << "\n]}\n";
+	out_stream.flush();
+
+	return (out_stream.status() == QTextStream::Ok);
+}
+
+ProfilingScope::ProfilingScope(Profiling::Stage *stage, uint64_t units) :
+	stage_(stage),
+	units_(units),
+	start_ns_(stage ? profiling.now_ns() : 0)
+{
+}
+
+ProfilingScope::~ProfilingScope()
+{
+	if (!stage_)
+		return;
+
+	const uint64_t duration_ns = profiling.now_ns() - start_ns_;
+
+	stage_->add(duration_ns, units_);
+	if (profiling.is_trace_recording())
+		profiling.record_trace_event(stage_, start_ns_, duration_ns, units_);
+}
+
+void ProfilingScope::set_units(uint64_t units)
+{
+	units_ = units;
+}
+
+} // namespace pv
@@ -0,0 +1,195 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_PROFILING_HPP
+#define PULSEVIEW_PV_PROFILING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <QString>
+
+using std::atomic;
+using std::deque;
+using std::map;
+using std::mutex;
+using std::vector;
+
+namespace pv {
+
+/**
+ * Lightweight runtime instrumentation of the acquisition, decoding and
+ * rendering pipeline. Every stage counts how often it ran, how many units
+ * (e.g. samples) it processed and keeps a histogram of the time it took.
+ * Optionally, all measurements are also recorded as trace events that can
+ * be exported in the Chrome trace event format.
+ */
+class Profiling
+{
+public:
+	class Stage
+	{
+	public:
+		/// Bucket n holds durations of [2^(n-1), 2^n) ns, the last one everything above
+		static const unsigned int HistogramBuckets = 40;
+
+	public:
+		Stage(const QString &name, const QString &unit);
+
+		const QString& name() const;
+		const QString& unit() const;
+
+		void add(uint64_t duration_ns, uint64_t units);
+		void reset();
+
+		uint64_t call_count() const;
+		uint64_t unit_count() const;
+		uint64_t total_ns() const;
+		uint64_t max_ns() const;
+
+		/**
+		 * Returns the upper bound of the histogram bucket that contains the
+		 * given percentile (0..1) of the durations.
+		 */
+		uint64_t percentile_ns(double percentile) const;
+
+	private:
+		const QString name_, unit_;
+		atomic<uint64_t> call_count_, unit_count_, total_ns_, max_ns_;
+		atomic<uint64_t> histogram_[HistogramBuckets];
+	};
+
+private:
+	struct TraceEvent
+	{
+		const Stage *stage;
+		uint64_t thread_id;
+		uint64_t start_ns, duration_ns;
+		uint64_t units;
+	};
+
+	static const size_t MaxTraceEvents;
+
+public:
+	Profiling();
+
+	/**
+	 * Returns the stage with the given name, creating it if needed. The
+	 * returned pointer remains valid for the lifetime of the application.
+	 */
+	Stage* stage(const QString &name, const QString &unit = QString());
+
+	vector<Stage*> stages() const;
+
+	/// Resets the statistics of all stages and drops the recorded trace events
+	void reset();
+
+	/// Nanoseconds since the application started
+	uint64_t now_ns() const;
+
+	void set_trace_recording(bool enabled);
+	bool is_trace_recording() const;
+	size_t trace_event_count() const;
+
+	void record_trace_event(const Stage *stage, uint64_t start_ns,
+		uint64_t duration_ns, uint64_t units);
+
+	/**
+	 * Writes the recorded trace events to a file that can be loaded by
+	 * chrome://tracing or Perfetto.
+	 */
+	bool export_trace(const QString &file_name) const;
+
+private:
+	const std::chrono::steady_clock::time_point start_time_;
+
+	mutable mutex stages_mutex_;
+	deque<Stage> stages_;
+	map<QString, Stage*> stage_map_;
+
+	atomic<bool> trace_recording_;
+	mutable mutex trace_mutex_;
+	vector<TraceEvent> trace_events_;
+};
+
+extern Profiling profiling;
+
+/**
+ * Measures the time until it goes out of scope and adds it to a stage.
+ * A null stage makes it a no-op.
+ */
+class ProfilingScope
+{
+public:
+	ProfilingScope(Profiling::Stage *stage, uint64_t units = 0);
+	~ProfilingScope();
+
+	ProfilingScope(const ProfilingScope&) = delete;
+	ProfilingScope& operator=(const ProfilingScope&) = delete;
+
+	void set_units(uint64_t units);
+
+private:
+	Profiling::Stage *const stage_;
+	uint64_t units_;
+	const uint64_t start_ns_;
+};
+
+/**
+ * Drop-in replacement for lock_guard that adds the time spent waiting for
+ * a contended lock to a stage. Uncontended locking is not measured, so the
+ * overhead is a single try_lock().
+ */
+template<class Mutex>
+class ProfiledLockGuard
+{
+public:
+	ProfiledLockGuard(Mutex &mutex, Profiling::Stage *stage) :
+		mutex_(mutex)
+	{
+		if (mutex_.try_lock())
+			return;
+
+		const uint64_t start_ns = profiling.now_ns();
+		mutex_.lock();
+		const uint64_t duration_ns = profiling.now_ns() - start_ns;
+
+		stage->add(duration_ns, 1);
+		if (profiling.is_trace_recording())
+			profiling.record_trace_event(stage, start_ns, duration_ns, 1);
+	}
+
+	~ProfiledLockGuard()
+	{
+		mutex_.unlock();
+	}
+
+	ProfiledLockGuard(const ProfiledLockGuard&) = delete;
+	ProfiledLockGuard& operator=(const ProfiledLockGuard&) = delete;
+
+private:
+	Mutex &mutex_;
+};
+
+} // namespace pv
+
+#endif // PULSEVIEW_PV_PROFILING_HPP
@@ -17,6 +17,8 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+
 #include <cassert>
 #include <memory>
 #include <mutex>
@@ -29,7 +31,9 @@
 #include <QFileInfo>
 
 #include "devicemanager.hpp"
+#include "globalsettings.hpp"
 #include "mainwindow.hpp"
+#include "profiling.hpp"
 #include "session.hpp"
 #include "util.hpp"
 
@@ -124,10 +128,14 @@ Session::Session(DeviceManager &device_manager, QString name) :
 	name_(name),
 	capture_state_(Stopped),
 	cur_samplerate_(0),
+	store_analog_codes_(false),
 	data_saved_(true)
 {
 	// Use this name also for the QObject instance
 	setObjectName(name_);
+
+	connect(&device_manager_, SIGNAL(devices_changed()),
+		this, SLOT(on_devices_changed()));
 }
 
 Session::~Session()
@@ -248,6 +256,10 @@ void Session::save_setup(QSettings &settings) const
 	settings.setValue("decode_signals", decode_signal_count);
 	settings.setValue("generated_signals", gen_signal_count);
 
+	// Without views (e.g. in batch mode) there's nothing left to save
+	if (!main_view_)
+		return;
+
 	// Save view states and their signal settings
 	// Note: main_view must be saved as view0
 	i = 0;
@@ -417,6 +429,10 @@ void Session::restore_setup(QSettings &settings)
 	}
 #endif
 
+	// Without views (e.g. in batch mode) there's nothing left to restore
+	if (!main_view_)
+		return;
+
 	// Restore views
 	int views = settings.value("views").toInt();
 
@@ -504,6 +520,11 @@ void Session::restore_settings(QSettings &settings)
 
 		if (device)
 			restore_setup(settings);
+		else if ((dev_info.count("model") > 0) && device_manager_.is_scanning()) {
+			// The device may not have been found yet, so try again later
+			pending_device_info_ = dev_info;
+			pending_device_settings_group_ = settings.group();
+		}
 	}
 
 	QString filename;
@@ -620,6 +641,8 @@ void Session::set_device(shared_ptr<devices::Device> device)
 	}
 
 	if (device_) {
+		device_->set_data_sink(this);
+
 		device_->session()->add_datafeed_callback([=]
 			(shared_ptr<sigrok::Device> device, shared_ptr<Packet> packet) {
 				data_feed_in(device, packet);
@@ -779,7 +802,8 @@ void Session::load_file(QString file_name, QString setup_file_name,
 		restore_setup(settings_storage);
 	}
 
-	main_bar_->update_device_list();
+	if (main_bar_)
+		main_bar_->update_device_list();
 
 	start_capture([&, errorMessage](QString infoMessage) {
 		Q_EMIT session_error_raised(errorMessage, infoMessage); });
@@ -806,11 +830,12 @@ void Session::start_capture(function<void (const QString)> error_handler)
 
 	stop_capture();
 
-	// Check that at least one channel is enabled
+	// Check that at least one channel is enabled. Devices that only learn
+	// their channels once the acquisition runs don't have any yet
 	const shared_ptr<sigrok::Device> sr_dev = device_->device();
 	if (sr_dev) {
 		const auto channels = sr_dev->channels();
-		if (!any_of(channels.begin(), channels.end(),
+		if (!channels.empty() && !any_of(channels.begin(), channels.end(),
 			[](shared_ptr<Channel> channel) {
 				return channel->enabled(); })) {
 			error_handler(tr("No channels enabled."));
@@ -1058,6 +1083,119 @@ MetadataObjManager* Session::metadata_obj_manager()
 	return &metadata_obj_manager_;
 }
 
+void Session::set_samplerate(uint64_t samplerate)
+{
+	cur_samplerate_ = samplerate;
+
+	signals_changed();
+}
+
+shared_ptr<data::LogicSegment> Session::begin_logic_segment(unsigned int unit_size)
+{
+	lock_guard<recursive_mutex> lock(data_mutex_);
+
+	if (!logic_data_)
+		update_signals();
+
+	if (!logic_data_)
+		return nullptr;
+
+	if (cur_logic_segment_) {
+		cur_logic_segment_->set_complete();
+		signal_segment_completed();
+	}
+
+	set_capture_state(Running);
+
+	cur_logic_segment_ = make_shared<data::LogicSegment>(
+		*logic_data_, logic_data_->get_segment_count(),
+		unit_size, cur_samplerate_);
+	logic_data_->push_segment(cur_logic_segment_);
+
+	signal_new_segment();
+
+	return cur_logic_segment_;
+}
+
+shared_ptr<data::AnalogSegment> Session::begin_analog_segment(unsigned int channel_index)
+{
+	lock_guard<recursive_mutex> lock(data_mutex_);
+
+	if (signalbases_.empty())
+		update_signals();
+
+	const shared_ptr<sigrok::Device> sr_dev = device_->device();
+	if (!sr_dev)
+		return nullptr;
+
+	shared_ptr<Channel> channel;
+	for (const shared_ptr<Channel>& ch : sr_dev->channels())
+		if ((ch->index() == channel_index) &&
+			(ch->type() == sigrok::ChannelType::ANALOG))
+			channel = ch;
+
+	const shared_ptr<data::SignalBase> base =
+		channel ? signalbase_from_channel(channel) : nullptr;
+	if (!base)
+		return nullptr;
+
+	shared_ptr<data::Analog> data(base->analog_data());
+	assert(data);
+
+	const auto iter = cur_analog_segments_.find(channel);
+	if (iter != cur_analog_segments_.end())
+		iter->second->set_complete();
+
+	set_capture_state(Running);
+
+	shared_ptr<data::AnalogSegment> segment = make_shared<data::AnalogSegment>(
+		*data, data->get_segment_count(), cur_samplerate_);
+	cur_analog_segments_[channel] = segment;
+	data->push_segment(segment);
+
+	signal_new_segment();
+
+	return segment;
+}
+
+void Session::samples_appended()
+{
+	{
+		lock_guard<recursive_mutex> lock(data_mutex_);
+
+		if (highest_segment_id_ < 0)
+			return;
+
+		if (cur_logic_segment_)
+			segment_sample_count_[highest_segment_id_] =
+				max(segment_sample_count_[highest_segment_id_],
+					cur_logic_segment_->get_sample_count());
+
+		for (auto& entry : cur_analog_segments_)
+			segment_sample_count_[highest_segment_id_] =
+				max(segment_sample_count_[highest_segment_id_],
+					entry.second->get_sample_count());
+	}
+
+	data_received();
+}
+
+void Session::end_segments()
+{
+	lock_guard<recursive_mutex> lock(data_mutex_);
+
+	if (cur_logic_segment_)
+		cur_logic_segment_->set_complete();
+
+	for (auto& entry : cur_analog_segments_) {
+		shared_ptr<data::AnalogSegment> segment = entry.second;
+		segment->set_complete();
+	}
+
+	cur_logic_segment_.reset();
+	cur_analog_segments_.clear();
+}
+
 void Session::set_capture_state(capture_state state)
 {
 	if (state == capture_state_)
@@ -1431,7 +1569,10 @@ Gst::FlowReturn Session::on_gst_new_sample()
 
 void Session::feed_in_header()
 {
-	// Nothing to do here for now
+	// Fetch the settings that are needed while data is coming in
+	GlobalSettings settings;
+	store_analog_codes_ =
+		settings.value(GlobalSettings::Key_General_CompactAnalogStorage).toBool();
 }
 
 void Session::feed_in_meta(shared_ptr<Meta> meta)
@@ -1527,8 +1668,10 @@ void Session::feed_in_logic(shared_ptr<sigrok::Logic> logic)
 		return;
 	}
 
-	if (logic->unit_size() > 8)
-		throw QString(tr("Can't handle more than 64 logic channels."));
+	static Profiling::Stage* const profiling_stage =
+		profiling.stage("Logic ingest", "samples");
+	ProfilingScope profiling_scope(profiling_stage,
+		logic->data_length() / logic->unit_size());
 
 	if (!cur_samplerate_)
 		try {
@@ -1567,6 +1710,54 @@ void Session::feed_in_logic(shared_ptr<sigrok::Logic> logic)
 	data_received();
 }
 
+/**
+ * Determines the storage format that holds the raw integer codes of an
+ * analog packet, along with the factor and offset to convert them back.
+ * Returns StorageFormat::Float if the codes can't be kept as they are,
+ * which is always the case if libsigrokcxx doesn't expose the format.
+ */
+static data::AnalogSegment::StorageFormat get_analog_code_format(
+	shared_ptr<sigrok::Analog> analog, float &scale, float &offset)
+{
+	using data::AnalogSegment;
+
+#if defined HAVE_SR_ANALOG_NATIVE_FORMAT && HAVE_SR_ANALOG_NATIVE_FORMAT
+	if (analog->is_float() || (analog->unitsize() > 2))
+		return AnalogSegment::StorageFormat::Float;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if ((analog->unitsize() > 1) && analog->is_bigendian())
+		return AnalogSegment::StorageFormat::Float;
+#elif __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	if ((analog->unitsize() > 1) && !analog->is_bigendian())
+		return AnalogSegment::StorageFormat::Float;
+#else
+#error Endianness unknown
+#endif
+
+	const shared_ptr<sigrok::Rational> sc = analog->scale();
+	const shared_ptr<sigrok::Rational> of = analog->offset();
+	if (!sc->denominator() || !of->denominator())
+		return AnalogSegment::StorageFormat::Float;
+
+	scale = (float)sc->numerator() / sc->denominator();
+	offset = (float)of->numerator() / of->denominator();
+
+	if (analog->unitsize() == 1)
+		return analog->is_signed() ?
+			AnalogSegment::StorageFormat::Int8 : AnalogSegment::StorageFormat::UInt8;
+	else
+		return analog->is_signed() ?
+			AnalogSegment::StorageFormat::Int16 : AnalogSegment::StorageFormat::UInt16;
+#else
+	(void)analog;
+	(void)scale;
+	(void)offset;
+
+	return AnalogSegment::StorageFormat::Float;
+#endif
+}
+
 void Session::feed_in_analog(shared_ptr<sigrok::Analog> analog)
 {
 	if (analog->num_samples() == 0) {
@@ -1574,6 +1765,10 @@ void Session::feed_in_analog(shared_ptr<sigrok::Analog> analog)
 		return;
 	}
 
+	static Profiling::Stage* const profiling_stage =
+		profiling.stage("Analog ingest", "samples");
+	ProfilingScope profiling_scope(profiling_stage, analog->num_samples());
+
 	if (!cur_samplerate_)
 		try {
 			cur_samplerate_ = device_->read_config<uint64_t>(ConfigKey::SAMPLERATE);
@@ -1586,13 +1781,19 @@ void Session::feed_in_analog(shared_ptr<sigrok::Analog> analog)
 	const vector<shared_ptr<Channel>> channels = analog->channels();
 	bool sweep_beginning = false;
 
-	unique_ptr<float[]> data(new float[analog->num_samples() * channels.size()]);
-	analog->get_data_as_float(data.get());
+	// Check whether we can keep the raw integer codes
+	data::AnalogSegment::StorageFormat format =
+		data::AnalogSegment::StorageFormat::Float;
+	float scale = 1.0f, offset = 0.0f;
+	if (store_analog_codes_)
+		format = get_analog_code_format(analog, scale, offset);
 
 	if (signalbases_.empty())
 		update_signals();
 
-	float *channel_data = data.get();
+	vector< shared_ptr<data::AnalogSegment> > segments;
+	segments.reserve(channels.size());
+
 	for (auto& channel : channels) {
 		shared_ptr<data::AnalogSegment> segment;
 
@@ -1616,7 +1817,8 @@ void Session::feed_in_analog(shared_ptr<sigrok::Analog> analog)
 
 			// Create a segment, keep it in the maps of channels
 			segment = make_shared<data::AnalogSegment>(
-				*data, data->get_segment_count(), cur_samplerate_);
+				*data, data->get_segment_count(), cur_samplerate_,
+				format, scale, offset);
 			cur_analog_segments_[channel] = segment;
 
 			// Push the segment into the analog data.
@@ -1627,13 +1829,35 @@ void Session::feed_in_analog(shared_ptr<sigrok::Analog> analog)
 
 		assert(segment);
 
-		// Append the samples in the segment
-		segment->append_interleaved_samples(channel_data++, analog->num_samples(),
-			channels.size());
+		segments.push_back(segment);
+	}
+
+	// If the segments store exactly the codes we received, we can skip the
+	// conversion to float. Otherwise, append the values as floats and let
+	// the segments deal with them
+#if defined HAVE_SR_ANALOG_NATIVE_FORMAT && HAVE_SR_ANALOG_NATIVE_FORMAT
+	bool codes_match = (format != data::AnalogSegment::StorageFormat::Float);
+	for (const shared_ptr<data::AnalogSegment>& segment : segments)
+		codes_match = codes_match && (segment->storage_format() == format) &&
+			(segment->scale() == scale) && (segment->offset() == offset);
+
+	// Append the samples to all segments in one go
+	if (codes_match)
+		data::AnalogSegment::append_interleaved_codes(segments,
+			analog->data_pointer(), analog->num_samples());
+	else
+#endif
+	{
+		unique_ptr<float[]> data(new float[analog->num_samples() * channels.size()]);
+		analog->get_data_as_float(data.get());
+
+		data::AnalogSegment::append_interleaved_samples(segments, data.get(),
+			analog->num_samples());
+	}
 
+	for (const shared_ptr<data::AnalogSegment>& segment : segments)
 		segment_sample_count_[highest_segment_id_] =
 			max(segment_sample_count_[highest_segment_id_], segment->get_sample_count());
-	}
 
 	if (sweep_beginning) {
 		// This could be the first packet after a trigger
@@ -1695,20 +1919,7 @@ void Session::data_feed_in(shared_ptr<sigrok::Device> device,
 		// Strictly speaking, this is performed when a frame end marker was
 		// received, so there's no point doing this again. However, not all
 		// devices use frames, and for those devices, we need to do it here.
-		{
-			lock_guard<recursive_mutex> lock(data_mutex_);
-
-			if (cur_logic_segment_)
-				cur_logic_segment_->set_complete();
-
-			for (auto& entry : cur_analog_segments_) {
-				shared_ptr<data::AnalogSegment> segment = entry.second;
-				segment->set_complete();
-			}
-
-			cur_logic_segment_.reset();
-			cur_analog_segments_.clear();
-		}
+		end_segments();
 		break;
 
 	default:
@@ -1736,4 +1947,37 @@ void Session::on_new_decoders_selected(vector<const srd_decoder*> decoders)
 }
 #endif
 
+void Session::on_devices_changed()
+{
+	if (pending_device_info_.empty())
+		return;
+
+	const shared_ptr<devices::HardwareDevice> device =
+		device_manager_.find_device_from_info(pending_device_info_);
+
+	if (!device) {
+		if (!device_manager_.is_scanning())
+			pending_device_info_.clear();
+		return;
+	}
+
+	pending_device_info_.clear();
+
+	// Don't interfere if a device was selected in the meantime
+	if (device_)
+		return;
+
+	try {
+		set_device(device);
+	} catch (const QString &e) {
+		MainWindow::show_session_error(tr("Failed to select device"), e);
+		return;
+	}
+
+	QSettings settings;
+	settings.beginGroup(pending_device_settings_group_);
+	restore_setup(settings);
+	settings.endGroup();
+}
+
 } // namespace pv
@@ -49,6 +49,7 @@
 
 #include "metadata_obj.hpp"
 #include "util.hpp"
+#include "devices/datasink.hpp"
 #include "views/viewbase.hpp"
 
 using std::deque;
@@ -114,7 +115,7 @@ class ViewBase;
 
 using pv::views::ViewType;
 
-class Session : public QObject
+class Session : public QObject, public devices::DataSink
 {
 	Q_OBJECT
 
@@ -215,6 +216,13 @@ public:
 
 	MetadataObjManager* metadata_obj_manager();
 
+	// Used by devices that write their samples directly into the segments
+	void set_samplerate(uint64_t samplerate) override;
+	shared_ptr<data::LogicSegment> begin_logic_segment(unsigned int unit_size) override;
+	shared_ptr<data::AnalogSegment> begin_analog_segment(unsigned int channel_index) override;
+	void samples_appended() override;
+	void end_segments() override;
+
 private:
 	void set_capture_state(capture_state state);
 
@@ -276,6 +284,9 @@ public Q_SLOTS:
 	void on_new_decoders_selected(vector<const srd_decoder*> decoders);
 #endif
 
+private Q_SLOTS:
+	void on_devices_changed();
+
 private:
 	bool shutting_down_;
 
@@ -283,6 +294,11 @@ private:
 	shared_ptr<devices::Device> device_;
 	QString default_name_, name_, save_path_;
 
+	/// Last used device that the device scan may still find and the
+	/// settings group to restore its setup from once it was found
+	map<string, string> pending_device_info_;
+	QString pending_device_settings_group_;
+
 	vector< shared_ptr<views::ViewBase> > views_;
 	shared_ptr<pv::views::ViewBase> main_view_;
 
@@ -307,6 +323,7 @@ private:
 		cur_analog_segments_;
 	int32_t highest_segment_id_;
 	vector<uint64_t> segment_sample_count_;
+	bool store_analog_codes_;
 
 	std::thread sampling_thread_;
 
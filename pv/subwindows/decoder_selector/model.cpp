@@ -21,11 +21,7 @@
 
 #include "subwindow.hpp"
 
-#include <libsigrokdecode/libsigrokdecode.h>
-
-#define DECODERS_HAVE_TAGS \
-	((SRD_PACKAGE_VERSION_MAJOR > 0) || \
-	 (SRD_PACKAGE_VERSION_MAJOR == 0) && (SRD_PACKAGE_VERSION_MINOR > 5))
+#include "pv/decodercatalog.hpp"
 
 using std::make_shared;
 
@@ -35,6 +31,18 @@ namespace decoder_selector {
 
 DecoderCollectionModel::DecoderCollectionModel(QObject* parent) :
 	QAbstractItemModel(parent)
+{
+	populate();
+}
+
+void DecoderCollectionModel::reload()
+{
+	beginResetModel();
+	populate();
+	endResetModel();
+}
+
+void DecoderCollectionModel::populate()
 {
 	vector<QVariant> header_data;
 	header_data.emplace_back(tr("Decoder"));     // Column #0
@@ -55,27 +63,19 @@ DecoderCollectionModel::DecoderCollectionModel(QObject* parent) :
 		make_shared<DecoderCollectionItem>(item_data, root_);
 	root_->appendSubItem(group_item_all);
 
-	for (GSList* li = (GSList*)srd_decoder_list(); li; li = li->next) {
-		const srd_decoder *const d = (srd_decoder*)li->data;
-		assert(d);
-
-		const QString id = QString::fromUtf8(d->id);
-		const QString name = QString::fromUtf8(d->name);
-		const QString long_name = QString::fromUtf8(d->longname);
-
+	for (const DecoderCatalog::Info& d : decoder_catalog.decoders()) {
 		// Add decoder to the "all decoders" group
 		item_data.clear();
-		item_data.emplace_back(name);
-		item_data.emplace_back(long_name);
-		item_data.emplace_back(id);
+		item_data.emplace_back(d.name);
+		item_data.emplace_back(d.longname);
+		item_data.emplace_back(d.id);
 		shared_ptr<DecoderCollectionItem> decoder_item_all =
 			make_shared<DecoderCollectionItem>(item_data, group_item_all);
 		group_item_all->appendSubItem(decoder_item_all);
 
 		// Add decoder to all relevant groups using the tag information
-#if DECODERS_HAVE_TAGS
-		for (GSList* ti = (GSList*)d->tags; ti; ti = ti->next) {
-			const QString tag = tr((char*)ti->data);
+		for (const QString& tag_name : d.tags) {
+			const QString tag = tr(tag_name.toUtf8().constData());
 			const QVariant tag_var = QVariant(tag);
 
 			// Find tag group and create it if it doesn't exist yet
@@ -95,16 +95,15 @@ DecoderCollectionModel::DecoderCollectionModel(QObject* parent) :
 
 			// Create decoder item
 			item_data.clear();
-			item_data.emplace_back(name);
-			item_data.emplace_back(long_name);
-			item_data.emplace_back(id);
+			item_data.emplace_back(d.name);
+			item_data.emplace_back(d.longname);
+			item_data.emplace_back(d.id);
 			shared_ptr<DecoderCollectionItem> decoder_item =
 				make_shared<DecoderCollectionItem>(item_data, group_item);
 
 			// Add decoder to tag group
 			group_item->appendSubItem(decoder_item);
 		}
-#endif
 	}
 }
 
@@ -29,6 +29,7 @@
 #include <QScrollArea>
 #include <QVBoxLayout>
 
+#include "pv/decodercatalog.hpp"
 #include "pv/session.hpp"
 #include "pv/subwindows/decoder_selector/subwindow.hpp"
 
@@ -49,6 +50,10 @@ const char *initial_notice =
 	QT_TRANSLATE_NOOP("pv::subwindows::decoder_selector::SubWindow",
 			"Select a decoder to see its description here.");  // clazy:exclude=non-pod-global-static
 
+const char *loading_notice =
+	QT_TRANSLATE_NOOP("pv::subwindows::decoder_selector::SubWindow",
+			"Loading protocol decoders...");  // clazy:exclude=non-pod-global-static
+
 const int min_width_margin = 75;
 
 
@@ -149,7 +154,8 @@ SubWindow::SubWindow(Session& session, QWidget* parent) :
 	info_label_header_->setTextInteractionFlags(flags);
 	info_label_body_->setWordWrap(true);
 	info_label_body_->setTextInteractionFlags(flags);
-	info_label_body_->setText(QString(tr(initial_notice)));
+	info_label_body_->setText(QString(tr(
+		decoder_catalog.is_loading() ? loading_notice : initial_notice)));
 	info_label_body_->setAlignment(Qt::AlignTop);
 	info_label_footer_->setWordWrap(true);
 	info_label_footer_->setTextInteractionFlags(flags);
@@ -167,6 +173,9 @@ SubWindow::SubWindow(Session& session, QWidget* parent) :
 	connect(this, SIGNAL(new_decoders_selected(vector<const srd_decoder*>)),
 		&session, SLOT(on_new_decoders_selected(vector<const srd_decoder*>)));
 
+	connect(&decoder_catalog, SIGNAL(decoders_changed()),
+		this, SLOT(on_decoders_changed()));
+
 	// Place the keyboard cursor in the filter QLineEdit initially
 	filter->setFocus();
 }
@@ -201,25 +210,9 @@ vector<const char*> SubWindow::get_decoder_inputs(const srd_decoder* d) const
 	return ret_val;
 }
 
-vector<const srd_decoder*> SubWindow::get_decoders_providing(const char* output) const
+vector<DecoderCatalog::Info> SubWindow::get_decoders_providing(const char* output) const
 {
-	vector<const srd_decoder*> ret_val;
-
-	for (GSList* li = (GSList*)srd_decoder_list(); li; li = li->next) {
-		const srd_decoder* d = (srd_decoder*)li->data;
-		assert(d);
-
-		if (!d->outputs)
-			continue;
-
-		const int maxlen = 1024;
-
-		// TODO For now we ignore that d->outputs is actually a list
-		if (strncmp((char*)(d->outputs->data), output, maxlen) == 0)
-			ret_val.push_back(d);
-	}
-
-	return ret_val;
+	return decoder_catalog.decoders_providing(QString::fromUtf8(output));
 }
 
 void SubWindow::on_item_changed(const QModelIndex& index)
@@ -234,21 +227,20 @@ void SubWindow::on_item_changed(const QModelIndex& index)
 		if (decoder_name.isEmpty())
 			return;
 
-		const srd_decoder* d = srd_decoder_get_by_id(decoder_name.toUtf8());
+		// Use the cached metadata so that the decoder doesn't need to be loaded
+		const DecoderCatalog::Info d = decoder_catalog.decoder_info(decoder_name);
 
-		id = QString::fromUtf8(d->id);
-		longname = QString::fromUtf8(d->longname);
-		desc = QString::fromUtf8(d->desc);
-		doc = QString::fromUtf8(srd_decoder_doc_get(d)).trimmed();
+		id = d.id;
+		longname = d.longname;
+		desc = d.desc;
+		doc = d.doc;
 
-#if DECODERS_HAVE_TAGS
-		for (GSList* li = (GSList*)d->tags; li; li = li->next) {
-			QString s = (li == (GSList*)d->tags) ?
-				tr((char*)li->data) :
-				QString(tr(", %1")).arg(tr((char*)li->data));
+		for (const QString& tag : d.tags) {
+			QString s = tags.isEmpty() ?
+				tr(tag.toUtf8().constData()) :
+				QString(tr(", %1")).arg(tr(tag.toUtf8().constData()));
 			tags.append(s);
 		}
-#endif
 	} else
 		doc = QString(tr(initial_notice));
 
@@ -275,7 +267,8 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 	QModelIndex id_index = index.model()->index(index.row(), 2, index.parent());
 	QString decoder_name = index.model()->data(id_index, Qt::DisplayRole).toString();
 
-	const srd_decoder* chosen_decoder = srd_decoder_get_by_id(decoder_name.toUtf8());
+	// The decoder modules are imported when they're first used
+	const srd_decoder* chosen_decoder = decoder_catalog.get_decoder(decoder_name);
 	if (chosen_decoder == nullptr)
 		return;
 
@@ -296,7 +289,7 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 
 	// Check if we can automatically fulfill the stacking requirements
 	while (strcmp(inputs.at(0), "logic") != 0) {
-		vector<const srd_decoder*> prov_decoders = get_decoders_providing(inputs.at(0));
+		vector<DecoderCatalog::Info> prov_decoders = get_decoders_providing(inputs.at(0));
 
 		if (prov_decoders.size() == 0) {
 			// Emit warning and add the stack that we could gather so far
@@ -306,7 +299,7 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 		}
 
 		if (prov_decoders.size() == 1) {
-			decoders.push_back(prov_decoders.front());
+			decoders.push_back(decoder_catalog.get_decoder(prov_decoders.front().id));
 		} else {
 			// Let user decide which one to use
 			QString caption = QString(tr("Protocol decoder <b>%1</b> requires input type <b>%2</b> " \
@@ -314,8 +307,8 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 					.arg(QString::fromUtf8(decoders.back()->id), QString::fromUtf8(inputs.at(0)));
 
 			QStringList items;
-			for (const srd_decoder* d : prov_decoders)
-				items << QString::fromUtf8(d->id) + " (" + QString::fromUtf8(d->longname) + ")";
+			for (const DecoderCatalog::Info& d : prov_decoders)
+				items << d.id + " (" + d.longname + ")";
 			bool ok_clicked;
 			QString item = QInputDialog::getItem(this, tr("Choose Decoder"),
 				tr(caption.toUtf8()), items, 0, false, &ok_clicked);
@@ -324,9 +317,12 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 				return;
 
 			QString d = item.section(' ', 0, 0);
-			decoders.push_back(srd_decoder_get_by_id(d.toUtf8()));
+			decoders.push_back(decoder_catalog.get_decoder(d));
 		}
 
+		if (!decoders.back())
+			return;
+
 		inputs = get_decoder_inputs(decoders.back());
 	}
 
@@ -335,6 +331,18 @@ void SubWindow::on_item_activated(const QModelIndex& index)
 	new_decoders_selected(decoders);
 }
 
+void SubWindow::on_decoders_changed()
+{
+	model_->reload();
+
+	tree_view_->resizeColumnToContents(0);
+#if (!DECODERS_HAVE_TAGS)
+	tree_view_->expandAll();
+#endif
+
+	info_label_body_->setText(QString(tr(initial_notice)));
+}
+
 void SubWindow::on_filter_changed(const QString& text)
 {
 	sort_filter_model_->setFilterFixedString(text);
@@ -28,6 +28,7 @@
 #include <QSplitter>
 #include <QTreeView>
 
+#include "pv/decodercatalog.hpp"
 #include "pv/subwindows/subwindowbase.hpp"
 
 using std::shared_ptr;
@@ -67,6 +68,9 @@ class DecoderCollectionModel : public QAbstractItemModel
 public:
 	DecoderCollectionModel(QObject* parent = nullptr);
 
+	/// Rebuilds the model from the current decoder metadata
+	void reload();
+
 	QVariant data(const QModelIndex& index, int role) const override;
 	Qt::ItemFlags flags(const QModelIndex& index) const override;
 
@@ -80,6 +84,9 @@ public:
 	int rowCount(const QModelIndex& parent_idx = QModelIndex()) const override;
 	int columnCount(const QModelIndex& parent_idx = QModelIndex()) const override;
 
+private:
+	void populate();
+
 private:
 	shared_ptr<DecoderCollectionItem> root_;
 };
@@ -121,10 +128,10 @@ public:
 	vector<const char*> get_decoder_inputs(const srd_decoder* d) const;
 
 	/**
-	 * Returns a list of protocol decoder IDs which provide a given output
-	 * ("uart", "spi", etc.)
+	 * Returns the metadata of the protocol decoders which provide a given
+	 * output ("uart", "spi", etc.)
 	 */
-	vector<const srd_decoder*> get_decoders_providing(const char* output) const;
+	vector<DecoderCatalog::Info> get_decoders_providing(const char* output) const;
 
 Q_SIGNALS:
 	void new_decoders_selected(vector<const srd_decoder*> decoders);
@@ -136,6 +143,9 @@ public Q_SLOTS:
 	void on_filter_changed(const QString& text);
 	void on_filter_return_pressed();
 
+private Q_SLOTS:
+	void on_decoders_changed();
+
 private:
 	QSplitter* splitter_;
 	QCustomTreeView* tree_view_;
@@ -0,0 +1,273 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QSplitter>
+#include <QToolBar>
+#include <QVBoxLayout>
+
+#include "pv/globalsettings.hpp"
+#include "pv/profiling.hpp"
+#include "pv/session.hpp"
+#include "pv/util.hpp"
+#include "pv/data/logic.hpp"
+#include "pv/data/signaldata.hpp"
+#include "pv/subwindows/profiling/subwindow.hpp"
+
+#include "subwindow.hpp"  // Required only for lupdate since above include isn't recognized
+
+using std::map;
+
+using pv::util::SIPrefix;
+
+namespace pv {
+namespace subwindows {
+namespace profiling {
+
+const int SubWindow::UpdateInterval = 500; // ms
+
+SubWindow::SubWindow(Session& session, QWidget* parent) :
+	SubWindowBase(session, parent),
+	stage_table_(new QTableWidget(0, 8)),
+	memory_table_(new QTableWidget(0, 2)),
+	trace_label_(new QLabel()),
+	action_reset_(new QAction(this)),
+	action_record_trace_(new QAction(this)),
+	action_export_trace_(new QAction(this))
+{
+	QVBoxLayout* root_layout = new QVBoxLayout(this);
+	root_layout->setContentsMargins(0, 0, 0, 0);
+
+	QSplitter* splitter = new QSplitter();
+	splitter->setOrientation(Qt::Vertical);
+	splitter->addWidget(stage_table_);
+	splitter->addWidget(memory_table_);
+	root_layout->addWidget(splitter);
+	root_layout->addWidget(trace_label_);
+
+	stage_table_->setHorizontalHeaderLabels({tr("Stage"), tr("Calls"),
+		tr("Units"), tr("Throughput"), tr("Mean"), tr("Median"), tr("99%"), tr("Max")});
+	memory_table_->setHorizontalHeaderLabels({tr("Signal Data"), tr("Memory")});
+
+	for (QTableWidget* table : {stage_table_, memory_table_}) {
+		table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+		table->setSelectionMode(QAbstractItemView::NoSelection);
+		table->setAlternatingRowColors(true);
+		table->verticalHeader()->hide();
+		table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+		table->horizontalHeader()->setStretchLastSection(true);
+	}
+
+	action_reset_->setText(tr("&Reset"));
+	action_reset_->setIcon(QIcon::fromTheme("edit-clear"));
+	action_reset_->setToolTip(tr("Reset all statistics"));
+	connect(action_reset_, SIGNAL(triggered(bool)), this, SLOT(on_reset()));
+
+	action_record_trace_->setText(tr("Record &Trace"));
+	action_record_trace_->setIcon(QIcon::fromTheme("media-record"));
+	action_record_trace_->setToolTip(tr("Record every measurement as a trace event"));
+	action_record_trace_->setCheckable(true);
+	action_record_trace_->setChecked(pv::profiling.is_trace_recording());
+	connect(action_record_trace_, SIGNAL(toggled(bool)),
+		this, SLOT(on_record_trace_toggled(bool)));
+
+	action_export_trace_->setText(tr("&Export Trace..."));
+	action_export_trace_->setIcon(QIcon::fromTheme("document-save-as",
+		QIcon(":/icons/document-save-as.png")));
+	action_export_trace_->setToolTip(tr("Export the recorded trace events for chrome://tracing"));
+	connect(action_export_trace_, SIGNAL(triggered(bool)), this, SLOT(on_export_trace()));
+
+	connect(&update_timer_, SIGNAL(timeout()), this, SLOT(on_update()));
+	update_timer_.setInterval(UpdateInterval);
+
+	on_update();
+}
+
+bool SubWindow::has_toolbar() const
+{
+	return true;
+}
+
+QToolBar* SubWindow::create_toolbar(QWidget *parent) const
+{
+	QToolBar* toolbar = new QToolBar(parent);
+
+	toolbar->addAction(action_reset_);
+	toolbar->addSeparator();
+	toolbar->addAction(action_record_trace_);
+	toolbar->addAction(action_export_trace_);
+
+	return toolbar;
+}
+
+void SubWindow::update_stages()
+{
+	const vector<Profiling::Stage*> stages = pv::profiling.stages();
+
+	stage_table_->setRowCount(0);
+
+	for (const Profiling::Stage* stage : stages) {
+		const uint64_t calls = stage->call_count();
+		if (calls == 0)
+			continue;
+
+		const uint64_t units = stage->unit_count();
+		const uint64_t total_ns = stage->total_ns();
+
+		const QString unit = stage->unit().isEmpty() ? tr("units") : stage->unit();
+		const QString throughput = (total_ns > 0) ?
+			util::format_value_si(units * 1e9 / total_ns, SIPrefix::unspecified,
+				2, unit + "/s", false) : QString();
+
+		const int row = stage_table_->rowCount();
+		stage_table_->insertRow(row);
+
+		const QStringList cells = {stage->name(), QString::number(calls),
+			QString::number(units), throughput,
+			format_duration(total_ns / calls),
+			format_duration(stage->percentile_ns(0.5)),
+			format_duration(stage->percentile_ns(0.99)),
+			format_duration(stage->max_ns())};
+
+		for (int column = 0; column < cells.size(); column++) {
+			QTableWidgetItem* item = new QTableWidgetItem(cells[column]);
+			if (column > 0)
+				item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+			stage_table_->setItem(row, column, item);
+		}
+	}
+}
+
+void SubWindow::update_memory()
+{
+	// Several signals may share the same data, e.g. all logic channels
+	map<const data::SignalData*, QString> data_names;
+
+	for (const shared_ptr<data::SignalBase>& base : session_.signalbases()) {
+		const data::SignalData* data = base->data().get();
+		if (!data || (data_names.count(data) > 0))
+			continue;
+
+		data_names[data] = dynamic_cast<const data::Logic*>(data) ?
+			tr("Logic channels") : base->name();
+	}
+
+	memory_table_->setRowCount(0);
+
+	uint64_t total = 0;
+	for (const auto& entry : data_names) {
+		const uint64_t size = entry.first->get_memory_used();
+		total += size;
+
+		const int row = memory_table_->rowCount();
+		memory_table_->insertRow(row);
+		memory_table_->setItem(row, 0, new QTableWidgetItem(entry.second));
+
+		QTableWidgetItem* item = new QTableWidgetItem(format_size(size));
+		item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+		memory_table_->setItem(row, 1, item);
+	}
+
+	const int row = memory_table_->rowCount();
+	memory_table_->insertRow(row);
+
+	QTableWidgetItem* label = new QTableWidgetItem(tr("Total"));
+	QFont font = label->font();
+	font.setBold(true);
+	label->setFont(font);
+	memory_table_->setItem(row, 0, label);
+
+	QTableWidgetItem* item = new QTableWidgetItem(format_size(total));
+	item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	item->setFont(font);
+	memory_table_->setItem(row, 1, item);
+}
+
+QString SubWindow::format_duration(uint64_t duration_ns)
+{
+	return util::format_value_si(duration_ns * 1e-9, SIPrefix::unspecified, 2, "s", false);
+}
+
+QString SubWindow::format_size(uint64_t size)
+{
+	return QString("%1 MiB").arg(size / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+void SubWindow::showEvent(QShowEvent *event)
+{
+	SubWindowBase::showEvent(event);
+
+	on_update();
+	update_timer_.start();
+}
+
+void SubWindow::hideEvent(QHideEvent *event)
+{
+	SubWindowBase::hideEvent(event);
+
+	update_timer_.stop();
+}
+
+void SubWindow::on_update()
+{
+	update_stages();
+	update_memory();
+
+	const bool recording = pv::profiling.is_trace_recording();
+
+	// Recording stops by itself when the event limit is reached
+	if (action_record_trace_->isChecked() != recording)
+		action_record_trace_->setChecked(recording);
+
+	trace_label_->setText(tr("%1 trace events recorded").arg(
+		pv::profiling.trace_event_count()));
+}
+
+void SubWindow::on_reset()
+{
+	pv::profiling.reset();
+	on_update();
+}
+
+void SubWindow::on_record_trace_toggled(bool checked)
+{
+	pv::profiling.set_trace_recording(checked);
+}
+
+void SubWindow::on_export_trace()
+{
+	GlobalSettings settings;
+	const QString dir = settings.value("MainWindow/SaveDirectory").toString();
+
+	const QString file_name = QFileDialog::getSaveFileName(this,
+		tr("Export Trace"), dir, tr("Trace Event Files (*.json);;All Files (*)"));
+
+	if (file_name.isEmpty())
+		return;
+
+	if (!pv::profiling.export_trace(file_name))
+		QMessageBox::warning(this, tr("Export Trace"),
+			tr("Failed to write %1").arg(file_name));
+}
+
+} // namespace profiling
+} // namespace subwindows
+} // namespace pv
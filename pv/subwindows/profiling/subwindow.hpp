@@ -0,0 +1,78 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_SUBWINDOWS_PROFILING_SUBWINDOW_HPP
+#define PULSEVIEW_PV_SUBWINDOWS_PROFILING_SUBWINDOW_HPP
+
+#include <QAction>
+#include <QLabel>
+#include <QTableWidget>
+#include <QTimer>
+
+#include "pv/subwindows/subwindowbase.hpp"
+
+namespace pv {
+namespace subwindows {
+namespace profiling {
+
+/**
+ * Shows the statistics collected for the pipeline stages and the memory
+ * used by the sample data of the session. The display is refreshed
+ * periodically while the subwindow is visible.
+ */
+class SubWindow : public SubWindowBase
+{
+	Q_OBJECT
+
+private:
+	static const int UpdateInterval;
+
+public:
+	explicit SubWindow(Session &session, QWidget *parent = nullptr);
+
+	bool has_toolbar() const;
+	QToolBar* create_toolbar(QWidget *parent) const;
+
+private:
+	void update_stages();
+	void update_memory();
+
+	static QString format_duration(uint64_t duration_ns);
+	static QString format_size(uint64_t size);
+
+protected:
+	void showEvent(QShowEvent *event);
+	void hideEvent(QHideEvent *event);
+
+private Q_SLOTS:
+	void on_update();
+	void on_reset();
+	void on_record_trace_toggled(bool checked);
+	void on_export_trace();
+
+private:
+	QTableWidget *stage_table_, *memory_table_;
+	QLabel *trace_label_;
+	QAction *action_reset_, *action_record_trace_, *action_export_trace_;
+	QTimer update_timer_;
+};
+
+} // namespace profiling
+} // namespace subwindows
+} // namespace pv
+
+#endif // PULSEVIEW_PV_SUBWINDOWS_PROFILING_SUBWINDOW_HPP
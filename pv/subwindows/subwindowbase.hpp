@@ -44,6 +44,7 @@ namespace subwindows {
 
 enum SubWindowType {
 	SubWindowTypeDecoderSelector,
+	SubWindowTypeProfiling,
 };
 
 class SubWindowBase : public QWidget
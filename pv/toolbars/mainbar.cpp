@@ -26,6 +26,7 @@
 #include <QDebug>
 #include <QFileDialog>
 #include <QHelpEvent>
+#include <QInputDialog>
 #include <QMenu>
 #include <QMessageBox>
 #include <QSettings>
@@ -40,6 +41,7 @@
 #include <pv/devices/hardwaredevice.hpp>
 #include <pv/devices/inputfile.hpp>
 #include <pv/devices/sessionfile.hpp>
+#include <pv/devices/streamdevice.hpp>
 #include <pv/dialogs/connect.hpp>
 #include <pv/dialogs/inputoutputoptions.hpp>
 #include <pv/dialogs/storeprogress.hpp>
@@ -87,6 +89,7 @@ const uint64_t MainBar::DefaultSampleCount = 1000000;
 
 const char *MainBar::SettingOpenDirectory = "MainWindow/OpenDirectory";
 const char *MainBar::SettingSaveDirectory = "MainWindow/SaveDirectory";
+const char *MainBar::SettingStreamPath = "MainWindow/StreamPath";
 
 MainBar::MainBar(Session &session, QWidget *parent, pv::views::trace::View *view) :
 	StandardBar(session, parent, view, false),
@@ -98,6 +101,7 @@ MainBar::MainBar(Session &session, QWidget *parent, pv::views::trace::View *view
 	action_restore_setup_(new QAction(this)),
 	action_save_setup_(new QAction(this)),
 	action_connect_(new QAction(this)),
+	action_connect_stream_(new QAction(this)),
 	new_view_button_(new QToolButton()),
 	open_button_(new QToolButton()),
 	save_button_(new QToolButton()),
@@ -190,6 +194,10 @@ MainBar::MainBar(Session &session, QWidget *parent, pv::views::trace::View *view
 	connect(action_connect_, SIGNAL(triggered(bool)),
 		this, SLOT(on_actionConnect_triggered()));
 
+	action_connect_stream_->setText(tr("Connect to S&tream..."));
+	connect(action_connect_stream_, SIGNAL(triggered(bool)),
+		this, SLOT(on_actionConnectStream_triggered()));
+
 	// New view button
 	QMenu *menu_new_view = new QMenu();
 	connect(menu_new_view, SIGNAL(triggered(QAction*)),
@@ -211,6 +219,7 @@ MainBar::MainBar(Session &session, QWidget *parent, pv::views::trace::View *view
 	separator_o->setSeparator(true);
 	open_actions.push_back(separator_o);
 	open_actions.push_back(action_restore_setup_);
+	open_actions.push_back(action_connect_stream_);
 
 	widgets::ImportMenu *import_menu = new widgets::ImportMenu(this,
 		session.device_manager().context(), open_actions);
@@ -291,11 +300,19 @@ MainBar::MainBar(Session &session, QWidget *parent, pv::views::trace::View *view
 		this, SLOT(on_capture_state_changed(int)));
 	connect(&session, SIGNAL(device_changed()),
 		this, SLOT(on_device_changed()));
+	connect(&session.device_manager(), SIGNAL(devices_changed()),
+		this, SLOT(on_devices_changed()));
 
 	update_device_list();
 }
 
 void MainBar::update_device_list()
+{
+	update_device_selector();
+	update_device_config_widgets();
+}
+
+void MainBar::update_device_selector()
 {
 	DeviceManager &mgr = session_.device_manager();
 	shared_ptr<devices::Device> selected_device = session_.device();
@@ -307,7 +324,6 @@ void MainBar::update_device_list()
 		devs.push_back(selected_device);
 
 	device_selector_.set_device_list(devs, selected_device);
-	update_device_config_widgets();
 }
 
 void MainBar::set_capture_state(pv::Session::capture_state state)
@@ -786,6 +802,12 @@ void MainBar::on_device_changed()
 	update_device_config_widgets();
 }
 
+void MainBar::on_devices_changed()
+{
+	// Only the list changed, the selected device and its config didn't
+	update_device_selector();
+}
+
 void MainBar::on_capture_state_changed(int state)
 {
 	set_capture_state((pv::Session::capture_state)state);
@@ -913,6 +935,30 @@ void MainBar::on_actionConnect_triggered()
 	update_device_list();
 }
 
+void MainBar::on_actionConnectStream_triggered()
+{
+	QSettings settings;
+	const QString last_path = settings.value(SettingStreamPath).toString();
+
+	bool ok;
+	const QString path = QInputDialog::getText(this, tr("Connect to Stream"),
+		tr("Unix domain socket or named pipe of the acquisition front-end:"),
+		QLineEdit::Normal, last_path, &ok).trimmed();
+
+	if (!ok || path.isEmpty())
+		return;
+
+	settings.setValue(SettingStreamPath, path);
+
+	// Stop any currently running capture session
+	session_.stop_capture();
+
+	session_.select_device(make_shared<devices::StreamDevice>(
+		session_.device_manager().context(), path.toStdString()));
+
+	update_device_list();
+}
+
 void MainBar::on_add_decoder_clicked()
 {
 	show_decoder_selector(&session_);
@@ -84,6 +84,12 @@ private:
 	 */
 	static const char *SettingSaveDirectory;
 
+	/**
+	 * Name of the setting used to remember the path of the
+	 * last sample stream that was connected to.
+	 */
+	static const char *SettingStreamPath;
+
 public:
 	MainBar(Session &session, QWidget *parent,
 		pv::views::trace::View *view);
@@ -108,6 +114,8 @@ private:
 
 	void select_init_device();
 
+	void update_device_selector();
+
 	void save_selection_to_file();
 
 	void update_sample_rate_selector();
@@ -126,6 +134,7 @@ private Q_SLOTS:
 
 	void on_device_selected();
 	void on_device_changed();
+	void on_devices_changed();
 	void on_capture_state_changed(int state);
 	void on_sample_count_changed();
 	void on_sample_rate_changed();
@@ -143,6 +152,7 @@ private Q_SLOTS:
 	void on_actionRestoreSetup_triggered();
 
 	void on_actionConnect_triggered();
+	void on_actionConnectStream_triggered();
 
 	void on_add_decoder_clicked();
 	void on_add_math_signal_clicked();
@@ -165,6 +175,7 @@ private:
 	QAction *const action_restore_setup_;
 	QAction *const action_save_setup_;
 	QAction *const action_connect_;
+	QAction *const action_connect_stream_;
 
 	QToolButton *new_view_button_, *open_button_, *save_button_;
 
@@ -0,0 +1,476 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <QDebug>
+
+#include "accumulator.hpp"
+
+#include "pv/data/analogsegment.hpp"
+#include "pv/data/logicsegment.hpp"
+
+using std::lock_guard;
+using std::max;
+using std::min;
+using std::sort;
+using std::unique_lock;
+
+using pv::data::LogicSegment;
+
+namespace pv {
+namespace views {
+namespace eye_diagram {
+
+const int Accumulator::Width = 512;
+const int Accumulator::Height = 256;
+
+const uint64_t Accumulator::ChunkSize = 256 * 1024;
+const uint64_t Accumulator::EstimationSampleCount = 1024 * 1024;
+
+const double Accumulator::PhaseGain = 0.1;
+const double Accumulator::PeriodGain = 0.01;
+const double Accumulator::MaxPeriodDeviation = 0.05;
+
+/// The shortest unit interval, in samples, that can be shown
+static const double MinSymbolPeriod = 2;
+
+/**
+ * Finds the threshold crossings of a signal. A hysteresis keeps noise from
+ * being taken for transitions, the crossing itself is the last point where
+ * the signal passed the threshold, interpolated between the samples
+ * enclosing it. Otherwise slow edges would appear to cross late.
+ */
+class CrossingDetector
+{
+public:
+	CrossingDetector(float min_value, float max_value) :
+		threshold_((min_value + max_value) / 2),
+		hysteresis_((max_value - min_value) / 20),
+		valid_(false),
+		high_(false),
+		prev_value_(0),
+		last_crossing_(-1)
+	{
+	}
+
+	/// Returns true if the signal crossed the threshold since the last sample
+	bool process(double t, float value, double &crossing)
+	{
+		if (!valid_) {
+			high_ = (value > threshold_);
+			prev_value_ = value;
+			valid_ = true;
+			return false;
+		}
+
+		if ((prev_value_ - threshold_) * (value - threshold_) < 0)
+			last_crossing_ = t - 1 + (threshold_ - prev_value_) / (value - prev_value_);
+		prev_value_ = value;
+
+		const bool high = high_ ?
+			(value > threshold_ - hysteresis_) : (value > threshold_ + hysteresis_);
+
+		if (high == high_)
+			return false;
+
+		high_ = high;
+		crossing = (last_crossing_ >= 0) ? last_crossing_ : t;
+
+		return true;
+	}
+
+private:
+	float threshold_, hysteresis_;
+	bool valid_, high_;
+	float prev_value_;
+	double last_crossing_;
+};
+
+Accumulator::Accumulator() :
+	params_changed_(false),
+	samples_added_(false),
+	restart_(false),
+	interrupt_(false),
+	result_sample_count_(0),
+	result_symbol_period_(0)
+{
+	params_.clock_bit = 0;
+	params_.symbol_period = 0;
+	params_.min_value = params_.max_value = 0;
+
+	accumulation_thread_ = std::thread(&Accumulator::accumulation_proc, this);
+}
+
+Accumulator::~Accumulator()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		interrupt_ = true;
+	}
+	cond_.notify_one();
+
+	accumulation_thread_.join();
+}
+
+void Accumulator::start(shared_ptr<data::AnalogSegment> segment,
+	shared_ptr<data::LogicSegment> clock_segment, int clock_bit,
+	double symbol_period, float min_value, float max_value)
+{
+	assert(max_value > min_value);
+
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		params_.segment = segment;
+		params_.clock_segment = clock_segment;
+		params_.clock_bit = clock_bit;
+		params_.symbol_period = symbol_period;
+		params_.min_value = min_value;
+		params_.max_value = max_value;
+
+		result_.clear();
+		result_sample_count_ = 0;
+		result_symbol_period_ = 0;
+
+		params_changed_ = true;
+		restart_ = true;
+	}
+	cond_.notify_one();
+}
+
+void Accumulator::clear()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		params_.segment.reset();
+		params_.clock_segment.reset();
+
+		result_.clear();
+		result_sample_count_ = 0;
+		result_symbol_period_ = 0;
+
+		params_changed_ = true;
+		restart_ = true;
+	}
+	cond_.notify_one();
+}
+
+void Accumulator::notify_samples_added()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		samples_added_ = true;
+	}
+	cond_.notify_one();
+}
+
+uint64_t Accumulator::get_histogram(vector<uint32_t> &histogram,
+	double &symbol_period) const
+{
+	lock_guard<mutex> lock(mutex_);
+
+	histogram = result_;
+	symbol_period = result_symbol_period_;
+
+	return result_sample_count_;
+}
+
+void Accumulator::publish(const vector<uint32_t> &histogram,
+	uint64_t sample_count, double symbol_period)
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		// Don't overwrite the result with one for outdated parameters
+		if (restart_)
+			return;
+
+		result_ = histogram;
+		result_sample_count_ = sample_count;
+		result_symbol_period_ = symbol_period;
+	}
+
+	histogram_changed();
+}
+
+double Accumulator::estimate_symbol_period(const Parameters &params,
+	uint64_t sample_count) const
+{
+	CrossingDetector detector(params.min_value, params.max_value);
+	vector<float> samples;
+	vector<double> intervals;
+
+	double last_crossing = -1;
+
+	for (uint64_t pos = 0; (pos < sample_count) && !restart_ && !interrupt_;
+		pos += ChunkSize) {
+		const uint64_t end = min(pos + ChunkSize, sample_count);
+		samples.resize(end - pos);
+		params.segment->get_samples(pos, end, samples.data());
+
+		for (size_t i = 0; i < samples.size(); i++) {
+			double crossing;
+			if (!detector.process(pos + i, samples[i], crossing))
+				continue;
+
+			if (last_crossing >= 0)
+				intervals.push_back(crossing - last_crossing);
+			last_crossing = crossing;
+		}
+	}
+
+	if (intervals.size() < 16)
+		return 0;
+
+	// The intervals between transitions are multiples of the unit interval.
+	// Take a short one as a first guess, then average all intervals that
+	// don't stem from long idle periods over the number of symbols they span.
+	vector<double> sorted(intervals);
+	sort(sorted.begin(), sorted.end());
+	const double guess = sorted[sorted.size() / 10];
+
+	if (guess < MinSymbolPeriod)
+		return 0;
+
+	double interval_sum = 0, symbol_sum = 0;
+	for (const double interval : intervals) {
+		const double symbols = round(interval / guess);
+		if ((symbols >= 1) && (symbols <= 16)) {
+			interval_sum += interval;
+			symbol_sum += symbols;
+		}
+	}
+
+	return (symbol_sum > 0) ? (interval_sum / symbol_sum) : 0;
+}
+
+void Accumulator::add_line(vector<uint32_t> &histogram, double x, double dx,
+	int row0, int row1) const
+{
+	const auto column = [](int c) {
+		c %= Width;
+		return (c < 0) ? (c + Width) : c;
+	};
+
+	const int first = (int)ceil(x);
+	const int last = (int)floor(x + dx);
+
+	// The line doesn't reach the next column
+	if (last < first) {
+		histogram[row1 * Width + column(last)]++;
+		return;
+	}
+
+	// Fill the rows that the line passes through in each column, so that
+	// steep edges don't fall apart into single dots
+	int prev_row = row0;
+	for (int c = first; c <= last; c++) {
+		const int row = lround(row0 + (row1 - row0) * (c - x) / dx);
+		const int col = column(c);
+
+		for (int r = min(prev_row, row); r <= max(prev_row, row); r++)
+			histogram[r * Width + col]++;
+
+		prev_row = row;
+	}
+}
+
+void Accumulator::accumulation_proc()
+{
+	Parameters params;
+	vector<uint32_t> histogram;
+	vector<float> samples;
+	vector<LogicSegment::EdgePair> edges;
+	vector<double> clock_edges;
+
+	// The state is kept across chunks so that samples can be added
+	// incrementally while the acquisition is running
+	uint64_t position = 0, sample_count = 0, estimation_count = 0;
+	double nominal_period = 0, period = 0, reference = 0;
+	bool have_reference = false, have_prev = false;
+	bool clock_level = false, clock_level_valid = false;
+	int prev_row = 0;
+	CrossingDetector detector(0, 1);
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(mutex_);
+			cond_.wait(lock, [&] {
+				return interrupt_ || params_changed_ || samples_added_; });
+
+			if (interrupt_)
+				return;
+
+			if (params_changed_) {
+				params = params_;
+				params_changed_ = false;
+				restart_ = false;
+
+				histogram.assign(params.segment ? (Width * Height) : 0, 0);
+				position = sample_count = estimation_count = 0;
+				nominal_period = period = params.clock_segment ? 0 : params.symbol_period;
+				have_reference = have_prev = false;
+				clock_level_valid = false;
+				clock_edges.clear();
+				detector = CrossingDetector(params.min_value, params.max_value);
+			}
+
+			samples_added_ = false;
+		}
+
+		if (!params.segment)
+			continue;
+
+		const float value_range = params.max_value - params.min_value;
+
+		while (!restart_ && !interrupt_) {
+			const bool complete = params.segment->is_complete();
+			uint64_t end = params.segment->get_sample_count();
+
+			// The clock must be recovered with a known nominal period. If it
+			// can't be estimated yet, try again once twice the samples exist.
+			if (!params.clock_segment && (nominal_period == 0)) {
+				const uint64_t count = min(end, 16 * EstimationSampleCount);
+				if ((count == estimation_count) || (!complete &&
+					(count < max(EstimationSampleCount, 2 * estimation_count))))
+					break;
+
+				estimation_count = count;
+				nominal_period = period = estimate_symbol_period(params, count);
+
+				if (nominal_period == 0) {
+					if (complete)
+						qWarning() << "Eye diagram: Can't determine the symbol rate";
+					break;
+				}
+			}
+
+			// Only process samples for which the clock is known, too
+			double clock_ratio = 1;
+			if (params.clock_segment) {
+				clock_ratio = params.clock_segment->samplerate() /
+					params.segment->samplerate();
+				end = min(end, (uint64_t)(params.clock_segment->get_sample_count() /
+					clock_ratio));
+			}
+
+			if (position >= end)
+				break;
+
+			const uint64_t chunk_end = min(position + ChunkSize, end);
+			samples.resize(chunk_end - position);
+			params.segment->get_samples(position, chunk_end, samples.data());
+
+			// Find the rising clock edges, in samples of the analog signal.
+			// Edges that weren't consumed by the previous chunk are kept.
+			size_t edge_index = 0;
+			if (params.clock_segment) {
+				// get_subsampled_edges() also reads the sample at the end index
+				const uint64_t last_clock_sample =
+					params.clock_segment->get_sample_count() - 1;
+
+				edges.clear();
+				params.clock_segment->get_subsampled_edges(edges,
+					(uint64_t)(position * clock_ratio),
+					min((uint64_t)(chunk_end * clock_ratio), last_clock_sample),
+					1, params.clock_bit);
+
+				for (const LogicSegment::EdgePair& edge : edges) {
+					if (clock_level_valid && edge.second && !clock_level)
+						clock_edges.push_back(edge.first / clock_ratio);
+					clock_level = edge.second;
+					clock_level_valid = true;
+				}
+			}
+
+			for (size_t i = 0; i < samples.size(); i++) {
+				const double t = position + i;
+				const float value = samples[i];
+
+				if (params.clock_segment) {
+					while ((edge_index < clock_edges.size()) &&
+						(clock_edges[edge_index] <= t)) {
+						const double edge = clock_edges[edge_index++];
+						// Average the period as the edges are only known
+						// to the nearest sample
+						if (have_reference && (edge > reference))
+							period = (period > 0) ?
+								(period + PhaseGain * (edge - reference - period)) :
+								(edge - reference);
+						reference = edge;
+						have_reference = true;
+					}
+				} else {
+					double crossing;
+					if (detector.process(t, value, crossing)) {
+						if (!have_reference) {
+							reference = crossing;
+							have_reference = true;
+						} else {
+							// Align the reference with the crossing and
+							// let the period follow the symbol rate
+							const double symbols = round((crossing - reference) / period);
+							const double expected = reference + symbols * period;
+							const double error = crossing - expected;
+
+							reference = expected + PhaseGain * error;
+							if (symbols >= 1)
+								period = min(max(period + PeriodGain * error / symbols,
+									nominal_period * (1 - MaxPeriodDeviation)),
+									nominal_period * (1 + MaxPeriodDeviation));
+						}
+					}
+				}
+
+				const int row = min(max((int)lround((params.max_value - value) /
+					value_range * (Height - 1)), 0), Height - 1);
+
+				if (have_reference && (period >= MinSymbolPeriod)) {
+					// Place the symbol boundary at a quarter of the width
+					const double span = 2 * period;
+					double x = fmod(t - reference + period / 2, span);
+					if (x < 0)
+						x += span;
+
+					const double scale = Width / span;
+					if (have_prev)
+						add_line(histogram, x * scale - scale, scale, prev_row, row);
+					else
+						histogram[row * Width + min((int)(x * scale), Width - 1)]++;
+
+					sample_count++;
+					have_prev = true;
+				}
+
+				prev_row = row;
+			}
+
+			clock_edges.erase(clock_edges.begin(), clock_edges.begin() + edge_index);
+
+			position = chunk_end;
+			publish(histogram, sample_count, period);
+		}
+	}
+}
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_ACCUMULATOR_HPP
+#define PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_ACCUMULATOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QObject>
+
+using std::atomic;
+using std::condition_variable;
+using std::mutex;
+using std::shared_ptr;
+using std::vector;
+
+namespace pv {
+
+namespace data {
+class AnalogSegment;
+class LogicSegment;
+}
+
+namespace views {
+namespace eye_diagram {
+
+/**
+ * Accumulates the eye diagram of an analog signal into a density histogram
+ * on a worker thread.
+ *
+ * The histogram spans two unit intervals horizontally, centered on the
+ * symbol boundary, and the given value range vertically. The signal is
+ * processed chunk by chunk, each chunk's line segments being rasterized into
+ * the histogram, and a copy of it is published after each chunk. The symbol
+ * boundaries are taken from the rising edges of a logic clock channel or
+ * recovered from the threshold crossings of the signal itself.
+ */
+class Accumulator : public QObject
+{
+	Q_OBJECT
+
+public:
+	/// The size of the histogram, the width covering two unit intervals
+	static const int Width;
+	static const int Height;
+
+private:
+	static const uint64_t ChunkSize;
+
+	/// The number of samples the symbol period is estimated from
+	static const uint64_t EstimationSampleCount;
+
+	/// The loop gains of the clock recovery
+	static const double PhaseGain;
+	static const double PeriodGain;
+
+	/// How far the recovered period may drift from the nominal one
+	static const double MaxPeriodDeviation;
+
+public:
+	Accumulator();
+	~Accumulator();
+
+	/**
+	 * Discards the histogram and starts accumulating.
+	 *
+	 * @param segment The signal to show.
+	 * @param clock_segment The logic data containing the clock channel or
+	 *        nullptr if the clock is to be recovered from the signal.
+	 * @param clock_bit The bit of the clock channel in @a clock_segment.
+	 * @param symbol_period The nominal unit interval in samples when
+	 *        recovering the clock, 0 to estimate it from the signal.
+	 * @param min_value The value shown at the bottom of the histogram.
+	 * @param max_value The value shown at the top of the histogram.
+	 */
+	void start(shared_ptr<data::AnalogSegment> segment,
+		shared_ptr<data::LogicSegment> clock_segment, int clock_bit,
+		double symbol_period, float min_value, float max_value);
+
+	/// Stops accumulating and discards the histogram
+	void clear();
+
+	/// Wakes up the worker so that it processes newly acquired samples
+	void notify_samples_added();
+
+	/**
+	 * Copies the histogram, rows top to bottom.
+	 *
+	 * @param symbol_period Receives the unit interval in samples.
+	 * @return The number of samples that were accumulated.
+	 */
+	uint64_t get_histogram(vector<uint32_t> &histogram,
+		double &symbol_period) const;
+
+Q_SIGNALS:
+	void histogram_changed();
+
+private:
+	struct Parameters {
+		shared_ptr<data::AnalogSegment> segment;
+		shared_ptr<data::LogicSegment> clock_segment;
+		int clock_bit;
+		double symbol_period;
+		float min_value, max_value;
+	};
+
+	void accumulation_proc();
+
+	double estimate_symbol_period(const Parameters &params,
+		uint64_t sample_count) const;
+
+	void add_line(vector<uint32_t> &histogram, double x, double dx,
+		int row0, int row1) const;
+
+	void publish(const vector<uint32_t> &histogram, uint64_t sample_count,
+		double symbol_period);
+
+private:
+	mutable mutex mutex_;
+	condition_variable cond_;
+
+	Parameters params_;
+	bool params_changed_, samples_added_;
+
+	/// Set when the worker must abandon the current parameters
+	atomic<bool> restart_, interrupt_;
+
+	vector<uint32_t> result_;
+	uint64_t result_sample_count_;
+	double result_symbol_period_;
+
+	std::thread accumulation_thread_;
+};
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_ACCUMULATOR_HPP
@@ -0,0 +1,181 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <QFontMetrics>
+#include <QPainter>
+
+#include "plot.hpp"
+
+#include "pv/util.hpp"
+
+using std::max;
+using std::max_element;
+
+namespace pv {
+namespace views {
+namespace eye_diagram {
+
+/// Formats a value with an SI prefix chosen to suit the value
+static QString format_si(double v, QString unit)
+{
+	return util::format_value_si(v, util::determine_value_prefix(v), 3, unit, false);
+}
+
+Plot::Plot(QWidget *parent) :
+	QWidget(parent),
+	symbol_period_(0),
+	min_value_(0),
+	max_value_(0),
+	sample_count_(0)
+{
+	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void Plot::set_histogram(const vector<uint32_t> &histogram, int width,
+	double symbol_period, float min_value, float max_value,
+	uint64_t sample_count)
+{
+	const int height = histogram.size() / width;
+
+	// Map the counts logarithmically onto a heat color scale so that rarely
+	// taken paths remain visible next to the dominant ones
+	QRgb colors[256];
+	for (int i = 0; i < 256; i++)
+		colors[i] = QColor::fromHsvF((255 - i) / 255.0 * (240 / 360.0), 1, 1).rgb();
+
+	const uint32_t max_count = histogram.empty() ? 0 :
+		*max_element(histogram.begin(), histogram.end());
+	const float scale = (max_count > 0) ? (255 / log1pf(max_count)) : 0;
+
+	image_ = QImage(width, height, QImage::Format_ARGB32);
+	for (int y = 0; y < height; y++) {
+		QRgb *const line = (QRgb*)image_.scanLine(y);
+		const uint32_t *const counts = &histogram[y * width];
+
+		for (int x = 0; x < width; x++)
+			line[x] = (counts[x] == 0) ? qRgba(0, 0, 0, 0) :
+				colors[(int)(log1pf(counts[x]) * scale)];
+	}
+
+	symbol_period_ = symbol_period;
+	min_value_ = min_value;
+	max_value_ = max_value;
+	sample_count_ = sample_count;
+	message_.clear();
+
+	update();
+}
+
+void Plot::clear(const QString &message)
+{
+	image_ = QImage();
+	sample_count_ = 0;
+	message_ = message;
+
+	update();
+}
+
+QSize Plot::sizeHint() const
+{
+	return QSize(600, 400);
+}
+
+QRect Plot::plot_rect() const
+{
+	const QFontMetrics fm(font());
+	const int margin = fm.height() / 2;
+	const int left = util::text_width(fm, "-0.000e-00") + 2 * margin;
+
+	return QRect(left, fm.height() + margin,
+		max(width() - left - 3 * margin, 1),
+		max(height() - 3 * fm.height() - margin, 1));
+}
+
+void Plot::paintEvent(QPaintEvent *event)
+{
+	(void)event;
+
+	QPainter p(this);
+	p.fillRect(rect(), palette().color(QPalette::Base));
+
+	if (image_.isNull()) {
+		p.setPen(palette().color(QPalette::Text));
+		p.drawText(rect(), Qt::AlignCenter, message_);
+		return;
+	}
+
+	const QRect area = plot_rect();
+
+	p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+	p.drawImage(area, image_);
+
+	paint_grid(p, area);
+
+	const QString info = tr("Unit interval: %1 (%2), %n sample(s)", "",
+		sample_count_).arg(format_si(symbol_period_, "s"),
+		format_si(1 / symbol_period_, "Bd"));
+
+	p.setPen(palette().color(QPalette::Text));
+	p.drawText(QRect(area.left(), 0, area.width(), area.top()),
+		Qt::AlignLeft | Qt::AlignVCenter, info);
+}
+
+void Plot::paint_grid(QPainter &p, const QRect &rect) const
+{
+	const QFontMetrics fm(font());
+	const QColor grid_color = palette().color(QPalette::Mid);
+	const QColor text_color = palette().color(QPalette::Text);
+
+	// The histogram spans from half a unit interval before the symbol
+	// boundary to half a unit interval after the next one
+	const int label_width = util::text_width(fm, "-0.5 UI");
+	for (int i = 0; i <= 4; i++) {
+		const int x = rect.left() + i * rect.width() / 4;
+
+		p.setPen(QPen(grid_color, 1, Qt::DotLine));
+		p.drawLine(x, rect.top(), x, rect.bottom());
+
+		p.setPen(text_color);
+		p.drawText(QRect(x - label_width, rect.bottom() + fm.height() / 2,
+			2 * label_width, fm.height()), Qt::AlignHCenter | Qt::AlignTop,
+			QString("%1 UI").arg(i * 0.5 - 0.5));
+	}
+
+	const int divisions = 8;
+	for (int i = 0; i <= divisions; i++) {
+		const int y = rect.top() + i * rect.height() / divisions;
+		const float value = max_value_ - (max_value_ - min_value_) * i / divisions;
+
+		p.setPen(QPen(grid_color, 1, Qt::DotLine));
+		p.drawLine(rect.left(), y, rect.right(), y);
+
+		p.setPen(text_color);
+		p.drawText(QRect(0, y - fm.height() / 2, rect.left() - fm.height() / 2,
+			fm.height()), Qt::AlignRight | Qt::AlignVCenter,
+			QString::number(value, 'g', 3));
+	}
+
+	p.setPen(grid_color);
+	p.drawRect(rect);
+}
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
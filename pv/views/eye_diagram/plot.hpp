@@ -0,0 +1,87 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_PLOT_HPP
+#define PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_PLOT_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QWidget>
+
+using std::vector;
+
+namespace pv {
+namespace views {
+namespace eye_diagram {
+
+/**
+ * Shows an eye diagram histogram as a density image. The image is only
+ * rebuilt when a new histogram is set, painting merely scales it.
+ */
+class Plot : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit Plot(QWidget *parent = nullptr);
+
+	/**
+	 * Sets the histogram to show.
+	 *
+	 * @param histogram The sample counts, rows top to bottom, each row
+	 *        spanning two unit intervals.
+	 * @param width The number of columns in @a histogram.
+	 * @param symbol_period The unit interval in seconds.
+	 * @param min_value The value of the bottom row.
+	 * @param max_value The value of the top row.
+	 * @param sample_count The number of accumulated samples.
+	 */
+	void set_histogram(const vector<uint32_t> &histogram, int width,
+		double symbol_period, float min_value, float max_value,
+		uint64_t sample_count);
+
+	/// Removes the histogram and shows the given message instead
+	void clear(const QString &message = QString());
+
+	QSize sizeHint() const;
+
+protected:
+	void paintEvent(QPaintEvent *event);
+
+private:
+	QRect plot_rect() const;
+
+	void paint_grid(QPainter &p, const QRect &rect) const;
+
+private:
+	QImage image_;
+	double symbol_period_;
+	float min_value_, max_value_;
+	uint64_t sample_count_;
+
+	QString message_;
+};
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_PLOT_HPP
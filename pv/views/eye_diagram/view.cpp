@@ -0,0 +1,350 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+
+#include <QLabel>
+#include <QToolBar>
+#include <QVBoxLayout>
+
+#include "view.hpp"
+#include "plot.hpp"
+
+#include "pv/session.hpp"
+#include "pv/data/analog.hpp"
+#include "pv/data/analogsegment.hpp"
+#include "pv/data/logic.hpp"
+#include "pv/data/logicsegment.hpp"
+#include "pv/data/signalbase.hpp"
+
+using pv::data::Analog;
+using pv::data::AnalogSegment;
+using pv::data::Logic;
+using pv::data::LogicSegment;
+using pv::data::SignalBase;
+
+using std::pair;
+using std::shared_ptr;
+
+namespace pv {
+namespace views {
+namespace eye_diagram {
+
+const float View::ValueMargin = 0.1f;
+
+View::View(Session &session, bool is_main_view, QMainWindow *parent) :
+	ViewBase(session, is_main_view, parent),
+
+	// Note: Place defaults in View::reset_view_state(), not here
+	signal_selector_(new QComboBox()),
+	clock_selector_(new QComboBox()),
+	symbol_rate_spinbox_(new QDoubleSpinBox()),
+	plot_(new Plot()),
+	min_value_(0),
+	max_value_(0)
+{
+	QVBoxLayout *root_layout = new QVBoxLayout(this);
+	root_layout->setContentsMargins(0, 0, 0, 0);
+	root_layout->addWidget(plot_);
+
+	// Create toolbar
+	QToolBar* toolbar = new QToolBar();
+	toolbar->setContextMenuPolicy(Qt::PreventContextMenu);
+	parent->addToolBar(toolbar);
+
+	// Populate toolbar
+	toolbar->addWidget(new QLabel(tr("Signal:")));
+	toolbar->addWidget(signal_selector_);
+	toolbar->addSeparator();
+	toolbar->addWidget(new QLabel(tr("Clock:")));
+	toolbar->addWidget(clock_selector_);
+	toolbar->addWidget(new QLabel(tr("Symbol rate:")));
+	toolbar->addWidget(symbol_rate_spinbox_);
+
+	// Configure widgets
+	signal_selector_->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+	clock_selector_->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+	clock_selector_->addItem(tr("Recovered from signal"), QVariant::fromValue((void*)nullptr));
+
+	symbol_rate_spinbox_->setRange(0, 1e12);
+	symbol_rate_spinbox_->setDecimals(0);
+	symbol_rate_spinbox_->setSuffix(" Bd");
+	symbol_rate_spinbox_->setSpecialValueText(tr("Auto"));
+	symbol_rate_spinbox_->setKeyboardTracking(false);
+
+	connect(signal_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_settings_changed()));
+	connect(clock_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_settings_changed()));
+	connect(symbol_rate_spinbox_, SIGNAL(valueChanged(double)),
+		this, SLOT(on_settings_changed()));
+
+	connect(&accumulator_, SIGNAL(histogram_changed()),
+		this, SLOT(on_histogram_changed()));
+
+	parent->setSizePolicy(plot_->sizePolicy());
+
+	reset_view_state();
+}
+
+ViewType View::get_type() const
+{
+	return ViewTypeEyeDiagram;
+}
+
+void View::reset_view_state()
+{
+	ViewBase::reset_view_state();
+
+	clock_selector_->setCurrentIndex(0);
+	symbol_rate_spinbox_->setValue(0);
+
+	update_accumulation();
+}
+
+void View::clear_signalbases()
+{
+	for (const shared_ptr<SignalBase>& signalbase : signalbases_)
+		disconnect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+			this, SLOT(on_signal_name_changed(const QString&)));
+
+	ViewBase::clear_signalbases();
+
+	signal_selector_->clear();
+	while (clock_selector_->count() > 1)
+		clock_selector_->removeItem(1);
+}
+
+void View::add_signalbase(const shared_ptr<SignalBase> signalbase)
+{
+	ViewBase::add_signalbase(signalbase);
+
+	// Analog signals can be shown, logic signals can serve as clock
+	QComboBox *selector;
+	switch (signalbase->type()) {
+	case SignalBase::AnalogChannel:
+	case SignalBase::MathChannel:
+		selector = signal_selector_;
+		break;
+	case SignalBase::LogicChannel:
+		selector = clock_selector_;
+		break;
+	default:
+		return;
+	}
+
+	connect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+		this, SLOT(on_signal_name_changed(const QString&)));
+
+	selector->addItem(signalbase->name(),
+		QVariant::fromValue((void*)signalbase.get()));
+}
+
+void View::remove_signalbase(const shared_ptr<SignalBase> signalbase)
+{
+	disconnect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+		this, SLOT(on_signal_name_changed(const QString&)));
+
+	ViewBase::remove_signalbase(signalbase);
+
+	const QVariant data = QVariant::fromValue((void*)signalbase.get());
+
+	int index = signal_selector_->findData(data);
+	if (index != -1)
+		signal_selector_->removeItem(index);
+
+	index = clock_selector_->findData(data);
+	if (index != -1)
+		clock_selector_->removeItem(index);
+}
+
+void View::save_settings(QSettings &settings) const
+{
+	ViewBase::save_settings(settings);
+
+	settings.setValue("signal", signal_selector_->currentText());
+	if (clock_selector_->currentIndex() > 0)
+		settings.setValue("clock", clock_selector_->currentText());
+	settings.setValue("symbol_rate", symbol_rate_spinbox_->value());
+}
+
+void View::restore_settings(QSettings &settings)
+{
+	ViewBase::restore_settings(settings);
+
+	if (settings.contains("signal")) {
+		const int index = signal_selector_->findText(settings.value("signal").toString());
+		if (index != -1)
+			signal_selector_->setCurrentIndex(index);
+	}
+
+	if (settings.contains("clock")) {
+		const int index = clock_selector_->findText(settings.value("clock").toString());
+		if (index > 0)
+			clock_selector_->setCurrentIndex(index);
+	}
+
+	if (settings.contains("symbol_rate"))
+		symbol_rate_spinbox_->setValue(settings.value("symbol_rate").toDouble());
+}
+
+shared_ptr<SignalBase> View::selected_signal(const QComboBox *selector) const
+{
+	void *const sb = selector->currentData().value<void*>();
+	if (!sb)
+		return nullptr;
+
+	for (const shared_ptr<SignalBase>& signalbase : signalbases_)
+		if (signalbase.get() == sb)
+			return signalbase;
+
+	return nullptr;
+}
+
+shared_ptr<AnalogSegment> View::current_analog_segment() const
+{
+	const shared_ptr<SignalBase> signal = selected_signal(signal_selector_);
+	if (!signal)
+		return nullptr;
+
+	const shared_ptr<Analog> analog = signal->analog_data();
+	if (!analog || (current_segment_ >= analog->analog_segments().size()))
+		return nullptr;
+
+	return analog->analog_segments()[current_segment_];
+}
+
+shared_ptr<LogicSegment> View::current_clock_segment() const
+{
+	const shared_ptr<SignalBase> signal = selected_signal(clock_selector_);
+	if (!signal)
+		return nullptr;
+
+	const shared_ptr<Logic> logic = signal->logic_data();
+	if (!logic || (current_segment_ >= logic->logic_segments().size()))
+		return nullptr;
+
+	return logic->logic_segments()[current_segment_];
+}
+
+bool View::value_range_exceeded() const
+{
+	if (!segment_)
+		return false;
+
+	const pair<float, float> min_max = segment_->get_min_max();
+
+	return (min_max.first < min_value_) || (min_max.second > max_value_);
+}
+
+void View::update_accumulation()
+{
+	const shared_ptr<SignalBase> clock = selected_signal(clock_selector_);
+
+	segment_ = current_analog_segment();
+	clock_segment_ = current_clock_segment();
+
+	// The symbol rate only matters when recovering the clock
+	symbol_rate_spinbox_->setEnabled(!clock);
+
+	if (!segment_) {
+		accumulator_.clear();
+		plot_->clear(tr("No analog data"));
+		return;
+	}
+
+	if (clock && !clock_segment_) {
+		accumulator_.clear();
+		plot_->clear(tr("No clock data"));
+		return;
+	}
+
+	// The value range is fixed while accumulating, so leave some room for
+	// values that are yet to be acquired
+	const pair<float, float> min_max = segment_->get_min_max();
+	const float margin = (min_max.second - min_max.first) * ValueMargin;
+	min_value_ = min_max.first - margin;
+	max_value_ = min_max.second + margin;
+
+	if ((segment_->get_sample_count() == 0) || (max_value_ <= min_value_)) {
+		accumulator_.clear();
+		plot_->clear(tr("Waiting for samples"));
+		return;
+	}
+
+	const double symbol_rate = symbol_rate_spinbox_->value();
+	const double symbol_period = (symbol_rate > 0) ?
+		(segment_->samplerate() / symbol_rate) : 0;
+
+	accumulator_.start(segment_, clock_segment_,
+		clock ? clock->logic_bit_index() : 0, symbol_period,
+		min_value_, max_value_);
+
+	plot_->clear(tr("Accumulating..."));
+}
+
+void View::on_settings_changed()
+{
+	update_accumulation();
+}
+
+void View::on_signal_name_changed(const QString &name)
+{
+	SignalBase* sb = qobject_cast<SignalBase*>(QObject::sender());
+	assert(sb);
+
+	const QVariant data = QVariant::fromValue((void*)sb);
+
+	int index = signal_selector_->findData(data);
+	if (index != -1)
+		signal_selector_->setItemText(index, name);
+
+	index = clock_selector_->findData(data);
+	if (index != -1)
+		clock_selector_->setItemText(index, name);
+}
+
+void View::on_histogram_changed()
+{
+	if (!delayed_view_updater_.isActive())
+		delayed_view_updater_.start();
+}
+
+void View::perform_delayed_view_update()
+{
+	// A new acquisition replaces the segments and values outside of the
+	// histogram require a new value range, otherwise only the new samples
+	// need to be accumulated
+	if ((current_analog_segment() != segment_) ||
+		(current_clock_segment() != clock_segment_) || value_range_exceeded())
+		update_accumulation();
+	else if (segment_)
+		accumulator_.notify_samples_added();
+
+	vector<uint32_t> histogram;
+	double symbol_period;
+	const uint64_t sample_count = accumulator_.get_histogram(histogram, symbol_period);
+
+	if ((sample_count > 0) && segment_)
+		plot_->set_histogram(histogram, Accumulator::Width,
+			symbol_period / segment_->samplerate(), min_value_, max_value_,
+			sample_count);
+}
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
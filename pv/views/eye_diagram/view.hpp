@@ -0,0 +1,104 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_VIEW_HPP
+#define PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_VIEW_HPP
+
+#include <QComboBox>
+#include <QDoubleSpinBox>
+
+#include "pv/views/viewbase.hpp"
+
+#include "accumulator.hpp"
+
+namespace pv {
+
+class Session;
+
+namespace data {
+class AnalogSegment;
+class LogicSegment;
+}
+
+namespace views {
+
+namespace eye_diagram {
+
+class Plot;
+
+class View : public ViewBase
+{
+	Q_OBJECT
+
+private:
+	/// The share of the value range that is added above and below it
+	static const float ValueMargin;
+
+public:
+	explicit View(Session &session, bool is_main_view=false, QMainWindow *parent = nullptr);
+
+	virtual ViewType get_type() const;
+
+	/**
+	 * Resets the view to its default state after construction. It does however
+	 * not reset the signal bases or any other connections with the session.
+	 */
+	virtual void reset_view_state();
+
+	virtual void clear_signalbases();
+	virtual void add_signalbase(const shared_ptr<data::SignalBase> signalbase);
+	virtual void remove_signalbase(const shared_ptr<data::SignalBase> signalbase);
+
+	virtual void save_settings(QSettings &settings) const;
+	virtual void restore_settings(QSettings &settings);
+
+private:
+	shared_ptr<data::SignalBase> selected_signal(const QComboBox *selector) const;
+
+	shared_ptr<data::AnalogSegment> current_analog_segment() const;
+	shared_ptr<data::LogicSegment> current_clock_segment() const;
+
+	/// Returns true if the signal exceeds the value range of the histogram
+	bool value_range_exceeded() const;
+
+	/// Restarts the accumulation with the current signals and settings
+	void update_accumulation();
+
+private Q_SLOTS:
+	void on_settings_changed();
+	void on_signal_name_changed(const QString &name);
+	void on_histogram_changed();
+
+	virtual void perform_delayed_view_update();
+
+private:
+	QComboBox *signal_selector_, *clock_selector_;
+	QDoubleSpinBox *symbol_rate_spinbox_;
+	Plot *plot_;
+
+	Accumulator accumulator_;
+
+	shared_ptr<data::AnalogSegment> segment_;
+	shared_ptr<data::LogicSegment> clock_segment_;
+	float min_value_, max_value_;
+};
+
+} // namespace eye_diagram
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_EYE_DIAGRAM_VIEW_HPP
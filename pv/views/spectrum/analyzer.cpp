@@ -0,0 +1,249 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "analyzer.hpp"
+
+#include "pv/data/analogsegment.hpp"
+
+using std::fill;
+using std::lock_guard;
+using std::min;
+using std::unique_lock;
+using std::unique_ptr;
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+const uint32_t Analyzer::PublishInterval = 16;
+
+Analyzer::Analyzer() :
+	params_changed_(false),
+	samples_added_(false),
+	restart_(false),
+	interrupt_(false),
+	result_frame_count_(0),
+	result_samplerate_(0)
+{
+	params_.start_sample = params_.end_sample = 0;
+	params_.fft_size = 0;
+	params_.window = WindowRectangular;
+	params_.averages = 1;
+
+	analysis_thread_ = std::thread(&Analyzer::analysis_proc, this);
+}
+
+Analyzer::~Analyzer()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		interrupt_ = true;
+	}
+	cond_.notify_one();
+
+	analysis_thread_.join();
+}
+
+void Analyzer::set_parameters(shared_ptr<data::AnalogSegment> segment,
+	uint64_t start_sample, uint64_t end_sample, uint32_t fft_size,
+	WindowType window, uint32_t averages)
+{
+	assert(averages > 0);
+
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		if ((segment != params_.segment) || (fft_size != params_.fft_size)) {
+			result_.clear();
+			result_frame_count_ = 0;
+		}
+
+		params_.segment = segment;
+		params_.start_sample = start_sample;
+		params_.end_sample = end_sample;
+		params_.fft_size = fft_size;
+		params_.window = window;
+		params_.averages = averages;
+
+		params_changed_ = true;
+		restart_ = true;
+	}
+	cond_.notify_one();
+}
+
+void Analyzer::clear()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		params_.segment.reset();
+		result_.clear();
+		result_frame_count_ = 0;
+
+		params_changed_ = true;
+		restart_ = true;
+	}
+	cond_.notify_one();
+}
+
+void Analyzer::notify_samples_added()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		samples_added_ = true;
+	}
+	cond_.notify_one();
+}
+
+uint32_t Analyzer::get_spectrum(vector<float> &power, double &samplerate) const
+{
+	lock_guard<mutex> lock(mutex_);
+
+	power = result_;
+	samplerate = result_samplerate_;
+
+	return result_frame_count_;
+}
+
+void Analyzer::publish(const vector<double> &sum, uint32_t frame_count,
+	double samplerate)
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+
+		// Don't overwrite the result with one for outdated parameters
+		if (restart_)
+			return;
+
+		result_.resize(sum.size());
+		for (size_t i = 0; i < sum.size(); i++)
+			result_[i] = sum[i] / frame_count;
+
+		result_frame_count_ = frame_count;
+		result_samplerate_ = samplerate;
+	}
+
+	spectrum_changed();
+}
+
+void Analyzer::analysis_proc()
+{
+	Parameters params;
+	unique_ptr<FFT> fft;
+
+	vector<float> frame, power;
+	vector<double> sum;
+	vector<bool> frame_done;
+	uint32_t frame_count = 0, frames_done = 0;
+
+	while (true) {
+		{
+			unique_lock<mutex> lock(mutex_);
+			cond_.wait(lock, [&] {
+				return interrupt_ || params_changed_ || samples_added_; });
+
+			if (interrupt_)
+				return;
+
+			if (params_changed_) {
+				params = params_;
+				params_changed_ = false;
+				restart_ = false;
+
+				frame_count = 0;
+				frames_done = 0;
+
+				if (params.segment && (params.end_sample > params.start_sample)) {
+					if (!fft || (fft->size() != params.fft_size) ||
+						(fft->window() != params.window))
+						fft.reset(new FFT(params.fft_size, params.window));
+
+					frame.resize(params.fft_size);
+					power.resize(fft->bin_count());
+					sum.assign(fft->bin_count(), 0);
+
+					// A range shorter than a frame is zero-padded, otherwise
+					// there can't be more frames than distinct positions
+					const uint64_t length = params.end_sample - params.start_sample;
+					frame_count = (length < params.fft_size) ? 1 :
+						min<uint64_t>(params.averages, length - params.fft_size + 1);
+					frame_done.assign(frame_count, false);
+				}
+			}
+
+			samples_added_ = false;
+		}
+
+		if (frames_done == frame_count)
+			continue;
+
+		const uint64_t start = params.start_sample;
+		const uint64_t length = params.end_sample - start;
+		const uint32_t size = params.fft_size;
+		const uint32_t prev_frames_done = frames_done;
+
+		for (uint32_t i = 0; (i < frame_count) && !restart_ && !interrupt_; i++) {
+			if (frame_done[i])
+				continue;
+
+			// Query completeness first so that the sample count is final if
+			// the segment is complete
+			const bool complete = params.segment->is_complete();
+			const uint64_t sample_count = params.segment->get_sample_count();
+
+			uint64_t frame_start, frame_end;
+			if (length < size) {
+				frame_start = start;
+				frame_end = params.end_sample;
+
+				// Use what there is once no more samples will arrive
+				if (complete && (frame_end > sample_count))
+					frame_end = sample_count;
+			} else {
+				frame_start = (frame_count > 1) ?
+					start + (length - size) * i / (frame_count - 1) : start;
+				frame_end = frame_start + size;
+			}
+
+			if ((frame_end > sample_count) || (frame_end <= frame_start))
+				continue;
+
+			params.segment->get_samples(frame_start, frame_end, frame.data());
+			fill(frame.begin() + (frame_end - frame_start), frame.end(), 0.0f);
+
+			fft->transform(frame.data(), power.data());
+			for (size_t b = 0; b < power.size(); b++)
+				sum[b] += power[b];
+
+			frame_done[i] = true;
+			frames_done++;
+
+			if ((frames_done % PublishInterval) == 0)
+				publish(sum, frames_done, params.segment->samplerate());
+		}
+
+		if ((frames_done != prev_frames_done) && ((frames_done % PublishInterval) != 0))
+			publish(sum, frames_done, params.segment->samplerate());
+	}
+}
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
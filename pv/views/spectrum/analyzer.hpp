@@ -0,0 +1,129 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_SPECTRUM_ANALYZER_HPP
+#define PULSEVIEW_PV_VIEWS_SPECTRUM_ANALYZER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QObject>
+
+#include "fft.hpp"
+
+using std::atomic;
+using std::condition_variable;
+using std::mutex;
+using std::shared_ptr;
+using std::vector;
+
+namespace pv {
+
+namespace data {
+class AnalogSegment;
+}
+
+namespace views {
+namespace spectrum {
+
+/**
+ * Computes the averaged spectrum of a sample range on a worker thread.
+ *
+ * The averages are taken over frames that are spread evenly across the range.
+ * Frames whose samples haven't been acquired yet are skipped and computed
+ * once notify_samples_added() reports new data, so during an acquisition the
+ * result is refined incrementally instead of being recomputed from scratch.
+ */
+class Analyzer : public QObject
+{
+	Q_OBJECT
+
+private:
+	/// Number of frames after which an intermediate result is published
+	static const uint32_t PublishInterval;
+
+public:
+	Analyzer();
+	~Analyzer();
+
+	/**
+	 * Discards the frames computed so far and starts analyzing the given
+	 * range. The previous result remains available until the first frames
+	 * of the new range are done unless the bins changed.
+	 */
+	void set_parameters(shared_ptr<data::AnalogSegment> segment,
+		uint64_t start_sample, uint64_t end_sample, uint32_t fft_size,
+		WindowType window, uint32_t averages);
+
+	/// Stops the analysis and discards the result
+	void clear();
+
+	/// Wakes up the worker so that it processes frames that became complete
+	void notify_samples_added();
+
+	/**
+	 * Copies the averaged spectrum, see FFT::transform() for the meaning
+	 * of the values.
+	 *
+	 * @return The number of frames that were averaged, 0 if there's no
+	 *         result.
+	 */
+	uint32_t get_spectrum(vector<float> &power, double &samplerate) const;
+
+Q_SIGNALS:
+	void spectrum_changed();
+
+private:
+	struct Parameters {
+		shared_ptr<data::AnalogSegment> segment;
+		uint64_t start_sample, end_sample;
+		uint32_t fft_size;
+		WindowType window;
+		uint32_t averages;
+	};
+
+	void analysis_proc();
+	void publish(const vector<double> &sum, uint32_t frame_count,
+		double samplerate);
+
+private:
+	mutable mutex mutex_;
+	condition_variable cond_;
+
+	Parameters params_;
+	bool params_changed_, samples_added_;
+
+	/// Set when the worker must abandon the frames it is working on
+	atomic<bool> restart_, interrupt_;
+
+	vector<float> result_;
+	uint32_t result_frame_count_;
+	double result_samplerate_;
+
+	std::thread analysis_thread_;
+};
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_SPECTRUM_ANALYZER_HPP
@@ -0,0 +1,198 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <cmath>
+
+#include "fft.hpp"
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+const char* WindowTypeNames[WindowTypeCount] = {
+	"Rectangular",
+	"Hann",
+	"Hamming",
+	"Blackman",
+	"Flat Top"
+};
+
+/**
+ * Combines the two halves of a block. The halves never overlap, which lets
+ * the compiler vectorize the loop without run-time alias checks.
+ */
+static void butterflies(float *__restrict ar, float *__restrict ai,
+	float *__restrict br, float *__restrict bi,
+	const float *__restrict wr, const float *__restrict wi, uint32_t count)
+{
+	for (uint32_t j = 0; j < count; j++) {
+		const float tr = br[j] * wr[j] - bi[j] * wi[j];
+		const float ti = br[j] * wi[j] + bi[j] * wr[j];
+		br[j] = ar[j] - tr;
+		bi[j] = ai[j] - ti;
+		ar[j] += tr;
+		ai[j] += ti;
+	}
+}
+
+const uint32_t FFT::MinSize = 16;
+const uint32_t FFT::MaxSize = 1 << 20;
+
+FFT::FFT(uint32_t size, WindowType window) :
+	size_(size),
+	half_size_(size / 2),
+	window_type_(window),
+	window_gain_(1),
+	re_(size / 2),
+	im_(size / 2)
+{
+	assert((size >= MinSize) && (size <= MaxSize));
+	assert((size & (size - 1)) == 0);
+
+	create_window();
+
+	// Bit reversal permutation of the half-size transform
+	uint32_t bits = 0;
+	while ((1u << bits) < half_size_)
+		bits++;
+
+	bit_reversal_.resize(half_size_);
+	for (uint32_t i = 0; i < half_size_; i++) {
+		uint32_t r = 0;
+		for (uint32_t b = 0; b < bits; b++)
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		bit_reversal_[i] = r;
+	}
+
+	// The twiddle factors are calculated in double precision so that their
+	// rounding errors don't accumulate over the stages
+	twiddle_re_.resize(half_size_);
+	twiddle_im_.resize(half_size_);
+	for (uint32_t h = 1; h < half_size_; h <<= 1)
+		for (uint32_t j = 0; j < h; j++) {
+			const double angle = -M_PI * j / h;
+			twiddle_re_[h + j] = cos(angle);
+			twiddle_im_[h + j] = sin(angle);
+		}
+
+	split_re_.resize(half_size_);
+	split_im_.resize(half_size_);
+	for (uint32_t k = 0; k < half_size_; k++) {
+		const double angle = -2 * M_PI * k / size_;
+		split_re_[k] = cos(angle);
+		split_im_[k] = sin(angle);
+	}
+}
+
+uint32_t FFT::size() const
+{
+	return size_;
+}
+
+WindowType FFT::window() const
+{
+	return window_type_;
+}
+
+uint32_t FFT::bin_count() const
+{
+	return half_size_ + 1;
+}
+
+void FFT::create_window()
+{
+	window_.resize(size_);
+
+	double sum = 0;
+	for (uint32_t n = 0; n < size_; n++) {
+		const double x = 2 * M_PI * n / size_;
+		double w;
+
+		switch (window_type_) {
+		case WindowHann:
+			w = 0.5 - 0.5 * cos(x);
+			break;
+		case WindowHamming:
+			w = 0.54 - 0.46 * cos(x);
+			break;
+		case WindowBlackman:
+			w = 0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x);
+			break;
+		case WindowFlatTop:
+			w = 0.21557895 - 0.41663158 * cos(x) + 0.277263158 * cos(2 * x) -
+				0.083578947 * cos(3 * x) + 0.006947368 * cos(4 * x);
+			break;
+		default:
+			w = 1;
+		}
+
+		window_[n] = w;
+		sum += w;
+	}
+
+	window_gain_ = sum;
+}
+
+void FFT::transform(const float *input, float *power)
+{
+	const uint32_t m = half_size_;
+	float *const re = re_.data();
+	float *const im = im_.data();
+
+	// Pack the even samples into the real and the odd samples into the
+	// imaginary part, in bit-reversed order
+	for (uint32_t n = 0; n < m; n++) {
+		const uint32_t r = bit_reversal_[n];
+		re[r] = input[2 * n] * window_[2 * n];
+		im[r] = input[2 * n + 1] * window_[2 * n + 1];
+	}
+
+	for (uint32_t h = 1; h < m; h <<= 1) {
+		const float *const wr = &twiddle_re_[h];
+		const float *const wi = &twiddle_im_[h];
+
+		for (uint32_t k = 0; k < m; k += 2 * h)
+			butterflies(re + k, im + k, re + k + h, im + k + h, wr, wi, h);
+	}
+
+	// Separate the spectra of the even and odd samples and combine them into
+	// the spectrum of the real frame. The amplitude of bin k is 2|X(k)| / gain,
+	// except for DC and Nyquist which have no negative frequency counterpart.
+	const float dc_scale = 1.0f / (window_gain_ * window_gain_);
+	const float scale = 4 * dc_scale;
+
+	power[0] = (re[0] + im[0]) * (re[0] + im[0]) * dc_scale;
+	power[m] = (re[0] - im[0]) * (re[0] - im[0]) * dc_scale;
+
+	for (uint32_t k = 1; k < m; k++) {
+		const float a = re[k], b = im[k];
+		const float c = re[m - k], d = im[m - k];
+
+		const float even_re = 0.5f * (a + c), even_im = 0.5f * (b - d);
+		const float odd_re = 0.5f * (b + d), odd_im = 0.5f * (c - a);
+
+		const float xr = even_re + split_re_[k] * odd_re - split_im_[k] * odd_im;
+		const float xi = even_im + split_re_[k] * odd_im + split_im_[k] * odd_re;
+
+		power[k] = (xr * xr + xi * xi) * scale;
+	}
+}
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
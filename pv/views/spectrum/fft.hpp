@@ -0,0 +1,107 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_SPECTRUM_FFT_HPP
+#define PULSEVIEW_PV_VIEWS_SPECTRUM_FFT_HPP
+
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+// When adding an entry here, don't forget to update WindowTypeNames as well
+enum WindowType {
+	WindowRectangular,
+	WindowHann,
+	WindowHamming,
+	WindowBlackman,
+	WindowFlatTop,
+	WindowTypeCount  // Indicates how many window types there are, must always be last
+};
+
+extern const char* WindowTypeNames[WindowTypeCount];
+
+/**
+ * Computes the single-sided amplitude spectrum of real-valued frames.
+ *
+ * The frame is packed into a complex sequence of half the length, transformed
+ * by an iterative radix-2 FFT and split into the spectrum of the real input.
+ * Real and imaginary parts are kept in separate arrays and the twiddle factors
+ * of each stage are stored contiguously, so the butterfly loops have unit
+ * stride and are vectorized by the compiler.
+ */
+class FFT
+{
+public:
+	static const uint32_t MinSize;
+	static const uint32_t MaxSize;
+
+public:
+	/**
+	 * @param size The frame size, must be a power of two between MinSize
+	 *        and MaxSize.
+	 * @param window The window that is applied to each frame.
+	 */
+	FFT(uint32_t size, WindowType window);
+
+	uint32_t size() const;
+	WindowType window() const;
+
+	/// Returns the number of bins that transform() produces
+	uint32_t bin_count() const;
+
+	/**
+	 * Windows and transforms a frame of size() samples.
+	 *
+	 * @param input The frame. Missing samples at the end of a partial frame
+	 *        must be zero.
+	 * @param power Receives bin_count() values, each being the squared
+	 *        amplitude of a sinusoid at the bin's frequency, corrected for
+	 *        the coherent gain of the window.
+	 */
+	void transform(const float *input, float *power);
+
+private:
+	void create_window();
+
+private:
+	const uint32_t size_, half_size_;
+	const WindowType window_type_;
+
+	vector<float> window_;
+	float window_gain_;
+
+	vector<uint32_t> bit_reversal_;
+
+	/// Twiddle factors of the butterfly stage with span h start at index h
+	vector<float> twiddle_re_, twiddle_im_;
+
+	/// Twiddle factors used to split the half-size transform
+	vector<float> split_re_, split_im_;
+
+	vector<float> re_, im_;
+};
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_SPECTRUM_FFT_HPP
@@ -0,0 +1,297 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <QFontMetrics>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPolygonF>
+
+#include "plot.hpp"
+
+#include "pv/util.hpp"
+
+using std::max;
+using std::min;
+
+using pv::util::SIPrefix;
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+const float Plot::MinLevel = -200;
+
+/// Returns the number of decimals needed to tell apart values that are
+/// @a step apart when formatted with the given prefix
+static unsigned decimals_for_step(double step, SIPrefix prefix)
+{
+	return max(0, util::exponent(prefix) - (int)floor(log10(step) + 1e-9));
+}
+
+Plot::Plot(QWidget *parent) :
+	QWidget(parent),
+	samplerate_(0),
+	frame_count_(0),
+	color_(palette().color(QPalette::Text)),
+	hover_x_(-1)
+{
+	setMouseTracking(true);
+	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void Plot::set_color(const QColor &color)
+{
+	color_ = color;
+	update();
+}
+
+void Plot::set_spectrum(const vector<float> &power, double samplerate,
+	uint32_t frame_count)
+{
+	levels_.resize(power.size());
+	for (size_t i = 0; i < power.size(); i++)
+		levels_[i] = (power[i] > 0) ? max(10 * log10f(power[i]), MinLevel) : MinLevel;
+
+	samplerate_ = samplerate;
+	frame_count_ = frame_count;
+	message_.clear();
+
+	update();
+}
+
+void Plot::clear(const QString &message)
+{
+	levels_.clear();
+	frame_count_ = 0;
+	message_ = message;
+
+	update();
+}
+
+QSize Plot::sizeHint() const
+{
+	return QSize(600, 300);
+}
+
+QRect Plot::plot_rect() const
+{
+	const QFontMetrics fm(font());
+	const int margin = fm.height() / 2;
+	const int left = util::text_width(fm, "-200 dB") + 2 * margin;
+
+	return QRect(left, fm.height() + margin,
+		max(width() - left - 3 * margin, 1),
+		max(height() - 3 * fm.height() - margin, 1));
+}
+
+double Plot::bin_frequency(size_t bin) const
+{
+	return (levels_.size() > 1) ?
+		(samplerate_ / 2) * bin / (levels_.size() - 1) : 0;
+}
+
+size_t Plot::bin_at(int x) const
+{
+	const QRect rect = plot_rect();
+	const double pos = (double)(x - rect.left()) / rect.width();
+
+	return min(max(lround(pos * (levels_.size() - 1)), 0L),
+		(long)levels_.size() - 1);
+}
+
+void Plot::paintEvent(QPaintEvent *event)
+{
+	(void)event;
+
+	QPainter p(this);
+	p.fillRect(rect(), palette().color(QPalette::Base));
+
+	if (levels_.size() < 2 || (samplerate_ <= 0)) {
+		p.setPen(palette().color(QPalette::Text));
+		p.drawText(rect(), Qt::AlignCenter, message_);
+		return;
+	}
+
+	const QRect area = plot_rect();
+
+	// Show a range of at most 160 dB, aligned to 10 dB
+	const auto minmax = std::minmax_element(levels_.begin(), levels_.end());
+	const float top_level = ceil(*minmax.second / 10) * 10 + 10;
+	const float bottom_level =
+		max(floorf(*minmax.first / 10) * 10, top_level - 160);
+
+	paint_grid(p, area, top_level, bottom_level);
+	paint_spectrum(p, area, top_level, bottom_level);
+	paint_hover_info(p, area);
+}
+
+void Plot::mouseMoveEvent(QMouseEvent *event)
+{
+	hover_x_ = event->pos().x();
+	update();
+}
+
+void Plot::leaveEvent(QEvent *event)
+{
+	(void)event;
+
+	hover_x_ = -1;
+	update();
+}
+
+void Plot::paint_grid(QPainter &p, const QRect &rect, float top_level,
+	float bottom_level) const
+{
+	const QFontMetrics fm(font());
+	const QColor grid_color = palette().color(QPalette::Mid);
+	const QColor text_color = palette().color(QPalette::Text);
+
+	// Level grid, with labels at least two text lines apart
+	const float level_range = top_level - bottom_level;
+	float level_step = 5;
+	while ((level_step < level_range) &&
+		(rect.height() * level_step / level_range < 2 * fm.height()))
+		level_step *= 2;
+
+	for (float level = top_level; level >= bottom_level; level -= level_step) {
+		const int y = rect.top() + (top_level - level) / level_range * rect.height();
+
+		p.setPen(grid_color);
+		p.drawLine(rect.left(), y, rect.right(), y);
+
+		p.setPen(text_color);
+		p.drawText(QRect(0, y - fm.height() / 2, rect.left() - fm.height() / 2,
+			fm.height()), Qt::AlignRight | Qt::AlignVCenter,
+			QString("%1 dB").arg(level));
+	}
+
+	// Frequency grid with a 1-2-5 step, wide enough for the labels
+	const double nyquist = samplerate_ / 2;
+	const SIPrefix prefix = util::determine_value_prefix(nyquist);
+	const int label_width = util::text_width(fm, "000.000 MHz");
+	const int max_divisions = max(rect.width() / label_width, 1);
+
+	const double raw_step = nyquist / max_divisions;
+	const double magnitude = pow(10, floor(log10(raw_step)));
+	double freq_step = magnitude;
+	for (const double m : {1.0, 2.0, 5.0, 10.0})
+		if (m * magnitude >= raw_step) {
+			freq_step = m * magnitude;
+			break;
+		}
+
+	const unsigned decimals = decimals_for_step(freq_step, prefix);
+
+	for (int i = 0; i * freq_step <= nyquist * (1 + 1e-9); i++) {
+		const double freq = i * freq_step;
+		const int x = rect.left() + freq / nyquist * rect.width();
+
+		p.setPen(grid_color);
+		p.drawLine(x, rect.top(), x, rect.bottom());
+
+		p.setPen(text_color);
+		p.drawText(QRect(x - label_width / 2, rect.bottom() + fm.height() / 2,
+			label_width, fm.height()), Qt::AlignHCenter | Qt::AlignTop,
+			util::format_value_si(freq, prefix, decimals, "Hz", false));
+	}
+
+	p.setPen(grid_color);
+	p.drawRect(rect);
+}
+
+void Plot::paint_spectrum(QPainter &p, const QRect &rect, float top_level,
+	float bottom_level) const
+{
+	const float level_range = top_level - bottom_level;
+	const size_t bins = levels_.size();
+
+	const auto to_y = [&](float level) {
+		return rect.top() + (top_level - max(level, bottom_level)) /
+			level_range * rect.height();
+	};
+
+	QPolygonF polygon;
+
+	if (bins <= (size_t)rect.width()) {
+		for (size_t i = 0; i < bins; i++)
+			polygon << QPointF(rect.left() + (double)i / (bins - 1) * rect.width(),
+				to_y(levels_[i]));
+	} else {
+		// Show the peak of all bins that fall onto the same column so that
+		// narrow spectral lines don't disappear
+		for (int x = 0; x < rect.width(); x++) {
+			const size_t first = (uint64_t)x * bins / rect.width();
+			const size_t last = min((uint64_t)(x + 1) * bins / rect.width(),
+				(uint64_t)bins);
+
+			const float peak = *std::max_element(levels_.begin() + first,
+				levels_.begin() + max(last, first + 1));
+
+			polygon << QPointF(rect.left() + x + 0.5, to_y(peak));
+		}
+	}
+
+	p.save();
+	p.setClipRect(rect);
+	p.setRenderHint(QPainter::Antialiasing, true);
+	p.setPen(QPen(color_, 1));
+	p.drawPolyline(polygon);
+	p.restore();
+}
+
+void Plot::paint_hover_info(QPainter &p, const QRect &rect) const
+{
+	const QFontMetrics fm(font());
+	const double nyquist = samplerate_ / 2;
+	const SIPrefix prefix = util::determine_value_prefix(nyquist);
+	const unsigned decimals =
+		decimals_for_step(nyquist / (levels_.size() - 1), prefix) + 1;
+
+	// Show the level under the mouse cursor or, if there's none, the peak
+	size_t bin;
+	QString caption;
+	if ((hover_x_ >= rect.left()) && (hover_x_ <= rect.right())) {
+		bin = bin_at(hover_x_);
+		caption = tr("Cursor");
+
+		const int x = rect.left() + (double)bin / (levels_.size() - 1) * rect.width();
+		p.setPen(QPen(palette().color(QPalette::Text), 1, Qt::DashLine));
+		p.drawLine(x, rect.top(), x, rect.bottom());
+	} else {
+		// Skip DC as an offset would otherwise always be the peak
+		bin = std::max_element(levels_.begin() + 1, levels_.end()) - levels_.begin();
+		caption = tr("Peak");
+	}
+
+	const QString info = QString("%1: %2, %3 dB").arg(caption,
+		util::format_value_si(bin_frequency(bin), prefix, decimals, "Hz", false),
+		QString::number(levels_[bin], 'f', 1));
+
+	p.setPen(palette().color(QPalette::Text));
+	p.drawText(QRect(rect.left(), 0, rect.width(), rect.top()),
+		Qt::AlignLeft | Qt::AlignVCenter, info);
+	p.drawText(QRect(rect.left(), 0, rect.width(), rect.top()),
+		Qt::AlignRight | Qt::AlignVCenter,
+		tr("%n frame(s) averaged", "", frame_count_));
+}
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
@@ -0,0 +1,98 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_SPECTRUM_PLOT_HPP
+#define PULSEVIEW_PV_VIEWS_SPECTRUM_PLOT_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <QColor>
+#include <QRect>
+#include <QString>
+#include <QWidget>
+
+using std::vector;
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+/**
+ * Shows a spectrum as level in dB over a linear frequency axis.
+ */
+class Plot : public QWidget
+{
+	Q_OBJECT
+
+private:
+	/// The lowest level that is shown, in dB
+	static const float MinLevel;
+
+public:
+	explicit Plot(QWidget *parent = nullptr);
+
+	void set_color(const QColor &color);
+
+	/**
+	 * Sets the spectrum to show.
+	 *
+	 * @param power The squared amplitude of each bin, the last bin being at
+	 *        half the sample rate.
+	 * @param frame_count The number of frames the spectrum is averaged over.
+	 */
+	void set_spectrum(const vector<float> &power, double samplerate,
+		uint32_t frame_count);
+
+	/// Removes the spectrum and shows the given message instead
+	void clear(const QString &message = QString());
+
+	QSize sizeHint() const;
+
+protected:
+	void paintEvent(QPaintEvent *event);
+	void mouseMoveEvent(QMouseEvent *event);
+	void leaveEvent(QEvent *event);
+
+private:
+	QRect plot_rect() const;
+
+	double bin_frequency(size_t bin) const;
+	size_t bin_at(int x) const;
+
+	void paint_grid(QPainter &p, const QRect &rect, float top_level,
+		float bottom_level) const;
+	void paint_spectrum(QPainter &p, const QRect &rect, float top_level,
+		float bottom_level) const;
+	void paint_hover_info(QPainter &p, const QRect &rect) const;
+
+private:
+	vector<float> levels_;
+	double samplerate_;
+	uint32_t frame_count_;
+
+	QColor color_;
+	QString message_;
+
+	int hover_x_;
+};
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_SPECTRUM_PLOT_HPP
@@ -0,0 +1,398 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include <QLabel>
+#include <QToolBar>
+#include <QVBoxLayout>
+
+#include "view.hpp"
+#include "plot.hpp"
+
+#include "pv/session.hpp"
+#include "pv/data/analog.hpp"
+#include "pv/data/analogsegment.hpp"
+#include "pv/data/signalbase.hpp"
+
+using pv::data::Analog;
+using pv::data::AnalogSegment;
+using pv::data::SignalBase;
+
+using std::max;
+using std::min;
+using std::shared_ptr;
+
+namespace pv {
+namespace views {
+namespace spectrum {
+
+const char* RangeTypeNames[RangeTypeCount] = {
+	"Visible range",
+	"Cursor range"
+};
+
+const uint32_t View::DefaultFFTSize = 4096;
+const int View::MaxAverages = 256;
+
+
+View::View(Session &session, bool is_main_view, QMainWindow *parent) :
+	ViewBase(session, is_main_view, parent),
+
+	// Note: Place defaults in View::reset_view_state(), not here
+	signal_selector_(new QComboBox()),
+	range_selector_(new QComboBox()),
+	size_selector_(new QComboBox()),
+	window_selector_(new QComboBox()),
+	averages_spinbox_(new QSpinBox()),
+	plot_(new Plot()),
+	segment_complete_(false)
+{
+	QVBoxLayout *root_layout = new QVBoxLayout(this);
+	root_layout->setContentsMargins(0, 0, 0, 0);
+	root_layout->addWidget(plot_);
+
+	// Create toolbar
+	QToolBar* toolbar = new QToolBar();
+	toolbar->setContextMenuPolicy(Qt::PreventContextMenu);
+	parent->addToolBar(toolbar);
+
+	// Populate toolbar
+	toolbar->addWidget(new QLabel(tr("Signal:")));
+	toolbar->addWidget(signal_selector_);
+	toolbar->addWidget(range_selector_);
+	toolbar->addSeparator();
+	toolbar->addWidget(new QLabel(tr("FFT size:")));
+	toolbar->addWidget(size_selector_);
+	toolbar->addWidget(new QLabel(tr("Window:")));
+	toolbar->addWidget(window_selector_);
+	toolbar->addWidget(new QLabel(tr("Averages:")));
+	toolbar->addWidget(averages_spinbox_);
+
+	// Add selector entries
+	for (int i = 0; i < RangeTypeCount; i++)
+		range_selector_->addItem(tr(RangeTypeNames[i]), QVariant::fromValue(i));
+
+	for (uint32_t size = 256; size <= 65536; size *= 2)
+		size_selector_->addItem(QString::number(size), QVariant::fromValue(size));
+
+	for (int i = 0; i < WindowTypeCount; i++)
+		window_selector_->addItem(tr(WindowTypeNames[i]), QVariant::fromValue(i));
+
+	averages_spinbox_->setRange(1, MaxAverages);
+
+	// Configure widgets
+	signal_selector_->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+	range_selector_->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+
+	connect(signal_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_selected_signal_changed(int)));
+	connect(range_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_analysis_settings_changed()));
+	connect(size_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_analysis_settings_changed()));
+	connect(window_selector_, SIGNAL(currentIndexChanged(int)),
+		this, SLOT(on_analysis_settings_changed()));
+	connect(averages_spinbox_, SIGNAL(valueChanged(int)),
+		this, SLOT(on_analysis_settings_changed()));
+
+	connect(&analyzer_, SIGNAL(spectrum_changed()),
+		this, SLOT(on_spectrum_changed()));
+
+	parent->setSizePolicy(plot_->sizePolicy());
+
+	// Set up metadata event handler
+	session_.metadata_obj_manager()->add_observer(this);
+
+	reset_view_state();
+}
+
+View::~View()
+{
+	session_.metadata_obj_manager()->remove_observer(this);
+}
+
+ViewType View::get_type() const
+{
+	return ViewTypeSpectrum;
+}
+
+void View::reset_view_state()
+{
+	ViewBase::reset_view_state();
+
+	range_selector_->setCurrentIndex(RangeVisible);
+	size_selector_->setCurrentIndex(
+		size_selector_->findData(QVariant::fromValue(DefaultFFTSize)));
+	window_selector_->setCurrentIndex(WindowHann);
+	averages_spinbox_->setValue(1);
+
+	update_analysis();
+}
+
+void View::clear_signalbases()
+{
+	for (const shared_ptr<SignalBase>& signalbase : signalbases_) {
+		disconnect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+			this, SLOT(on_signal_name_changed(const QString&)));
+		disconnect(signalbase.get(), SIGNAL(color_changed(const QColor&)),
+			this, SLOT(on_signal_color_changed(const QColor&)));
+	}
+
+	ViewBase::clear_signalbases();
+
+	signal_selector_->clear();
+}
+
+void View::add_signalbase(const shared_ptr<SignalBase> signalbase)
+{
+	ViewBase::add_signalbase(signalbase);
+
+	// Only signals with analog data can be analyzed
+	if ((signalbase->type() != SignalBase::AnalogChannel) &&
+		(signalbase->type() != SignalBase::MathChannel))
+		return;
+
+	connect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+		this, SLOT(on_signal_name_changed(const QString&)));
+	connect(signalbase.get(), SIGNAL(color_changed(const QColor&)),
+		this, SLOT(on_signal_color_changed(const QColor&)));
+
+	signal_selector_->addItem(signalbase->name(),
+		QVariant::fromValue((void*)signalbase.get()));
+}
+
+void View::remove_signalbase(const shared_ptr<SignalBase> signalbase)
+{
+	disconnect(signalbase.get(), SIGNAL(name_changed(const QString&)),
+		this, SLOT(on_signal_name_changed(const QString&)));
+	disconnect(signalbase.get(), SIGNAL(color_changed(const QColor&)),
+		this, SLOT(on_signal_color_changed(const QColor&)));
+
+	ViewBase::remove_signalbase(signalbase);
+
+	// If this is the selected signal, another one will be selected
+	const int index =
+		signal_selector_->findData(QVariant::fromValue((void*)signalbase.get()));
+	if (index != -1)
+		signal_selector_->removeItem(index);
+}
+
+void View::save_settings(QSettings &settings) const
+{
+	ViewBase::save_settings(settings);
+
+	settings.setValue("signal", signal_selector_->currentText());
+	settings.setValue("range", range_selector_->currentIndex());
+	settings.setValue("fft_size", size_selector_->currentData());
+	settings.setValue("window", window_selector_->currentIndex());
+	settings.setValue("averages", averages_spinbox_->value());
+}
+
+void View::restore_settings(QSettings &settings)
+{
+	ViewBase::restore_settings(settings);
+
+	if (settings.contains("signal")) {
+		const int index = signal_selector_->findText(settings.value("signal").toString());
+		if (index != -1)
+			signal_selector_->setCurrentIndex(index);
+	}
+
+	if (settings.contains("range"))
+		range_selector_->setCurrentIndex(settings.value("range").toInt());
+
+	if (settings.contains("fft_size")) {
+		const int index = size_selector_->findData(
+			QVariant::fromValue(settings.value("fft_size").toUInt()));
+		if (index != -1)
+			size_selector_->setCurrentIndex(index);
+	}
+
+	if (settings.contains("window"))
+		window_selector_->setCurrentIndex(settings.value("window").toInt());
+
+	if (settings.contains("averages"))
+		averages_spinbox_->setValue(settings.value("averages").toInt());
+}
+
+shared_ptr<AnalogSegment> View::current_analog_segment() const
+{
+	if (!signal_)
+		return nullptr;
+
+	const shared_ptr<Analog> analog = signal_->analog_data();
+	if (!analog)
+		return nullptr;
+
+	const auto &segments = analog->analog_segments();
+	if (current_segment_ >= segments.size())
+		return nullptr;
+
+	return segments[current_segment_];
+}
+
+bool View::get_sample_range(uint64_t &start_sample, uint64_t &end_sample) const
+{
+	const MetadataObjectType obj_type =
+		(range_selector_->currentIndex() == RangeCursors) ?
+		MetadataObjSelection : MetadataObjMainViewRange;
+
+	MetadataObject *md_obj =
+		session_.metadata_obj_manager()->find_object_by_type(obj_type);
+	if (!md_obj)
+		return false;
+
+	const QVariant start = md_obj->value(MetadataValueStartSample);
+	const QVariant end = md_obj->value(MetadataValueEndSample);
+	if (!start.isValid() || !end.isValid())
+		return false;
+
+	// The visible range may begin before the first sample
+	start_sample = max(start.toLongLong(), 0LL);
+	end_sample = max(end.toLongLong(), 0LL);
+
+	return end_sample > start_sample;
+}
+
+void View::update_analysis()
+{
+	const shared_ptr<AnalogSegment> segment = current_analog_segment();
+
+	// Don't keep showing the spectrum of different data
+	if (segment != segment_)
+		plot_->clear();
+
+	segment_ = segment;
+
+	if (!segment_) {
+		analyzer_.clear();
+		plot_->clear(tr("No analog data"));
+		return;
+	}
+
+	uint64_t start_sample, end_sample;
+	if (!get_sample_range(start_sample, end_sample)) {
+		analyzer_.clear();
+		plot_->clear((range_selector_->currentIndex() == RangeCursors) ?
+			tr("Show the cursors in the main view to select a range") :
+			tr("No sample range"));
+		return;
+	}
+
+	// Once the segment is complete, frames outside of it can be dropped
+	segment_complete_ = segment_->is_complete();
+	if (segment_complete_)
+		end_sample = min(end_sample, segment_->get_sample_count());
+
+	if (end_sample <= start_sample) {
+		analyzer_.clear();
+		plot_->clear(tr("The range contains no samples"));
+		return;
+	}
+
+	analyzer_.set_parameters(segment_, start_sample, end_sample,
+		size_selector_->currentData().toUInt(),
+		(WindowType)window_selector_->currentIndex(),
+		averages_spinbox_->value());
+}
+
+void View::on_selected_signal_changed(int index)
+{
+	// Index is -1 if there are no signals left
+	void *const sb = signal_selector_->itemData(index).value<void*>();
+
+	signal_.reset();
+	for (const shared_ptr<SignalBase>& signalbase : signalbases_)
+		if (signalbase.get() == sb)
+			signal_ = signalbase;
+
+	if (signal_)
+		plot_->set_color(signal_->color());
+
+	update_analysis();
+}
+
+void View::on_analysis_settings_changed()
+{
+	update_analysis();
+}
+
+void View::on_signal_name_changed(const QString &name)
+{
+	SignalBase* sb = qobject_cast<SignalBase*>(QObject::sender());
+	assert(sb);
+
+	const int index = signal_selector_->findData(QVariant::fromValue((void*)sb));
+	if (index != -1)
+		signal_selector_->setItemText(index, name);
+}
+
+void View::on_signal_color_changed(const QColor &color)
+{
+	SignalBase* sb = qobject_cast<SignalBase*>(QObject::sender());
+	assert(sb);
+
+	if (sb == signal_.get())
+		plot_->set_color(color);
+}
+
+void View::on_spectrum_changed()
+{
+	if (!delayed_view_updater_.isActive())
+		delayed_view_updater_.start();
+}
+
+void View::on_metadata_object_changed(MetadataObject* obj,
+	MetadataValueType value_type)
+{
+	// The start sample value is updated first, so we only need to act
+	// on the end sample value
+	if (value_type != MetadataValueEndSample)
+		return;
+
+	const int range = range_selector_->currentIndex();
+
+	if (((obj->type() == MetadataObjMainViewRange) && (range == RangeVisible)) ||
+		((obj->type() == MetadataObjSelection) && (range == RangeCursors)))
+		update_analysis();
+}
+
+void View::perform_delayed_view_update()
+{
+	// A new acquisition replaces the segment and a completed segment allows
+	// the range to be clipped, otherwise only new frames need to be processed
+	const shared_ptr<AnalogSegment> segment = current_analog_segment();
+
+	if ((segment != segment_) ||
+		(segment_ && !segment_complete_ && segment_->is_complete()))
+		update_analysis();
+	else if (segment_)
+		analyzer_.notify_samples_added();
+
+	vector<float> power;
+	double samplerate;
+	const uint32_t frame_count = analyzer_.get_spectrum(power, samplerate);
+
+	if (frame_count > 0)
+		plot_->set_spectrum(power, samplerate, frame_count);
+}
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
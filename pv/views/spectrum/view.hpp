@@ -0,0 +1,118 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_PV_VIEWS_SPECTRUM_VIEW_HPP
+#define PULSEVIEW_PV_VIEWS_SPECTRUM_VIEW_HPP
+
+#include <QComboBox>
+#include <QSpinBox>
+
+#include "pv/metadata_obj.hpp"
+#include "pv/views/viewbase.hpp"
+
+#include "analyzer.hpp"
+
+namespace pv {
+
+class Session;
+
+namespace data {
+class AnalogSegment;
+}
+
+namespace views {
+
+namespace spectrum {
+
+class Plot;
+
+// When adding an entry here, don't forget to update RangeTypeNames as well
+enum RangeType {
+	RangeVisible,
+	RangeCursors,
+	RangeTypeCount  // Indicates how many range types there are, must always be last
+};
+
+extern const char* RangeTypeNames[RangeTypeCount];
+
+
+class View : public ViewBase, public MetadataObjObserverInterface
+{
+	Q_OBJECT
+
+private:
+	static const uint32_t DefaultFFTSize;
+	static const int MaxAverages;
+
+public:
+	explicit View(Session &session, bool is_main_view=false, QMainWindow *parent = nullptr);
+	~View();
+
+	virtual ViewType get_type() const;
+
+	/**
+	 * Resets the view to its default state after construction. It does however
+	 * not reset the signal bases or any other connections with the session.
+	 */
+	virtual void reset_view_state();
+
+	virtual void clear_signalbases();
+	virtual void add_signalbase(const shared_ptr<data::SignalBase> signalbase);
+	virtual void remove_signalbase(const shared_ptr<data::SignalBase> signalbase);
+
+	virtual void save_settings(QSettings &settings) const;
+	virtual void restore_settings(QSettings &settings);
+
+private:
+	shared_ptr<data::AnalogSegment> current_analog_segment() const;
+
+	/// Determines the sample range to analyze, returns false if there is none
+	bool get_sample_range(uint64_t &start_sample, uint64_t &end_sample) const;
+
+	/// Restarts the analysis with the current signal, range and settings
+	void update_analysis();
+
+private Q_SLOTS:
+	void on_selected_signal_changed(int index);
+	void on_analysis_settings_changed();
+	void on_signal_name_changed(const QString &name);
+	void on_signal_color_changed(const QColor &color);
+	void on_spectrum_changed();
+
+	virtual void on_metadata_object_changed(MetadataObject* obj,
+		MetadataValueType value_type);
+
+	virtual void perform_delayed_view_update();
+
+private:
+	QComboBox *signal_selector_, *range_selector_, *size_selector_,
+		*window_selector_;
+	QSpinBox *averages_spinbox_;
+	Plot *plot_;
+
+	Analyzer analyzer_;
+
+	shared_ptr<data::SignalBase> signal_;
+	shared_ptr<data::AnalogSegment> segment_;
+	bool segment_complete_;
+};
+
+} // namespace spectrum
+} // namespace views
+} // namespace pv
+
+#endif // PULSEVIEW_PV_VIEWS_SPECTRUM_VIEW_HPP
@@ -29,6 +29,7 @@
 #include "pv/globalsettings.hpp"
 
 using std::make_shared;
+using std::min;
 
 using pv::util::Timestamp;
 using pv::util::format_time_si;
@@ -46,7 +47,8 @@ AnnotationCollectionModel::AnnotationCollectionModel(QObject* parent) :
 	signal_(nullptr),
 	first_hidden_column_(0),
 	prev_segment_(0),
-	prev_last_row_(0),
+	source_row_count_(0),
+	row_count_(0),
 	had_highlight_before_(false),
 	hide_hidden_(false)
 {
@@ -184,7 +186,7 @@ QModelIndex AnnotationCollectionModel::index(int row, int column,
 
 	QModelIndex idx;
 
-	if ((size_t)row < dataset_->size())
+	if (((uint64_t)row < row_count_) && ((size_t)row < dataset_->size()))
 		idx = createIndex(row, column, (void*)dataset_->at(row));
 
 	return idx;
@@ -201,10 +203,7 @@ int AnnotationCollectionModel::rowCount(const QModelIndex& parent_idx) const
 {
 	(void)parent_idx;
 
-	if (!dataset_)
-		return 0;
-
-	return dataset_->size();
+	return row_count_;
 }
 
 int AnnotationCollectionModel::columnCount(const QModelIndex& parent_idx) const
@@ -216,15 +215,14 @@ int AnnotationCollectionModel::columnCount(const QModelIndex& parent_idx) const
 
 void AnnotationCollectionModel::set_signal_and_segment(data::DecodeSignal* signal, uint32_t current_segment)
 {
-	layoutAboutToBeChanged();
-
-	if (!signal) {
-		all_annotations_ = nullptr;
-		dataset_ = nullptr;
-		signal_ = nullptr;
-
-		dataChanged(QModelIndex(), QModelIndex());
-		layoutChanged();
+	const deque<const Annotation*>* all_annotations =
+		signal ? signal->get_all_annotations_by_segment(current_segment) : nullptr;
+
+	// New annotations of the same data source are published incrementally so
+	// that the views and the proxy model only need to process those
+	if (all_annotations && (signal == signal_) && (current_segment == prev_segment_) &&
+		(all_annotations == all_annotations_)) {
+		update_dataset();
 		return;
 	}
 
@@ -232,84 +230,114 @@ void AnnotationCollectionModel::set_signal_and_segment(data::DecodeSignal* signa
 		for (const shared_ptr<Decoder>& dec : signal_->decoder_stack())
 			disconnect(dec.get(), nullptr, this, SLOT(on_annotation_visibility_changed()));
 
-	all_annotations_ = signal->get_all_annotations_by_segment(current_segment);
 	signal_ = signal;
+	all_annotations_ = all_annotations;
+	prev_segment_ = current_segment;
+
+	if (signal_)
+		for (const shared_ptr<Decoder>& dec : signal_->decoder_stack())
+			connect(dec.get(), SIGNAL(annotation_visibility_changed()),
+				this, SLOT(on_annotation_visibility_changed()));
+
+	reset_dataset();
+}
 
-	for (const shared_ptr<Decoder>& dec : signal_->decoder_stack())
-		connect(dec.get(), SIGNAL(annotation_visibility_changed()),
-			this, SLOT(on_annotation_visibility_changed()));
+void AnnotationCollectionModel::set_hide_hidden(bool hide_hidden)
+{
+	hide_hidden_ = hide_hidden;
+
+	reset_dataset();
+}
+
+void AnnotationCollectionModel::reset_dataset()
+{
+	beginResetModel();
+
+	all_annotations_without_hidden_.clear();
+	without_hidden_source_rows_.clear();
+
+	source_row_count_ = all_annotations_ ? all_annotations_->size() : 0;
 
 	if (hide_hidden_) {
-		update_annotations_without_hidden();
+		append_annotations_without_hidden(0);
 		dataset_ = &all_annotations_without_hidden_;
 	} else
 		dataset_ = all_annotations_;
 
-	if (!dataset_ || dataset_->empty()) {
-		prev_segment_ = current_segment;
+	row_count_ = dataset_ ? min((uint64_t)dataset_->size(), source_row_count_) : 0;
+
+	endResetModel();
+}
+
+void AnnotationCollectionModel::update_dataset()
+{
+	if (!signal_ || !all_annotations_)
 		return;
-	}
 
-	const size_t new_row_count = dataset_->size() - 1;
-
-	// Force the view associated with this model to update when the segment changes
-	if (prev_segment_ != current_segment) {
-		dataChanged(index(0, 0), index(new_row_count, 0));
-		layoutChanged();
-	} else {
-		// Force the view associated with this model to update when we have more annotations
-		if (prev_last_row_ < new_row_count) {
-			dataChanged(index(prev_last_row_, 0), index(new_row_count, 0));
-			layoutChanged();
-		}
+	uint64_t source_count;
+	const uint64_t first_changed = signal_->get_first_changed_annotation_index(
+		prev_segment_, source_row_count_, source_count);
+
+	if (source_count < source_row_count_) {
+		// The annotations were cleared, which we should've been told about
+		reset_dataset();
+		return;
 	}
 
-	prev_segment_ = current_segment;
-	prev_last_row_ = new_row_count;
-}
+	if (first_changed == source_count)
+		return;
 
-void AnnotationCollectionModel::set_hide_hidden(bool hide_hidden)
-{
-	layoutAboutToBeChanged();
+	source_row_count_ = source_count;
 
-	hide_hidden_ = hide_hidden;
+	uint64_t first_changed_row = first_changed;
+	uint64_t new_row_count = source_count;
 
 	if (hide_hidden_) {
-		dataset_ = &all_annotations_without_hidden_;
-		update_annotations_without_hidden();
-	} else {
-		dataset_ = all_annotations_;
-		all_annotations_without_hidden_.clear();  // To conserve memory
+		// Filter the changed part of the source rows again
+		size_t keep = without_hidden_source_rows_.size();
+		while ((keep > 0) && (without_hidden_source_rows_[keep - 1] >= first_changed))
+			keep--;
+
+		all_annotations_without_hidden_.resize(keep);
+		without_hidden_source_rows_.resize(keep);
+		append_annotations_without_hidden(first_changed);
+
+		first_changed_row = keep;
+		new_row_count = all_annotations_without_hidden_.size();
+	}
+
+	if (new_row_count < row_count_) {
+		beginRemoveRows(QModelIndex(), new_row_count, row_count_ - 1);
+		row_count_ = new_row_count;
+		endRemoveRows();
 	}
 
-	if (dataset_)
-		dataChanged(index(0, 0), index(dataset_->size() - 1, 0));
-	else
-		dataChanged(QModelIndex(), QModelIndex());
+	// Existing rows may have been shifted by annotations inserted before them
+	if (first_changed_row < row_count_)
+		dataChanged(index(first_changed_row, 0),
+			index(row_count_ - 1, columnCount() - 1));
 
-	layoutChanged();
+	if (new_row_count > row_count_) {
+		beginInsertRows(QModelIndex(), row_count_, new_row_count - 1);
+		row_count_ = new_row_count;
+		endInsertRows();
+	}
 }
 
-void AnnotationCollectionModel::update_annotations_without_hidden()
+void AnnotationCollectionModel::append_annotations_without_hidden(
+	uint64_t first_source_row)
 {
-	uint64_t count = 0;
-
-	if (!all_annotations_ || all_annotations_->empty()) {
-		all_annotations_without_hidden_.clear();
+	if (!all_annotations_)
 		return;
-	}
 
-	for (const Annotation* ann : *all_annotations_) {
+	for (uint64_t i = first_source_row; i < source_row_count_; i++) {
+		const Annotation* ann = (*all_annotations_)[i];
 		if (!ann->visible())
 			continue;
 
-		if (all_annotations_without_hidden_.size() < (count + 100))
-			all_annotations_without_hidden_.resize(count + 100);
-
-		all_annotations_without_hidden_[count++] = ann;
+		all_annotations_without_hidden_.push_back(ann);
+		without_hidden_source_rows_.push_back(i);
 	}
-
-	all_annotations_without_hidden_.resize(count);
 }
 
 QModelIndex AnnotationCollectionModel::update_highlighted_rows(QModelIndex first,
@@ -358,16 +386,7 @@ void AnnotationCollectionModel::on_annotation_visibility_changed()
 	if (!hide_hidden_)
 		return;
 
-	layoutAboutToBeChanged();
-
-	update_annotations_without_hidden();
-
-	if (dataset_)
-		dataChanged(index(0, 0), index(dataset_->size() - 1, 0));
-	else
-		dataChanged(QModelIndex(), QModelIndex());
-
-	layoutChanged();
+	reset_dataset();
 }
 
 } // namespace tabular_decoder
@@ -79,13 +79,15 @@ bool CustomFilterProxyModel::filterAcceptsRow(int sourceRow,
 	bool result = true;
 
 	if (range_filtering_enabled_) {
-		const QModelIndex ann_start_sample_idx = sourceModel()->index(sourceRow, 0);
-		const uint64_t ann_start_sample =
-			sourceModel()->data(ann_start_sample_idx, Qt::DisplayRole).toULongLong();
-
-		const QModelIndex ann_end_sample_idx = sourceModel()->index(sourceRow, 6);
-		const uint64_t ann_end_sample =
-			sourceModel()->data(ann_end_sample_idx, Qt::DisplayRole).toULongLong();
+		// Read the annotation directly, going through data() and QVariant
+		// is needlessly slow for the many rows of a live decode
+		const QModelIndex ann_idx = sourceModel()->index(sourceRow, 0);
+		const Annotation* ann = static_cast<const Annotation*>(ann_idx.internalPointer());
+		if (!ann)
+			return false;
+
+		const uint64_t ann_start_sample = ann->start_sample();
+		const uint64_t ann_end_sample = ann->end_sample();
 
 		// We consider all annotations as visible that either
 		// a) begin to the left of the range and end within the range or
@@ -81,13 +81,26 @@ public:
 	int rowCount(const QModelIndex& parent_idx = QModelIndex()) const override;
 	int columnCount(const QModelIndex& parent_idx = QModelIndex()) const override;
 
+	/**
+	 * Sets the data source. If it didn't change, only the annotations that
+	 * were added since the last call are published to the views.
+	 */
 	void set_signal_and_segment(data::DecodeSignal* signal, uint32_t current_segment);
 	void set_hide_hidden(bool hide_hidden);
 
-	void update_annotations_without_hidden();
 	QModelIndex update_highlighted_rows(QModelIndex first, QModelIndex last,
 		int64_t sample_num);
 
+private:
+	/// Rebuilds the data set from scratch, resetting the model
+	void reset_dataset();
+
+	/// Publishes the changes of the data set since the last update
+	void update_dataset();
+
+	/// Adds the visible annotations starting at the given source row
+	void append_annotations_without_hidden(uint64_t first_source_row);
+
 private Q_SLOTS:
 	void on_annotation_visibility_changed();
 
@@ -95,11 +108,13 @@ private:
 	vector<QVariant> header_data_;
 	const deque<const Annotation*>* all_annotations_;
 	deque<const Annotation*> all_annotations_without_hidden_;
+	deque<uint64_t> without_hidden_source_rows_;  ///< Index in all_annotations_
 	const deque<const Annotation*>* dataset_;
 	data::DecodeSignal* signal_;
 	uint8_t first_hidden_column_;
 	uint32_t prev_segment_;
-	uint64_t prev_last_row_;
+	uint64_t source_row_count_;  ///< Number of entries of all_annotations_ published
+	uint64_t row_count_;         ///< Number of rows published to the views
 	int64_t highlight_sample_num_;
 	bool had_highlight_before_;
 	bool hide_hidden_;
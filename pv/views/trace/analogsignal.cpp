@@ -37,6 +37,7 @@
 #include "analogsignal.hpp"
 #include "logicsignal.hpp"
 #include "view.hpp"
+#include "viewport.hpp"
 
 #include "pv/util.hpp"
 #include "pv/data/analog.hpp"
@@ -99,18 +100,23 @@ const int AnalogSignal::InfoTextMarginBottom = 5;
 AnalogSignal::AnalogSignal(pv::Session &session, shared_ptr<data::SignalBase> base) :
 	LogicSignal(session, base),
 	value_at_hover_pos_(std::numeric_limits<float>::quiet_NaN()),
+	visible_start_sample_(0),
+	visible_end_sample_(0),
 	scale_index_(4), // 20 per div
 	pos_vdivs_(1),
 	neg_vdivs_(1),
 	resolution_(0),
 	display_type_(DisplayAnalog),
-	autoranging_(true)
+	autoranging_(true),
+	fit_visible_range_(false)
 {
 	axis_pen_ = AxisPen;
 
 	pv::data::Analog* analog_data =
 		dynamic_cast<pv::data::Analog*>(base_->analog_data().get());
 
+	connect(analog_data, SIGNAL(samples_added(SharedPtrToSegment, uint64_t, uint64_t)),
+		this, SLOT(on_samples_added()));
 	connect(analog_data, SIGNAL(min_max_changed(float, float)),
 		this, SLOT(on_min_max_changed(float, float)));
 
@@ -131,6 +137,23 @@ AnalogSignal::AnalogSignal(pv::Session &session, shared_ptr<data::SignalBase> ba
 	update_scale();
 }
 
+void AnalogSignal::set_owner(TraceTreeItemOwner *owner)
+{
+	LogicSignal::set_owner(owner);
+
+	if (!owner)
+		return;
+
+	// Autoranging to the visible samples follows the view
+	View *view = owner->view();
+	connect(view, SIGNAL(offset_changed()),
+		this, SLOT(on_visible_range_changed()), Qt::UniqueConnection);
+	connect(view, SIGNAL(scale_changed()),
+		this, SLOT(on_visible_range_changed()), Qt::UniqueConnection);
+	connect(view, SIGNAL(segment_changed(int)),
+		this, SLOT(on_visible_range_changed()), Qt::UniqueConnection);
+}
+
 std::map<QString, QVariant> AnalogSignal::save_settings() const
 {
 	LogicSignal::save_settings();
@@ -142,6 +165,7 @@ std::map<QString, QVariant> AnalogSignal::save_settings() const
 	result["scale_index"] = scale_index_;
 	result["display_type"] = display_type_;
 	result["autoranging"] = autoranging_;
+	result["fit_visible_range"] = fit_visible_range_;
 	result["div_height"] = div_height_;
 
 	return result;
@@ -173,6 +197,10 @@ void AnalogSignal::restore_settings(std::map<QString, QVariant> settings)
 	if (entry != settings.end())
 		autoranging_ = settings["autoranging"].toBool();
 
+	entry = settings.find("fit_visible_range");
+	if (entry != settings.end())
+		fit_visible_range_ = settings["fit_visible_range"].toBool();
+
 	entry = settings.find("div_height");
 	if (entry != settings.end()) {
 		const int old_height = div_height_;
@@ -298,6 +326,17 @@ void AnalogSignal::paint_fore(QPainter &p, ViewItemPaintParams &pp)
 	if (!enabled())
 		return;
 
+	if ((display_type_ == DisplayConverted) || (display_type_ == DisplayBoth))
+		LogicSignal::paint_fore(p, pp);
+}
+
+void AnalogSignal::paint_overlay(QPainter &p, ViewItemPaintParams &pp)
+{
+	if (!enabled())
+		return;
+
+	LogicSignal::paint_overlay(p, pp);
+
 	if ((display_type_ == DisplayAnalog) || (display_type_ == DisplayBoth)) {
 		const int y = get_visual_y();
 
@@ -328,13 +367,7 @@ void AnalogSignal::paint_fore(QPainter &p, ViewItemPaintParams &pp)
 				v_extents().second - v_extents().first - InfoTextMarginBottom);
 
 		p.drawText(bounding_rect, Qt::AlignRight | Qt::AlignBottom, infotext);
-
-		if (show_hover_marker_)
-			paint_hover_marker(p);
 	}
-
-	if ((display_type_ == DisplayConverted) || (display_type_ == DisplayBoth))
-		LogicSignal::paint_fore(p, pp);
 }
 
 void AnalogSignal::paint_grid(QPainter &p, int y, int left, int right)
@@ -558,6 +591,49 @@ shared_ptr<pv::data::AnalogSegment> AnalogSignal::get_analog_segment_to_paint()
 	return segment;
 }
 
+bool AnalogSignal::update_visible_range()
+{
+	const shared_ptr<pv::data::AnalogSegment> segment = get_analog_segment_to_paint();
+	if (!owner_ || !segment || (segment->get_sample_count() == 0))
+		return false;
+
+	// Determine the samples that paint_mid() shows
+	const View *view = owner_->view();
+	const double samplerate = max(1.0, segment->samplerate());
+	const int64_t last_sample = (int64_t)segment->get_sample_count() - 1;
+	const double samples_per_pixel = samplerate * view->scale();
+	const pv::util::Timestamp start =
+		samplerate * (view->offset() - segment->start_time());
+	const pv::util::Timestamp end =
+		start + samples_per_pixel * view->viewport()->width();
+
+	const int64_t start_sample = min(max(floor(start).convert_to<int64_t>(),
+		(int64_t)0), last_sample);
+	const int64_t end_sample = min(max((ceil(end) + 1).convert_to<int64_t>(),
+		(int64_t)0), last_sample) + 1;
+
+	if ((start_sample == visible_start_sample_) && (end_sample == visible_end_sample_))
+		return false;
+
+	visible_start_sample_ = start_sample;
+	visible_end_sample_ = end_sample;
+
+	return true;
+}
+
+void AnalogSignal::autorange_visible_range()
+{
+	if (!autoranging_ || !fit_visible_range_ || !update_visible_range())
+		return;
+
+	// The range query is cheap enough to do this on every pan
+	const int old_scale_index = scale_index_;
+	perform_autoranging(true, false);
+
+	if (owner_ && (scale_index_ != old_scale_index))
+		owner_->row_item_appearance_changed(false, true);
+}
+
 float AnalogSignal::get_resolution(int scale_index)
 {
 	const float seq[] = {1.0f, 2.0f, 5.0f};
@@ -671,10 +747,21 @@ void AnalogSignal::perform_autoranging(bool keep_divs, bool force_update)
 
 	double min = 0, max = 0;
 
-	for (const shared_ptr<pv::data::AnalogSegment>& segment : segments) {
-		pair<double, double> mm = segment->get_min_max();
+	const shared_ptr<pv::data::AnalogSegment> visible_segment =
+		fit_visible_range_ ? get_analog_segment_to_paint() : nullptr;
+
+	if (visible_segment && (visible_start_sample_ < visible_end_sample_) &&
+		(visible_end_sample_ <= (int64_t)visible_segment->get_sample_count())) {
+		pair<double, double> mm = visible_segment->get_min_max(
+			visible_start_sample_, visible_end_sample_);
 		min = std::min(min, mm.first);
 		max = std::max(max, mm.second);
+	} else {
+		for (const shared_ptr<pv::data::AnalogSegment>& segment : segments) {
+			pair<double, double> mm = segment->get_min_max();
+			min = std::min(min, mm.first);
+			max = std::max(max, mm.second);
+		}
 	}
 
 	if ((min == signal_min_) && (max == signal_max_) && !force_update)
@@ -852,6 +939,14 @@ void AnalogSignal::populate_popup_form(QWidget *parent, QFormLayout *form)
 
 	form->addRow(tr("Autoranging"), autoranging_cb);
 
+	QCheckBox* fit_visible_range_cb = new QCheckBox();
+	fit_visible_range_cb->setCheckState(fit_visible_range_ ? Qt::Checked : Qt::Unchecked);
+
+	connect(fit_visible_range_cb, SIGNAL(stateChanged(int)),
+		this, SLOT(on_fit_visible_range_changed(int)));
+
+	form->addRow(tr("Autorange to visible range"), fit_visible_range_cb);
+
 	// Add the conversion type dropdown
 	conversion_cb_ = new QComboBox();
 
@@ -941,6 +1036,17 @@ void AnalogSignal::on_setting_changed(const QString &key, const QVariant &value)
 	}
 }
 
+void AnalogSignal::on_samples_added()
+{
+	// New samples may show up in the visible range
+	autorange_visible_range();
+}
+
+void AnalogSignal::on_visible_range_changed()
+{
+	autorange_visible_range();
+}
+
 void AnalogSignal::on_min_max_changed(float min, float max)
 {
 	if (autoranging_)
@@ -1060,6 +1166,19 @@ void AnalogSignal::on_autoranging_changed(int state)
 	}
 }
 
+void AnalogSignal::on_fit_visible_range_changed(int state)
+{
+	fit_visible_range_ = (state == Qt::Checked);
+
+	update_visible_range();
+
+	if (autoranging_)
+		perform_autoranging(false, true);
+
+	if (owner_)
+		owner_->row_item_appearance_changed(false, true);
+}
+
 void AnalogSignal::on_conversion_changed(int index)
 {
 	SignalBase::ConversionType old_conv_type = base_->get_conversion_type();
@@ -74,6 +74,8 @@ private:
 public:
 	AnalogSignal(pv::Session &session, shared_ptr<data::SignalBase> base);
 
+	virtual void set_owner(TraceTreeItemOwner *owner);
+
 	virtual std::map<QString, QVariant> save_settings() const;
 	virtual void restore_settings(std::map<QString, QVariant> settings);
 
@@ -104,6 +106,14 @@ public:
 	 */
 	virtual void paint_fore(QPainter &p, ViewItemPaintParams &pp);
 
+	/**
+	 * Paints the overlay layer of the item, i.e. the hover marker and
+	 * the info text with the value at the hover point.
+	 * @param p the QPainter to paint into.
+	 * @param pp the painting parameters object to paint with.
+	 */
+	virtual void paint_overlay(QPainter &p, ViewItemPaintParams &pp);
+
 private:
 	void paint_grid(QPainter &p, int y, int left, int right);
 
@@ -140,6 +150,15 @@ private:
 
 	void perform_autoranging(bool keep_divs, bool force_update);
 
+	/**
+	 * Determines the samples that are visible with the current view
+	 * offset and scale. Returns true if they changed.
+	 */
+	bool update_visible_range();
+
+	/// Autoranges to the visible samples if they changed and it's enabled
+	void autorange_visible_range();
+
 	void reset_pixel_values();
 	void process_next_sample_value(float x, float value);
 
@@ -151,7 +170,9 @@ protected:
 private Q_SLOTS:
 	virtual void on_setting_changed(const QString &key, const QVariant &value);
 
+	void on_samples_added();
 	void on_min_max_changed(float min, float max);
+	void on_visible_range_changed();
 
 	void on_pos_vdivs_changed(int vdivs);
 	void on_neg_vdivs_changed(int vdivs);
@@ -160,6 +181,7 @@ private Q_SLOTS:
 	void on_resolution_changed(int index);
 
 	void on_autoranging_changed(int state);
+	void on_fit_visible_range_changed(int state);
 
 	void on_conversion_changed(int index);
 	void on_conv_threshold_changed(int index=-1);
@@ -186,6 +208,9 @@ private:
 	float min_value_at_pixel_, max_value_at_pixel_;  // Only used during lookup table update
 	int current_pixel_pos_;  // Only used during lookup table update
 
+	// The sample range [start, end) that is visible in the view
+	int64_t visible_start_sample_, visible_end_sample_;
+
 	// ---------------------------------------------------------------------------
 	// Note: Make sure to update save_settings() and restore_settings() when
 	//       adding a trace-configurable variable here
@@ -198,6 +223,7 @@ private:
 
 	DisplayType display_type_;
 	bool autoranging_;
+	bool fit_visible_range_;  // Autorange to the visible samples only
 };
 
 } // namespace trace
@@ -39,6 +39,7 @@
 #include <QMenu>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QSpinBox>
 #include <QTextStream>
 #include <QToolTip>
 
@@ -54,6 +55,7 @@
 #include <pv/data/decode/decoder.hpp>
 #include <pv/data/logic.hpp>
 #include <pv/data/logicsegment.hpp>
+#include <pv/dialogs/decodersweep.hpp>
 #include <pv/widgets/decodergroupbox.hpp>
 #include <pv/widgets/decodermenu.hpp>
 #include <pv/widgets/flowlayout.hpp>
@@ -95,6 +97,31 @@ const int DecodeTrace::MaxTraceUpdateRate = 1; // No more than 1 Hz
 const int DecodeTrace::AnimationDurationInTicks = 7;
 const int DecodeTrace::HiddenRowHideDelay = 1000; // 1 second
 
+/**
+ * Reads the sample range of the main view or the cursors from the
+ * respective metadata object. Returns false if the range is unavailable
+ * or empty.
+ */
+static bool get_metadata_sample_range(Session &session, MetadataObjectType obj_type,
+	uint64_t &start_sample, uint64_t &end_sample)
+{
+	MetadataObject *md_obj =
+		session.metadata_obj_manager()->find_object_by_type(obj_type);
+	if (!md_obj)
+		return false;
+
+	const QVariant start = md_obj->value(MetadataValueStartSample);
+	const QVariant end = md_obj->value(MetadataValueEndSample);
+	if (!start.isValid() || !end.isValid())
+		return false;
+
+	// The range may begin before the first sample
+	start_sample = max(start.toLongLong(), 0LL);
+	end_sample = max(end.toLongLong(), 0LL);
+
+	return end_sample > start_sample;
+}
+
 /**
  * Helper function for forceUpdate()
  */
@@ -285,10 +312,6 @@ void DecodeTrace::paint_mid(QPainter &p, ViewItemPaintParams &pp)
 	lock_guard<mutex> lock(row_modification_mutex_);
 	unsigned int visible_rows;
 
-#if DECODETRACE_SHOW_RENDER_TIME
-	render_time_.restart();
-#endif
-
 	// Set default pen to allow for text width calculation
 	p.setPen(Qt::black);
 
@@ -347,10 +370,6 @@ void DecodeTrace::paint_mid(QPainter &p, ViewItemPaintParams &pp)
 	const QString err = base_->get_error_message();
 	if (!err.isEmpty())
 		paint_error(p, pp);
-
-#if DECODETRACE_SHOW_RENDER_TIME
-	qDebug() << "Rendering" << base_->name() << "took" << render_time_.elapsed() << "ms";
-#endif
 }
 
 void DecodeTrace::paint_fore(QPainter &p, ViewItemPaintParams &pp)
@@ -404,9 +423,6 @@ void DecodeTrace::paint_fore(QPainter &p, ViewItemPaintParams &pp)
 
 		y += r.height;
 	}
-
-	if (show_hover_marker_)
-		paint_hover_marker(p);
 }
 
 void DecodeTrace::update_stack_button()
@@ -467,6 +483,20 @@ void DecodeTrace::populate_popup_form(QWidget *parent, QFormLayout *form)
 			tr("<i>* Required channels</i>"), parent));
 	}
 
+	// Add the decode range pre-roll
+	QSpinBox *const preroll_sb = new QSpinBox(parent);
+	preroll_sb->setRange(0, numeric_limits<int>::max());
+	preroll_sb->setSingleStep(1000);
+	preroll_sb->setSuffix(tr(" samples"));
+	preroll_sb->setKeyboardTracking(false);
+	preroll_sb->setValue((int)min(decode_signal_->decode_preroll(),
+		(uint64_t)numeric_limits<int>::max()));
+	preroll_sb->setToolTip(tr("Number of samples decoded ahead of a restricted "
+		"decode range so that the decoders can synchronize"));
+	connect(preroll_sb, SIGNAL(valueChanged(int)),
+		this, SLOT(on_decode_preroll_changed(int)));
+	form->addRow(tr("Decode range pre-roll"), preroll_sb);
+
 	// Add stacking button
 	stack_button_ = new QPushButton(tr("Stack Decoder"), parent);
 	stack_button_->setToolTip(tr("Stack a higher-level decoder on top of this one"));
@@ -539,6 +569,32 @@ QMenu* DecodeTrace::create_view_context_menu(QWidget *parent, QPoint &click_pos)
 		menu->addAction(pause);
 	}
 
+	QAction *const decode_cursor_range =
+		new QAction(tr("Decode only within cursor range"), this);
+	connect(decode_cursor_range, SIGNAL(triggered()), this, SLOT(on_decode_cursor_range()));
+	menu->addAction(decode_cursor_range);
+
+	QAction *const decode_visible_range =
+		new QAction(tr("Decode only the visible range"), this);
+	connect(decode_visible_range, SIGNAL(triggered()), this, SLOT(on_decode_visible_range()));
+	menu->addAction(decode_visible_range);
+
+	QAction *const decode_all =
+		new QAction(tr("Decode everything"), this);
+	connect(decode_all, SIGNAL(triggered()), this, SLOT(on_decode_all()));
+	menu->addAction(decode_all);
+
+	if (!view->cursors()->enabled())
+		decode_cursor_range->setEnabled(false);
+
+	if (!decode_signal_->has_decode_range())
+		decode_all->setEnabled(false);
+
+	QAction *const sweep_option =
+		new QAction(tr("Find best decoder option..."), this);
+	connect(sweep_option, SIGNAL(triggered()), this, SLOT(on_sweep_option()));
+	menu->addAction(sweep_option);
+
 	QAction *const copy_annotation_to_clipboard =
 		new QAction(tr("Copy annotation text to clipboard"), this);
 	copy_annotation_to_clipboard->setIcon(QIcon::fromTheme("edit-paste",
@@ -616,8 +672,14 @@ void DecodeTrace::hover_point_changed(const QPoint &hp)
 	DecodeTraceRow* hover_row = get_row_at_point(hp);
 
 	// Row expansion marker handling
-	for (DecodeTraceRow& r : rows_)
+	const DecodeTraceRow* prev_highlighted_row = nullptr;
+	for (DecodeTraceRow& r : rows_) {
+		if (r.expand_marker_highlighted)
+			prev_highlighted_row = &r;
 		r.expand_marker_highlighted = false;
+	}
+
+	const bool prev_show_hidden_rows = show_hidden_rows_;
 
 	if (hover_row) {
 		const pair<int, int> extents = v_extents();
@@ -633,6 +695,14 @@ void DecodeTrace::hover_point_changed(const QPoint &hp)
 		}
 	}
 
+	// The expansion markers aren't part of the overlay, so repaint the
+	// trace content if their state changed
+	const DecodeTraceRow* highlighted_row =
+		(hover_row && hover_row->expand_marker_highlighted) ? hover_row : nullptr;
+	if ((highlighted_row != prev_highlighted_row) ||
+		(show_hidden_rows_ != prev_show_hidden_rows))
+		owner_->row_item_appearance_changed(false, true);
+
 	// Tooltip handling
 	if (hp.x() > 0) {
 		QString ann = get_annotation_at_point(hp);
@@ -933,27 +1003,43 @@ void DecodeTrace::draw_unresolved_period(QPainter &p, int left, int right) const
 		return;
 
 	const int64_t samples_decoded = decode_signal_->get_decoded_sample_count(current_segment_, true);
-	if (sample_count == samples_decoded)
+
+	// Samples before the decode range aren't decoded either
+	const int64_t range_start = decode_signal_->has_decode_range() ?
+		min((int64_t)decode_signal_->decode_range_start(), sample_count) : 0;
+
+	if ((sample_count == samples_decoded) && (range_start == 0))
 		return;
 
 	const int y = get_visual_y();
 
 	tie(pixels_offset, samples_per_pixel) = get_pixels_offset_samples_per_pixel();
 
-	const double start = max(samples_decoded /
-		samples_per_pixel - pixels_offset, left - 1.0);
-	const double end = min(sample_count / samples_per_pixel -
-		pixels_offset, right + 1.0);
-	const QRectF no_decode_rect(start, y - (annotation_height_ / 2) - 0.5,
-		end - start, annotation_height_);
+	const auto draw_period = [&](int64_t start_sample, int64_t end_sample) {
+		const double start = max(start_sample /
+			samples_per_pixel - pixels_offset, left - 1.0);
+		const double end = min(end_sample / samples_per_pixel -
+			pixels_offset, right + 1.0);
+		if (end <= start)
+			return;
+
+		const QRectF no_decode_rect(start, y - (annotation_height_ / 2) - 0.5,
+			end - start, annotation_height_);
+
+		p.setPen(QPen(Qt::NoPen));
+		p.setBrush(Qt::white);
+		p.drawRect(no_decode_rect);
+
+		p.setPen(NoDecodeColor);
+		p.setBrush(QBrush(NoDecodeColor, Qt::Dense6Pattern));
+		p.drawRect(no_decode_rect);
+	};
 
-	p.setPen(QPen(Qt::NoPen));
-	p.setBrush(Qt::white);
-	p.drawRect(no_decode_rect);
+	if (range_start > 0)
+		draw_period(0, range_start);
 
-	p.setPen(NoDecodeColor);
-	p.setBrush(QBrush(NoDecodeColor, Qt::Dense6Pattern));
-	p.drawRect(no_decode_rect);
+	if (sample_count > samples_decoded)
+		draw_period(samples_decoded, sample_count);
 }
 
 pair<double, double> DecodeTrace::get_pixels_offset_samples_per_pixel() const
@@ -1194,60 +1280,12 @@ void DecodeTrace::export_annotations(deque<const Annotation*>& annotations) cons
 	if (file_name.isEmpty())
 		return;
 
-	QString format = settings.value(GlobalSettings::Key_Dec_ExportFormat).toString();
-	const QString quote = format.contains("%q") ? "\"" : "";
-	format = format.remove("%q");
-
-	const bool has_sample_range   = format.contains("%s");
-	const bool has_row_name       = format.contains("%r");
-	const bool has_dec_name       = format.contains("%d");
-	const bool has_class_name     = format.contains("%c");
-	const bool has_first_ann_text = format.contains("%1");
-	const bool has_all_ann_text   = format.contains("%a");
-
 	QFile file(file_name);
 	if (file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
 		QTextStream out_stream(&file);
 
-		for (const Annotation* ann : annotations) {
-			QString out_text = format;
-
-			if (has_sample_range) {
-				const QString sample_range = QString("%1-%2") \
-					.arg(QString::number(ann->start_sample()), QString::number(ann->end_sample()));
-				out_text = out_text.replace("%s", sample_range);
-			}
-
-			if (has_dec_name)
-				out_text = out_text.replace("%d",
-					quote + QString::fromUtf8(ann->row()->decoder()->name()) + quote);
-
-			if (has_row_name) {
-				const QString row_name = quote + ann->row()->description() + quote;
-				out_text = out_text.replace("%r", row_name);
-			}
-
-			if (has_class_name) {
-				const QString class_name = quote + ann->ann_class_name() + quote;
-				out_text = out_text.replace("%c", class_name);
-			}
-
-			if (has_first_ann_text) {
-				const QString first_ann_text = quote + ann->annotations()->front() + quote;
-				out_text = out_text.replace("%1", first_ann_text);
-			}
-
-			if (has_all_ann_text) {
-				QString all_ann_text;
-				for (const QString &s : *(ann->annotations()))
-					all_ann_text = all_ann_text + quote + s + quote + ",";
-				all_ann_text.chop(1);
-
-				out_text = out_text.replace("%a", all_ann_text);
-			}
-
-			out_stream << out_text << '\n';
-		}
+		DecodeSignal::export_annotations(out_stream, annotations,
+			settings.value(GlobalSettings::Key_Dec_ExportFormat).toString());
 
 		if (out_stream.status() == QTextStream::Ok)
 			return;
@@ -1344,6 +1382,16 @@ void DecodeTrace::initialize_row_widgets(DecodeTraceRow* r, unsigned int row_id)
 	btn->setProperty("decode_trace_row_ptr", QVariant::fromValue((void*)r));
 	connect(btn, SIGNAL(clicked(bool)), this, SLOT(on_hide_all_classes()));
 
+	cb = new QCheckBox();
+	r->record_hidden_checkbox = cb;
+	header_container_layout->addWidget(cb);
+	cb->setText(tr("Record hidden classes"));
+	cb->setToolTip(tr("When unchecked, annotations of hidden classes are discarded "
+		"while decoding to save memory and time"));
+	cb->setChecked(!r->decode_row->has_unrecorded_classes());
+	cb->setProperty("decode_trace_row_ptr", QVariant::fromValue((void*)r));
+	connect(cb, SIGNAL(toggled(bool)), this, SLOT(on_record_hidden_classes(bool)));
+
 	header_container_layout->addStretch(); // To left-align the header widgets
 
 	// Add selector container
@@ -1436,6 +1484,7 @@ void DecodeTrace::update_rows()
 		for (unsigned int i = 0; i < rows_.size(); i++)
 			if (!rows_[i].exists) {
 				delete rows_[i].row_visibility_checkbox;
+				delete rows_[i].record_hidden_checkbox;
 
 				for (QCheckBox* cb : rows_[i].selectors)
 					delete cb;
@@ -1552,6 +1601,49 @@ void DecodeTrace::on_pause_decode()
 		decode_signal_->pause_decode();
 }
 
+void DecodeTrace::on_decode_cursor_range()
+{
+	uint64_t start_sample, end_sample;
+	if (get_metadata_sample_range(session_, MetadataObjSelection,
+		start_sample, end_sample))
+		decode_signal_->set_decode_range(start_sample, end_sample);
+}
+
+void DecodeTrace::on_decode_visible_range()
+{
+	uint64_t start_sample, end_sample;
+	if (get_metadata_sample_range(session_, MetadataObjMainViewRange,
+		start_sample, end_sample))
+		decode_signal_->set_decode_range(start_sample, end_sample);
+}
+
+void DecodeTrace::on_decode_all()
+{
+	decode_signal_->clear_decode_range();
+}
+
+void DecodeTrace::on_sweep_option()
+{
+	// Try the values within the cursor range if there is one, as that is
+	// usually where the user suspects a problem
+	uint64_t start_sample, end_sample;
+	if (!(owner_->view()->cursors()->enabled() &&
+		get_metadata_sample_range(session_, MetadataObjSelection,
+			start_sample, end_sample)) &&
+		!get_metadata_sample_range(session_, MetadataObjMainViewRange,
+			start_sample, end_sample))
+		return;
+
+	dialogs::DecoderSweep dlg(decode_signal_, current_segment_,
+		start_sample, end_sample, owner_->view());
+	dlg.exec();
+}
+
+void DecodeTrace::on_decode_preroll_changed(int value)
+{
+	decode_signal_->set_decode_preroll(value);
+}
+
 void DecodeTrace::on_delete()
 {
 	session_.remove_decode_signal(decode_signal_);
@@ -1653,19 +1745,50 @@ void DecodeTrace::on_show_hide_class(QWidget* sender)
 
 	row->has_hidden_classes = row->decode_row->has_hidden_classes();
 
+	// Visible classes are always recorded
+	if (ann_class->visible() || !row->record_hidden_checkbox->isChecked())
+		decode_signal_->set_ann_classes_recorded({ann_class}, ann_class->visible());
+
 	owner_->row_item_appearance_changed(false, true);
 }
 
+vector<AnnotationClass*> DecodeTrace::set_row_classes_visible(DecodeTraceRow* r,
+	bool visible)
+{
+	vector<AnnotationClass*> changed_classes;
+
+	for (QCheckBox* cb : r->selectors) {
+		AnnotationClass* ann_class =
+			(AnnotationClass*)cb->property("ann_class_ptr").value<void*>();
+		assert(ann_class);
+
+		// The check box signals are blocked so that the decode isn't
+		// restarted for every single class by on_show_hide_class()
+		const bool was_blocked = cb->blockSignals(true);
+		cb->setChecked(visible);
+		cb->blockSignals(was_blocked);
+
+		if (ann_class->visible() != visible) {
+			ann_class->set_visible(visible);
+			changed_classes.push_back(ann_class);
+		}
+	}
+
+	r->has_hidden_classes = r->decode_row->has_hidden_classes();
+
+	return changed_classes;
+}
+
 void DecodeTrace::on_show_all_classes()
 {
 	void* row_ptr = QObject::sender()->property("decode_trace_row_ptr").value<void*>();
 	assert(row_ptr);
 	DecodeTraceRow* row = (DecodeTraceRow*)row_ptr;
 
-	for (QCheckBox* cb : row->selectors)
-		cb->setChecked(true);
+	const vector<AnnotationClass*> changed_classes = set_row_classes_visible(row, true);
 
-	row->has_hidden_classes = false;
+	// Visible classes are always recorded
+	decode_signal_->set_ann_classes_recorded(changed_classes, true);
 
 	owner_->row_item_appearance_changed(false, true);
 }
@@ -1676,14 +1799,28 @@ void DecodeTrace::on_hide_all_classes()
 	assert(row_ptr);
 	DecodeTraceRow* row = (DecodeTraceRow*)row_ptr;
 
-	for (QCheckBox* cb : row->selectors)
-		cb->setChecked(false);
+	const vector<AnnotationClass*> changed_classes = set_row_classes_visible(row, false);
 
-	row->has_hidden_classes = true;
+	if (!row->record_hidden_checkbox->isChecked())
+		decode_signal_->set_ann_classes_recorded(changed_classes, false);
 
 	owner_->row_item_appearance_changed(false, true);
 }
 
+void DecodeTrace::on_record_hidden_classes(bool record)
+{
+	void* row_ptr = QObject::sender()->property("decode_trace_row_ptr").value<void*>();
+	assert(row_ptr);
+	DecodeTraceRow* row = (DecodeTraceRow*)row_ptr;
+
+	vector<AnnotationClass*> hidden_classes;
+	for (AnnotationClass* ann_class : row->decode_row->ann_classes())
+		if (!ann_class->visible())
+			hidden_classes.push_back(ann_class);
+
+	decode_signal_->set_ann_classes_recorded(hidden_classes, record);
+}
+
 void DecodeTrace::on_row_container_resized(QWidget* sender)
 {
 	sender->update();
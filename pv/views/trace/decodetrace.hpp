@@ -31,7 +31,6 @@
 #include <QColor>
 #include <QComboBox>
 #include <QCheckBox>
-#include <QElapsedTimer>
 #include <QPolygon>
 #include <QPushButton>
 #include <QSignalMapper>
@@ -43,8 +42,6 @@
 #include <pv/data/decode/row.hpp>
 #include <pv/data/signalbase.hpp>
 
-#define DECODETRACE_SHOW_RENDER_TIME 0
-
 using std::deque;
 using std::list;
 using std::map;
@@ -55,6 +52,7 @@ using std::vector;
 
 using pv::data::SignalBase;
 using pv::data::decode::Annotation;
+using pv::data::decode::AnnotationClass;
 using pv::data::decode::Decoder;
 using pv::data::decode::Row;
 
@@ -99,6 +97,7 @@ struct DecodeTraceRow {
 	QWidget* header_container;
 	QWidget* selector_container;
 	QCheckBox* row_visibility_checkbox;
+	QCheckBox* record_hidden_checkbox;
 	vector<QCheckBox*> selectors;
 };
 
@@ -253,6 +252,13 @@ private:
 
 	void update_expanded_rows();
 
+	/**
+	 * Shows or hides all annotation classes of row r at once and returns
+	 * the classes that changed
+	 */
+	vector<AnnotationClass*> set_row_classes_visible(DecodeTraceRow* r,
+		bool visible);
+
 private Q_SLOTS:
 	void on_setting_changed(const QString &key, const QVariant &value);
 
@@ -263,6 +269,11 @@ private Q_SLOTS:
 	void on_decode_reset();
 	void on_decode_finished();
 	void on_pause_decode();
+	void on_decode_cursor_range();
+	void on_decode_visible_range();
+	void on_decode_all();
+	void on_sweep_option();
+	void on_decode_preroll_changed(int value);
 
 	void on_delete();
 
@@ -285,6 +296,7 @@ private Q_SLOTS:
 #endif
 	void on_show_all_classes();
 	void on_hide_all_classes();
+	void on_record_hidden_classes(bool record);
 	void on_row_container_resized(QWidget* sender);
 
 	void on_copy_annotation_to_clipboard();
@@ -328,10 +340,6 @@ private:
 	QTimer delayed_trace_updater_, animation_timer_, delayed_hidden_row_hider_;
 
 	QPolygon default_marker_shape_;
-
-#if DECODETRACE_SHOW_RENDER_TIME
-	QElapsedTimer render_time_;
-#endif
 };
 
 } // namespace trace
@@ -341,9 +341,6 @@ void LogicSignal::paint_fore(QPainter &p, ViewItemPaintParams &pp)
 				break;
 			}
 		}
-
-		if (show_hover_marker_)
-			paint_hover_marker(p);
 	}
 }
 
@@ -290,10 +290,9 @@ int Trace::get_current_segment() const
 
 void Trace::hover_point_changed(const QPoint &hp)
 {
+	// The hover marker is painted in the overlay, which the view
+	// repaints by itself
 	(void)hp;
-
-	if (owner_)
-		owner_->row_item_appearance_changed(false, true);
 }
 
 void Trace::paint_back(QPainter &p, ViewItemPaintParams &pp)
@@ -338,6 +337,14 @@ void Trace::add_color_option(QWidget *parent, QFormLayout *form)
 	form->addRow(tr("Color"), color_button);
 }
 
+void Trace::paint_overlay(QPainter &p, ViewItemPaintParams &pp)
+{
+	(void)pp;
+
+	if (show_hover_marker_ && base_->enabled())
+		paint_hover_marker(p);
+}
+
 void Trace::paint_hover_marker(QPainter &p)
 {
 	const View *view = owner_->view();
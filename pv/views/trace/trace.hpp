@@ -170,6 +170,13 @@ protected:
 	 */
 	virtual void paint_back(QPainter &p, ViewItemPaintParams &pp);
 
+	/**
+	 * Paints the overlay layer of the trace, i.e. the hover marker.
+	 * @param p The QPainter to paint into.
+	 * @param pp The painting parameters object to paint with.
+	 */
+	virtual void paint_overlay(QPainter &p, ViewItemPaintParams &pp);
+
 	/**
 	 * Paints a zero axis across the viewport.
 	 * @param p the QPainter to paint into.
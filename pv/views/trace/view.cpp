@@ -188,6 +188,7 @@ View::View(Session &session, bool is_main_view, QMainWindow *parent) :
 	if (is_main_view) {
 		session_.metadata_obj_manager()->create_object(MetadataObjMainViewRange);
 		session_.metadata_obj_manager()->create_object(MetadataObjMousePos);
+		session_.metadata_obj_manager()->create_object(MetadataObjSelection);
 	}
 
 	// Set up UI event handlers
@@ -455,7 +456,7 @@ void View::remove_trace(shared_ptr<Trace> trace)
 	update_layout();
 
 	header_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 shared_ptr<Signal> View::get_signal_under_mouse_cursor() const
@@ -658,14 +659,14 @@ void View::set_v_offset(int offset)
 {
 	scrollarea_->verticalScrollBar()->setSliderPosition(offset);
 	header_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 void View::set_h_offset(int offset)
 {
 	scrollarea_->horizontalScrollBar()->setSliderPosition(offset);
 	header_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 int View::get_h_scrollbar_maximum() const
@@ -760,7 +761,7 @@ void View::set_current_segment(uint32_t segment_id)
 	if (!custom_zero_offset_set_)
 		reset_zero_position();
 
-	viewport_->update();
+	viewport_->invalidate_frame();
 
 	segment_changed(segment_id);
 }
@@ -816,7 +817,7 @@ void View::set_segment_display_mode(Trace::SegmentDisplayMode mode)
 	if ((mode == Trace::ShowAllSegments) || (mode == Trace::ShowAccumulatedIntensity))
 		segment_selectable_ = false;
 
-	viewport_->update();
+	viewport_->invalidate_frame();
 
 	segment_display_mode_changed((int)mode, segment_selectable_);
 }
@@ -911,7 +912,7 @@ void View::set_scale_offset(double scale, const Timestamp& offset)
 
 	update_scroll();
 	ruler_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 vector< shared_ptr<SignalData> > View::get_visible_data() const
@@ -976,8 +977,9 @@ void View::show_cursors(bool show)
 		show_cursors_ = show;
 
 		cursor_state_changed(show);
+		update_cursor_range_metaobject();
 		ruler_->update();
-		viewport_->update();
+		viewport_->invalidate_frame();
 	}
 }
 
@@ -989,7 +991,7 @@ void View::set_cursors(pv::util::Timestamp& first, pv::util::Timestamp& second)
 	cursors_->second()->set_time(second);
 
 	ruler_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 void View::center_cursors()
@@ -1001,7 +1003,7 @@ void View::center_cursors()
 	cursors_->second()->set_time(offset_ + time_width * 0.6);
 
 	ruler_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 shared_ptr<CursorPair> View::cursors() const
@@ -1183,12 +1185,12 @@ void View::on_setting_changed(const QString &key, const QVariant &value)
 
 	if (key == GlobalSettings::Key_View_ColoredBG) {
 		colored_bg_ = settings.value(GlobalSettings::Key_View_ColoredBG).toBool();
-		viewport_->update();
+		viewport_->invalidate_frame();
 	}
 
 	if ((key == GlobalSettings::Key_View_ShowSamplingPoints) ||
 	   (key == GlobalSettings::Key_View_ShowAnalogMinorGrid))
-		viewport_->update();
+		viewport_->invalidate_frame();
 
 	if (key == GlobalSettings::Key_View_TriggerIsZeroTime)
 		on_settingViewTriggerIsZeroTime_changed(value);
@@ -1652,6 +1654,36 @@ void View::update_view_range_metaobject() const
 	}
 }
 
+void View::update_cursor_range_metaobject() const
+{
+	if (!is_main_view_ || !cursors_)
+		return;
+
+	MetadataObject* md_obj =
+		session_.metadata_obj_manager()->find_object_by_type(MetadataObjSelection);
+
+	// The range is invalid while the cursors are hidden
+	QVariant start_sample, end_sample;
+	if (show_cursors_) {
+		const double samplerate = session_.get_samplerate();
+		const int64_t first =
+			(cursors_->first()->time() * samplerate).convert_to<int64_t>();
+		const int64_t second =
+			(cursors_->second()->time() * samplerate).convert_to<int64_t>();
+
+		start_sample = QVariant((qlonglong)min(first, second));
+		end_sample = QVariant((qlonglong)max(first, second));
+	}
+
+	if ((start_sample == md_obj->value(MetadataValueStartSample)) &&
+		(end_sample == md_obj->value(MetadataValueEndSample)))
+		return;
+
+	// Always set both values, observers act on the end sample
+	md_obj->set_value(MetadataValueStartSample, start_sample);
+	md_obj->set_value(MetadataValueEndSample, end_sample);
+}
+
 void View::update_hover_point()
 {
 	// Determine signal that the mouse cursor is hovering over
@@ -1673,6 +1705,10 @@ void View::update_hover_point()
 	for (const shared_ptr<TraceTreeItem>& r : trace_tree_items)
 		r->hover_point_changed(hover_point_);
 
+	// Only the overlay depends on the hover point, the trace content
+	// doesn't need to be painted again
+	viewport_->update_overlay();
+
 	// Notify this view's listeners
 	hover_point_changed(hover_widget_, hover_point_);
 
@@ -1693,11 +1729,13 @@ void View::row_item_appearance_changed(bool label, bool content)
 	if (label)
 		header_->update();
 	if (content)
-		viewport_->update();
+		viewport_->invalidate_frame();
 }
 
 void View::time_item_appearance_changed(bool label, bool content)
 {
+	update_cursor_range_metaobject();
+
 	if (label) {
 		ruler_->update();
 
@@ -1706,7 +1744,7 @@ void View::time_item_appearance_changed(bool label, bool content)
 	}
 
 	if (content)
-		viewport_->update();
+		viewport_->invalidate_frame();
 }
 
 void View::extents_changed(bool horz, bool vert)
@@ -1777,13 +1815,13 @@ void View::h_scroll_value_changed(int value)
 	}
 
 	ruler_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 void View::v_scroll_value_changed()
 {
 	header_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 void View::on_grab_ruler(int ruler_id)
@@ -1985,7 +2023,7 @@ void View::signals_changed()
 	update_layout();
 
 	header_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 
 	if (reset_scrollbar)
 		set_scroll_default();
@@ -2117,7 +2155,7 @@ void View::perform_delayed_view_update()
 	determine_time_unit();
 	update_scroll();
 	ruler_->update();
-	viewport_->update();
+	viewport_->invalidate_frame();
 }
 
 void View::process_sticky_events()
@@ -421,6 +421,7 @@ private:
 	void resizeEvent(QResizeEvent *event);
 
 	void update_view_range_metaobject() const;
+	void update_cursor_range_metaobject() const;
 	void update_hover_point();
 
 public:
@@ -143,6 +143,12 @@ void ViewItem::paint_fore(QPainter &p, ViewItemPaintParams &pp)
 	(void)pp;
 }
 
+void ViewItem::paint_overlay(QPainter &p, ViewItemPaintParams &pp)
+{
+	(void)p;
+	(void)pp;
+}
+
 QColor ViewItem::select_text_color(QColor background)
 {
 	return (background.lightness() > 110) ? Qt::black : Qt::white;
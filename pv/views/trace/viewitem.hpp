@@ -151,6 +151,16 @@ public:
 	 */
 	virtual void paint_fore(QPainter &p, ViewItemPaintParams &pp);
 
+	/**
+	 * Paints the overlay layer of the item with a QPainter. The overlay
+	 * holds everything that depends on the mouse position and is painted
+	 * over a cached image of the other layers, so moving the mouse only
+	 * repaints this layer.
+	 * @param p the QPainter to paint into.
+	 * @param pp the painting parameters object to paint with.
+	 */
+	virtual void paint_overlay(QPainter &p, ViewItemPaintParams &pp);
+
 	/**
 	 * Gets the text color.
 	 * @remarks This color is computed by comparing the lightness
@@ -23,10 +23,12 @@
 #include <limits>
 
 #include "signal.hpp"
+#include "trace.hpp"
 #include "view.hpp"
 #include "viewitempaintparams.hpp"
 #include "viewport.hpp"
 
+#include <pv/profiling.hpp>
 #include <pv/session.hpp>
 
 #include <QMouseEvent>
@@ -50,7 +52,8 @@ namespace trace {
 
 Viewport::Viewport(View &parent) :
 	ViewWidget(parent),
-	pinch_zoom_active_(false)
+	pinch_zoom_active_(false),
+	frame_cache_valid_(false)
 {
 	setAutoFillBackground(true);
 	setBackgroundRole(QPalette::Base);
@@ -77,6 +80,17 @@ shared_ptr<ViewItem> Viewport::get_mouse_over_item(const QPoint &pt)
 	return nullptr;
 }
 
+void Viewport::invalidate_frame()
+{
+	frame_cache_valid_ = false;
+	QWidget::update();
+}
+
+void Viewport::update_overlay()
+{
+	QWidget::update();
+}
+
 void Viewport::item_hover(const shared_ptr<ViewItem> &item, QPoint pos)
 {
 	if (item && item->is_draggable(pos))
@@ -203,6 +217,33 @@ bool Viewport::touch_event(QTouchEvent *event)
 	return true;
 }
 
+bool Viewport::event(QEvent *event)
+{
+	// Clicks and key presses may change the selection or other painted
+	// state without going through invalidate_frame(), mouse moves only
+	// affect the overlay
+	switch (event->type()) {
+	case QEvent::MouseButtonPress:
+	case QEvent::MouseButtonRelease:
+	case QEvent::MouseButtonDblClick:
+	case QEvent::KeyPress:
+	case QEvent::KeyRelease:
+	case QEvent::Wheel:
+	case QEvent::TouchBegin:
+	case QEvent::TouchUpdate:
+	case QEvent::TouchEnd:
+	case QEvent::PaletteChange:
+	case QEvent::FontChange:
+		frame_cache_valid_ = false;
+		break;
+
+	default:
+		break;
+	}
+
+	return ViewWidget::event(event);
+}
+
 void Viewport::paintEvent(QPaintEvent*)
 {
 	typedef void (ViewItem::*LayerPaintFunc)(
@@ -223,23 +264,67 @@ void Viewport::paintEvent(QPaintEvent*)
 	assert(none_of(time_items.begin(), time_items.end(),
 		[](const shared_ptr<TimeItem> &t) { return !t; }));
 
-	QPainter p(this);
+	const qreal pixel_ratio = window()->windowHandle()->screen()->devicePixelRatio();
 
 	// Disable antialiasing for high-DPI displays
-	bool use_antialiasing =
-		window()->windowHandle()->screen()->devicePixelRatio() < 2.0;
+	bool use_antialiasing = pixel_ratio < 2.0;
+
+	// Render the back, mid and fore layers into the frame cache unless
+	// only the overlay changed since the last paint
+	const QSize frame_size = size() * pixel_ratio;
+	if (!frame_cache_valid_ || (frame_cache_.size() != frame_size)) {
+		static Profiling::Stage* const profiling_stage = profiling.stage("Paint", "frames");
+		ProfilingScope profiling_scope(profiling_stage, 1);
+
+		// Decode traces change their extents while painting when rows
+		// appear or disappear, which must cause another full paint
+		frame_cache_valid_ = true;
+
+		frame_cache_ = QPixmap(frame_size);
+		frame_cache_.setDevicePixelRatio(pixel_ratio);
+		frame_cache_.fill(palette().color(QPalette::Base));
+
+		QPainter p(&frame_cache_);
+		p.setRenderHint(QPainter::Antialiasing, use_antialiasing);
+
+		for (LayerPaintFunc *paint_func = layer_paint_funcs;
+				*paint_func; paint_func++) {
+			ViewItemPaintParams time_pp(rect(), view_.scale(), view_.offset());
+			for (const shared_ptr<TimeItem>& t : time_items)
+				(t.get()->*(*paint_func))(p, time_pp);
+
+			ViewItemPaintParams row_pp(rect(), view_.scale(), view_.offset());
+			for (const shared_ptr<ViewItem>& r : row_items) {
+				// The mid layer holds the trace data, so that's where the time is spent
+				Profiling::Stage* item_stage = nullptr;
+				const shared_ptr<Trace> trace = dynamic_pointer_cast<Trace>(r);
+				if (trace && (*paint_func == &ViewItem::paint_mid))
+					item_stage = trace->base()->profiling_stage(
+						data::SignalBase::PaintProfilingStage);
+
+				ProfilingScope item_scope(item_stage, 1);
+				(r.get()->*(*paint_func))(p, row_pp);
+			}
+		}
+
+		p.end();
+	}
+
+	static Profiling::Stage* const overlay_stage = profiling.stage("Paint: overlay", "frames");
+	ProfilingScope overlay_scope(overlay_stage, 1);
+
+	QPainter p(this);
+	p.drawPixmap(0, 0, frame_cache_);
+
 	p.setRenderHint(QPainter::Antialiasing, use_antialiasing);
 
-	for (LayerPaintFunc *paint_func = layer_paint_funcs;
-			*paint_func; paint_func++) {
-		ViewItemPaintParams time_pp(rect(), view_.scale(), view_.offset());
-		for (const shared_ptr<TimeItem>& t : time_items)
-			(t.get()->*(*paint_func))(p, time_pp);
+	ViewItemPaintParams time_pp(rect(), view_.scale(), view_.offset());
+	for (const shared_ptr<TimeItem>& t : time_items)
+		t->paint_overlay(p, time_pp);
 
-		ViewItemPaintParams row_pp(rect(), view_.scale(), view_.offset());
-		for (const shared_ptr<ViewItem>& r : row_items)
-			(r.get()->*(*paint_func))(p, row_pp);
-	}
+	ViewItemPaintParams row_pp(rect(), view_.scale(), view_.offset());
+	for (const shared_ptr<ViewItem>& r : row_items)
+		r->paint_overlay(p, row_pp);
 
 	p.end();
 }
@@ -22,6 +22,7 @@
 
 #include <boost/optional.hpp>
 
+#include <QPixmap>
 #include <QPoint>
 #include <QTimer>
 #include <QTouchEvent>
@@ -60,6 +61,18 @@ public:
 	 */
 	shared_ptr<ViewItem> get_mouse_over_item(const QPoint &pt);
 
+	/**
+	 * Drops the cached frame and repaints the viewport including the
+	 * trace content. QWidget::update() alone only repaints the overlay.
+	 */
+	void invalidate_frame();
+
+	/**
+	 * Repaints only the overlay layer on top of the cached frame, which
+	 * is all that changes when the mouse moves.
+	 */
+	void update_overlay();
+
 private:
 	/**
 	 * Indicates when a view item is being hovered over.
@@ -95,6 +108,8 @@ private:
 	 */
 	bool touch_event(QTouchEvent *event);
 
+	bool event(QEvent *event);
+
 	void paintEvent(QPaintEvent *event);
 
 	void mouseDoubleClickEvent(QMouseEvent *event);
@@ -111,6 +126,10 @@ private:
 	double pinch_offset0_;
 	double pinch_offset1_;
 	bool pinch_zoom_active_;
+
+	/// The back, mid and fore layers of the last paint
+	QPixmap frame_cache_;
+	bool frame_cache_valid_;
 };
 
 } // namespace trace
@@ -43,6 +43,11 @@ ViewWidget::ViewWidget(View &parent) :
 	setMouseTracking(true);
 }
 
+void ViewWidget::invalidate_frame()
+{
+	update();
+}
+
 void ViewWidget::clear_selection()
 {
 	const auto items = this->items();
@@ -289,7 +294,7 @@ void ViewWidget::keyReleaseEvent(QKeyEvent *event)
 	// Update mouse_modifiers_ also if modifiers change, but pointer doesn't move
 	if ((mouse_point_.x() >= 0) && (mouse_point_.y() >= 0)) // mouse is inside
 		mouse_modifiers_ = event->modifiers();
-	update();
+	invalidate_frame();
 }
 
 void ViewWidget::keyPressEvent(QKeyEvent *event)
@@ -297,7 +302,7 @@ void ViewWidget::keyPressEvent(QKeyEvent *event)
 	// Update mouse_modifiers_ also if modifiers change, but pointer doesn't move
 	if ((mouse_point_.x() >= 0) && (mouse_point_.y() >= 0)) // mouse is inside
 		mouse_modifiers_ = event->modifiers();
-	update();
+	invalidate_frame();
 }
 
 void ViewWidget::mouseMoveEvent(QMouseEvent *event)
@@ -340,8 +345,12 @@ void ViewWidget::mouseMoveEvent(QMouseEvent *event)
 		}
 	}
 
-	// Force a repaint of the widget to update highlighted parts
-	update();
+	// Force a repaint of the widget to update highlighted parts, dragging
+	// may also have moved items or cursors
+	if (event->buttons())
+		invalidate_frame();
+	else
+		update();
 }
 
 void ViewWidget::leaveEvent(QEvent*)
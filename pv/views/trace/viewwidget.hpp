@@ -46,6 +46,17 @@ class ViewWidget : public QWidget
 protected:
 	ViewWidget(View &parent);
 
+public:
+	/**
+	 * Repaints the widget including all of its content.
+	 * @remarks The default implementation just calls update(). Widgets
+	 * that cache their content must drop the cache here, update() only
+	 * repaints what depends on the mouse position.
+	 */
+	virtual void invalidate_frame();
+
+protected:
+
 	/**
 	 * Indicates when a view item is being hovered over.
 	 * @param item The item that is being hovered over, or @c nullptr
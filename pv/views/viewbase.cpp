@@ -37,8 +37,10 @@ const char* ViewTypeNames[ViewTypeCount] = {
 	"Trace View",
 #ifdef ENABLE_DECODE
 	"Binary Decoder Output View",
-	"Tabular Decoder Output View"
+	"Tabular Decoder Output View",
 #endif
+	"Spectrum View",
+	"Eye Diagram View"
 };
 
 const int ViewBase::MaxViewAutoUpdateRate = 25; // No more than 25 Hz
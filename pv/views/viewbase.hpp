@@ -58,6 +58,8 @@ enum ViewType {
 	ViewTypeDecoderBinary,
 	ViewTypeTabularDecoder,
 #endif
+	ViewTypeSpectrum,
+	ViewTypeEyeDiagram,
 	ViewTypeCount  // Indicates how many view types there are, must always be last
 };
 
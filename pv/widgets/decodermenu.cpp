@@ -17,12 +17,17 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include <libsigrokdecode/libsigrokdecode.h>
 
 #include "decodermenu.hpp"
 
+#include <pv/decodercatalog.hpp>
+
+using std::sort;
+
 namespace pv {
 namespace widgets {
 
@@ -30,32 +35,31 @@ DecoderMenu::DecoderMenu(QWidget *parent, const char* input, bool first_level_de
 	QMenu(parent),
 	mapper_(this)
 {
-	GSList *li = g_slist_sort(g_slist_copy((GSList*)srd_decoder_list()), decoder_name_cmp);
-
-	for (GSList *l = li; l; l = l->next) {
-		const srd_decoder *const d = (srd_decoder*)l->data;
-		assert(d);
+	vector<DecoderCatalog::Info> decoders = decoder_catalog.decoders();
+	sort(decoders.begin(), decoders.end(),
+		[](const DecoderCatalog::Info& a, const DecoderCatalog::Info& b) {
+			return a.name < b.name; });
 
-		const bool have_channels = (d->channels || d->opt_channels) != 0;
+	for (const DecoderCatalog::Info& d : decoders) {
+		const bool have_channels = !d.channels.empty() || !d.opt_channels.empty();
 		if (first_level_decoder != have_channels)
 			continue;
 
 		if (!first_level_decoder) {
 			// Dismiss all non-stacked decoders unless we're looking for first-level decoders
-			if (!d->inputs)
+			if (d.inputs.isEmpty())
 				continue;
 
-			// TODO For now we ignore that d->inputs is actually a list
-			if (strncmp((char*)(d->inputs->data), input, 1024) != 0)
+			// TODO For now we ignore that d.inputs is actually a list
+			if (d.inputs.first() != QString::fromUtf8(input))
 				continue;
 		}
 
-		QAction *const action = addAction(QString::fromUtf8(d->name));
-		action->setData(QVariant::fromValue(l->data));
+		QAction *const action = addAction(d.name);
+		action->setData(d.id);
 		mapper_.setMapping(action, action);
 		connect(action, SIGNAL(triggered()), &mapper_, SLOT(map()));
 	}
-	g_slist_free(li);
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	connect(&mapper_, SIGNAL(mappedObject(QObject*)), this, SLOT(on_action(QObject*)));
@@ -64,19 +68,15 @@ DecoderMenu::DecoderMenu(QWidget *parent, const char* input, bool first_level_de
 #endif
 }
 
-int DecoderMenu::decoder_name_cmp(const void *a, const void *b)
-{
-	return strcmp(((const srd_decoder*)a)->name, ((const srd_decoder*)b)->name);
-}
-
 void DecoderMenu::on_action(QObject *action)
 {
 	assert(action);
 
-	srd_decoder *const dec = (srd_decoder*)((QAction*)action)->data().value<void*>();
-	assert(dec);
+	// The decoder module is imported when it is first used
+	srd_decoder *const dec = decoder_catalog.get_decoder(((QAction*)action)->data().toString());
 
-	decoder_selected(dec);
+	if (dec)
+		decoder_selected(dec);
 }
 
 }  // namespace widgets
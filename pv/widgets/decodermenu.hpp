@@ -35,9 +35,6 @@ class DecoderMenu : public QMenu
 public:
 	DecoderMenu(QWidget *parent, const char* input, bool first_level_decoder = false);
 
-private:
-	static int decoder_name_cmp(const void *a, const void *b);
-
 private Q_SLOTS:
 	void on_action(QObject *action);
 
@@ -113,6 +113,20 @@ void DeviceToolButton::update_device_list()
 
 		menu_.addAction(a);
 	}
+
+	// Show the devices found during the previous run until their
+	// driver has been scanned so that they're either confirmed or gone
+	for (const QString& name : device_manager_.pending_cached_devices()) {
+		QAction *const a = new QAction(tr("%1 (searching...)").arg(name), this);
+		a->setEnabled(false);
+		menu_.addAction(a);
+	}
+
+	if (device_manager_.is_scanning()) {
+		QAction *const a = new QAction(tr("Scanning for devices..."), this);
+		a->setEnabled(false);
+		menu_.addAction(a);
+	}
 }
 
 void DeviceToolButton::on_action(QObject *action)
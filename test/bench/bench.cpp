@@ -0,0 +1,689 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * pulseview-bench: Generates synthetic logic and analog captures and measures
+ * the throughput of PulseView's hot paths. The results are written as JSON so
+ * that they can be tracked over time.
+ */
+
+#ifdef ENABLE_DECODE
+#include <libsigrokdecode/libsigrokdecode.h> /* First, so we avoid a _POSIX_C_SOURCE warning. */
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <getopt.h>
+#include <memory>
+#include <vector>
+
+#include <QApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <libsigrokcxx/libsigrokcxx.hpp>
+
+#include "config.h"
+
+#include <pv/devicemanager.hpp>
+#include <pv/globalsettings.hpp>
+#include <pv/session.hpp>
+#include <pv/storesession.hpp>
+#include <pv/data/analog.hpp>
+#include <pv/data/analogsegment.hpp>
+#include <pv/data/logic.hpp>
+#include <pv/data/logicsegment.hpp>
+#include <pv/data/signalbase.hpp>
+#include <pv/views/trace/view.hpp>
+#include <pv/views/trace/viewport.hpp>
+
+#ifdef ENABLE_DECODE
+#include <pv/data/decodesignal.hpp>
+#endif
+
+using std::function;
+using std::make_shared;
+using std::map;
+using std::min;
+using std::shared_ptr;
+using std::sort;
+using std::string;
+using std::vector;
+
+using pv::Session;
+using pv::data::Analog;
+using pv::data::AnalogSegment;
+using pv::data::Logic;
+using pv::data::LogicSegment;
+using pv::data::SignalBase;
+
+namespace {
+
+const uint64_t SampleRate = 10000000;
+const unsigned int LogicChannels = 8;
+const unsigned int AnalogChannels = 4;
+const uint64_t UartBaudRate = 115200;
+
+const uint64_t LogicPacketSize = 64 * 1024;   // Bytes, roughly what drivers send
+const uint64_t AnalogPacketSize = 4 * 1024;   // Samples per channel
+
+const int ViewWidth = 1920;
+const int ViewHeight = 1080;
+const int FramesPerIteration = 10;
+const vector<unsigned int> ZoomFactors = {1, 16, 256, 4096};
+
+const int LoadTimeout = 10 * 60 * 1000;   // ms
+
+struct Config
+{
+	uint64_t logic_samples;
+	uint64_t analog_samples;
+	unsigned int iterations;
+	QString filter;
+};
+
+Config config = {16 * 1024 * 1024, 4 * 1024 * 1024, 3, QString()};
+QJsonArray results;
+
+/**
+ * Runs fn config.iterations times and records the best and mean run time
+ * together with the throughput, based on the number of units processed per run.
+ */
+void measure(const QString &name, uint64_t unit_count, const QString &unit,
+	function<void()> fn)
+{
+	if (!config.filter.isEmpty() && !name.contains(config.filter))
+		return;
+
+	qDebug().noquote() << "Running" << name;
+
+	vector<double> times;
+	for (unsigned int i = 0; i < config.iterations; i++) {
+		QElapsedTimer timer;
+		timer.start();
+		fn();
+		times.push_back(timer.nsecsElapsed() / 1e9);
+	}
+
+	sort(times.begin(), times.end());
+
+	double total = 0;
+	for (double t : times)
+		total += t;
+
+	QJsonObject result;
+	result["name"] = name;
+	result["iterations"] = (int)times.size();
+	result["best_s"] = times.front();
+	result["median_s"] = times[times.size() / 2];
+	result["mean_s"] = total / times.size();
+	result["unit"] = unit;
+	result["count"] = (double)unit_count;
+	result["per_s"] = (times.front() > 0) ? (unit_count / times.front()) : 0.0;
+	results.append(result);
+}
+
+void record_error(const QString &name, const QString &error)
+{
+	qWarning().noquote() << name << "failed:" << error;
+
+	QJsonObject result;
+	result["name"] = name;
+	result["error"] = error;
+	results.append(result);
+}
+
+/**
+ * Processes events until done() returns true or the timeout expired.
+ */
+bool wait_until(function<bool()> done, int timeout_ms)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// Make sure we wake up regularly even if no events arrive
+	QTimer wakeup;
+	wakeup.start(10);
+
+	while (!done()) {
+		if (timer.elapsed() > timeout_ms)
+			return false;
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	return true;
+}
+
+/**
+ * Logic data with 8 channels: D0 carries 8N1 UART frames, D1..D3 are clocks
+ * with different periods and D4..D7 are random signals of decreasing edge
+ * density. This gives both extremely busy and very quiet channels.
+ */
+vector<uint8_t> generate_logic_data(uint64_t sample_count)
+{
+	vector<uint8_t> data(sample_count);
+
+	const double samples_per_bit = (double)SampleRate / UartBaudRate;
+	const uint32_t noise_masks[] = {0x7, 0x3F, 0x1FF, 0xFFF};
+
+	uint32_t lcg = 1;
+	uint8_t noise = 0;
+
+	for (uint64_t i = 0; i < sample_count; i++) {
+		const uint64_t bit = (uint64_t)(i / samples_per_bit);
+		const uint64_t frame_bit = bit % 10;
+		const uint8_t byte = (uint8_t)((bit / 10) * 37);
+
+		uint8_t value;
+		if (frame_bit == 0)
+			value = 0;  // Start bit
+		else if (frame_bit == 9)
+			value = 1;  // Stop bit
+		else
+			value = (byte >> (frame_bit - 1)) & 1;
+
+		value |= (i & 1) << 1;
+		value |= ((i >> 4) & 1) << 2;
+		value |= ((i >> 10) & 1) << 3;
+
+		for (unsigned int ch = 0; ch < 4; ch++) {
+			lcg = lcg * 1103515245 + 12345;
+			if (((lcg >> 8) & noise_masks[ch]) == 0)
+				noise ^= 1 << (4 + ch);
+		}
+
+		data[i] = value | noise;
+	}
+
+	return data;
+}
+
+/**
+ * Interleaved analog data: sine waves of different frequencies with a bit of
+ * noise, scaled to [-1, 1].
+ */
+vector<float> generate_analog_data(uint64_t sample_count)
+{
+	vector<float> data(sample_count * AnalogChannels);
+
+	uint32_t lcg = 1;
+	for (uint64_t i = 0; i < sample_count; i++)
+		for (unsigned int ch = 0; ch < AnalogChannels; ch++) {
+			lcg = lcg * 1103515245 + 12345;
+			const float noise = ((lcg >> 16) & 0xFF) / 2560.0f - 0.05f;
+			const double phase = 2 * M_PI * i / (100.0 * (1 << (2 * ch)));
+			data[i * AnalogChannels + ch] = 0.9f * (float)sin(phase) + noise;
+		}
+
+	return data;
+}
+
+bool write_logic_file(const QString &file_name, const vector<uint8_t> &data)
+{
+	QFile file(file_name);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	return (file.write((const char*)data.data(), data.size()) == (qint64)data.size());
+}
+
+/**
+ * Writes the analog data as 16-bit PCM WAV file.
+ */
+bool write_analog_file(const QString &file_name, const vector<float> &data)
+{
+	QFile file(file_name);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	const uint32_t data_size = data.size() * sizeof(int16_t);
+	const uint16_t block_align = AnalogChannels * sizeof(int16_t);
+
+	QByteArray header;
+	auto append_u32 = [&](uint32_t v) {
+		for (int i = 0; i < 4; i++) header.append((char)((v >> (8 * i)) & 0xFF)); };
+	auto append_u16 = [&](uint16_t v) {
+		for (int i = 0; i < 2; i++) header.append((char)((v >> (8 * i)) & 0xFF)); };
+
+	header.append("RIFF");
+	append_u32(36 + data_size);
+	header.append("WAVEfmt ");
+	append_u32(16);
+	append_u16(1);  // PCM
+	append_u16(AnalogChannels);
+	append_u32(SampleRate);
+	append_u32(SampleRate * block_align);
+	append_u16(block_align);
+	append_u16(16);
+	header.append("data");
+	append_u32(data_size);
+	file.write(header);
+
+	vector<int16_t> pcm(data.size());
+	for (size_t i = 0; i < data.size(); i++)
+		pcm[i] = (int16_t)(data[i] * 32767);
+
+	return (file.write((const char*)pcm.data(), data_size) == data_size);
+}
+
+/**
+ * Loads the file into the session and waits for the acquisition to finish.
+ */
+bool load_file(Session &session, const QString &file_name, const string &format)
+{
+	bool stopped = false;
+
+	QObject context;
+	QObject::connect(&session, &Session::capture_state_changed, &context,
+		[&](int state) { stopped = (state == Session::Stopped); });
+
+	session.load_init_file(file_name.toStdString(), format, string());
+
+	if (!session.device())
+		return false;
+
+	return wait_until([&]() { return stopped; }, LoadTimeout);
+}
+
+void bench_segments(const vector<uint8_t> &logic_data, const vector<float> &analog_data)
+{
+	// Logic ingest and mip-map build
+	Logic logic(LogicChannels);
+	shared_ptr<LogicSegment> logic_segment;
+
+	measure("logic_append", logic_data.size(), "samples", [&]() {
+		logic.clear();
+		logic_segment = make_shared<LogicSegment>(logic, 0, 1, SampleRate);
+		logic.push_segment(logic_segment);
+
+		for (uint64_t offset = 0; offset < logic_data.size(); offset += LogicPacketSize)
+			logic_segment->append_payload((void*)(logic_data.data() + offset),
+				min(LogicPacketSize, logic_data.size() - offset));
+
+		logic_segment->set_complete();
+	});
+
+	// Edge extraction the way LogicSignal does it when drawing the
+	// center of the capture at different zoom levels
+	if (logic_segment)
+		for (unsigned int zoom : ZoomFactors) {
+			const uint64_t window = logic_data.size() / zoom;
+			const uint64_t start = (logic_data.size() - window) / 2;
+			const float samples_per_pixel = (float)window / ViewWidth;
+
+			measure(QString("logic_subsampled_edges_zoom%1").arg(zoom), LogicChannels,
+				"channels", [&]() {
+				vector<LogicSegment::EdgePair> edges;
+				for (unsigned int ch = 0; ch < LogicChannels; ch++) {
+					edges.clear();
+					logic_segment->get_subsampled_edges(edges, start, start + window - 1,
+						samples_per_pixel, ch);
+				}
+			});
+		}
+
+	// Analog ingest and envelope build
+	const uint64_t analog_samples = analog_data.size() / AnalogChannels;
+	vector< shared_ptr<Analog> > analogs;
+	vector< shared_ptr<AnalogSegment> > analog_segments;
+
+	for (unsigned int ch = 0; ch < AnalogChannels; ch++)
+		analogs.push_back(make_shared<Analog>());
+
+	measure("analog_append", analog_data.size(), "samples", [&]() {
+		analog_segments.clear();
+		for (shared_ptr<Analog>& analog : analogs) {
+			analog->clear();
+			shared_ptr<AnalogSegment> segment =
+				make_shared<AnalogSegment>(*analog, 0, SampleRate);
+			analog->push_segment(segment);
+			analog_segments.push_back(segment);
+		}
+
+		for (uint64_t offset = 0; offset < analog_samples; offset += AnalogPacketSize)
+			AnalogSegment::append_interleaved_samples(analog_segments,
+				analog_data.data() + offset * AnalogChannels,
+				min(AnalogPacketSize, analog_samples - offset));
+
+		for (shared_ptr<AnalogSegment>& segment : analog_segments)
+			segment->set_complete();
+	});
+
+	if (!analog_segments.empty())
+		for (unsigned int zoom : ZoomFactors) {
+			const uint64_t window = analog_samples / zoom;
+			const uint64_t start = (analog_samples - window) / 2;
+			const float samples_per_pixel = (float)window / ViewWidth;
+
+			measure(QString("analog_envelope_zoom%1").arg(zoom), AnalogChannels,
+				"channels", [&]() {
+				for (shared_ptr<AnalogSegment>& segment : analog_segments) {
+					AnalogSegment::EnvelopeSection section;
+					segment->get_envelope_section(section, start, start + window,
+						samples_per_pixel);
+					delete[] section.samples;
+				}
+			});
+		}
+}
+
+#ifdef ENABLE_DECODE
+void bench_decode(Session &session, uint64_t sample_count)
+{
+	const srd_decoder *decoder = srd_decoder_get_by_id("uart");
+	if (!decoder) {
+		record_error("decode_uart", "Decoder 'uart' not found");
+		return;
+	}
+
+	shared_ptr<pv::data::DecodeSignal> signal = session.add_decode_signal();
+	if (!signal) {
+		record_error("decode_uart", "Failed to create decode signal");
+		return;
+	}
+
+	signal->stack_decoder(decoder, false);
+
+	// Connect D0 to RX
+	shared_ptr<SignalBase> d0;
+	for (const shared_ptr<SignalBase>& base : session.signalbases())
+		if ((base->type() == SignalBase::LogicChannel) && (base->index() == 0))
+			d0 = base;
+
+	for (const pv::data::decode::DecodeChannel& ch : signal->get_channels())
+		if (ch.name.toLower() == "rx")
+			signal->assign_signal(ch.id, d0);
+
+	bool finished = false, timed_out = false;
+
+	QObject context;
+	QObject::connect(signal.get(), &pv::data::DecodeSignal::decode_finished, &context,
+		[&]() { finished = true; });
+
+	// This includes muxing the logic samples into the decoder input format
+	measure("decode_uart", sample_count, "samples", [&]() {
+		finished = false;
+		signal->begin_decode();
+		if (!wait_until([&]() { return finished; }, LoadTimeout))
+			timed_out = true;
+	});
+
+	if (timed_out)
+		record_error("decode_uart", "Decoding didn't finish: " + signal->get_error_message());
+}
+#endif
+
+void bench_render(Session &session, const QString &name)
+{
+	shared_ptr<pv::views::trace::View> view =
+		make_shared<pv::views::trace::View>(session, true);
+	session.register_view(view);
+
+	view->resize(ViewWidth, ViewHeight);
+	view->show();
+	QCoreApplication::processEvents();
+
+	view->zoom_fit(false);
+	const double fit_scale = view->scale();
+	const pv::util::Timestamp fit_offset = view->offset();
+
+	pv::views::trace::Viewport *viewport = view->viewport();
+	QImage image(viewport->size(), QImage::Format_ARGB32_Premultiplied);
+
+	for (unsigned int zoom : ZoomFactors) {
+		// Zoom into the center of the capture
+		const double scale = fit_scale / zoom;
+		const pv::util::Timestamp offset = fit_offset +
+			(fit_scale - scale) * viewport->width() / 2;
+		view->set_scale_offset(scale, offset);
+		QCoreApplication::processEvents();
+
+		measure(QString("render_%1_zoom%2").arg(name).arg(zoom), FramesPerIteration,
+			"frames", [&]() {
+			// Drop the frame cache so every frame renders the traces
+			for (int i = 0; i < FramesPerIteration; i++) {
+				viewport->invalidate_frame();
+				viewport->render(&image);
+			}
+		});
+	}
+
+	session.deregister_view(view);
+}
+
+void bench_store(Session &session, const QString &temp_path, uint64_t sample_count)
+{
+	const map<string, shared_ptr<sigrok::OutputFormat> > formats =
+		session.device_manager().context()->output_formats();
+
+	const auto iter = formats.find("srzip");
+	if (iter == formats.end()) {
+		record_error("store_srzip", "Output format 'srzip' not found");
+		return;
+	}
+
+	const string file_name = QDir(temp_path).filePath("store.sr").toStdString();
+
+	QString error;
+	measure("store_srzip", sample_count, "samples", [&]() {
+		pv::StoreSession store(file_name, iter->second, {}, {0, 0}, session);
+		if (!store.start())
+			error = store.error();
+		else
+			store.wait();
+	});
+
+	if (!error.isEmpty())
+		record_error("store_srzip", error);
+}
+
+void usage()
+{
+	fprintf(stdout,
+		"Usage:\n"
+		"  pulseview-bench [OPTIONS]\n"
+		"\n"
+		"Options:\n"
+		"  -h, --help                      Show help option\n"
+		"  -n, --iterations                Number of runs per benchmark (default 3)\n"
+		"  -l, --logic-samples             Number of logic samples to generate\n"
+		"  -a, --analog-samples            Number of analog samples per channel\n"
+		"  -f, --filter                    Only run benchmarks containing this text\n"
+		"  -o, --output                    Write the JSON results to this file\n"
+		"\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	QString output_file;
+
+	// Rendering is done offscreen, so don't require a display
+	if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QApplication a(argc, argv);
+
+	// Use separate settings so that the user's configuration isn't touched
+	a.setApplicationName("PulseView-bench");
+	a.setOrganizationName("sigrok");
+	a.setOrganizationDomain("sigrok.org");
+
+	while (true) {
+		static const struct option long_options[] = {
+			{"help", no_argument, nullptr, 'h'},
+			{"iterations", required_argument, nullptr, 'n'},
+			{"logic-samples", required_argument, nullptr, 'l'},
+			{"analog-samples", required_argument, nullptr, 'a'},
+			{"filter", required_argument, nullptr, 'f'},
+			{"output", required_argument, nullptr, 'o'},
+			{nullptr, 0, nullptr, 0}
+		};
+
+		const int c = getopt_long(argc, argv, "h?n:l:a:f:o:", long_options, nullptr);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'n':
+			config.iterations = std::max(1, atoi(optarg));
+			break;
+		case 'l':
+			config.logic_samples = std::max(1024ULL, strtoull(optarg, nullptr, 0));
+			break;
+		case 'a':
+			config.analog_samples = std::max(1024ULL, strtoull(optarg, nullptr, 0));
+			break;
+		case 'f':
+			config.filter = optarg;
+			break;
+		case 'o':
+			output_file = optarg;
+			break;
+		default:
+			usage();
+			return 0;
+		}
+	}
+
+	qRegisterMetaType<uint64_t>("uint64_t");
+	qRegisterMetaType<pv::util::Timestamp>("util::Timestamp");
+	qRegisterMetaType<SharedPtrToSegment>("SharedPtrToSegment");
+	qRegisterMetaType<shared_ptr<SignalBase>>("shared_ptr<SignalBase>");
+
+	pv::GlobalSettings settings;
+	settings.set_defaults_where_needed();
+
+	shared_ptr<sigrok::Context> context = sigrok::Context::create();
+	pv::Session::sr_context = context;
+
+#ifdef ENABLE_DECODE
+	if (srd_init(nullptr) != SRD_OK) {
+		qWarning() << "ERROR: libsigrokdecode init failed.";
+		return 1;
+	}
+	srd_decoder_load_all();
+#endif
+
+	QTemporaryDir temp_dir;
+	if (!temp_dir.isValid()) {
+		qWarning() << "ERROR: Can't create temporary directory.";
+		return 1;
+	}
+
+	const vector<uint8_t> logic_data = generate_logic_data(config.logic_samples);
+	const vector<float> analog_data = generate_analog_data(config.analog_samples);
+
+	bench_segments(logic_data, analog_data);
+
+	{
+		pv::DeviceManager device_manager(context, string(), false);
+
+		// Full acquisition path through libsigrok input modules and the session
+		const QString logic_file = QDir(temp_dir.path()).filePath("logic.bin");
+		const QString analog_file = QDir(temp_dir.path()).filePath("analog.wav");
+		const string logic_format = QString("binary:numchannels=%1:samplerate=%2")
+			.arg(LogicChannels).arg(SampleRate).toStdString();
+
+		shared_ptr<Session> logic_session, analog_session;
+
+		if (!write_logic_file(logic_file, logic_data) ||
+			!write_analog_file(analog_file, analog_data))
+			record_error("session_load", "Can't write input files");
+		else {
+			bool failed = false;
+
+			measure("session_load_logic", logic_data.size(), "samples", [&]() {
+				logic_session = make_shared<Session>(device_manager, "logic");
+				failed |= !load_file(*logic_session, logic_file, logic_format);
+			});
+			if (failed) {
+				record_error("session_load_logic", "Loading failed");
+				logic_session.reset();
+			}
+
+			failed = false;
+			measure("session_load_analog", analog_data.size(), "samples", [&]() {
+				analog_session = make_shared<Session>(device_manager, "analog");
+				failed |= !load_file(*analog_session, analog_file, "wav");
+			});
+			if (failed) {
+				record_error("session_load_analog", "Loading failed");
+				analog_session.reset();
+			}
+		}
+
+		if (logic_session) {
+#ifdef ENABLE_DECODE
+			bench_decode(*logic_session, logic_data.size());
+#endif
+			// Includes the decode trace if decoding is enabled
+			bench_render(*logic_session, "logic");
+			bench_store(*logic_session, temp_dir.path(), logic_data.size());
+		}
+
+		if (analog_session)
+			bench_render(*analog_session, "analog");
+	}
+
+	QJsonObject config_obj;
+	config_obj["logic_samples"] = (double)config.logic_samples;
+	config_obj["analog_samples"] = (double)config.analog_samples;
+	config_obj["logic_channels"] = (int)LogicChannels;
+	config_obj["analog_channels"] = (int)AnalogChannels;
+	config_obj["samplerate"] = (double)SampleRate;
+	config_obj["iterations"] = (int)config.iterations;
+
+	QJsonObject root;
+	root["version"] = PV_VERSION_STRING;
+	root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+	root["config"] = config_obj;
+	root["results"] = results;
+
+	const QByteArray json = QJsonDocument(root).toJson();
+
+	if (output_file.isEmpty())
+		fwrite(json.constData(), 1, json.size(), stdout);
+	else {
+		QFile file(output_file);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+			(file.write(json) != json.size())) {
+			qWarning() << "ERROR: Can't write" << output_file;
+			return 1;
+		}
+	}
+
+#ifdef ENABLE_DECODE
+	srd_exit();
+#endif
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pv/data/decode/decoder.hpp"
+#include "pv/data/decode/sweep.hpp"
+
+using std::string;
+using std::vector;
+
+using pv::data::decode::AnnotationClass;
+using pv::data::decode::Sweep;
+
+namespace {
+
+bool is_error_class(const char *name, const char *description)
+{
+	string n(name), d(description);
+	AnnotationClass ann_class(0, &n[0], &d[0], nullptr);
+
+	return Sweep::is_error_class(&ann_class);
+}
+
+Sweep::Result result(uint64_t annotation_count, uint64_t error_count,
+	bool done = true, bool failed = false)
+{
+	return {nullptr, 0, annotation_count, error_count, done, failed};
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(SweepTest)
+
+BOOST_AUTO_TEST_CASE(ErrorClasses)
+{
+	// Names as the decoders use them
+	BOOST_CHECK(is_error_class("error", "Error"));
+	BOOST_CHECK(is_error_class("parity-err", "Parity error"));
+	BOOST_CHECK(is_error_class("frame_err", "Frame"));
+	BOOST_CHECK(is_error_class("warning", "Warnings"));
+	BOOST_CHECK(is_error_class("warn", "Warn"));
+	BOOST_CHECK(is_error_class("bit", "Invalid bit"));
+	BOOST_CHECK(is_error_class("crc", "CRC errors"));
+
+	// Words that merely contain one of the error words
+	BOOST_CHECK(!is_error_class("interrupt", "Interrupt"));
+	BOOST_CHECK(!is_error_class("warmup", "Warm-up time"));
+	BOOST_CHECK(!is_error_class("ferry", "Terrace"));
+	BOOST_CHECK(!is_error_class("invalidation", "Cache invalidation"));
+	BOOST_CHECK(!is_error_class("data", "Data"));
+	BOOST_CHECK(!is_error_class("", ""));
+}
+
+BOOST_AUTO_TEST_CASE(BestResult)
+{
+	// Nothing to choose from
+	BOOST_CHECK_EQUAL(Sweep::best_result({}), -1);
+
+	// Results that don't decode anything, aren't done or failed don't count
+	BOOST_CHECK_EQUAL(Sweep::best_result({result(0, 0), result(10, 0, false),
+		result(10, 0, true, true)}), -1);
+	BOOST_CHECK_EQUAL(Sweep::best_result({result(0, 0), result(5, 3)}), 1);
+
+	// Fewer errors win over more annotations
+	BOOST_CHECK_EQUAL(Sweep::best_result({result(100, 2), result(10, 1),
+		result(1000, 5)}), 1);
+
+	// For the same number of errors, more annotations win
+	BOOST_CHECK_EQUAL(Sweep::best_result({result(10, 1), result(20, 1),
+		result(15, 1)}), 1);
+
+	// The first one wins a tie
+	BOOST_CHECK_EQUAL(Sweep::best_result({result(20, 0), result(20, 0)}), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
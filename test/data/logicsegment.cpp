@@ -19,16 +19,23 @@
 
 #include <extdef.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
+#include <pv/data/logic.hpp>
 #include <pv/data/logicsegment.hpp>
 
-#if 0
+using pv::data::Logic;
 using pv::data::LogicSegment;
+using std::make_shared;
+using std::min;
+using std::shared_ptr;
 using std::vector;
-#endif
 
 // Dummy, remove again when unit tests are fixed.
 BOOST_AUTO_TEST_SUITE(DummyTestSuite)
@@ -38,6 +45,482 @@ BOOST_AUTO_TEST_CASE(DummyTestCase)
 }
 BOOST_AUTO_TEST_SUITE_END()
 
+namespace {
+
+/**
+ * Appends @a data to the segment with append_received() in pieces of the
+ * given sizes, which are limited to the space append_received() offers.
+ * A size of 0 leaves one byte of that space, so that a sample remains
+ * incomplete right at the end of a data chunk.
+ */
+void receive(LogicSegment &s, const vector<uint8_t> &data,
+	const vector<uint64_t> &piece_sizes, unsigned int &partial_bytes)
+{
+	uint64_t offset = 0;
+	for (size_t i = 0; offset < data.size(); i++) {
+		const uint64_t piece_size = piece_sizes[i % piece_sizes.size()];
+
+		const int64_t received = s.append_received(
+			[&](uint8_t *dest, uint64_t max_size) -> int64_t {
+				uint64_t size = (piece_size == 0) ?
+					((max_size > 1) ? (max_size - 1) : max_size) :
+					min(piece_size, max_size);
+				size = min(size, data.size() - offset);
+				memcpy(dest, data.data() + offset, size);
+				return size;
+			}, partial_bytes);
+
+		BOOST_REQUIRE(received > 0);
+		offset += received;
+
+		// Only the complete samples are visible
+		BOOST_REQUIRE_EQUAL(s.get_sample_count(), offset / s.unit_size());
+		BOOST_REQUIRE_EQUAL(partial_bytes, offset % s.unit_size());
+	}
+}
+
+void check_samples(const LogicSegment &s, const vector<uint8_t> &data)
+{
+	const uint64_t sample_count = data.size() / s.unit_size();
+	BOOST_REQUIRE_EQUAL(s.get_sample_count(), sample_count);
+
+	vector<uint8_t> samples(sample_count * s.unit_size());
+	s.get_samples(0, sample_count, samples.data());
+
+	BOOST_CHECK(std::equal(samples.begin(), samples.end(), data.begin()));
+}
+
+vector<uint8_t> make_data(uint64_t size)
+{
+	vector<uint8_t> data(size);
+	for (uint64_t i = 0; i < size; i++)
+		data[i] = (uint8_t)(i * 31 + i / 7);
+
+	return data;
+}
+
+/**
+ * Generates samples whose bits change after runs of very different
+ * lengths, so that there are edges at every mip-map level. The bits of the
+ * last byte never change.
+ */
+vector<uint8_t> make_runs(uint64_t sample_count, unsigned int unit_size)
+{
+	static const uint64_t RunLengths[] =
+		{1, 2, 3, 15, 16, 17, 255, 256, 257, 4095, 4097, 70000};
+
+	vector<uint8_t> data(sample_count * unit_size);
+	vector<uint8_t> sample(unit_size, 0);
+	sample[unit_size - 1] = 0xA5;
+
+	uint32_t seed = 1;
+	uint64_t run_end = 0;
+	for (uint64_t i = 0; i < sample_count; i++) {
+		if (i == run_end) {
+			seed = seed * 1103515245 + 12345;
+			run_end += RunLengths[(seed >> 16) % countof(RunLengths)];
+
+			for (unsigned int b = 0; b + 1 < unit_size; b++) {
+				seed = seed * 1103515245 + 12345;
+				sample[b] ^= seed >> 16;
+			}
+		}
+
+		memcpy(&data[i * unit_size], sample.data(), unit_size);
+	}
+
+	return data;
+}
+
+/// Appends @a data with append_payload() in pieces of the given sample counts
+void append(LogicSegment &s, const vector<uint8_t> &data,
+	const vector<uint64_t> &piece_sizes)
+{
+	const unsigned int unit_size = s.unit_size();
+	const uint64_t sample_count = data.size() / unit_size;
+
+	uint64_t offset = 0;
+	for (size_t i = 0; offset < sample_count; i++) {
+		const uint64_t count = min(piece_sizes[i % piece_sizes.size()],
+			sample_count - offset);
+		s.append_payload((void*)&data[offset * unit_size], count * unit_size);
+		offset += count;
+	}
+}
+
+/**
+ * Checks the edges that get_subsampled_edges() finds at full resolution
+ * against the edges in @a data.
+ */
+void check_edges(LogicSegment &s, const vector<uint8_t> &data, int sig_index,
+	uint64_t start, uint64_t end)
+{
+	const unsigned int unit_size = s.unit_size();
+	const auto bit = [&](uint64_t i) {
+		return ((data[i * unit_size + sig_index / 8] >> (sig_index % 8)) & 1) != 0; };
+
+	vector<LogicSegment::EdgePair> expected;
+	expected.emplace_back(start, bit(start));
+	for (uint64_t i = start + 1; i <= end; i++)
+		if (bit(i) != bit(i - 1))
+			expected.emplace_back(i, bit(i));
+	expected.emplace_back(end + 1, bit(end));
+
+	vector<LogicSegment::EdgePair> edges;
+	s.get_subsampled_edges(edges, start, end, 1, sig_index);
+
+	BOOST_CHECK_MESSAGE(edges == expected, "signal " << sig_index <<
+		", samples " << start << ".." << end << ": " << edges.size() <<
+		" edges, expected " << expected.size());
+}
+
+/**
+ * Checks that get_subsampled_edges() finds the same edges in both segments
+ * at all levels of detail, which tests the mip-maps as well.
+ */
+void compare_edges(LogicSegment &a, LogicSegment &b, int sig_index)
+{
+	BOOST_REQUIRE_EQUAL(a.get_sample_count(), b.get_sample_count());
+	const uint64_t end = a.get_sample_count() - 1;
+
+	for (const float min_length : {1.0f, 2.5f, 17.0f, 300.0f, 5000.0f, 100000.0f})
+		for (const uint64_t start : {(uint64_t)0, (uint64_t)1000, end / 2}) {
+			vector<LogicSegment::EdgePair> edges_a, edges_b;
+			a.get_subsampled_edges(edges_a, start, end, min_length, sig_index);
+			b.get_subsampled_edges(edges_b, start, end, min_length, sig_index);
+
+			BOOST_CHECK_MESSAGE(edges_a == edges_b, "signal " << sig_index <<
+				", samples " << start << ".." << end << ", min_length " <<
+				min_length << ": " << edges_a.size() << " != " << edges_b.size());
+		}
+}
+
+/**
+ * Computes the first mip-map level of @a data. It holds the changes within
+ * blocks of MipMapScaleFactor samples, including the change from the sample
+ * before the block.
+ */
+vector<uint8_t> reference_mipmap(const vector<uint8_t> &data,
+	unsigned int unit_size)
+{
+	const int F = LogicSegment::MipMapScaleFactor;
+
+	vector<uint8_t> level(data.size() / F / unit_size * unit_size);
+	for (uint64_t i = 0; i < level.size(); i++) {
+		const uint64_t sample = (i / unit_size) * F;
+		const unsigned int byte = i % unit_size;
+		for (int j = 0; j < F; j++) {
+			const uint8_t prev = (sample + j == 0) ? 0 :
+				data[(sample + j - 1) * unit_size + byte];
+			level[i] |= prev ^ data[(sample + j) * unit_size + byte];
+		}
+	}
+
+	return level;
+}
+
+/// Computes the next mip-map level, which ORs MipMapScaleFactor entries
+vector<uint8_t> reference_next_mipmap(const vector<uint8_t> &level,
+	unsigned int unit_size)
+{
+	const int F = LogicSegment::MipMapScaleFactor;
+
+	vector<uint8_t> next(level.size() / unit_size / F * unit_size);
+	for (uint64_t i = 0; i < next.size(); i++)
+		for (int j = 0; j < F; j++)
+			next[i] |= level[((i / unit_size) * F + j) * unit_size + i % unit_size];
+
+	return next;
+}
+
+struct Run
+{
+	vector<uint8_t> value;
+	uint64_t count;
+};
+
+/**
+ * Generates runs that start and end at all positions relative to the
+ * downsample blocks, among them runs that fill several data chunks and a
+ * whole chunk of the first mip-map level. Some runs repeat the value of
+ * the run before them.
+ */
+vector<Run> make_run_list(unsigned int unit_size)
+{
+	static const uint64_t Counts[] = {1, 2, 15, 16, 17, 1, 255, 4097, 65536,
+		3, 1048576 + 7, 16, 1, 300000};
+
+	vector<Run> runs;
+	vector<uint8_t> value(unit_size, 0);
+
+	uint32_t seed = 1;
+	for (size_t i = 0; i < countof(Counts); i++) {
+		if (i % 5 != 4)
+			for (uint8_t &b : value) {
+				seed = seed * 1103515245 + 12345;
+				b = seed >> 16;
+			}
+
+		runs.push_back({value, Counts[i]});
+	}
+
+	return runs;
+}
+
+vector<uint8_t> expand_runs(const vector<Run> &runs)
+{
+	vector<uint8_t> data;
+	for (const Run &run : runs)
+		for (uint64_t i = 0; i < run.count; i++)
+			data.insert(data.end(), run.value.begin(), run.value.end());
+
+	return data;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(LogicSegmentReceiveTest)
+
+BOOST_AUTO_TEST_CASE(PartialSamples)
+{
+	Logic logic(24);
+	shared_ptr<LogicSegment> s = make_shared<LogicSegment>(logic, 0, 3, 1);
+
+	// Samples are split across reads in every possible way
+	const vector<uint8_t> data = make_data(3 * 1000 + 2);
+	unsigned int partial_bytes = 0;
+	receive(*s, data, {1, 2, 4, 5, 7, 1, 1}, partial_bytes);
+
+	BOOST_CHECK_EQUAL(partial_bytes, 2);
+	check_samples(*s, data);
+}
+
+BOOST_AUTO_TEST_CASE(FullChunks)
+{
+	Logic logic(24);
+	shared_ptr<LogicSegment> s = make_shared<LogicSegment>(logic, 0, 3, 1);
+
+	// The data spans several chunks and reads end one byte before the end
+	// of a chunk, so that the incomplete sample must be completed there
+	// before the next chunk is started
+	const vector<uint8_t> data = make_data(3 * 300000 + 1);
+	unsigned int partial_bytes = 0;
+	receive(*s, data, {0, 1, 1000, 0, 2, 65536, 0}, partial_bytes);
+
+	BOOST_CHECK_EQUAL(partial_bytes, 1);
+	check_samples(*s, data);
+}
+
+BOOST_AUTO_TEST_CASE(NothingReceived)
+{
+	Logic logic(8);
+	shared_ptr<LogicSegment> s = make_shared<LogicSegment>(logic, 0, 2, 1);
+
+	unsigned int partial_bytes = 0;
+	const vector<uint8_t> data = make_data(3);
+	receive(*s, data, {3}, partial_bytes);
+	BOOST_CHECK_EQUAL(partial_bytes, 1);
+
+	// End of stream and errors are passed through without changes
+	BOOST_CHECK_EQUAL(s->append_received(
+		[](uint8_t*, uint64_t) -> int64_t { return 0; }, partial_bytes), 0);
+	BOOST_CHECK_EQUAL(s->append_received(
+		[](uint8_t*, uint64_t) -> int64_t { return -1; }, partial_bytes), -1);
+
+	BOOST_CHECK_EQUAL(partial_bytes, 1);
+	BOOST_CHECK_EQUAL(s->get_sample_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(LogicSegmentWideTest)
+
+BOOST_AUTO_TEST_CASE(Edges)
+{
+	for (const unsigned int unit_size : {9, 16}) {
+		Logic logic(unit_size * 8);
+		shared_ptr<LogicSegment> s =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+		shared_ptr<LogicSegment> single =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+
+		// Pieces that leave downsample blocks incomplete
+		const vector<uint8_t> data = make_runs(300000, unit_size);
+		append(*s, data, {1000, 1, 4097, 65536, 15, 17});
+		append(*single, data, {data.size() / unit_size});
+		check_samples(*s, data);
+
+		const int last = unit_size * 8 - 1;
+		for (const int sig_index : {0, 7, 8, 63, 64, 71, last}) {
+			check_edges(*s, data, sig_index, 0, 299999);
+			check_edges(*s, data, sig_index, 12345, 250000);
+			compare_edges(*s, *single, sig_index);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MipMapLevels)
+{
+	for (const unsigned int unit_size : {9, 16}) {
+		Logic logic(unit_size * 8);
+		shared_ptr<LogicSegment> s =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+
+		const vector<uint8_t> data = make_runs(300000, unit_size);
+		append(*s, data, {1000, 1, 4097, 65536, 15, 17});
+
+		vector<uint8_t> expected = reference_mipmap(data, unit_size);
+		for (unsigned int level = 0; level < LogicSegment::ScaleStepCount; level++) {
+			const LogicSegment::MipMapLevel &m = s->mip_map_[level];
+			BOOST_REQUIRE_EQUAL(m.length, expected.size() / unit_size);
+
+			bool match = true;
+			for (uint64_t offset = 0; offset < m.length; offset++)
+				match = match && std::equal(expected.begin() + offset * unit_size,
+					expected.begin() + (offset + 1) * unit_size,
+					s->get_mipmap_entry(m, offset));
+			BOOST_CHECK_MESSAGE(match, "level " << level);
+
+			expected = reference_next_mipmap(expected, unit_size);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(LogicSegmentDownsampleTest)
+
+BOOST_AUTO_TEST_CASE(BlockBoundaries)
+{
+	// Pieces of N * MipMapScaleFactor +- 1 samples end one sample before or
+	// after a downsample block, so that the next piece either just completes
+	// the previous block or starts with one that is already complete. The
+	// data spans several data chunks, whose boundaries also split blocks
+	// unless the unit size is a power of two, and more than one chunk of the
+	// first mip-map level. Every sample width has its own downsample function.
+	const uint64_t F = LogicSegment::MipMapScaleFactor;
+	const vector<uint64_t> piece_sizes = {F - 1, F + 1, 2 * F - 1, 1,
+		4096 * F + 1, 4096 * F - 1, F + 1, 65536 * F - 1, F - 1, 2 * F + 1};
+
+	for (const unsigned int unit_size : {1, 2, 3, 4, 8}) {
+		Logic logic(unit_size * 8);
+		shared_ptr<LogicSegment> s =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+		shared_ptr<LogicSegment> single =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+
+		// Every byte toggles one of its bits in about every eighth sample, so
+		// that a block only changes a few bits and changes carried over from
+		// another block don't go unnoticed
+		const uint64_t sample_count = 1300000;
+		vector<uint8_t> data(sample_count * unit_size);
+		uint32_t seed = 1;
+		for (uint64_t i = 1; i < sample_count; i++)
+			for (unsigned int b = 0; b < unit_size; b++) {
+				seed = seed * 1103515245 + 12345;
+				const uint8_t toggle = ((seed >> 16) % 8 == 0) ?
+					(1 << ((seed >> 24) % 8)) : 0;
+				data[i * unit_size + b] = data[(i - 1) * unit_size + b] ^ toggle;
+			}
+
+		append(*s, data, piece_sizes);
+		append(*single, data, {sample_count});
+		check_samples(*s, data);
+
+		// The mip-maps must not depend on how the samples were appended
+		vector<uint8_t> expected = reference_mipmap(data, unit_size);
+		for (unsigned int level = 0; level < LogicSegment::ScaleStepCount; level++) {
+			for (const shared_ptr<LogicSegment> &segment : {s, single}) {
+				const LogicSegment::MipMapLevel &m = segment->mip_map_[level];
+				BOOST_REQUIRE_EQUAL(m.length, expected.size() / unit_size);
+
+				bool match = true;
+				for (uint64_t offset = 0; offset < m.length; offset++)
+					match = match && std::equal(expected.begin() + offset * unit_size,
+						expected.begin() + (offset + 1) * unit_size,
+						segment->get_mipmap_entry(m, offset));
+				BOOST_CHECK_MESSAGE(match, "unit size " << unit_size <<
+					", level " << level);
+			}
+
+			expected = reference_next_mipmap(expected, unit_size);
+		}
+
+		const uint64_t end = sample_count - 1;
+		for (const int sig_index : {0, 4, std::min((int)unit_size * 8 - 1, 20)}) {
+			check_edges(*s, data, sig_index, 0, end);
+			check_edges(*s, data, sig_index, F * 65536 - 1, F * 65536 + 17);
+			compare_edges(*s, *single, sig_index);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(LogicSegmentRunTest)
+
+BOOST_AUTO_TEST_CASE(Runs)
+{
+	for (const unsigned int unit_size : {1, 2, 3, 8, 9}) {
+		Logic logic(unit_size * 8);
+		shared_ptr<LogicSegment> s =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+		shared_ptr<LogicSegment> payload =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+
+		const vector<Run> runs = make_run_list(unit_size);
+		for (const Run &run : runs)
+			s->append_run(run.value.data(), run.count);
+
+		// Empty runs don't change anything
+		s->append_run(runs.front().value.data(), 0);
+
+		const vector<uint8_t> data = expand_runs(runs);
+		append(*payload, data, {data.size() / unit_size});
+		check_samples(*s, data);
+
+		const uint64_t end = data.size() / unit_size - 1;
+		const int last = unit_size * 8 - 1;
+		for (const int sig_index : {0, 7, last}) {
+			check_edges(*s, data, sig_index, 0, end);
+			check_edges(*s, data, sig_index, 70000, 1200000);
+			compare_edges(*s, *payload, sig_index);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MixedWithPayload)
+{
+	// Runs that start inside blocks which were partly filled by
+	// append_payload() and the other way round
+	for (const unsigned int unit_size : {1, 3, 9}) {
+		Logic logic(unit_size * 8);
+		shared_ptr<LogicSegment> s =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+		shared_ptr<LogicSegment> payload =
+			make_shared<LogicSegment>(logic, 0, unit_size, 1);
+
+		const vector<Run> runs = make_run_list(unit_size);
+		for (size_t i = 0; i < runs.size(); i++)
+			if (i % 2)
+				append(*s, expand_runs({runs[i]}), {7, 4096});
+			else
+				s->append_run(runs[i].value.data(), runs[i].count);
+
+		const vector<uint8_t> data = expand_runs(runs);
+		append(*payload, data, {data.size() / unit_size});
+		check_samples(*s, data);
+
+		const uint64_t end = data.size() / unit_size - 1;
+		for (const int sig_index : {0, 5, (int)unit_size * 8 - 1}) {
+			check_edges(*s, data, sig_index, 0, end);
+			compare_edges(*s, *payload, sig_index);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 #if 0
 BOOST_AUTO_TEST_SUITE(LogicSegmentTest)
 
@@ -20,13 +20,57 @@
 
 #include <extdef.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
 #include <pv/data/segment.hpp>
 
 using pv::data::Segment;
+using std::max;
+using std::min;
+using std::vector;
+
+namespace {
+
+/**
+ * Returns the first sample of every data chunk that holds any of
+ * @a sample_count samples. The chunks start at MinChunkSize and double in
+ * size until they reach the size of MaxChunkSize rounded down to whole
+ * samples.
+ */
+vector<uint64_t> chunk_starts(uint64_t min_chunk_size, uint64_t max_chunk_size,
+	unsigned int unit_size, uint64_t sample_count)
+{
+	const uint64_t full_chunk_size = (max_chunk_size / unit_size) * unit_size;
+
+	vector<uint64_t> starts = {0};
+	uint64_t size = min_chunk_size;
+	while (starts.back() < sample_count) {
+		const uint64_t samples = (size < full_chunk_size) ?
+			max(size / unit_size, (uint64_t)1) : full_chunk_size / unit_size;
+		starts.push_back(starts.back() + samples);
+		size *= 2;
+	}
+	starts.pop_back();
+
+	return starts;
+}
+
+vector<uint8_t> make_data(unsigned int unit_size, uint64_t sample_count)
+{
+	// 251 is prime, so an offset of whole samples always shows
+	vector<uint8_t> data(unit_size * sample_count);
+	for (uint64_t i = 0; i < data.size(); i++)
+		data[i] = i % 251;
+
+	return data;
+}
+
+}  // namespace
 
 BOOST_AUTO_TEST_SUITE(SegmentTest)
 
@@ -215,10 +259,12 @@ BOOST_AUTO_TEST_CASE(MaxSize32Multi)
 {
 	Segment s(0, 1, sizeof(uint32_t));
 
-	// Chunk size is num*unit_size, so with pv::data::Segment::MaxChunkSize/unit_size, we reach the maximum size
+	// The chunks double in size from MinChunkSize up to MaxChunkSize, so twice
+	// MaxChunkSize worth of samples fills all smaller chunks and a part of
+	// the first full-size one
 	uint32_t num_samples = 2*(pv::data::Segment::MaxChunkSize / sizeof(uint32_t));
 
-	//----- Chunk size == pv::data::Segment::MaxChunkSize @ 32bit, added in num_samples calls ----//
+	//----- Samples @ 32bit, added in num_samples calls ----//
 	uint32_t data;
 	for (uint32_t i = 0; i < num_samples; i++) {
 		data = i;
@@ -244,7 +290,8 @@ BOOST_AUTO_TEST_CASE(MaxSize32MultiAtOnce)
 {
 	Segment s(0, 1, sizeof(uint32_t));
 
-	// Chunk size is num*unit_size, so with pv::data::Segment::MaxChunkSize/unit_size, we reach the maximum size
+	// Three times MaxChunkSize worth of samples fills all smaller chunks, the
+	// first full-size chunk and a part of the second one
 	uint32_t num_samples = 3*(pv::data::Segment::MaxChunkSize / sizeof(uint32_t));
 
 	//----- Add all samples, requiring multiple chunks, in one call ----//
@@ -274,10 +321,12 @@ BOOST_AUTO_TEST_CASE(MaxSize32MultiIterated)
 {
 	Segment s(0, 1, sizeof(uint32_t));
 
-	// Chunk size is num*unit_size, so with pv::data::Segment::MaxChunkSize/unit_size, we reach the maximum size
+	// The chunks double in size from MinChunkSize up to MaxChunkSize, so twice
+	// MaxChunkSize worth of samples fills all smaller chunks and a part of
+	// the first full-size one
 	uint32_t num_samples = 2*(pv::data::Segment::MaxChunkSize / sizeof(uint32_t));
 
-	//----- Chunk size == pv::data::Segment::MaxChunkSize @ 32bit, added in num_samples calls ----//
+	//----- Samples @ 32bit, added in num_samples calls ----//
 	uint32_t data;
 	for (uint32_t i = 0; i < num_samples; i++) {
 		data = i;
@@ -296,4 +345,95 @@ BOOST_AUTO_TEST_CASE(MaxSize32MultiIterated)
 	s.end_sample_iteration(it);
 }
 
+BOOST_AUTO_TEST_CASE(RampChunks)
+{
+	// Unit sizes that don't divide the chunk sizes leave chunks that aren't
+	// completely used, so every boundary must be located by its sample
+	for (const unsigned int unit_size : {1, 3, 4, 7}) {
+		Segment s(0, 1, unit_size);
+
+		const uint64_t num_samples = 3 * (Segment::MaxChunkSize / unit_size);
+		const vector<uint8_t> data = make_data(unit_size, num_samples);
+		const vector<uint64_t> starts = chunk_starts(Segment::MinChunkSize,
+			Segment::MaxChunkSize, unit_size, num_samples);
+
+		// Append in pieces that don't line up with any chunk boundary
+		for (uint64_t i = 0; i < num_samples; i += 100003)
+			s.append_samples((void*)&data[i * unit_size],
+				min((uint64_t)100003, num_samples - i));
+
+		BOOST_REQUIRE_EQUAL(s.get_sample_count(), num_samples);
+		BOOST_REQUIRE_EQUAL(s.data_chunks_.size(), starts.size());
+		for (size_t c = 0; c + 1 < starts.size(); c++)
+			BOOST_CHECK_EQUAL(s.chunk_capacity(c), starts[c + 1] - starts[c]);
+
+		// Single samples and short ranges on both sides of every boundary
+		vector<uint8_t> sample_data(5 * unit_size);
+		for (size_t c = 1; c < starts.size(); c++)
+			for (uint64_t start = starts[c] - 2; start <= starts[c]; start++) {
+				const uint64_t count = min((uint64_t)5, num_samples - start);
+				s.get_raw_samples(start, count, sample_data.data());
+				BOOST_CHECK_MESSAGE(std::equal(sample_data.begin(),
+					sample_data.begin() + count * unit_size,
+					data.begin() + start * unit_size),
+					"unit size " << unit_size << ", chunk " << c <<
+					", sample " << start);
+				BOOST_CHECK(memcmp(s.get_raw_sample(start),
+					&data[start * unit_size], unit_size) == 0);
+			}
+
+		// All samples at once
+		vector<uint8_t> all(data.size());
+		s.get_raw_samples(0, num_samples, all.data());
+		BOOST_CHECK(all == data);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(RampIteration)
+{
+	for (const unsigned int unit_size : {1, 3, 4, 7}) {
+		Segment s(0, 1, unit_size);
+
+		const uint64_t num_samples = 3 * (Segment::MaxChunkSize / unit_size);
+		const vector<uint8_t> data = make_data(unit_size, num_samples);
+		const vector<uint64_t> starts = chunk_starts(Segment::MinChunkSize,
+			Segment::MaxChunkSize, unit_size, num_samples);
+
+		s.append_samples((void*)data.data(), num_samples);
+		BOOST_REQUIRE_EQUAL(s.get_sample_count(), num_samples);
+
+		// Iterate chunk by chunk, each of which must end at the next boundary
+		pv::data::SegmentDataIterator* it = s.begin_sample_iteration(0);
+		for (size_t c = 0; c < starts.size(); c++) {
+			BOOST_REQUIRE_EQUAL(it->sample_index, starts[c]);
+
+			const uint64_t length = s.get_iterator_valid_length(it);
+			if (c + 1 < starts.size())
+				BOOST_CHECK_EQUAL(length, starts[c + 1] - starts[c]);
+
+			const uint64_t count = min(length, num_samples - starts[c]);
+			BOOST_CHECK_MESSAGE(memcmp(s.get_iterator_value(it),
+				&data[starts[c] * unit_size], count * unit_size) == 0,
+				"unit size " << unit_size << ", chunk " << c);
+
+			if (c + 1 < starts.size())
+				s.continue_sample_iteration(it, count);
+		}
+		s.end_sample_iteration(it);
+
+		// Step one sample at a time across every boundary
+		for (size_t c = 1; c < starts.size(); c++) {
+			it = s.begin_sample_iteration(starts[c] - 2);
+			for (uint64_t i = starts[c] - 2; i < min(starts[c] + 2, num_samples); i++) {
+				BOOST_CHECK_MESSAGE(memcmp(s.get_iterator_value(it),
+					&data[i * unit_size], unit_size) == 0,
+					"unit size " << unit_size << ", sample " << i);
+				if (i + 1 < num_samples)
+					s.continue_sample_iteration(it, 1);
+			}
+			s.end_sample_iteration(it);
+		}
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
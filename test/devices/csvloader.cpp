@@ -0,0 +1,252 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <glibmm/variant.h>
+
+#include <QTemporaryFile>
+
+#include <pv/devices/csvloader.hpp>
+
+#include "test/devices/testsink.hpp"
+
+using std::atomic;
+using std::map;
+using std::string;
+using std::to_string;
+using std::unique_ptr;
+using std::vector;
+
+using pv::devices::CsvLoader;
+using pv::devices::FileLoader;
+
+namespace {
+
+void write_file(QTemporaryFile &file, const string &text)
+{
+	BOOST_REQUIRE(file.open());
+	BOOST_REQUIRE_EQUAL(file.write(text.c_str(), text.size()), (qint64)text.size());
+	BOOST_REQUIRE(file.flush());
+}
+
+void load(FileLoader &loader, TestSink &sink)
+{
+	const atomic<bool> interrupt(false);
+
+	loader.read_header();
+	loader.run(sink, interrupt);
+
+	BOOST_CHECK(sink.ended);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(CsvLoaderTest)
+
+BOOST_AUTO_TEST_CASE(ParseNumber)
+{
+	const auto parse = [](const char *text) {
+		return CsvLoader::parse_number(text, text + strlen(text)); };
+
+	BOOST_CHECK_EQUAL(parse("0"), 0.0);
+	BOOST_CHECK_EQUAL(parse("42"), 42.0);
+	BOOST_CHECK_EQUAL(parse("0.1"), 0.1);
+	BOOST_CHECK_EQUAL(parse("123.456"), 123.456);
+	BOOST_CHECK_EQUAL(parse(".5"), 0.5);
+	BOOST_CHECK_EQUAL(parse("5."), 5.0);
+
+	// Signs
+	BOOST_CHECK_EQUAL(parse("-0.5"), -0.5);
+	BOOST_CHECK_EQUAL(parse("+7"), 7.0);
+
+	// Leading zeros don't count as significant digits
+	BOOST_CHECK_EQUAL(parse("000123"), 123.0);
+	BOOST_CHECK_EQUAL(parse("0.000123"), 0.000123);
+	BOOST_CHECK_EQUAL(parse("00000000000000000000000000001.5"), 1.5);
+
+	// More than 19 significant digits
+	BOOST_CHECK_CLOSE(parse("12345678901234567890123"), 1.2345678901234567890123e22, 1e-12);
+	BOOST_CHECK_CLOSE(parse("1.2345678901234567890123"), 1.2345678901234567890123, 1e-12);
+
+	// Exponents
+	BOOST_CHECK_EQUAL(parse("1.5e3"), 1500.0);
+	BOOST_CHECK_EQUAL(parse("1.5E+3"), 1500.0);
+	BOOST_CHECK_EQUAL(parse("-2E-2"), -0.02);
+	BOOST_CHECK_EQUAL(parse("25e-1"), 2.5);
+
+	// Exponents without an exact power of ten, special values and other
+	// formats are left to strtod()
+	BOOST_CHECK_EQUAL(parse("1e-27"), strtod("1e-27", nullptr));
+	BOOST_CHECK_EQUAL(parse("4.9e-324"), strtod("4.9e-324", nullptr));
+	BOOST_CHECK_EQUAL(parse("1.7976931348623157e308"), 1.7976931348623157e308);
+	BOOST_CHECK(std::isinf(parse("1e400")));
+	BOOST_CHECK(std::isinf(parse("-inf")));
+	BOOST_CHECK(std::isnan(parse("nan")));
+	BOOST_CHECK_EQUAL(parse("0x10"), 16.0);
+	BOOST_CHECK_EQUAL(parse("1e"), 1.0);
+	BOOST_CHECK_EQUAL(parse("-"), 0.0);
+	BOOST_CHECK_EQUAL(parse("abc"), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(ParseColumnFormats)
+{
+	CsvLoader loader("", 1, 0, 1, false, 0, ',', ";");
+
+	BOOST_REQUIRE(loader.parse_column_formats("t,2a,-,3l"));
+	BOOST_REQUIRE_EQUAL(loader.columns_.size(), 7);
+	BOOST_CHECK(loader.columns_[0].type == CsvLoader::TimestampColumn);
+	BOOST_CHECK(loader.columns_[1].type == CsvLoader::AnalogColumn);
+	BOOST_CHECK(loader.columns_[2].type == CsvLoader::AnalogColumn);
+	BOOST_CHECK(loader.columns_[3].type == CsvLoader::IgnoredColumn);
+	for (size_t i = 4; i < 7; i++)
+		BOOST_CHECK(loader.columns_[i].type == CsvLoader::LogicColumn);
+
+	// Analog columns may specify their number of significant digits, which
+	// must not be taken as the count of the next column
+	BOOST_REQUIRE(loader.parse_column_formats(" 2a3 , a10,*,l "));
+	BOOST_REQUIRE_EQUAL(loader.columns_.size(), 5);
+	BOOST_CHECK(loader.columns_[0].type == CsvLoader::AnalogColumn);
+	BOOST_CHECK(loader.columns_[1].type == CsvLoader::AnalogColumn);
+	BOOST_CHECK(loader.columns_[2].type == CsvLoader::AnalogColumn);
+	BOOST_CHECK(loader.columns_[3].type == CsvLoader::IgnoredColumn);
+	BOOST_CHECK(loader.columns_[4].type == CsvLoader::LogicColumn);
+
+	BOOST_CHECK(loader.parse_column_formats("16l"));
+	BOOST_CHECK_EQUAL(loader.columns_.size(), 16);
+
+	// Multi-bit columns and malformed lists are rejected
+	BOOST_CHECK(!loader.parse_column_formats(""));
+	BOOST_CHECK(!loader.parse_column_formats("b"));
+	BOOST_CHECK(!loader.parse_column_formats("8x"));
+	BOOST_CHECK(!loader.parse_column_formats("a,l x"));
+}
+
+BOOST_AUTO_TEST_CASE(Header)
+{
+	QTemporaryFile file;
+	write_file(file,
+		"; Leading comment\n"
+		"time,a,b,c\n"
+		"0.000,1.5,1,0\n"
+		"0.001, 2.5 ,0,1\r\n"
+		"; A comment between the samples\n"
+		"\n"
+		"0.002,-3e0,1,1");
+
+	map<string, Glib::VariantBase> options;
+	options["column_formats"] = Glib::Variant<Glib::ustring>::create("t,a,2l");
+	options["header"] = Glib::Variant<bool>::create(true);
+
+	unique_ptr<FileLoader> loader =
+		FileLoader::create("csv", file.fileName().toStdString(), options);
+	BOOST_REQUIRE(loader);
+
+	TestSink sink(2, 1);
+	load(*loader, sink);
+
+	// The logic channels come first and the names are taken from the header
+	BOOST_REQUIRE_EQUAL(loader->channels().size(), 3);
+	BOOST_CHECK_EQUAL(loader->channels()[0].name, "b");
+	BOOST_CHECK_EQUAL(loader->channels()[1].name, "c");
+	BOOST_CHECK_EQUAL(loader->channels()[2].name, "a");
+
+	// The samplerate follows from the first two timestamps
+	BOOST_CHECK_EQUAL(sink.samplerate, 1000);
+
+	const vector<uint8_t> expected_logic = {1, 2, 3};
+	const vector<uint8_t> logic = sink.logic_samples();
+	BOOST_CHECK_EQUAL_COLLECTIONS(logic.begin(), logic.end(),
+		expected_logic.begin(), expected_logic.end());
+
+	const vector<float> expected_analog = {1.5f, 2.5f, -3.0f};
+	const vector<float> analog = sink.analog_samples(0);
+	BOOST_CHECK_EQUAL_COLLECTIONS(analog.begin(), analog.end(),
+		expected_analog.begin(), expected_analog.end());
+
+	// A given samplerate takes precedence
+	options["samplerate"] = Glib::Variant<guint64>::create(5000);
+	unique_ptr<FileLoader> rate_loader =
+		FileLoader::create("csv", file.fileName().toStdString(), options);
+	BOOST_REQUIRE(rate_loader);
+
+	TestSink rate_sink(2, 1);
+	load(*rate_loader, rate_sink);
+	BOOST_CHECK_EQUAL(rate_sink.samplerate, 5000);
+
+	// Multi-bit values in a single column are left to libsigrok
+	options["single_column"] = Glib::Variant<gint32>::create(1);
+	BOOST_CHECK(!FileLoader::create("csv", file.fileName().toStdString(), options));
+}
+
+BOOST_AUTO_TEST_CASE(MultiBlock)
+{
+	string text;
+	vector<uint8_t> expected_logic;
+	vector<float> expected_analog;
+	for (int i = 0; i < 1000; i++) {
+		text += to_string(i) + ".5," + to_string(i % 2) + "," +
+			to_string((i / 2) % 2) + "\n";
+		expected_analog.push_back(i + 0.5f);
+		expected_logic.push_back((i % 2) | (((i / 2) % 2) << 1));
+	}
+
+	QTemporaryFile file;
+	write_file(file, text);
+
+	CsvLoader loader(file.fileName().toStdString(), 1, 0, 1, false, 0, ',', ";");
+	BOOST_REQUIRE(loader.parse_column_formats("a,2l"));
+	loader.block_size_ = 64;
+
+	TestSink sink(2, 1);
+	load(loader, sink);
+	BOOST_CHECK(sink.appended_count > 1);
+
+	CsvLoader single_loader(file.fileName().toStdString(), 1, 0, 1, false, 0, ',', ";");
+	BOOST_REQUIRE(single_loader.parse_column_formats("a,2l"));
+
+	TestSink single_sink(2, 1);
+	load(single_loader, single_sink);
+	BOOST_CHECK_EQUAL(single_sink.appended_count, 1);
+
+	// Both must match each other and the expected samples
+	const vector<uint8_t> logic = sink.logic_samples();
+	const vector<uint8_t> single_logic = single_sink.logic_samples();
+	BOOST_CHECK_EQUAL_COLLECTIONS(logic.begin(), logic.end(),
+		single_logic.begin(), single_logic.end());
+	BOOST_CHECK_EQUAL_COLLECTIONS(logic.begin(), logic.end(),
+		expected_logic.begin(), expected_logic.end());
+
+	const vector<float> analog = sink.analog_samples(0);
+	const vector<float> single_analog = single_sink.analog_samples(0);
+	BOOST_CHECK_EQUAL_COLLECTIONS(analog.begin(), analog.end(),
+		single_analog.begin(), single_analog.end());
+	BOOST_CHECK_EQUAL_COLLECTIONS(analog.begin(), analog.end(),
+		expected_analog.begin(), expected_analog.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <pv/devices/streamdevice.hpp>
+
+#include "test/devices/testsink.hpp"
+
+using std::min;
+using std::string;
+using std::vector;
+
+using pv::devices::StreamDevice;
+
+namespace {
+
+const size_t PieceSize = 7;
+
+/**
+ * A front-end that listens on a Unix domain socket and sends one of the
+ * given streams to each connection it accepts. The streams are sent in
+ * small pieces, so the samples arrive split across several reads.
+ */
+class StreamServer
+{
+public:
+	StreamServer(const vector<string> &streams) :
+		path_(QDir(dir_.path()).filePath("stream").toStdString()),
+		fd_(::socket(AF_UNIX, SOCK_STREAM, 0))
+	{
+		BOOST_REQUIRE(fd_ >= 0);
+
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		BOOST_REQUIRE(path_.size() < sizeof(addr.sun_path));
+		memcpy(addr.sun_path, path_.c_str(), path_.size());
+
+		BOOST_REQUIRE(::bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+		BOOST_REQUIRE(::listen(fd_, 1) == 0);
+
+		thread_ = std::thread([this, streams]() {
+			for (const string& stream : streams) {
+				const int fd = ::accept(fd_, nullptr, nullptr);
+				if (fd < 0)
+					return;
+
+				for (size_t offset = 0; offset < stream.size(); offset += PieceSize)
+					if (::send(fd, stream.data() + offset,
+						min(PieceSize, stream.size() - offset), MSG_NOSIGNAL) < 0)
+						break;
+
+				::close(fd);
+			}
+		});
+	}
+
+	~StreamServer()
+	{
+		// Makes accept() return if not all streams were requested
+		::shutdown(fd_, SHUT_RDWR);
+		thread_.join();
+		::close(fd_);
+	}
+
+	const string& path() const
+	{
+		return path_;
+	}
+
+private:
+	QTemporaryDir dir_;
+	const string path_;
+	const int fd_;
+	std::thread thread_;
+};
+
+void append_le(string &s, uint64_t value, unsigned int size)
+{
+	for (unsigned int i = 0; i < size; i++)
+		s += (char)(value >> (8 * i));
+}
+
+string header(uint32_t version, uint64_t samplerate, uint32_t unit_size,
+	const vector<string> &names, uint32_t channel_count)
+{
+	string s = "PVSTREAM";
+	append_le(s, version, 4);
+	append_le(s, samplerate, 8);
+	append_le(s, unit_size, 4);
+	append_le(s, channel_count, 4);
+
+	for (const string& name : names) {
+		append_le(s, name.size(), 4);
+		s += name;
+	}
+
+	return s;
+}
+
+string header(uint64_t samplerate, uint32_t unit_size, const vector<string> &names)
+{
+	return header(1, samplerate, unit_size, names, names.size());
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(StreamDeviceTest)
+
+BOOST_AUTO_TEST_CASE(Samples)
+{
+	vector<string> names = {"CLK", "DATA"};
+	names.resize(10);
+
+	// The last sample is incomplete and must be dropped
+	string samples;
+	for (int i = 0; i < 1000; i++)
+		append_le(samples, (i * 37) & 0x3FF, 2);
+
+	StreamServer server({header(1000000, 2, names) + samples + "x"});
+
+	StreamDevice device(nullptr, server.path());
+	TestSink sink(10, 0);
+	device.set_data_sink(&sink);
+
+	// Reads the header, then runs until the front-end closes the stream
+	device.run();
+
+	BOOST_CHECK_EQUAL(device.samplerate_, 1000000);
+	BOOST_CHECK_EQUAL(device.unit_size_, 2);
+	BOOST_REQUIRE_EQUAL(device.channel_names_.size(), 10);
+	BOOST_CHECK_EQUAL(device.channel_names_[0], "CLK");
+	BOOST_CHECK_EQUAL(device.channel_names_[1], "DATA");
+	BOOST_CHECK_EQUAL(device.channel_names_[2], "D2");
+	BOOST_CHECK_EQUAL(device.channel_names_[9], "D9");
+
+	BOOST_CHECK(sink.ended);
+	BOOST_CHECK(sink.appended_count > 0);
+	BOOST_CHECK_EQUAL(sink.samplerate, 1000000);
+	BOOST_CHECK_EQUAL(device.fd_, -1);
+
+	BOOST_REQUIRE_EQUAL(sink.logic->logic_segments().size(), 1);
+	BOOST_CHECK(sink.logic->logic_segments().front()->is_complete());
+
+	const vector<uint8_t> received = sink.logic_samples();
+	BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+		(const uint8_t*)samples.data(), (const uint8_t*)samples.data() + samples.size());
+}
+
+BOOST_AUTO_TEST_CASE(WideSamples)
+{
+	// More channels than fit into 64 bits
+	const unsigned int unit_size = 13;
+	vector<string> names(100);
+
+	string samples;
+	for (int i = 0; i < 300; i++)
+		for (unsigned int b = 0; b < unit_size; b++)
+			samples += (char)((i * 11 + b * 29) & ((b < 12) ? 0xFF : 0x0F));
+
+	StreamServer server({header(0, unit_size, names) + samples});
+
+	StreamDevice device(nullptr, server.path());
+	TestSink sink(100, 0);
+	device.set_data_sink(&sink);
+
+	device.run();
+
+	BOOST_CHECK_EQUAL(device.unit_size_, unit_size);
+	BOOST_REQUIRE_EQUAL(device.channel_names_.size(), 100);
+	BOOST_CHECK_EQUAL(device.channel_names_[99], "D99");
+
+	const vector<uint8_t> received = sink.logic_samples();
+	BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+		(const uint8_t*)samples.data(), (const uint8_t*)samples.data() + samples.size());
+}
+
+BOOST_AUTO_TEST_CASE(HeaderErrors)
+{
+	string bad_magic = header(0, 1, {"A"});
+	bad_magic[7] = 'X';
+
+	const vector<string> streams = {
+		bad_magic,
+		header(2, 0, 1, {"A"}, 1),               // Unsupported version
+		header(1, 0, 0, {"A"}, 1),               // Unit size too small
+		header(1, 0, 65, {"A"}, 1),              // Unit size too large
+		header(1, 0, 1, {}, 0),                  // No channels
+		header(1, 0, 1, vector<string>(9), 9),   // Too many channels
+		header(0, 1, {string(257, 'A')}),        // Name too long
+		header(0, 1, {"A", "B"}).substr(0, 30)   // Stream ends within the header
+	};
+
+	StreamServer server(streams);
+	StreamDevice device(nullptr, server.path());
+
+	for (size_t i = 0; i < streams.size(); i++) {
+		BOOST_CHECK_THROW(device.connect_stream(), QString);
+		BOOST_CHECK_EQUAL(device.fd_, -1);
+	}
+
+	// The path must be a socket or a named pipe
+	StreamDevice missing(nullptr, server.path() + "-missing");
+	BOOST_CHECK_THROW(missing.connect_stream(), QString);
+
+	QTemporaryDir dir;
+	QFile file(dir.filePath("file"));
+	BOOST_REQUIRE(file.open(QIODevice::WriteOnly));
+	file.close();
+
+	StreamDevice regular_file(nullptr, file.fileName().toStdString());
+	BOOST_CHECK_THROW(regular_file.connect_stream(), QString);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelsChanged)
+{
+	StreamServer server({header(0, 1, {"A"}) + string("\x01\x00\x01", 3),
+		header(0, 1, {"B"}) + "\x01"});
+
+	StreamDevice device(nullptr, server.path());
+	TestSink sink(1, 0);
+	device.set_data_sink(&sink);
+
+	device.run();
+
+	const vector<uint8_t> expected = {1, 0, 1};
+	const vector<uint8_t> received = sink.logic_samples();
+	BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+		expected.begin(), expected.end());
+
+	// The next acquisition reconnects and must see the same channels
+	BOOST_CHECK_THROW(device.run(), QString);
+	BOOST_CHECK_EQUAL(device.fd_, -1);
+	BOOST_REQUIRE_EQUAL(device.channel_names_.size(), 1);
+	BOOST_CHECK_EQUAL(device.channel_names_[0], "A");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PULSEVIEW_TEST_DEVICES_TESTSINK_HPP
+#define PULSEVIEW_TEST_DEVICES_TESTSINK_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <pv/data/analog.hpp>
+#include <pv/data/analogsegment.hpp>
+#include <pv/data/logic.hpp>
+#include <pv/data/logicsegment.hpp>
+#include <pv/devices/datasink.hpp>
+
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+/**
+ * A DataSink that collects the samples in segments of its own, like
+ * Session does, so that the tests can check them.
+ */
+class TestSink : public pv::devices::DataSink
+{
+public:
+	TestSink(unsigned int logic_channels, unsigned int analog_channels) :
+		logic(logic_channels ? make_shared<pv::data::Logic>(logic_channels) : nullptr),
+		samplerate(0),
+		appended_count(0),
+		ended(false)
+	{
+		for (unsigned int i = 0; i < analog_channels; i++)
+			analog.push_back(make_shared<pv::data::Analog>());
+	}
+
+	void set_samplerate(uint64_t value) override
+	{
+		samplerate = value;
+	}
+
+	shared_ptr<pv::data::LogicSegment> begin_logic_segment(
+		unsigned int unit_size) override
+	{
+		if (!logic)
+			return nullptr;
+
+		shared_ptr<pv::data::LogicSegment> segment =
+			make_shared<pv::data::LogicSegment>(*logic,
+				logic->get_segment_count(), unit_size, samplerate);
+		logic->push_segment(segment);
+
+		return segment;
+	}
+
+	/// The analog channels follow the logic channels, as with the loaders
+	shared_ptr<pv::data::AnalogSegment> begin_analog_segment(
+		unsigned int channel_index) override
+	{
+		const unsigned int logic_count = logic ? logic->num_channels() : 0;
+		if ((channel_index < logic_count) ||
+			(channel_index - logic_count >= analog.size()))
+			return nullptr;
+
+		pv::data::Analog &data = *analog[channel_index - logic_count];
+		shared_ptr<pv::data::AnalogSegment> segment =
+			make_shared<pv::data::AnalogSegment>(data,
+				data.get_segment_count(), samplerate);
+		data.push_segment(segment);
+
+		return segment;
+	}
+
+	void samples_appended() override
+	{
+		appended_count++;
+	}
+
+	void end_segments() override
+	{
+		if (logic)
+			for (const shared_ptr<pv::data::LogicSegment>& s : logic->logic_segments())
+				s->set_complete();
+
+		for (const shared_ptr<pv::data::Analog>& a : analog)
+			for (const shared_ptr<pv::data::AnalogSegment>& s : a->analog_segments())
+				s->set_complete();
+
+		ended = true;
+	}
+
+	/// Returns the samples of the first logic segment, one byte per sample
+	vector<uint8_t> logic_samples() const
+	{
+		if (!logic || logic->logic_segments().empty())
+			return vector<uint8_t>();
+
+		const shared_ptr<pv::data::LogicSegment> s = logic->logic_segments().front();
+		vector<uint8_t> samples(s->get_sample_count() * s->unit_size());
+		if (!samples.empty())
+			s->get_samples(0, s->get_sample_count(), samples.data());
+
+		return samples;
+	}
+
+	/// Returns the samples of the first segment of an analog channel
+	vector<float> analog_samples(unsigned int index) const
+	{
+		if (analog[index]->analog_segments().empty())
+			return vector<float>();
+
+		const shared_ptr<pv::data::AnalogSegment> s =
+			analog[index]->analog_segments().front();
+		vector<float> samples(s->get_sample_count());
+		if (!samples.empty())
+			s->get_samples(0, s->get_sample_count(), samples.data());
+
+		return samples;
+	}
+
+public:
+	shared_ptr<pv::data::Logic> logic;
+	vector< shared_ptr<pv::data::Analog> > analog;
+
+	uint64_t samplerate;
+	unsigned int appended_count;
+	bool ended;
+};
+
+#endif // PULSEVIEW_TEST_DEVICES_TESTSINK_HPP
@@ -0,0 +1,223 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <QTemporaryFile>
+
+#include <pv/devices/vcdloader.hpp>
+
+#include "test/devices/testsink.hpp"
+
+using std::atomic;
+using std::string;
+using std::to_string;
+using std::vector;
+
+using pv::devices::VcdLoader;
+
+namespace {
+
+// Channel c shares its identifier with a, so only a receives the changes.
+// The sections in the body are skipped, including the values they contain.
+const char *const VcdText =
+	"$timescale 1 us $end\n"
+	"$comment Sections in the header $var wire 1 # d $end\n"
+	"$scope module top $end\n"
+	"$var wire 1 ! a $end\n"
+	"$var wire 1 \" b $end\n"
+	"$var wire 1 ! c $end\n"
+	"$upscope $end\n"
+	"$enddefinitions $end\n"
+	"#0\n"
+	"$dumpvars\n0!\n1\"\n$end\n"
+	"$comment 1! 0\" $end\n"
+	"#2\n1!\n"
+	"#5\n0\"\n"
+	"#6\n";
+
+void write_file(QTemporaryFile &file, const string &text)
+{
+	BOOST_REQUIRE(file.open());
+	BOOST_REQUIRE_EQUAL(file.write(text.c_str(), text.size()), (qint64)text.size());
+	BOOST_REQUIRE(file.flush());
+}
+
+vector<uint8_t> load(VcdLoader &loader, TestSink &sink)
+{
+	const atomic<bool> interrupt(false);
+
+	loader.read_header();
+	loader.run(sink, interrupt);
+
+	BOOST_CHECK(sink.ended);
+
+	return sink.logic_samples();
+}
+
+vector<uint8_t> load(const string &text, int64_t skip = -1,
+	int64_t downsample = 1, int64_t compress = 0)
+{
+	QTemporaryFile file;
+	write_file(file, text);
+
+	VcdLoader loader(file.fileName().toStdString(), 0, skip, downsample, compress);
+	TestSink sink(3, 0);
+
+	return load(loader, sink);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(VcdLoaderTest)
+
+BOOST_AUTO_TEST_CASE(Header)
+{
+	QTemporaryFile file;
+	write_file(file, VcdText);
+
+	VcdLoader loader(file.fileName().toStdString(), 0, -1, 1, 0);
+	loader.read_header();
+
+	BOOST_REQUIRE_EQUAL(loader.channels().size(), 3);
+	BOOST_CHECK_EQUAL(loader.channels()[0].name, "a");
+	BOOST_CHECK_EQUAL(loader.channels()[1].name, "b");
+	BOOST_CHECK_EQUAL(loader.channels()[2].name, "c");
+
+	// Only the requested number of channels is created
+	VcdLoader limited(file.fileName().toStdString(), 2, -1, 1, 0);
+	limited.read_header();
+	BOOST_CHECK_EQUAL(limited.channels().size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(Samples)
+{
+	QTemporaryFile file;
+	write_file(file, VcdText);
+
+	VcdLoader loader(file.fileName().toStdString(), 0, -1, 1, 0);
+	TestSink sink(3, 0);
+
+	const vector<uint8_t> expected = {2, 2, 3, 3, 3, 1};
+	const vector<uint8_t> samples = load(loader, sink);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		expected.begin(), expected.end());
+
+	BOOST_CHECK_EQUAL(sink.samplerate, 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(Skip)
+{
+	// Skip until the given timestamp
+	const vector<uint8_t> expected = {3, 3, 1};
+	const vector<uint8_t> samples = load(VcdText, 3);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		expected.begin(), expected.end());
+
+	// The samples before the first timestamp are only kept without skipping
+	const string text = string(VcdText).replace(string(VcdText).find("#0"), 2, "#1");
+
+	const vector<uint8_t> expected_unskipped = {0, 2, 3, 3, 3, 1};
+	const vector<uint8_t> unskipped = load(text, 0);
+	BOOST_CHECK_EQUAL_COLLECTIONS(unskipped.begin(), unskipped.end(),
+		expected_unskipped.begin(), expected_unskipped.end());
+
+	const vector<uint8_t> expected_skipped = {2, 3, 3, 3, 1};
+	const vector<uint8_t> skipped = load(text, -1);
+	BOOST_CHECK_EQUAL_COLLECTIONS(skipped.begin(), skipped.end(),
+		expected_skipped.begin(), expected_skipped.end());
+}
+
+BOOST_AUTO_TEST_CASE(Downsample)
+{
+	QTemporaryFile file;
+	write_file(file, VcdText);
+
+	VcdLoader loader(file.fileName().toStdString(), 0, -1, 2, 0);
+	TestSink sink(3, 0);
+
+	const vector<uint8_t> expected = {2, 3, 1};
+	const vector<uint8_t> samples = load(loader, sink);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		expected.begin(), expected.end());
+
+	BOOST_CHECK_EQUAL(sink.samplerate, 500000);
+
+	// The skip position is given in timestamps of the file
+	const vector<uint8_t> expected_skipped = {3, 1};
+	const vector<uint8_t> skipped = load(VcdText, 2, 2);
+	BOOST_CHECK_EQUAL_COLLECTIONS(skipped.begin(), skipped.end(),
+		expected_skipped.begin(), expected_skipped.end());
+}
+
+BOOST_AUTO_TEST_CASE(Compress)
+{
+	// Periods without changes are shortened to the compress length
+	const vector<uint8_t> expected = {2, 2, 3, 3, 1};
+	const vector<uint8_t> samples = load(VcdText, -1, 1, 2);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(BlockSplit)
+{
+	string text =
+		"$timescale 1 ns $end\n"
+		"$var wire 1 ! a $end\n"
+		"$enddefinitions $end\n";
+
+	vector<uint8_t> expected;
+	for (int i = 0; i < 200; i++) {
+		text += "#" + to_string(i * 3) + "\n" + to_string(i % 2) + "!\n";
+		if (i > 0)
+			expected.insert(expected.end(), 3, (i - 1) % 2);
+	}
+
+	QTemporaryFile file;
+	write_file(file, text);
+
+	VcdLoader loader(file.fileName().toStdString(), 0, -1, 1, 0);
+	loader.block_size_ = 16;
+	loader.read_header();
+
+	// Make sure that the body really is split into many blocks
+	const char *const first_block_end = loader.find_block_end(loader.body_);
+	BOOST_CHECK(first_block_end < loader.end_);
+	BOOST_CHECK_EQUAL(*first_block_end, '#');
+
+	TestSink sink(1, 0);
+	const vector<uint8_t> samples = load(loader, sink);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		expected.begin(), expected.end());
+
+	// The result must be the same as with a single block
+	QTemporaryFile single_file;
+	write_file(single_file, text);
+
+	VcdLoader single_loader(single_file.fileName().toStdString(), 0, -1, 1, 0);
+	TestSink single_sink(1, 0);
+	const vector<uint8_t> single_samples = load(single_loader, single_sink);
+	BOOST_CHECK_EQUAL_COLLECTIONS(samples.begin(), samples.end(),
+		single_samples.begin(), single_samples.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,268 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include <boost/version.hpp>
+#if BOOST_VERSION >= 107100 // 1.71 deprecated the old header location.
+#include <boost/test/tools/floating_point_comparison.hpp>
+#else
+#include <boost/test/floating_point_comparison.hpp>
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include "pv/views/spectrum/fft.hpp"
+
+using std::complex;
+using std::vector;
+
+using namespace pv::views::spectrum;
+
+namespace {
+	const uint32_t Sizes[] = {16, 64, 1024};
+
+	/// Returns the cosine window coefficient, as in FFT::create_window()
+	double window_coefficient(WindowType window, uint32_t n, uint32_t size)
+	{
+		const double x = 2 * M_PI * n / size;
+
+		switch (window) {
+		case WindowHann:
+			return 0.5 - 0.5 * cos(x);
+		case WindowHamming:
+			return 0.54 - 0.46 * cos(x);
+		case WindowBlackman:
+			return 0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x);
+		case WindowFlatTop:
+			return 0.21557895 - 0.41663158 * cos(x) + 0.277263158 * cos(2 * x) -
+				0.083578947 * cos(3 * x) + 0.006947368 * cos(4 * x);
+		default:
+			return 1;
+		}
+	}
+
+	/// Computes the expected power of each bin by a direct DFT in double
+	vector<double> reference_power(const vector<float> &input, WindowType window)
+	{
+		const uint32_t size = input.size();
+
+		double gain = 0;
+		vector<double> windowed(size);
+		for (uint32_t n = 0; n < size; n++) {
+			const double w = window_coefficient(window, n, size);
+			windowed[n] = input[n] * w;
+			gain += w;
+		}
+
+		vector<double> power(size / 2 + 1);
+		for (uint32_t k = 0; k <= size / 2; k++) {
+			complex<double> sum = 0;
+			for (uint32_t n = 0; n < size; n++)
+				sum += windowed[n] * std::polar(1.0, -2 * M_PI * k * n / size);
+
+			const double scale = ((k == 0) || (k == size / 2)) ? 1 : 2;
+			power[k] = std::norm(sum * scale / gain);
+		}
+
+		return power;
+	}
+
+	vector<float> tone(uint32_t size, uint32_t length, double cycles,
+		double amplitude, double phase = 0, double offset = 0)
+	{
+		vector<float> input(size, 0.0f);
+		for (uint32_t n = 0; n < length; n++)
+			input[n] = offset + amplitude * cos(2 * M_PI * cycles * n / size + phase);
+
+		return input;
+	}
+
+	vector<float> transform(FFT &fft, const vector<float> &input)
+	{
+		vector<float> power(fft.bin_count());
+		fft.transform(input.data(), power.data());
+
+		return power;
+	}
+};
+
+BOOST_AUTO_TEST_SUITE(FFTTest)
+
+BOOST_AUTO_TEST_CASE(BinCount)
+{
+	for (uint32_t size : Sizes) {
+		FFT fft(size, WindowHann);
+		BOOST_CHECK_EQUAL(fft.size(), size);
+		BOOST_CHECK_EQUAL(fft.bin_count(), size / 2 + 1);
+		BOOST_CHECK_EQUAL(fft.window(), WindowHann);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(BinCentredTones)
+{
+	// A tone at the centre of a bin only shows in that bin and its power is
+	// the squared amplitude, whatever the phase
+	for (uint32_t size : Sizes) {
+		FFT fft(size, WindowRectangular);
+
+		for (uint32_t k : {1u, 3u, size / 4 + 1, size / 2 - 1}) {
+			const vector<float> power =
+				transform(fft, tone(size, size, k, 2.0, 0.3 * k));
+
+			for (uint32_t i = 0; i < fft.bin_count(); i++) {
+				BOOST_CHECK_MESSAGE(fabs(power[i] - ((i == k) ? 4.0 : 0.0)) < 1e-4,
+					"size " << size << ", tone " << k << ", bin " << i <<
+					": " << power[i]);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DCAndNyquist)
+{
+	for (uint32_t size : Sizes) {
+		FFT fft(size, WindowRectangular);
+
+		// A constant offset only shows in the DC bin
+		vector<float> power = transform(fft, tone(size, size, 0, 0, 0, -1.5));
+		BOOST_CHECK_CLOSE(power[0], 2.25, 1e-3);
+		for (uint32_t i = 1; i < fft.bin_count(); i++)
+			BOOST_CHECK_SMALL(power[i], 1e-5f);
+
+		// Alternating samples only show in the Nyquist bin
+		power = transform(fft, tone(size, size, size / 2, 0.5));
+		BOOST_CHECK_CLOSE(power[size / 2], 0.25, 1e-3);
+		for (uint32_t i = 0; i < size / 2; i++)
+			BOOST_CHECK_SMALL(power[i], 1e-5f);
+
+		// Both at once, together with a tone
+		vector<float> input = tone(size, size, 5, 1.0, 0, 0.5);
+		for (uint32_t n = 0; n < size; n++)
+			input[n] += (n % 2) ? -0.25f : 0.25f;
+
+		power = transform(fft, input);
+		BOOST_CHECK_CLOSE(power[0], 0.25, 1e-3);
+		BOOST_CHECK_CLOSE(power[5], 1.0, 1e-3);
+		BOOST_CHECK_CLOSE(power[size / 2], 0.0625, 1e-3);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(WindowGain)
+{
+	// The peak of a bin-centred tone is corrected for the coherent gain of
+	// every window, while the neighbouring bins see the main lobe
+	for (int w = 0; w < WindowTypeCount; w++) {
+		const WindowType window = (WindowType)w;
+
+		for (uint32_t size : Sizes) {
+			FFT fft(size, window);
+			const uint32_t k = size / 4;
+
+			const vector<float> power = transform(fft, tone(size, size, k, 3.0));
+			BOOST_CHECK_CLOSE(power[k], 9.0, 1e-2);
+
+			for (uint32_t i = 0; i < fft.bin_count(); i++)
+				BOOST_CHECK(power[i] <= power[k] * (1 + 1e-4));
+
+			if (window == WindowRectangular)
+				BOOST_CHECK_SMALL(power[k + 1], 1e-4f);
+			else
+				BOOST_CHECK(power[k + 1] > 0.1);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MatchesDFT)
+{
+	// Tones between the bins, with an odd number of half cycles per frame,
+	// spread over all bins and must match a direct DFT
+	for (int w = 0; w < WindowTypeCount; w++) {
+		const WindowType window = (WindowType)w;
+
+		for (uint32_t size : Sizes) {
+			FFT fft(size, window);
+
+			vector<float> input = tone(size, size, 2.5, 1.0, 0.7, 0.1);
+			const vector<float> other = tone(size, size, size / 3 + 0.5, 0.5, 1.9);
+			for (uint32_t n = 0; n < size; n++)
+				input[n] += other[n];
+
+			const vector<float> power = transform(fft, input);
+			const vector<double> expected = reference_power(input, window);
+
+			for (uint32_t i = 0; i < fft.bin_count(); i++) {
+				BOOST_CHECK_MESSAGE(fabs(power[i] - expected[i]) < 1e-4,
+					"window " << WindowTypeNames[w] << ", size " << size <<
+					", bin " << i << ": " << power[i] << " != " << expected[i]);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PartialFrames)
+{
+	// Frames with an odd number of samples are zero-padded to the FFT size
+	for (int w = 0; w < WindowTypeCount; w++) {
+		const WindowType window = (WindowType)w;
+
+		for (uint32_t size : Sizes) {
+			FFT fft(size, window);
+
+			for (uint32_t length : {1u, size / 2 + 1, size - 1}) {
+				const vector<float> input = tone(size, length, 3, 1.0, 0.2, -0.3);
+
+				const vector<float> power = transform(fft, input);
+				const vector<double> expected = reference_power(input, window);
+
+				for (uint32_t i = 0; i < fft.bin_count(); i++) {
+					BOOST_CHECK_MESSAGE(fabs(power[i] - expected[i]) < 1e-4,
+						"window " << WindowTypeNames[w] << ", size " << size <<
+						", length " << length << ", bin " << i << ": " <<
+						power[i] << " != " << expected[i]);
+				}
+			}
+		}
+	}
+
+	// Almost a full frame of a bin-centred tone peaks in the same bin, with
+	// the power scaled by the share of the frame that holds samples, apart
+	// from a little leakage
+	FFT fft(1024, WindowRectangular);
+	const vector<float> power = transform(fft, tone(1024, 1023, 64, 1.0));
+	BOOST_CHECK_CLOSE(power[64], (1023.0 / 1024) * (1023.0 / 1024), 0.5);
+	for (uint32_t i = 0; i < fft.bin_count(); i++)
+		BOOST_CHECK(power[i] <= power[64]);
+}
+
+BOOST_AUTO_TEST_CASE(Reuse)
+{
+	// Transforming a frame doesn't depend on the frames before it
+	FFT fft(64, WindowBlackman);
+
+	const vector<float> input = tone(64, 64, 7, 1.0, 0.4);
+	const vector<float> first = transform(fft, input);
+	transform(fft, tone(64, 64, 20, 5.0));
+	const vector<float> second = transform(fft, input);
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(first.begin(), first.end(),
+		second.begin(), second.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()